@@ -0,0 +1,69 @@
+#include "bench_element.h"
+
+#include <algorithm>
+#include <wrl/client.h>
+
+namespace hmi_graphics
+{
+    namespace bench
+    {
+        namespace
+        {
+            constexpr int MIN_ELEMENT_SIZE = 16;
+            constexpr int MAX_ELEMENT_SIZE = 96;
+        }
+
+        BenchElement::BenchElement(uint32_t argb)
+            : argb_{argb}
+        {
+        }
+
+        void BenchElement::Render(System* parent)
+        {
+            Surface surface{};
+            if(GetSurface(&surface))
+            {
+                for(int y = 0; y < surface.height; ++y)
+                {
+                    std::fill_n(surface.pixels + static_cast<size_t>(y) * surface.stride, surface.width, argb_);
+                }
+
+                return;
+            }
+
+            Microsoft::WRL::ComPtr<ID2D1DeviceContext> context;
+            Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> brush;
+            if(!parent->GetDirect2dDeviceContext(&context) || !parent->GetCachedColorBrush(D2D1::ColorF(argb_ & 0xFFFFFF), &brush))
+                return;
+
+            if(!BeginDraw(context.Get()))
+                return;
+
+            auto size = GetSize();
+            context->FillRectangle(D2D1::RectF(0.f, 0.f, size.width, size.height), brush.Get());
+            EndDraw(context.Get());
+        }
+
+        ElementHandle AddSceneElement(System* system, Random* random)
+        {
+            const int width = MIN_ELEMENT_SIZE + random->NextInt(MAX_ELEMENT_SIZE - MIN_ELEMENT_SIZE);
+            const int height = MIN_ELEMENT_SIZE + random->NextInt(MAX_ELEMENT_SIZE - MIN_ELEMENT_SIZE);
+            auto* element = system->AddElement<BenchElement>(static_cast<int16_t>(width), static_cast<int16_t>(height),
+                0xFF000000u | (random->Next() & 0xFFFFFFu));
+            element->SetPosition(static_cast<int16_t>(random->NextInt(SCENE_WIDTH - width)),
+                static_cast<int16_t>(random->NextInt(SCENE_HEIGHT - height)));
+            element->SetZIndex(static_cast<int16_t>(random->NextInt(SCENE_Z_LEVELS)));
+            element->NotifyUpdated();
+            return element->GetHandle();
+        }
+
+        void PopulateScene(System* system, int count, Random* random, std::vector<ElementHandle>* handles)
+        {
+            handles->clear();
+            for(int i = 0; i < count; ++i)
+            {
+                handles->push_back(AddSceneElement(system, random));
+            }
+        }
+    }
+}
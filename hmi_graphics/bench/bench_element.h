@@ -0,0 +1,37 @@
+#ifndef HMI_GRAPHICS_BENCH_BENCH_ELEMENT_H
+#define HMI_GRAPHICS_BENCH_BENCH_ELEMENT_H
+
+#include <cstdint>
+#include <vector>
+#include <graphics/graphics_element.h>
+#include <graphics/graphics_system.h>
+#include "benchmark.h"
+
+namespace hmi_graphics
+{
+    namespace bench
+    {
+        constexpr int16_t SCENE_WIDTH = 1920;
+        constexpr int16_t SCENE_HEIGHT = 1080;
+        constexpr int16_t SCENE_Z_LEVELS = 16;
+
+        // Solid rectangle; fills the surface on the headless backend and draws with a cached brush on Direct3D.
+        class BenchElement: public GraphicsElement
+        {
+        public:
+            explicit BenchElement(uint32_t argb);
+
+            void Render(System* parent) override;
+
+        private:
+            uint32_t argb_;
+        };
+
+        // Adds an element with a random position, size, z-index and color inside the scene bounds.
+        ElementHandle AddSceneElement(System* system, Random* random);
+
+        void PopulateScene(System* system, int count, Random* random, std::vector<ElementHandle>* handles);
+    }
+}
+
+#endif //HMI_GRAPHICS_BENCH_BENCH_ELEMENT_H
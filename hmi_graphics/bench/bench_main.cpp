@@ -0,0 +1,130 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include "benchmark.h"
+
+namespace
+{
+    void PrintUsage()
+    {
+        std::fprintf(stderr,
+            "usage: hmi_graphics_bench [options]\n"
+            "  --filter=TEXT         run benchmarks whose name contains TEXT\n"
+            "  --out=PATH            write JSON results to PATH instead of stdout\n"
+            "  --seed=N              scene generator seed (default 1)\n"
+            "  --repetitions=N       timed repetitions per benchmark (default 10)\n"
+            "  --elements=A,B,...    element counts (default 10,100,1000,10000)\n"
+            "  --dirty=R,S,...       dirty element ratios for frame benchmarks (default 0.01,0.1,1)\n");
+    }
+
+    template<typename T>
+    bool ParseList(const char* text, std::vector<T>* values)
+    {
+        values->clear();
+        std::stringstream stream{text};
+        std::string item;
+        while(std::getline(stream, item, ','))
+        {
+            std::stringstream itemStream{item};
+            T value{};
+            if(!(itemStream >> value) || value <= 0)
+                return false;
+
+            values->push_back(value);
+        }
+
+        return !values->empty();
+    }
+
+    bool MatchOption(const char* argument, const char* option, const char** value)
+    {
+        const size_t length = std::strlen(option);
+        if(std::strncmp(argument, option, length) != 0 || argument[length] != '=')
+            return false;
+
+        *value = argument + length + 1;
+        return true;
+    }
+
+    bool ParseOptions(int argc, char** argv, hmi_graphics::bench::BenchmarkOptions* options)
+    {
+        for(int i = 1; i < argc; ++i)
+        {
+            const char* value = nullptr;
+            if(MatchOption(argv[i], "--filter", &value))
+            {
+                options->filter = value;
+            }
+            else if(MatchOption(argv[i], "--out", &value))
+            {
+                options->outputPath = value;
+            }
+            else if(MatchOption(argv[i], "--seed", &value))
+            {
+                options->seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            }
+            else if(MatchOption(argv[i], "--repetitions", &value))
+            {
+                options->repetitions = std::atoi(value);
+            }
+            else if(MatchOption(argv[i], "--elements", &value))
+            {
+                if(!ParseList(value, &options->elementCounts))
+                    return false;
+            }
+            else if(MatchOption(argv[i], "--dirty", &value))
+            {
+                if(!ParseList(value, &options->dirtyRatios))
+                    return false;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    struct FileCloser
+    {
+        void operator()(std::FILE* file) const
+        {
+            std::fclose(file);
+        }
+    };
+}
+
+int main(int argc, char** argv)
+{
+    hmi_graphics::bench::BenchmarkOptions options{};
+    options.seed = 1;
+    options.repetitions = 10;
+    options.elementCounts = {10, 100, 1000, 10000};
+    options.dirtyRatios = {0.01, 0.1, 1.0};
+    if(!ParseOptions(argc, argv, &options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    hmi_graphics::bench::BenchmarkRunner runner{options};
+    hmi_graphics::bench::RunElementBenchmarks(&runner);
+    hmi_graphics::bench::RunFrameBenchmarks(&runner);
+    hmi_graphics::bench::RunResourceCacheBenchmarks(&runner);
+
+    if(options.outputPath.empty())
+        return runner.WriteJson(stdout) ? 0 : 1;
+
+    std::unique_ptr<std::FILE, FileCloser> file{std::fopen(options.outputPath.c_str(), "w")};
+    if(!file)
+    {
+        std::fprintf(stderr, "cannot open %s\n", options.outputPath.c_str());
+        return 1;
+    }
+
+    return runner.WriteJson(file.get()) ? 0 : 1;
+}
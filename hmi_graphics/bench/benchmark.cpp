@@ -0,0 +1,171 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace hmi_graphics
+{
+    namespace bench
+    {
+        namespace
+        {
+            void WriteJsonString(std::FILE* out, const std::string& value)
+            {
+                std::fputc('"', out);
+                for(char c: value)
+                {
+                    if(c == '"' || c == '\\')
+                    {
+                        std::fputc('\\', out);
+                    }
+
+                    std::fputc(c, out);
+                }
+
+                std::fputc('"', out);
+            }
+
+            void WriteJsonObject(std::FILE* out, const BenchmarkParameters& values)
+            {
+                std::fputc('{', out);
+                for(size_t i = 0; i < values.size(); ++i)
+                {
+                    if(i > 0)
+                    {
+                        std::fputc(',', out);
+                    }
+
+                    WriteJsonString(out, values[i].first);
+                    std::fprintf(out, ":%.17g", values[i].second);
+                }
+
+                std::fputc('}', out);
+            }
+        }
+
+        BenchmarkRunner::BenchmarkRunner(const BenchmarkOptions& options)
+            : options_{options}
+        {
+            options_.repetitions = std::max(options_.repetitions, 1);
+        }
+
+        const BenchmarkOptions& BenchmarkRunner::GetOptions() const
+        {
+            return options_;
+        }
+
+        bool BenchmarkRunner::IsSelected(const std::string& name) const
+        {
+            return options_.filter.empty() || name.find(options_.filter) != std::string::npos;
+        }
+
+        BenchmarkResult* BenchmarkRunner::Run(const std::string& name, const BenchmarkParameters& parameters,
+            const std::function<uint64_t()>& body)
+        {
+            if(!IsSelected(name))
+                return nullptr;
+
+            body();
+            std::vector<double> samples;
+            uint64_t operations = 0;
+            for(int i = 0; i < options_.repetitions; ++i)
+            {
+                auto start = std::chrono::steady_clock::now();
+                operations = std::max<uint64_t>(body(), 1);
+                auto elapsed = std::chrono::steady_clock::now() - start;
+                samples.push_back(std::chrono::duration<double, std::nano>(elapsed).count() / operations);
+            }
+
+            std::sort(samples.begin(), samples.end());
+            BenchmarkResult result{};
+            result.name = name;
+            result.parameters = parameters;
+            result.operationsPerRepetition = operations;
+            result.minNanoseconds = samples.front();
+            result.medianNanoseconds = samples.size() % 2 != 0 ? samples[samples.size() / 2]
+                : (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2;
+            result.p95Nanoseconds = samples[std::min(samples.size() - 1, static_cast<size_t>(std::ceil(samples.size() * 0.95)) - 1)];
+            double sum = 0;
+            for(double sample: samples)
+            {
+                sum += sample;
+            }
+
+            result.meanNanoseconds = sum / samples.size();
+            double variance = 0;
+            for(double sample: samples)
+            {
+                variance += (sample - result.meanNanoseconds) * (sample - result.meanNanoseconds);
+            }
+
+            result.stddevNanoseconds = std::sqrt(variance / samples.size());
+            std::fprintf(stderr, "%-40s median %12.1f ns/op\n", name.c_str(), result.medianNanoseconds);
+            results_.push_back(result);
+            return &results_.back();
+        }
+
+        void BenchmarkRunner::Skip(const std::string& name, const BenchmarkParameters& parameters, const std::string& reason)
+        {
+            if(!IsSelected(name))
+                return;
+
+            BenchmarkResult result{};
+            result.name = name;
+            result.parameters = parameters;
+            result.skipped = true;
+            result.skipReason = reason;
+            std::fprintf(stderr, "%-40s skipped: %s\n", name.c_str(), reason.c_str());
+            results_.push_back(result);
+        }
+
+        bool BenchmarkRunner::WriteJson(std::FILE* out) const
+        {
+            std::fprintf(out, "{\"seed\":%u,\"repetitions\":%d,\"benchmarks\":[", options_.seed, options_.repetitions);
+            for(size_t i = 0; i < results_.size(); ++i)
+            {
+                const BenchmarkResult& result = results_[i];
+                std::fprintf(out, "%s\n{\"name\":", i > 0 ? "," : "");
+                WriteJsonString(out, result.name);
+                std::fprintf(out, ",\"parameters\":");
+                WriteJsonObject(out, result.parameters);
+                if(result.skipped)
+                {
+                    std::fprintf(out, ",\"skipped\":true,\"reason\":");
+                    WriteJsonString(out, result.skipReason);
+                    std::fputc('}', out);
+                    continue;
+                }
+
+                std::fprintf(out, ",\"skipped\":false,\"operations\":%llu,\"unit\":\"ns/op\",\"min\":%.3f,\"median\":%.3f,"
+                    "\"mean\":%.3f,\"p95\":%.3f,\"stddev\":%.3f,\"metrics\":",
+                    static_cast<unsigned long long>(result.operationsPerRepetition), result.minNanoseconds,
+                    result.medianNanoseconds, result.meanNanoseconds, result.p95Nanoseconds, result.stddevNanoseconds);
+                WriteJsonObject(out, result.metrics);
+                std::fputc('}', out);
+            }
+
+            std::fprintf(out, "\n]}\n");
+            return std::ferror(out) == 0;
+        }
+
+        Random::Random(uint32_t seed)
+            : state_{seed * 0x9E3779B97F4A7C15ull + 1}
+        {
+        }
+
+        uint32_t Random::Next()
+        {
+            // xorshift64*
+            state_ ^= state_ >> 12;
+            state_ ^= state_ << 25;
+            state_ ^= state_ >> 27;
+            return static_cast<uint32_t>((state_ * 0x2545F4914F6CDD1Dull) >> 32);
+        }
+
+        int Random::NextInt(int bound)
+        {
+            return bound > 0 ? static_cast<int>(Next() % static_cast<uint32_t>(bound)) : 0;
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef HMI_GRAPHICS_BENCH_BENCHMARK_H
+#define HMI_GRAPHICS_BENCH_BENCHMARK_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace hmi_graphics
+{
+    namespace bench
+    {
+        struct BenchmarkOptions
+        {
+            std::string filter;
+            std::string outputPath;
+            uint32_t seed;
+            int repetitions;
+            std::vector<int> elementCounts;
+            std::vector<double> dirtyRatios;
+        };
+
+        using BenchmarkParameters = std::vector<std::pair<std::string, double>>;
+
+        struct BenchmarkResult
+        {
+            std::string name;
+            BenchmarkParameters parameters;
+            // Extra values reported by the benchmark itself, e.g. profiler stage averages.
+            BenchmarkParameters metrics;
+            uint64_t operationsPerRepetition;
+            double minNanoseconds;
+            double medianNanoseconds;
+            double meanNanoseconds;
+            double p95Nanoseconds;
+            double stddevNanoseconds;
+            bool skipped;
+            std::string skipReason;
+        };
+
+        // Runs each benchmark body once to warm up and then options.repetitions times; every call performs a fixed
+        // amount of work and returns the number of operations it did. Timings are reported per operation.
+        class BenchmarkRunner
+        {
+        public:
+            explicit BenchmarkRunner(const BenchmarkOptions& options);
+
+            const BenchmarkOptions& GetOptions() const;
+
+            // False when the filter excludes the benchmark; skip its setup in that case.
+            bool IsSelected(const std::string& name) const;
+
+            BenchmarkResult* Run(const std::string& name, const BenchmarkParameters& parameters,
+                const std::function<uint64_t()>& body);
+
+            void Skip(const std::string& name, const BenchmarkParameters& parameters, const std::string& reason);
+
+            bool WriteJson(std::FILE* out) const;
+
+        private:
+            BenchmarkOptions options_;
+            std::vector<BenchmarkResult> results_;
+        };
+
+        // Deterministic generator so every run of a benchmark sees the same scene for the same seed.
+        class Random
+        {
+        public:
+            explicit Random(uint32_t seed);
+
+            uint32_t Next();
+
+            // Uniform in [0, bound).
+            int NextInt(int bound);
+
+        private:
+            uint64_t state_;
+        };
+
+        void RunElementBenchmarks(BenchmarkRunner* runner);
+
+        void RunFrameBenchmarks(BenchmarkRunner* runner);
+
+        void RunResourceCacheBenchmarks(BenchmarkRunner* runner);
+    }
+}
+
+#endif //HMI_GRAPHICS_BENCH_BENCHMARK_H
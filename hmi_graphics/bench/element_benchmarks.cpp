@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bench_element.h"
+#include "benchmark.h"
+#include "draw_order.h"
+
+namespace hmi_graphics
+{
+    namespace bench
+    {
+        namespace
+        {
+            constexpr int CHURN_OPERATIONS = 256;
+            constexpr int REORDER_OPERATIONS = 1024;
+            constexpr int HIT_TEST_OPERATIONS = 4096;
+
+            std::string WithCount(const char* name, int count)
+            {
+                return std::string{name} + "/" + std::to_string(count);
+            }
+
+            void RunChurn(BenchmarkRunner* runner, int count)
+            {
+                const std::string name = WithCount("element/add_remove", count);
+                if(!runner->IsSelected(name))
+                    return;
+
+                std::unique_ptr<System> system{System::CreateHeadlessInstance(SCENE_WIDTH, SCENE_HEIGHT)};
+                Random random{runner->GetOptions().seed};
+                std::vector<ElementHandle> handles;
+                PopulateScene(system.get(), count, &random, &handles);
+                runner->Run(name, {{"elements", count}}, [&]()
+                {
+                    for(int i = 0; i < CHURN_OPERATIONS; ++i)
+                    {
+                        auto& handle = handles[random.NextInt(count)];
+                        system->RemoveElement(handle);
+                        handle = AddSceneElement(system.get(), &random);
+                    }
+
+                    return static_cast<uint64_t>(CHURN_OPERATIONS);
+                });
+            }
+
+            void RunZReorder(BenchmarkRunner* runner, int count)
+            {
+                const std::string name = WithCount("element/z_reorder", count);
+                if(!runner->IsSelected(name))
+                    return;
+
+                std::unique_ptr<System> system{System::CreateHeadlessInstance(SCENE_WIDTH, SCENE_HEIGHT)};
+                Random random{runner->GetOptions().seed};
+                std::vector<ElementHandle> handles;
+                PopulateScene(system.get(), count, &random, &handles);
+                runner->Run(name, {{"elements", count}, {"zLevels", SCENE_Z_LEVELS}}, [&]()
+                {
+                    for(int i = 0; i < REORDER_OPERATIONS; ++i)
+                    {
+                        auto* element = system->GetElement(handles[random.NextInt(count)]);
+                        element->SetZIndex(static_cast<int16_t>(random.NextInt(SCENE_Z_LEVELS)));
+                    }
+
+                    return static_cast<uint64_t>(REORDER_OPERATIONS);
+                });
+            }
+
+            // DrawOrder on its own against the full stable_sort on every z-index change it replaced, fed the scene's
+            // elements and the same sequence of changes.
+            void RunZReorderBaseline(BenchmarkRunner* runner, int count)
+            {
+                const std::string drawOrderName = WithCount("element/z_reorder_draw_order", count);
+                const std::string sortName = WithCount("element/z_reorder_stable_sort", count);
+                if(!runner->IsSelected(drawOrderName) && !runner->IsSelected(sortName))
+                    return;
+
+                std::unique_ptr<System> system{System::CreateHeadlessInstance(SCENE_WIDTH, SCENE_HEIGHT)};
+                Random random{runner->GetOptions().seed};
+                std::vector<ElementHandle> handles;
+                PopulateScene(system.get(), count, &random, &handles);
+                std::vector<GraphicsElement*> elements;
+                DrawOrder drawOrder;
+                std::vector<DrawOrder::Entry> sorted;
+                for(auto& handle: handles)
+                {
+                    auto* element = system->GetElement(handle);
+                    elements.push_back(element);
+                    drawOrder.Insert(element, handle, element->GetZIndex());
+                    sorted.push_back(DrawOrder::Entry{element->GetZIndex(), 0, element, handle});
+                }
+
+                auto zIndexLess = [](const DrawOrder::Entry& lhs, const DrawOrder::Entry& rhs)
+                {
+                    return lhs.zIndex < rhs.zIndex;
+                };
+
+                std::stable_sort(sorted.begin(), sorted.end(), zIndexLess);
+                const BenchmarkParameters parameters{{"elements", count}, {"zLevels", SCENE_Z_LEVELS}};
+                Random drawOrderRandom{runner->GetOptions().seed};
+                auto* result = runner->Run(drawOrderName, parameters, [&]()
+                {
+                    for(int i = 0; i < REORDER_OPERATIONS; ++i)
+                    {
+                        auto* element = elements[drawOrderRandom.NextInt(count)];
+                        drawOrder.Reposition(element, static_cast<int16_t>(drawOrderRandom.NextInt(SCENE_Z_LEVELS)));
+                    }
+
+                    return static_cast<uint64_t>(REORDER_OPERATIONS);
+                });
+
+                // Results move when the next one is added.
+                const double drawOrderMedian = result != nullptr ? result->medianNanoseconds : 0.;
+                Random sortRandom{runner->GetOptions().seed};
+                result = runner->Run(sortName, parameters, [&]()
+                {
+                    for(int i = 0; i < REORDER_OPERATIONS; ++i)
+                    {
+                        auto& entry = sorted[sortRandom.NextInt(count)];
+                        entry.zIndex = static_cast<int16_t>(sortRandom.NextInt(SCENE_Z_LEVELS));
+                        std::stable_sort(sorted.begin(), sorted.end(), zIndexLess);
+                    }
+
+                    return static_cast<uint64_t>(REORDER_OPERATIONS);
+                });
+
+                if(result != nullptr && drawOrderMedian > 0.)
+                {
+                    result->metrics.emplace_back("drawOrderSpeedup", result->medianNanoseconds / drawOrderMedian);
+                }
+            }
+
+            void RunHitTest(BenchmarkRunner* runner, int count)
+            {
+                const std::string topName = WithCount("element/hit_test", count);
+                const std::string stackName = WithCount("element/hit_test_stack", count);
+                if(!runner->IsSelected(topName) && !runner->IsSelected(stackName))
+                    return;
+
+                std::unique_ptr<System> system{System::CreateHeadlessInstance(SCENE_WIDTH, SCENE_HEIGHT)};
+                Random random{runner->GetOptions().seed};
+                std::vector<ElementHandle> handles;
+                PopulateScene(system.get(), count, &random, &handles);
+                uint64_t hits = 0;
+                auto* result = runner->Run(topName, {{"elements", count}}, [&]()
+                {
+                    hits = 0;
+                    for(int i = 0; i < HIT_TEST_OPERATIONS; ++i)
+                    {
+                        if(system->HitTest(random.NextInt(SCENE_WIDTH), random.NextInt(SCENE_HEIGHT), nullptr) != nullptr)
+                        {
+                            hits += 1;
+                        }
+                    }
+
+                    return static_cast<uint64_t>(HIT_TEST_OPERATIONS);
+                });
+
+                if(result != nullptr)
+                {
+                    result->metrics.emplace_back("hitRatio", static_cast<double>(hits) / HIT_TEST_OPERATIONS);
+                }
+
+                // Walks every element under the point, the way input routing falls through transparent elements.
+                result = runner->Run(stackName, {{"elements", count}}, [&]()
+                {
+                    hits = 0;
+                    for(int i = 0; i < HIT_TEST_OPERATIONS; ++i)
+                    {
+                        HitTestCursor cursor{};
+                        const int x = random.NextInt(SCENE_WIDTH);
+                        const int y = random.NextInt(SCENE_HEIGHT);
+                        while(system->HitTest(x, y, &cursor) != nullptr)
+                        {
+                            hits += 1;
+                        }
+                    }
+
+                    return static_cast<uint64_t>(HIT_TEST_OPERATIONS);
+                });
+
+                if(result != nullptr)
+                {
+                    result->metrics.emplace_back("hitsPerQuery", static_cast<double>(hits) / HIT_TEST_OPERATIONS);
+                }
+            }
+        }
+
+        void RunElementBenchmarks(BenchmarkRunner* runner)
+        {
+            for(int count: runner->GetOptions().elementCounts)
+            {
+                RunChurn(runner, count);
+                RunZReorder(runner, count);
+                RunZReorderBaseline(runner, count);
+                RunHitTest(runner, count);
+            }
+        }
+    }
+}
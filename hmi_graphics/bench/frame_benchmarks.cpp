@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "bench_element.h"
+#include "benchmark.h"
+#include "composite_batch.h"
+#include "damage_region.h"
+#include "rect_util.h"
+
+namespace hmi_graphics
+{
+    namespace bench
+    {
+        namespace
+        {
+            constexpr int FRAMES_PER_REPETITION = 10;
+            constexpr size_t PROFILED_FRAMES = 64;
+            constexpr int ATLAS_PAGE_COUNTS[] = {1, 4, 16};
+            constexpr int ATLAS_PAGE_SIZE = 2048;
+            constexpr int MAX_QUAD_SIZE = 96;
+            constexpr int MIN_DAMAGE_SIZE = 8;
+            constexpr int MAX_DAMAGE_SIZE = 32;
+
+            // Averages the stage timings of the latest frames the system profiled.
+            void AddStageMetrics(System* system, BenchmarkResult* result)
+            {
+                FrameStatistics frames[PROFILED_FRAMES];
+                const size_t count = system->GetFrameStatistics(frames, PROFILED_FRAMES);
+                if(count == 0)
+                    return;
+
+                double elementRender = 0;
+                double composite = 0;
+                double damageArea = 0;
+                for(size_t i = 0; i < count; ++i)
+                {
+                    elementRender += frames[i].stages[FRAME_STAGE_ELEMENT_RENDER].durationMicroseconds;
+                    composite += frames[i].stages[FRAME_STAGE_COMPOSITE].durationMicroseconds;
+                    damageArea += static_cast<double>(frames[i].damageArea);
+                }
+
+                result->metrics.emplace_back("elementRenderMicroseconds", elementRender / count);
+                result->metrics.emplace_back("compositeMicroseconds", composite / count);
+                result->metrics.emplace_back("damageArea", damageArea / count);
+            }
+
+            void RunHeadlessFrame(BenchmarkRunner* runner, int count, double dirtyRatio)
+            {
+                char name[64];
+                std::snprintf(name, sizeof(name), "frame/headless/%d/dirty_%g", count, dirtyRatio);
+                if(!runner->IsSelected(name))
+                    return;
+
+                std::unique_ptr<System> system{System::CreateHeadlessInstance(SCENE_WIDTH, SCENE_HEIGHT)};
+                Random random{runner->GetOptions().seed};
+                std::vector<ElementHandle> handles;
+                PopulateScene(system.get(), count, &random, &handles);
+                system->Render();
+
+                // Dirty elements rotate through the scene so every frame touches a different part of it.
+                const int dirtyCount = std::max(1, static_cast<int>(std::lround(count * dirtyRatio)));
+                size_t next = 0;
+                auto* result = runner->Run(name, {{"elements", count}, {"dirtyRatio", dirtyRatio}, {"dirtyElements", dirtyCount}}, [&]()
+                {
+                    for(int frame = 0; frame < FRAMES_PER_REPETITION; ++frame)
+                    {
+                        for(int i = 0; i < dirtyCount; ++i)
+                        {
+                            system->GetElement(handles[next])->NotifyUpdated();
+                            next = (next + 1) % handles.size();
+                        }
+
+                        system->Render();
+                    }
+
+                    return static_cast<uint64_t>(FRAMES_PER_REPETITION);
+                });
+
+                if(result != nullptr)
+                {
+                    AddStageMetrics(system.get(), result);
+                }
+            }
+
+            // A frame in which count small elements changed all over the scene, merged with the system's rect limit.
+            void RunDamageRegion(BenchmarkRunner* runner, int count)
+            {
+                char name[64];
+                std::snprintf(name, sizeof(name), "frame/damage_region/%d", count);
+                if(!runner->IsSelected(name))
+                    return;
+
+                Random random{runner->GetOptions().seed};
+                std::vector<Rect> rects;
+                for(int i = 0; i < count; ++i)
+                {
+                    const int width = MIN_DAMAGE_SIZE + random.NextInt(MAX_DAMAGE_SIZE - MIN_DAMAGE_SIZE);
+                    const int height = MIN_DAMAGE_SIZE + random.NextInt(MAX_DAMAGE_SIZE - MIN_DAMAGE_SIZE);
+                    rects.push_back(MakeRect(random.NextInt(SCENE_WIDTH - width), random.NextInt(SCENE_HEIGHT - height),
+                        width, height));
+                }
+
+                DamageRegion damage;
+                auto* result = runner->Run(name, {{"damageRects", count}}, [&]()
+                {
+                    for(int frame = 0; frame < FRAMES_PER_REPETITION; ++frame)
+                    {
+                        damage.Clear();
+                        for(auto& rect: rects)
+                        {
+                            damage.Add(rect);
+                        }
+
+                        damage.Clip(MakeRect(0, 0, SCENE_WIDTH, SCENE_HEIGHT));
+                    }
+
+                    return static_cast<uint64_t>(FRAMES_PER_REPETITION);
+                });
+
+                if(result != nullptr)
+                {
+                    double area = 0;
+                    for(auto& rect: damage.GetRects())
+                    {
+                        area += static_cast<double>(RectArea(rect));
+                    }
+
+                    result->metrics.emplace_back("rects", static_cast<double>(damage.GetRects().size()));
+                    result->metrics.emplace_back("damageArea", area);
+                }
+            }
+
+            // CPU side of the Direct3D composite: one full-frame pass of count quads spread over pageCount atlas
+            // pages and the scene's z-levels, sorted into instance data and draws.
+            void RunCompositeBatch(BenchmarkRunner* runner, int count, int pageCount)
+            {
+                char name[64];
+                std::snprintf(name, sizeof(name), "frame/composite_batch/%d/pages_%d", count, pageCount);
+                if(!runner->IsSelected(name))
+                    return;
+
+                struct Input
+                {
+                    uint32_t texture;
+                    int32_t zIndex;
+                    CompositeQuad quad;
+                };
+
+                Random random{runner->GetOptions().seed};
+                std::vector<Input> inputs;
+                for(int i = 0; i < count; ++i)
+                {
+                    const float width = static_cast<float>(1 + random.NextInt(MAX_QUAD_SIZE));
+                    const float height = static_cast<float>(1 + random.NextInt(MAX_QUAD_SIZE));
+                    const float left = static_cast<float>(random.NextInt(SCENE_WIDTH - MAX_QUAD_SIZE));
+                    const float top = static_cast<float>(random.NextInt(SCENE_HEIGHT - MAX_QUAD_SIZE));
+                    const float u = static_cast<float>(random.NextInt(ATLAS_PAGE_SIZE - MAX_QUAD_SIZE)) / ATLAS_PAGE_SIZE;
+                    const float v = static_cast<float>(random.NextInt(ATLAS_PAGE_SIZE - MAX_QUAD_SIZE)) / ATLAS_PAGE_SIZE;
+                    CompositeQuad quad{left, top, left + width, top + height, u, v, u + width / ATLAS_PAGE_SIZE,
+                        v + height / ATLAS_PAGE_SIZE, 1.f, 0.f, 0.f, 1.f, 1.f, {}};
+                    inputs.push_back(Input{static_cast<uint32_t>(random.NextInt(pageCount)),
+                        random.NextInt(SCENE_Z_LEVELS), quad});
+                }
+
+                CompositeBatchBuilder builder;
+                auto* result = runner->Run(name, {{"elements", count}, {"atlasPages", pageCount}, {"zLevels", SCENE_Z_LEVELS}}, [&]()
+                {
+                    for(int frame = 0; frame < FRAMES_PER_REPETITION; ++frame)
+                    {
+                        builder.Reset();
+                        builder.BeginPass(Rect{{0, 0}, {SCENE_WIDTH, SCENE_HEIGHT}});
+                        for(auto& input: inputs)
+                        {
+                            builder.Add(input.texture, input.zIndex, input.quad);
+                        }
+
+                        builder.EndPass();
+                    }
+
+                    return static_cast<uint64_t>(FRAMES_PER_REPETITION);
+                });
+
+                if(result != nullptr)
+                {
+                    result->metrics.emplace_back("draws", static_cast<double>(builder.GetBatches().size()));
+                    result->metrics.emplace_back("instances", static_cast<double>(builder.GetInstances().size()));
+                }
+            }
+        }
+
+        void RunFrameBenchmarks(BenchmarkRunner* runner)
+        {
+            for(int count: runner->GetOptions().elementCounts)
+            {
+                for(double dirtyRatio: runner->GetOptions().dirtyRatios)
+                {
+                    RunHeadlessFrame(runner, count, dirtyRatio);
+                }
+
+                RunDamageRegion(runner, count);
+                for(int pageCount: ATLAS_PAGE_COUNTS)
+                {
+                    RunCompositeBatch(runner, count, pageCount);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,229 @@
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Windows.h>
+#include <wrl/client.h>
+#include "bench_element.h"
+#include "benchmark.h"
+
+namespace hmi_graphics
+{
+    namespace bench
+    {
+        namespace
+        {
+            constexpr int LOOKUP_OPERATIONS = 4096;
+            constexpr int HOT_COLOR_COUNT = 16;
+            // More distinct colors than the brush cache holds, so lookups keep evicting.
+            constexpr int COLD_COLOR_COUNT = 1024;
+            constexpr int TEXT_FORMAT_SIZE_COUNT = 8;
+            constexpr wchar_t WINDOW_CLASS_NAME[] = L"HmiGraphicsBench";
+            constexpr int LABEL_COUNT = 64;
+            constexpr int LABEL_WIDTH = 96;
+            constexpr int LABEL_HEIGHT = 24;
+
+            const TextFormatDesc LABEL_FORMAT{L"arial", 11.f, DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL,
+                DWRITE_FONT_STRETCH_NORMAL, DWRITE_TEXT_ALIGNMENT_CENTER, DWRITE_PARAGRAPH_ALIGNMENT_CENTER};
+
+            // The brush and text format caches only exist on the Direct3D backend, which needs a window for its
+            // swap chain. The window is never shown.
+            class HiddenWindow
+            {
+            public:
+                HiddenWindow()
+                    : hWnd_{nullptr}
+                {
+                    WNDCLASSEXW windowClass{};
+                    windowClass.cbSize = sizeof(windowClass);
+                    windowClass.lpfnWndProc = DefWindowProcW;
+                    windowClass.hInstance = GetModuleHandleW(nullptr);
+                    windowClass.lpszClassName = WINDOW_CLASS_NAME;
+                    RegisterClassExW(&windowClass);
+                    hWnd_ = CreateWindowExW(0, WINDOW_CLASS_NAME, L"", WS_OVERLAPPEDWINDOW, 0, 0, SCENE_WIDTH, SCENE_HEIGHT,
+                        nullptr, nullptr, windowClass.hInstance, nullptr);
+                }
+
+                HiddenWindow(const HiddenWindow&) = delete;
+
+                ~HiddenWindow()
+                {
+                    if(hWnd_ != nullptr)
+                    {
+                        DestroyWindow(hWnd_);
+                    }
+
+                    UnregisterClassW(WINDOW_CLASS_NAME, GetModuleHandleW(nullptr));
+                }
+
+                HWND GetHandle() const
+                {
+                    return hWnd_;
+                }
+
+            private:
+                HWND hWnd_;
+            };
+
+            D2D1_COLOR_F MakeColor(int index)
+            {
+                return D2D1::ColorF((static_cast<UINT32>(index) * 0x010203u) & 0xFFFFFFu);
+            }
+
+            void AddHitRate(const CacheStatistics& before, const CacheStatistics& after, BenchmarkResult* result)
+            {
+                if(result == nullptr)
+                    return;
+
+                const double hits = static_cast<double>(after.hits - before.hits);
+                const double misses = static_cast<double>(after.misses - before.misses);
+                result->metrics.emplace_back("hitRate", hits + misses > 0 ? hits / (hits + misses) : 0.0);
+                result->metrics.emplace_back("evictions", static_cast<double>(after.evictions - before.evictions));
+            }
+
+            void RunColorBrushLookups(BenchmarkRunner* runner, System* system, const char* name, int colorCount)
+            {
+                CacheStatistics before{};
+                CacheStatistics after{};
+                system->GetResourceCacheStatistics(&before, nullptr);
+                int next = 0;
+                auto* result = runner->Run(name, {{"colors", colorCount}}, [&]()
+                {
+                    for(int i = 0; i < LOOKUP_OPERATIONS; ++i)
+                    {
+                        Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> brush;
+                        system->GetCachedColorBrush(MakeColor(next), &brush);
+                        next = (next + 1) % colorCount;
+                    }
+
+                    return static_cast<uint64_t>(LOOKUP_OPERATIONS);
+                });
+
+                system->GetResourceCacheStatistics(&after, nullptr);
+                AddHitRate(before, after, result);
+            }
+
+            void RunTextFormatLookups(BenchmarkRunner* runner, System* system)
+            {
+                CacheStatistics before{};
+                CacheStatistics after{};
+                system->GetResourceCacheStatistics(nullptr, &before);
+                int next = 0;
+                auto* result = runner->Run("resource/text_format_hot", {{"formats", TEXT_FORMAT_SIZE_COUNT}}, [&]()
+                {
+                    for(int i = 0; i < LOOKUP_OPERATIONS; ++i)
+                    {
+                        TextFormatDesc desc{L"arial", 10.f + next, DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL,
+                            DWRITE_FONT_STRETCH_NORMAL, DWRITE_TEXT_ALIGNMENT_CENTER, DWRITE_PARAGRAPH_ALIGNMENT_CENTER};
+                        Microsoft::WRL::ComPtr<IDWriteTextFormat> textFormat;
+                        system->GetCachedTextFormat(desc, &textFormat);
+                        next = (next + 1) % TEXT_FORMAT_SIZE_COUNT;
+                    }
+
+                    return static_cast<uint64_t>(LOOKUP_OPERATIONS);
+                });
+
+                system->GetResourceCacheStatistics(nullptr, &after);
+                AddHitRate(before, after, result);
+            }
+
+            // Labels repeat: the same LABEL_COUNT strings are looked up and drawn over and over.
+            void RunTextBenchmarks(BenchmarkRunner* runner)
+            {
+                if(!runner->IsSelected("resource/text_layout_hot") && !runner->IsSelected("resource/text_atlas_draw"))
+                    return;
+
+                std::unique_ptr<System> system{System::CreateHeadlessInstance(SCENE_WIDTH, SCENE_HEIGHT)};
+                std::vector<std::wstring> labels;
+                for(int i = 0; i < LABEL_COUNT; ++i)
+                {
+                    labels.push_back(L"Label " + std::to_wstring(i * 37));
+                }
+
+                int next = 0;
+                runner->Run("resource/text_layout_hot", {{"labels", LABEL_COUNT}}, [&]()
+                {
+                    for(int i = 0; i < LOOKUP_OPERATIONS; ++i)
+                    {
+                        auto& label = labels[next];
+                        Microsoft::WRL::ComPtr<IDWriteTextLayout> layout;
+                        system->GetCachedTextLayout(label.c_str(), static_cast<uint32_t>(label.size()), LABEL_FORMAT,
+                            LABEL_WIDTH, LABEL_HEIGHT, &layout);
+                        next = (next + 1) % LABEL_COUNT;
+                    }
+
+                    return static_cast<uint64_t>(LOOKUP_OPERATIONS);
+                });
+
+                std::vector<uint32_t> pixels(LABEL_WIDTH * LABEL_HEIGHT);
+                Surface surface{pixels.data(), LABEL_WIDTH, LABEL_HEIGHT, LABEL_WIDTH};
+                const Rect box{Point{0, 0}, Size{LABEL_WIDTH, LABEL_HEIGHT}};
+                auto* result = runner->Run("resource/text_atlas_draw", {{"labels", LABEL_COUNT}}, [&]()
+                {
+                    for(int i = 0; i < LOOKUP_OPERATIONS; ++i)
+                    {
+                        auto& label = labels[next];
+                        system->DrawCachedText(surface, box, label.c_str(), static_cast<uint32_t>(label.size()), LABEL_FORMAT,
+                            0xFF000000u);
+                        next = (next + 1) % LABEL_COUNT;
+                    }
+
+                    return static_cast<uint64_t>(LOOKUP_OPERATIONS);
+                });
+
+                if(result != nullptr)
+                {
+                    AtlasStatistics atlas{};
+                    system->GetTextCacheStatistics(nullptr, &atlas);
+                    result->metrics.emplace_back("atlasPages", static_cast<double>(atlas.pageCount));
+                    result->metrics.emplace_back("atlasUsedArea", static_cast<double>(atlas.usedArea));
+                }
+            }
+        }
+
+        void RunResourceCacheBenchmarks(BenchmarkRunner* runner)
+        {
+            RunTextBenchmarks(runner);
+
+            const char* const names[] = {"resource/color_brush_hot", "resource/color_brush_cold", "resource/text_format_hot"};
+            bool selected = false;
+            for(auto* name: names)
+            {
+                selected = selected || runner->IsSelected(name);
+            }
+
+            if(!selected)
+                return;
+
+            HiddenWindow window;
+            std::unique_ptr<System> system;
+            std::string error = "window creation failed";
+            if(window.GetHandle() != nullptr)
+            {
+                error = "Direct3D system creation failed";
+                try
+                {
+                    system.reset(System::CreateInstance(window.GetHandle(), SCENE_WIDTH, SCENE_HEIGHT));
+                }
+                catch(const std::exception& e)
+                {
+                    error = e.what();
+                }
+            }
+
+            if(!system)
+            {
+                for(auto* name: names)
+                {
+                    runner->Skip(name, {}, error);
+                }
+
+                return;
+            }
+
+            RunColorBrushLookups(runner, system.get(), names[0], HOT_COLOR_COUNT);
+            RunColorBrushLookups(runner, system.get(), names[1], COLD_COLOR_COUNT);
+            RunTextFormatLookups(runner, system.get());
+        }
+    }
+}
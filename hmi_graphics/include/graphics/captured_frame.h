@@ -0,0 +1,34 @@
+#ifndef HMI_CAPTURED_FRAME_H
+#define HMI_CAPTURED_FRAME_H
+
+#include <cstddef>
+#include <cstdint>
+#include "types.h"
+
+namespace hmi_graphics
+{
+    // A presented frame handed out by System::AcquireCapturedFrame. The pixels are the backend's capture buffer
+    // itself, e.g. a mapped staging texture, and stay valid until the last reference is released, which may happen
+    // on any thread. Works with ComPtr. Release every frame before the system is destroyed.
+    class CapturedFrame
+    {
+    public:
+        virtual uint32_t AddRef() = 0;
+
+        virtual uint32_t Release() = 0;
+
+        virtual const Surface& GetSurface() const = 0;
+
+        // Counts the frames presented since capture was enabled; a gap means frames were dropped.
+        virtual uint64_t GetFrameNumber() const = 0;
+
+        // Rects changed since the previous captured frame, including the changes of dropped frames. Copies up to
+        // capacity of them and returns the total count.
+        virtual size_t GetDamage(Rect* rects, size_t capacity) const = 0;
+
+    protected:
+        ~CapturedFrame() = default;
+    };
+}
+
+#endif //HMI_CAPTURED_FRAME_H
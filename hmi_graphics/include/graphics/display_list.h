@@ -0,0 +1,85 @@
+#ifndef HMI_DISPLAY_LIST_H
+#define HMI_DISPLAY_LIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <d2d1_2.h>
+#include "types.h"
+
+#if defined(_WIN32) && defined(HMI_GRAPHICS_DLL)
+#if !defined(HMI_GRAPHICS_EXPORT)
+#define HMI_GRAPHICS_EXPORT __declspec(dllexport)
+#endif
+#else
+#define HMI_GRAPHICS_EXPORT
+#endif
+
+namespace hmi_graphics
+{
+    class System;
+    struct TextFormatDesc;
+
+    // Retained drawing commands for an element, replayable with Direct2D or into a software surface. Transforms,
+    // colors and strings live in parameter slots that commands refer to, so an element records its content once
+    // and afterwards only patches the slots that changed; GraphicsElement::RenderDisplayList replays the list.
+    class HMI_GRAPHICS_EXPORT DisplayList
+    {
+    public:
+        class Pimpl;
+
+        DisplayList();
+
+        DisplayList(const DisplayList&) = delete;
+
+        ~DisplayList();
+
+        uint32_t AddTransform(const D2D1_MATRIX_3X2_F& transform);
+
+        uint32_t AddColor(const D2D1_COLOR_F& color);
+
+        uint32_t AddString(const wchar_t* text, uint32_t length, const TextFormatDesc& desc);
+
+        // The setters return false when the slot already held the value, so callers can skip NotifyUpdated.
+        bool SetTransform(uint32_t slot, const D2D1_MATRIX_3X2_F& transform);
+
+        bool SetColor(uint32_t slot, const D2D1_COLOR_F& color);
+
+        bool SetString(uint32_t slot, const wchar_t* text, uint32_t length);
+
+        // Replaces the element's pixels, ignoring transforms.
+        void Clear(uint32_t color);
+
+        // Following commands are drawn with the slot's transform applied on top of the enclosing ones.
+        void PushTransform(uint32_t transform);
+
+        void PopTransform();
+
+        void FillRectangle(const D2D1_RECT_F& rect, uint32_t color);
+
+        void DrawRectangle(const D2D1_RECT_F& rect, uint32_t color, float strokeWidth);
+
+        void FillEllipse(const D2D1_ELLIPSE& ellipse, uint32_t color);
+
+        void DrawEllipse(const D2D1_ELLIPSE& ellipse, uint32_t color, float strokeWidth);
+
+        void DrawLine(D2D1_POINT_2F from, D2D1_POINT_2F to, uint32_t color, float strokeWidth);
+
+        // Lays the string out in box. The software replay only honours the translation of the current transform.
+        void DrawString(uint32_t text, const D2D1_RECT_F& box, uint32_t color);
+
+        // Drops commands and slots.
+        void Reset();
+
+        size_t GetCommandCount() const;
+
+        // context must be inside BeginDraw; base is the transform to the element's origin in the target.
+        bool Replay(System* system, ID2D1DeviceContext* context, const D2D1_MATRIX_3X2_F& base) const;
+
+        bool Replay(System* system, const Surface& surface) const;
+
+    private:
+        Pimpl* pimpl_;
+    };
+}
+
+#endif //HMI_DISPLAY_LIST_H
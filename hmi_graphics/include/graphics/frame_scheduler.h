@@ -0,0 +1,114 @@
+#ifndef HMI_FRAME_SCHEDULER_H
+#define HMI_FRAME_SCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#if defined(_WIN32) && defined(HMI_GRAPHICS_DLL)
+#if !defined(HMI_GRAPHICS_EXPORT)
+#define HMI_GRAPHICS_EXPORT __declspec(dllexport)
+#endif
+#else
+#define HMI_GRAPHICS_EXPORT
+#endif
+
+namespace hmi_graphics
+{
+    // Time source of a FrameScheduler in microseconds from an arbitrary origin. Tests and simulations inject one
+    // that advances on SleepUntil instead of sleeping.
+    class HMI_GRAPHICS_EXPORT FrameClock
+    {
+    public:
+        // std::chrono::steady_clock; SleepUntil sleeps and spins the last stretch, so it may still overshoot by a
+        // scheduler tick when the thread is descheduled.
+        static FrameClock* GetSteadyClock();
+
+        virtual ~FrameClock() = default;
+
+        virtual uint64_t Now() = 0;
+
+        virtual void SleepUntil(uint64_t microseconds) = 0;
+    };
+
+    enum LateFramePolicy
+    {
+        // A frame that cannot make its deadline gives it up and aims for the next one on the original cadence, so
+        // frames are dropped but animation stays in phase.
+        LATE_FRAME_POLICY_SKIP,
+        // Starts right away and moves the cadence to the late frame, so no frame is dropped but the phase shifts.
+        LATE_FRAME_POLICY_RESYNC,
+    };
+
+    struct MissedDeadline
+    {
+      uint64_t frameIndex;
+      uint64_t deadlineMicroseconds;
+      uint32_t latenessMicroseconds;
+      // From the scheduled start to the end of the frame.
+      uint32_t workMicroseconds;
+    };
+
+    struct FrameSchedulerOptions
+    {
+      uint32_t targetFps;
+      LateFramePolicy latePolicy;
+      // Added to the estimated frame time when picking the start; covers sleep overshoot and frame time jitter.
+      uint32_t safetyMarginMicroseconds;
+      // nullptr uses FrameClock::GetSteadyClock; otherwise it must outlive the scheduler.
+      FrameClock* clock;
+      // Called by EndFrame, on the thread that renders.
+      std::function<void(const MissedDeadline&)> onMissedDeadline;
+    };
+
+    struct FrameSchedulerStatistics
+    {
+      uint64_t frames;
+      uint64_t missedDeadlines;
+      // Deadlines given up by LATE_FRAME_POLICY_SKIP; idle time without frames does not count.
+      uint64_t skippedDeadlines;
+      uint32_t estimatedWorkMicroseconds;
+      uint32_t lastLatenessMicroseconds;
+      uint32_t maxLatenessMicroseconds;
+    };
+
+    // Paces frames to deadlines every 1 / targetFps seconds. Each frame starts as late as the longest recent frame
+    // time plus the safety margin allows, so the input applied at the start is as fresh as possible when the frame
+    // is presented at its deadline. Not thread-safe; call from the thread that renders.
+    class HMI_GRAPHICS_EXPORT FrameScheduler
+    {
+    public:
+        explicit FrameScheduler(const FrameSchedulerOptions& options);
+
+        FrameScheduler(const FrameScheduler&) = delete;
+
+        // Sleeps until the start of the next frame and returns its deadline.
+        uint64_t WaitForFrameStart();
+
+        // Frames that presented nothing neither count nor teach the frame time estimate.
+        void EndFrame(bool presented);
+
+        void GetStatistics(FrameSchedulerStatistics* statistics) const;
+
+        uint64_t GetPeriodMicroseconds() const;
+
+    private:
+        static constexpr size_t WORK_HISTORY_SIZE = 32;
+
+        uint32_t EstimateWork() const;
+
+        FrameSchedulerOptions options_;
+        FrameClock* clock_;
+        uint64_t period_;
+        uint64_t deadline_;
+        uint64_t start_;
+        bool scheduled_;
+        bool lastMissed_;
+        uint32_t workHistory_[WORK_HISTORY_SIZE];
+        size_t workCount_;
+        size_t workNext_;
+        FrameSchedulerStatistics statistics_;
+    };
+}
+
+#endif //HMI_FRAME_SCHEDULER_H
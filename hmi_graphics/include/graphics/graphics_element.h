@@ -17,6 +17,7 @@
 namespace hmi_graphics
 {
     class System;
+    class DisplayList;
     class HMI_GRAPHICS_EXPORT GraphicsElement
     {
     public:
@@ -42,19 +43,46 @@ namespace hmi_graphics
 
         Point GetPosition() const;
 
+        // Rotates, scales or fades the element at composite time; its content is not rendered again.
+        void SetCompositeTransform(const CompositeTransform& transform);
+
+        CompositeTransform GetCompositeTransform() const;
+
+        // Elements are translucent unless they declare otherwise, usually in Initialize.
+        void SetOpacityHint(OpacityHint hint);
+
+        OpacityHint GetOpacityHint() const;
+
         bool GetTarget(ID2D1Bitmap1** target);
 
+        bool GetSurface(Surface* surface);
+
         System* GetParent() const;
 
+        ElementHandle GetHandle() const;
+
         void NotifyUpdated();
 
         bool ResetUpdatedFlag();
 
+        // Called from the system's worker threads, concurrently with other elements. Only draw into this element's
+        // target here; changing geometry, z-index or the updated flag of any element is not allowed.
         virtual void Render(System* parent) = 0;
 
     protected:
         ID2D1Bitmap1* GetTarget() const;
 
+        // Elements may share their target with others (atlas pages). BeginDraw selects the target, clips to the
+        // element's region and translates the origin to it; custom transforms must be composed with GetTargetTransform.
+        bool BeginDraw(ID2D1DeviceContext* context);
+
+        HRESULT EndDraw(ID2D1DeviceContext* context);
+
+        D2D1::Matrix3x2F GetTargetTransform() const;
+
+        // Replays list into this element's surface or target, whichever the system provides.
+        bool RenderDisplayList(const DisplayList& list);
+
     private:
         Pimpl *pimpl_;
     };
@@ -7,6 +7,8 @@
 #include <d2d1_2.h>
 #include <d3d11.h>
 #include <dwrite.h>
+#include "captured_frame.h"
+#include "types.h"
 
 #if defined(_WIN32) && defined(HMI_GRAPHICS_DLL)
 #if !defined(HMI_GRAPHICS_EXPORT)
@@ -19,23 +21,64 @@
 namespace hmi_graphics
 {
     class GraphicsElement;
+
+    struct TextFormatDesc
+    {
+        const wchar_t* fontFamily;
+        float fontSize;
+        DWRITE_FONT_WEIGHT fontWeight;
+        DWRITE_FONT_STYLE fontStyle;
+        DWRITE_FONT_STRETCH fontStretch;
+        DWRITE_TEXT_ALIGNMENT textAlignment;
+        DWRITE_PARAGRAPH_ALIGNMENT paragraphAlignment;
+    };
+
     class System
     {
     public:
         static HMI_GRAPHICS_EXPORT System* CreateInstance(HWND hWnd, int16_t width, int16_t height);
 
+        static HMI_GRAPHICS_EXPORT System* CreateHeadlessInstance(int16_t width, int16_t height);
+
         virtual ~System() = default;
 
+        // The system owns added elements: RemoveElement destroys them and the system destroys the remaining ones
+        // when it is deleted. Keep an ElementHandle rather than the pointer when the element may go away.
         template<typename T, typename... Args>
         T* AddElement(int16_t width, int16_t height, Args&&... args);
 
         virtual void RemoveElement(GraphicsElement* element) = 0;
 
+        virtual bool RemoveElement(ElementHandle handle) = 0;
+
+        virtual GraphicsElement* GetElement(ElementHandle handle) = 0;
+
+        // Each render thread has its own device context; call this from Render rather than caching the result.
         virtual bool GetDirect2dDeviceContext(ID2D1DeviceContext** deviceContext) = 0;
 
+        // The caches are safe to use from Render on any thread.
         virtual bool GetCachedColorBrush(const D2D1_COLOR_F& rgba, ID2D1SolidColorBrush** colorBrush) = 0;
 
-        virtual void Render() = 0;
+        virtual bool GetCachedTextFormat(const TextFormatDesc& desc, IDWriteTextFormat** textFormat) = 0;
+
+        // Shapes text once per text, format and layout box and shares the layout between all callers, so treat it
+        // as read-only. Layouts are evicted least recently used within a memory budget.
+        virtual bool GetCachedTextLayout(const wchar_t* text, uint32_t length, const TextFormatDesc& desc, float maxWidth,
+            float maxHeight, IDWriteTextLayout** textLayout) = 0;
+
+        // Blends text laid out in box into a surface (see GraphicsElement::GetSurface) with premultiplied argb. The
+        // rasterized text is kept in an atlas, so drawing the same text again is a blit. Only the headless backend
+        // has element surfaces; the others return false and elements draw the cached layout with Direct2D instead.
+        virtual bool DrawCachedText(const Surface& surface, const Rect& box, const wchar_t* text, uint32_t length,
+            const TextFormatDesc& desc, uint32_t argb) = 0;
+
+        virtual void GetResourceCacheStatistics(CacheStatistics* colorBrushes, CacheStatistics* textFormats) = 0;
+
+        // Layout sizes are reported in estimated bytes; textAtlas is empty on backends without DrawCachedText.
+        virtual void GetTextCacheStatistics(CacheStatistics* textLayouts, AtlasStatistics* textAtlas) = 0;
+
+        // Returns false when nothing was dirty and the frame was neither composited nor presented.
+        virtual bool Render() = 0;
 
         virtual void GetDirect3dDevice(ID3D11Device** device) = 0;
 
@@ -43,7 +86,59 @@ namespace hmi_graphics
 
         virtual void GetDirectWriteFactory(IDWriteFactory** factory) = 0;
 
-        virtual GraphicsElement* HitTest(int32_t x, int32_t y, GraphicsElement* hint) = 0;
+        // Returns the top-most element containing the point. Passing the same cursor again with the same point
+        // continues with the next element below; nullptr cursor returns only the top-most hit.
+        virtual GraphicsElement* HitTest(int32_t x, int32_t y, HitTestCursor* cursor) = 0;
+
+        virtual bool GetFramebuffer(Surface* framebuffer) = 0;
+
+        // Rects the last presented frame changed, e.g. for streaming it. Copies up to capacity of them and returns
+        // the total count; call from the thread that renders.
+        virtual size_t GetPresentedDamage(Rect* rects, size_t capacity) = 0;
+
+        // Capture copies every presented frame into a ring of depth buffers without stalling the renderer: the
+        // D3D11 backend copies the back buffer into staging textures and maps one only once its query reports the
+        // copy finished. 0 turns capture off. Fails while captured frames are held; call from the thread that renders.
+        virtual bool SetFrameCaptureDepth(size_t depth) = 0;
+
+        // Hands out the oldest ready captured frame; may be called from any thread. False when none is ready.
+        virtual bool AcquireCapturedFrame(CapturedFrame** frame) = 0;
+
+        // While the element surfaces together take more than bytes, the backing stores of elements outside the frame
+        // or faded out are freed, those shown least recently first. An evicted element is rendered again before it
+        // is next composited. Elements in view are never evicted, so the budget may still be exceeded; 0, the
+        // default, turns eviction off. Call these from the thread that renders.
+        virtual void SetSurfaceMemoryBudget(uint64_t bytes) = 0;
+
+        virtual void GetSurfaceMemoryStatistics(SurfaceMemoryStatistics* statistics) = 0;
+
+        // False when the handle is stale.
+        virtual bool GetElementSurfaceMemory(ElementHandle handle, ElementSurfaceMemory* memory) = 0;
+
+        // Elements that have not been updated, moved, resized, restacked or transformed for frames composited frames
+        // are flattened: each run of them adjacent in draw order is drawn once into a layer surface, which is then
+        // composited instead of its members. Changing a member or stacking another element among them dissolves the
+        // layer. 0, the default, turns flattening off; call from the thread that renders.
+        virtual void SetStaticLayerThreshold(uint32_t frames) = 0;
+
+        virtual void GetStaticLayerStatistics(StaticLayerStatistics* statistics) = 0;
+
+        // Signaled when the swap chain can accept another frame; nullptr when the backend has no such object.
+        virtual HANDLE GetFrameLatencyWaitableObject() = 0;
+
+        virtual void GetAtlasStatistics(AtlasStatistics* statistics) = 0;
+
+        // Profiling keeps the latest frames and element render timings in fixed-size rings; frames that neither
+        // rendered nor presented anything are not recorded. The getters copy up to capacity of the latest entries,
+        // oldest first, and may be called from any thread.
+        virtual void SetProfilingEnabled(bool enabled) = 0;
+
+        virtual size_t GetFrameStatistics(FrameStatistics* frames, size_t capacity) = 0;
+
+        virtual size_t GetElementTimings(ElementTiming* timings, size_t capacity) = 0;
+
+        // Writes the recorded frames as Chrome trace event JSON, viewable in chrome://tracing or Perfetto.
+        virtual bool ExportChromeTrace(const char* path) = 0;
 
     protected:
         virtual void AddElement(GraphicsElement* element, int16_t width, int16_t height) = 0;
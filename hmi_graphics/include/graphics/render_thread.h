@@ -0,0 +1,82 @@
+#ifndef HMI_RENDER_THREAD_H
+#define HMI_RENDER_THREAD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "frame_scheduler.h"
+#include "types.h"
+
+#if defined(_WIN32) && defined(HMI_GRAPHICS_DLL)
+#if !defined(HMI_GRAPHICS_EXPORT)
+#define HMI_GRAPHICS_EXPORT __declspec(dllexport)
+#endif
+#else
+#define HMI_GRAPHICS_EXPORT
+#endif
+
+namespace hmi_graphics
+{
+    class System;
+    class GraphicsElement;
+
+    // Runs System::Render and presentation on a dedicated thread. Once started, the system and its elements belong
+    // to that thread: other threads change the scene by posting commands, which never block (they fail when the
+    // queue is full), and read element geometry from a double-buffered snapshot published after every frame.
+    class HMI_GRAPHICS_EXPORT RenderThread
+    {
+    public:
+        class Pimpl;
+
+        explicit RenderThread(System* system, size_t queueCapacity = 4096);
+
+        RenderThread(const RenderThread&) = delete;
+
+        ~RenderThread();
+
+        bool SetPosition(ElementHandle handle, int16_t x, int16_t y);
+
+        bool SetSize(ElementHandle handle, int16_t width, int16_t height);
+
+        bool SetZIndex(ElementHandle handle, int16_t zIndex);
+
+        // Runs update on the render thread, e.g. to change an element's text or angle. Skipped if the handle is stale.
+        bool Invoke(ElementHandle handle, std::function<void(GraphicsElement*)> update);
+
+        // Runs update on the render thread with the system, e.g. to add or remove elements.
+        bool Invoke(std::function<void(System*)> update);
+
+        // Calls listener on the render thread after every presented frame, e.g. to read the framebuffer and
+        // System::GetPresentedDamage. Replaces the previous listener; an empty function removes it.
+        bool SetFrameListener(std::function<void(System*)> listener);
+
+        // Paces the following frames with a FrameScheduler: the thread waits for the scheduled start before it
+        // applies the queued commands and renders. targetFps 0 turns pacing off again, so frames render as soon as
+        // there is work.
+        bool SetFrameScheduler(const FrameSchedulerOptions& options);
+
+        // Statistics of the current scheduler, which starts from zero; false when pacing is off.
+        bool GetFrameSchedulerStatistics(FrameSchedulerStatistics* statistics) const;
+
+        // Reads the latest published snapshot; false when the element was not in it.
+        bool GetElementState(ElementHandle handle, ElementState* state) const;
+
+        // Top-most element of the latest published snapshot containing the point; generation 0 when none.
+        ElementHandle HitTest(int32_t x, int32_t y) const;
+
+        // Like System::HitTest: passing the same cursor again with the same point continues with the next element
+        // below, also when a newer snapshot was published in between.
+        ElementHandle HitTest(int32_t x, int32_t y, HitTestCursor* cursor) const;
+
+        uint64_t GetFrameCount() const;
+
+        // Applies the commands already queued, renders a last frame and joins the thread. The system may be used
+        // from the calling thread again afterwards.
+        void Stop();
+
+    private:
+        Pimpl* pimpl_;
+    };
+}
+
+#endif //HMI_RENDER_THREAD_H
@@ -1,6 +1,9 @@
 #ifndef HMI_GRAPHICS_TYPES_H
 #define HMI_GRAPHICS_TYPES_H
 
+#include <cstddef>
+#include <cstdint>
+
 namespace hmi_graphics
 {
     struct Point
@@ -20,6 +23,149 @@ namespace hmi_graphics
       Point origin;
       Size size;
     };
+
+    struct CacheStatistics
+    {
+      uint64_t hits;
+      uint64_t misses;
+      uint64_t evictions;
+      size_t size;
+      size_t capacity;
+    };
+
+    struct AtlasStatistics
+    {
+      size_t pageCount;
+      size_t allocationCount;
+      uint64_t usedArea;
+      uint64_t reservedArea;
+      uint64_t pageArea;
+      float fragmentation;
+    };
+
+    // Premultiplied R8G8B8A8 pixels in memory order, i.e. 0xAABBGGRR when read as uint32_t.
+    struct Surface
+    {
+      uint32_t* pixels;
+      int width;
+      int height;
+      int stride;
+    };
+
+    // Stable reference to an element owned by a System. Generation 0 never refers to a live element.
+    struct ElementHandle
+    {
+      uint32_t index;
+      uint32_t generation;
+    };
+
+    // Declared by an element. An opaque element fills every pixel of its rect with full alpha, so elements with a
+    // lower z-index behind it are not composited there. It is treated as translucent while its composite transform
+    // rotates, scales or fades it.
+    enum OpacityHint: uint8_t
+    {
+        OPACITY_HINT_TRANSLUCENT,
+        OPACITY_HINT_OPAQUE,
+    };
+
+    // Applied when an element's surface is composited, so changing it does not render the element again. Rotation is
+    // in degrees, clockwise like D2D1::Matrix3x2F::Rotation; rotation and scale pivot on the element's center.
+    struct CompositeTransform
+    {
+      float rotation;
+      float scaleX;
+      float scaleY;
+      float opacity;
+    };
+
+    // Element backing stores in bytes. Atlased surfaces count their region of the shared page and are never evicted.
+    struct SurfaceMemoryStatistics
+    {
+      uint64_t budgetBytes;
+      uint64_t residentBytes;
+      uint64_t evictedBytes;
+      size_t residentCount;
+      size_t evictedCount;
+      uint64_t evictions;
+      uint64_t restores;
+    };
+
+    struct ElementSurfaceMemory
+    {
+      uint64_t bytes;
+      bool resident;
+    };
+
+    struct StaticLayerStatistics
+    {
+      size_t layerCount;
+      size_t elementCount;
+      // Layer surfaces at 4 bytes per pixel.
+      uint64_t bytes;
+      uint64_t flattened;
+      uint64_t dissolved;
+    };
+
+    struct ElementState
+    {
+      ElementHandle handle;
+      Rect bounds;
+      int16_t zIndex;
+    };
+
+    enum FrameStage
+    {
+      FRAME_STAGE_ELEMENT_RENDER,
+      // Draw order maintenance is incremental; this is the time spent on it since the previous frame.
+      FRAME_STAGE_Z_ORDER,
+      FRAME_STAGE_COMPOSITE,
+      FRAME_STAGE_PRESENT,
+      FRAME_STAGE_COUNT,
+    };
+
+    struct StageTiming
+    {
+      uint32_t offsetMicroseconds;
+      uint32_t durationMicroseconds;
+    };
+
+    struct FrameStatistics
+    {
+      uint64_t frameIndex;
+      // Relative to the creation of the system.
+      uint64_t startMicroseconds;
+      uint32_t durationMicroseconds;
+      StageTiming stages[FRAME_STAGE_COUNT];
+      uint32_t dirtyElementCount;
+      uint32_t damageRectCount;
+      uint64_t damageArea;
+      CacheStatistics colorBrushes;
+      CacheStatistics textFormats;
+      CacheStatistics textLayouts;
+      bool presented;
+    };
+
+    struct ElementTiming
+    {
+      uint64_t frameIndex;
+      ElementHandle handle;
+      uint64_t startMicroseconds;
+      uint32_t durationMicroseconds;
+      uint32_t threadIndex;
+    };
+
+    // Continuation state for System::HitTest. Zero-initialize it, then pass it back with the same point to step
+    // from the top-most element under the point to the ones below it.
+    struct HitTestCursor
+    {
+      int32_t x;
+      int32_t y;
+      uint32_t position;
+      uint32_t version;
+      uint32_t sequence;
+      int16_t zIndex;
+      bool started;
+    };
 }
 
 #endif //HMI_GRAPHICS_TYPES_H
@@ -0,0 +1,220 @@
+#include "atlas_allocator.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        constexpr int SHELF_HEIGHT_GRANULARITY = 8;
+
+        int RoundUpShelfHeight(int height)
+        {
+            return (height + SHELF_HEIGHT_GRANULARITY - 1) / SHELF_HEIGHT_GRANULARITY * SHELF_HEIGHT_GRANULARITY;
+        }
+    }
+
+    AtlasAllocator::AtlasAllocator(int pageWidth, int pageHeight, int padding, size_t maxPages)
+        : pageWidth_{pageWidth}
+        , pageHeight_{pageHeight}
+        , padding_{padding}
+        , maxPages_{maxPages}
+        , allocationCount_{}
+        , usedArea_{}
+    {
+    }
+
+    bool AtlasAllocator::Allocate(int width, int height, AtlasRegion* region)
+    {
+        if(region == nullptr || width <= 0 || height <= 0)
+            return false;
+
+        const int paddedWidth = width + padding_ * 2;
+        const int paddedHeight = height + padding_ * 2;
+        if(paddedWidth > pageWidth_ || paddedHeight > pageHeight_)
+            return false;
+
+        Rect rect{};
+        bool allocated = false;
+        for(size_t i = 0; i < pages_.size() && !allocated; ++i)
+        {
+            if(AllocateInPage(pages_[i], paddedWidth, paddedHeight, &rect))
+            {
+                region->page = static_cast<uint32_t>(i);
+                allocated = true;
+            }
+        }
+
+        if(!allocated)
+        {
+            if(pages_.size() >= maxPages_)
+                return false;
+
+            pages_.push_back(Page{0, {}});
+            if(!AllocateInPage(pages_.back(), paddedWidth, paddedHeight, &rect))
+                return false;
+
+            region->page = static_cast<uint32_t>(pages_.size() - 1);
+        }
+
+        region->rect = Rect{Point{rect.origin.x + padding_, rect.origin.y + padding_}, Size{width, height}};
+        allocationCount_ += 1;
+        usedArea_ += static_cast<uint64_t>(paddedWidth) * paddedHeight;
+        return true;
+    }
+
+    void AtlasAllocator::Free(const AtlasRegion& region)
+    {
+        if(region.page >= pages_.size())
+            return;
+
+        Page& page = pages_[region.page];
+        const int x = region.rect.origin.x - padding_;
+        const int y = region.rect.origin.y - padding_;
+        for(auto& shelf: page.shelves)
+        {
+            if(shelf.y != y)
+                continue;
+
+            for(size_t i = 0; i < shelf.spans.size(); ++i)
+            {
+                Span& span = shelf.spans[i];
+                if(span.x != x || !span.used)
+                    continue;
+
+                span.used = false;
+                allocationCount_ -= 1;
+                usedArea_ -= static_cast<uint64_t>(span.width) * (region.rect.size.height + padding_ * 2);
+                if(i + 1 < shelf.spans.size() && !shelf.spans[i + 1].used)
+                {
+                    span.width += shelf.spans[i + 1].width;
+                    shelf.spans.erase(shelf.spans.begin() + i + 1);
+                }
+
+                if(i > 0 && !shelf.spans[i - 1].used)
+                {
+                    shelf.spans[i - 1].width += shelf.spans[i].width;
+                    shelf.spans.erase(shelf.spans.begin() + i);
+                }
+
+                break;
+            }
+
+            break;
+        }
+
+        while(!page.shelves.empty())
+        {
+            const Shelf& last = page.shelves.back();
+            if(last.spans.size() != 1 || last.spans.front().used)
+                break;
+
+            page.nextShelfY = last.y;
+            page.shelves.pop_back();
+        }
+    }
+
+    size_t AtlasAllocator::GetPageCount() const
+    {
+        return pages_.size();
+    }
+
+    int AtlasAllocator::GetPageWidth() const
+    {
+        return pageWidth_;
+    }
+
+    int AtlasAllocator::GetPageHeight() const
+    {
+        return pageHeight_;
+    }
+
+    AtlasStatistics AtlasAllocator::GetStatistics() const
+    {
+        AtlasStatistics statistics{};
+        statistics.pageCount = pages_.size();
+        statistics.allocationCount = allocationCount_;
+        statistics.usedArea = usedArea_;
+        statistics.pageArea = static_cast<uint64_t>(pageWidth_) * pageHeight_ * pages_.size();
+        for(auto& page: pages_)
+        {
+            for(auto& shelf: page.shelves)
+            {
+                statistics.reservedArea += static_cast<uint64_t>(pageWidth_) * shelf.height;
+            }
+        }
+
+        if(statistics.reservedArea > 0)
+        {
+            statistics.fragmentation = 1.f - static_cast<float>(statistics.usedArea) / statistics.reservedArea;
+        }
+
+        return statistics;
+    }
+
+    bool AtlasAllocator::AllocateInPage(Page& page, int width, int height, Rect* rect)
+    {
+        Shelf* best = nullptr;
+        int bestWaste = std::numeric_limits<int>::max();
+        for(auto& shelf: page.shelves)
+        {
+            if(shelf.height < height || shelf.height - height >= bestWaste)
+                continue;
+
+            for(auto& span: shelf.spans)
+            {
+                if(!span.used && span.width >= width)
+                {
+                    best = &shelf;
+                    bestWaste = shelf.height - height;
+                    break;
+                }
+            }
+        }
+
+        // Only reuse a much taller shelf when the page has no room left for a new one.
+        const int shelfHeight = std::min(RoundUpShelfHeight(height), pageHeight_ - page.nextShelfY);
+        const bool canOpenShelf = shelfHeight >= height;
+        if(best != nullptr && (bestWaste < height || !canOpenShelf))
+            return AllocateInShelf(*best, width, rect);
+
+        if(canOpenShelf)
+        {
+            Shelf shelf{page.nextShelfY, shelfHeight, {Span{0, pageWidth_, false}}};
+            page.nextShelfY += shelf.height;
+            page.shelves.push_back(shelf);
+            return AllocateInShelf(page.shelves.back(), width, rect);
+        }
+
+        return false;
+    }
+
+    bool AtlasAllocator::AllocateInShelf(Shelf& shelf, int width, Rect* rect)
+    {
+        for(size_t i = 0; i < shelf.spans.size(); ++i)
+        {
+            Span& span = shelf.spans[i];
+            if(span.used || span.width < width)
+                continue;
+
+            const int x = span.x;
+            if(span.width > width)
+            {
+                Span rest{span.x + width, span.width - width, false};
+                span.width = width;
+                span.used = true;
+                shelf.spans.insert(shelf.spans.begin() + i + 1, rest);
+            }
+            else
+            {
+                span.used = true;
+            }
+
+            *rect = Rect{Point{x, shelf.y}, Size{width, shelf.height}};
+            return true;
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef HMI_ATLAS_ALLOCATOR_H
+#define HMI_ATLAS_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "types.h"
+
+namespace hmi_graphics
+{
+    struct AtlasRegion
+    {
+        uint32_t page;
+        Rect rect;
+    };
+
+    // Shelf packer over fixed-size pages. Each shelf is a horizontal band split into used and free spans; freed
+    // spans are coalesced with their neighbours and trailing empty shelves are returned to the page. Pages are opened
+    // on demand up to maxPages; past that Allocate fails and the caller has to Free something first.
+    class AtlasAllocator
+    {
+    public:
+        AtlasAllocator(int pageWidth, int pageHeight, int padding = 1, size_t maxPages = SIZE_MAX);
+
+        bool Allocate(int width, int height, AtlasRegion* region);
+
+        void Free(const AtlasRegion& region);
+
+        size_t GetPageCount() const;
+
+        int GetPageWidth() const;
+
+        int GetPageHeight() const;
+
+        AtlasStatistics GetStatistics() const;
+
+    private:
+        struct Span
+        {
+            int x;
+            int width;
+            bool used;
+        };
+
+        struct Shelf
+        {
+            int y;
+            int height;
+            std::vector<Span> spans;
+        };
+
+        struct Page
+        {
+            int nextShelfY;
+            std::vector<Shelf> shelves;
+        };
+
+        bool AllocateInPage(Page& page, int width, int height, Rect* rect);
+
+        bool AllocateInShelf(Shelf& shelf, int width, Rect* rect);
+
+        std::vector<Page> pages_;
+        int pageWidth_;
+        int pageHeight_;
+        int padding_;
+        size_t maxPages_;
+        size_t allocationCount_;
+        uint64_t usedArea_;
+    };
+}
+
+#endif //HMI_ATLAS_ALLOCATOR_H
@@ -0,0 +1,166 @@
+#include "blend.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(HMI_GRAPHICS_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        inline uint32_t Div255(uint32_t value)
+        {
+            value += 128;
+            return (value + (value >> 8)) >> 8;
+        }
+
+        inline uint32_t BlendPixel(uint32_t dst, uint32_t src)
+        {
+            const uint32_t alpha = src >> 24;
+            if(alpha == 255)
+                return src;
+
+            if(src == 0)
+                return dst;
+
+            const uint32_t inverse = 255 - alpha;
+            uint32_t result = 0;
+            for(int shift = 0; shift < 32; shift += 8)
+            {
+                uint32_t channel = ((src >> shift) & 0xFF) + Div255(((dst >> shift) & 0xFF) * inverse);
+                result |= std::min<uint32_t>(channel, 255) << shift;
+            }
+
+            return result;
+        }
+
+#if defined(HMI_GRAPHICS_SSE2)
+        // x / 255 rounded, exact for every product of two 8-bit values; same as Div255.
+        inline __m128i Div255Epi16(__m128i value)
+        {
+            value = _mm_add_epi16(value, _mm_set1_epi16(128));
+            return _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+        }
+
+        inline __m128i BlendHalf(__m128i dst16, __m128i src16)
+        {
+            const __m128i full = _mm_set1_epi16(255);
+            __m128i alpha = _mm_shufflelo_epi16(src16, _MM_SHUFFLE(3, 3, 3, 3));
+            alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+            return _mm_add_epi16(src16, Div255Epi16(_mm_mullo_epi16(dst16, _mm_sub_epi16(full, alpha))));
+        }
+#endif
+    }
+
+    void BlendRowSourceOver(uint32_t* dst, const uint32_t* src, size_t count)
+    {
+        size_t i = 0;
+#if defined(HMI_GRAPHICS_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        for(; i + 4 <= count; i += 4)
+        {
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i sourceAlpha = _mm_and_si128(s, alphaMask);
+            if(_mm_movemask_epi8(_mm_cmpeq_epi32(sourceAlpha, alphaMask)) == 0xFFFF)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), s);
+                continue;
+            }
+
+            if(_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xFFFF)
+                continue;
+
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+            __m128i low = BlendHalf(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero));
+            __m128i high = BlendHalf(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(low, high));
+        }
+#endif
+        BlendRowSourceOverScalar(dst + i, src + i, count - i);
+    }
+
+    void BlendRowMask(uint32_t* dst, const uint8_t* mask, uint32_t color, size_t count)
+    {
+        size_t i = 0;
+#if defined(HMI_GRAPHICS_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i color16 = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color)), zero);
+        for(; i + 4 <= count; i += 4)
+        {
+            uint32_t coverage;
+            std::memcpy(&coverage, mask + i, sizeof(coverage));
+            if(coverage == 0)
+                continue;
+
+            // Each coverage byte repeated for the four channels of its pixel, then scaled color as the source.
+            __m128i spread = _mm_cvtsi32_si128(static_cast<int>(coverage));
+            spread = _mm_unpacklo_epi8(spread, spread);
+            spread = _mm_unpacklo_epi16(spread, spread);
+            const __m128i srcLow = Div255Epi16(_mm_mullo_epi16(color16, _mm_unpacklo_epi8(spread, zero)));
+            const __m128i srcHigh = Div255Epi16(_mm_mullo_epi16(color16, _mm_unpackhi_epi8(spread, zero)));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+            __m128i low = BlendHalf(_mm_unpacklo_epi8(d, zero), srcLow);
+            __m128i high = BlendHalf(_mm_unpackhi_epi8(d, zero), srcHigh);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(low, high));
+        }
+#endif
+        BlendRowMaskScalar(dst + i, mask + i, color, count - i);
+    }
+
+    void FillRow(uint32_t* dst, uint32_t value, size_t count)
+    {
+        size_t i = 0;
+#if defined(HMI_GRAPHICS_SSE2)
+        const __m128i v = _mm_set1_epi32(static_cast<int>(value));
+        for(; i + 4 <= count; i += 4)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+        }
+#endif
+        FillRowScalar(dst + i, value, count - i);
+    }
+
+    void BlendRowSourceOverScalar(uint32_t* dst, const uint32_t* src, size_t count)
+    {
+        for(size_t i = 0; i < count; ++i)
+        {
+            dst[i] = BlendPixel(dst[i], src[i]);
+        }
+    }
+
+    void BlendRowMaskScalar(uint32_t* dst, const uint8_t* mask, uint32_t color, size_t count)
+    {
+        for(size_t i = 0; i < count; ++i)
+        {
+            const uint32_t coverage = mask[i];
+            if(coverage == 0)
+                continue;
+
+            if(coverage == 255)
+            {
+                dst[i] = BlendPixel(dst[i], color);
+                continue;
+            }
+
+            uint32_t src = 0;
+            for(int shift = 0; shift < 32; shift += 8)
+            {
+                src |= Div255(((color >> shift) & 0xFF) * coverage) << shift;
+            }
+
+            dst[i] = BlendPixel(dst[i], src);
+        }
+    }
+
+    void FillRowScalar(uint32_t* dst, uint32_t value, size_t count)
+    {
+        for(size_t i = 0; i < count; ++i)
+        {
+            dst[i] = value;
+        }
+    }
+}
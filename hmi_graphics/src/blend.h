@@ -0,0 +1,26 @@
+#ifndef HMI_BLEND_H
+#define HMI_BLEND_H
+
+#include <cstddef>
+#include <cstdint>
+#include "simd_config.h"
+
+namespace hmi_graphics
+{
+    // Premultiplied source-over: dst = src + dst * (255 - src.a) / 255
+    void BlendRowSourceOver(uint32_t* dst, const uint32_t* src, size_t count);
+
+    // Source-over of a solid premultiplied color scaled by 8-bit coverage, e.g. anti-aliased text.
+    void BlendRowMask(uint32_t* dst, const uint8_t* mask, uint32_t color, size_t count);
+
+    void FillRow(uint32_t* dst, uint32_t value, size_t count);
+
+    // Portable versions of the above, used for the pixels the SIMD kernels leave over and to check them against.
+    void BlendRowSourceOverScalar(uint32_t* dst, const uint32_t* src, size_t count);
+
+    void BlendRowMaskScalar(uint32_t* dst, const uint8_t* mask, uint32_t color, size_t count);
+
+    void FillRowScalar(uint32_t* dst, uint32_t value, size_t count);
+}
+
+#endif //HMI_BLEND_H
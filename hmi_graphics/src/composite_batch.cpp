@@ -0,0 +1,131 @@
+#include "composite_batch.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        // How many batches back a quad may move; bounds the cost of a pass with many textures.
+        constexpr size_t MAX_BATCH_LOOKBACK = 16;
+
+        void GetQuadBounds(const CompositeQuad& quad, float* left, float* top, float* right, float* bottom)
+        {
+            const float centerX = (quad.destLeft + quad.destRight) * .5f;
+            const float centerY = (quad.destTop + quad.destBottom) * .5f;
+            const float halfWidth = (quad.destRight - quad.destLeft) * .5f;
+            const float halfHeight = (quad.destBottom - quad.destTop) * .5f;
+            const float extentX = std::abs(quad.transform11) * halfWidth + std::abs(quad.transform21) * halfHeight;
+            const float extentY = std::abs(quad.transform12) * halfWidth + std::abs(quad.transform22) * halfHeight;
+            *left = centerX - extentX;
+            *top = centerY - extentY;
+            *right = centerX + extentX;
+            *bottom = centerY + extentY;
+        }
+    }
+
+    void CompositeBatchBuilder::Reset()
+    {
+        items_.clear();
+        passes_.clear();
+        instances_.clear();
+        batches_.clear();
+    }
+
+    void CompositeBatchBuilder::BeginPass(const Rect& scissor)
+    {
+        items_.clear();
+        passes_.push_back(scissor);
+    }
+
+    void CompositeBatchBuilder::Add(uint32_t texture, int32_t zIndex, const CompositeQuad& quad)
+    {
+        items_.push_back(Item{zIndex, texture, quad});
+    }
+
+    void CompositeBatchBuilder::EndPass()
+    {
+        // Elements are added in draw order already; the sort only serves callers that add them otherwise.
+        const auto byZIndex = [](const Item& lhs, const Item& rhs)
+        {
+            return lhs.zIndex < rhs.zIndex;
+        };
+        if(!std::is_sorted(items_.begin(), items_.end(), byZIndex))
+        {
+            std::stable_sort(items_.begin(), items_.end(), byZIndex);
+        }
+
+        pending_.clear();
+        itemBatches_.resize(items_.size());
+        for(size_t i = 0; i < items_.size(); ++i)
+        {
+            const Item& item = items_[i];
+            float left, top, right, bottom;
+            GetQuadBounds(item.quad, &left, &top, &right, &bottom);
+
+            // Walk back over the batches drawn after the candidate; the quad may only move below those it misses.
+            size_t target = pending_.size();
+            for(size_t back = 0; back < MAX_BATCH_LOOKBACK && back < pending_.size(); ++back)
+            {
+                const PendingBatch& batch = pending_[pending_.size() - 1 - back];
+                if(batch.texture == item.texture)
+                {
+                    target = pending_.size() - 1 - back;
+                    break;
+                }
+
+                if(left < batch.right && batch.left < right && top < batch.bottom && batch.top < bottom)
+                    break;
+            }
+
+            if(target == pending_.size())
+            {
+                pending_.push_back(PendingBatch{item.texture, 0, left, top, right, bottom});
+            }
+
+            PendingBatch& batch = pending_[target];
+            batch.count += 1;
+            batch.left = std::min(batch.left, left);
+            batch.top = std::min(batch.top, top);
+            batch.right = std::max(batch.right, right);
+            batch.bottom = std::max(batch.bottom, bottom);
+            itemBatches_[i] = static_cast<uint32_t>(target);
+        }
+
+        // Lay the batches out contiguously; quads keep their order within a batch.
+        const uint32_t pass = static_cast<uint32_t>(passes_.size() - 1);
+        const size_t firstBatch = batches_.size();
+        uint32_t instance = static_cast<uint32_t>(instances_.size());
+        for(auto& batch: pending_)
+        {
+            batches_.push_back(CompositeBatch{pass, batch.texture, instance, 0});
+            instance += batch.count;
+        }
+
+        instances_.resize(instance);
+        for(size_t i = 0; i < items_.size(); ++i)
+        {
+            CompositeBatch& batch = batches_[firstBatch + itemBatches_[i]];
+            instances_[batch.firstInstance + batch.instanceCount] = items_[i].quad;
+            batch.instanceCount += 1;
+        }
+
+        items_.clear();
+    }
+
+    const std::vector<Rect>& CompositeBatchBuilder::GetPasses() const
+    {
+        return passes_;
+    }
+
+    const std::vector<CompositeQuad>& CompositeBatchBuilder::GetInstances() const
+    {
+        return instances_;
+    }
+
+    const std::vector<CompositeBatch>& CompositeBatchBuilder::GetBatches() const
+    {
+        return batches_;
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef HMI_COMPOSITE_BATCH_H
+#define HMI_COMPOSITE_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "types.h"
+
+namespace hmi_graphics
+{
+    // Per-instance data of one composited quad: destination rect in pixels, source rect in texture UVs and the
+    // element's composite transform as a row-vector 2x2 matrix around the center of the destination rect.
+    struct CompositeQuad
+    {
+        float destLeft;
+        float destTop;
+        float destRight;
+        float destBottom;
+        float sourceLeft;
+        float sourceTop;
+        float sourceRight;
+        float sourceBottom;
+        float transform11;
+        float transform12;
+        float transform21;
+        float transform22;
+        float opacity;
+        float padding[3];
+    };
+
+    struct CompositeBatch
+    {
+        uint32_t pass;
+        uint32_t texture;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+    };
+
+    // Collects quads per scissor pass and turns them into one contiguous instance array plus one draw per batch of
+    // quads sharing a texture. Quads are drawn by z-index, then insertion order, like the elements they come from. A
+    // quad joins an earlier batch of its texture only if nothing drawn in between overlaps it, so the merging never
+    // changes which quad ends up on top.
+    class CompositeBatchBuilder
+    {
+    public:
+        void Reset();
+
+        void BeginPass(const Rect& scissor);
+
+        void Add(uint32_t texture, int32_t zIndex, const CompositeQuad& quad);
+
+        void EndPass();
+
+        const std::vector<Rect>& GetPasses() const;
+
+        const std::vector<CompositeQuad>& GetInstances() const;
+
+        const std::vector<CompositeBatch>& GetBatches() const;
+
+    private:
+        struct Item
+        {
+            int32_t zIndex;
+            uint32_t texture;
+            CompositeQuad quad;
+        };
+
+        // Batch of the current pass with the destination bounds of its quads, transforms included.
+        struct PendingBatch
+        {
+            uint32_t texture;
+            uint32_t count;
+            float left;
+            float top;
+            float right;
+            float bottom;
+        };
+
+        std::vector<Item> items_;
+        std::vector<PendingBatch> pending_;
+        std::vector<uint32_t> itemBatches_;
+        std::vector<Rect> passes_;
+        std::vector<CompositeQuad> instances_;
+        std::vector<CompositeBatch> batches_;
+    };
+}
+
+#endif //HMI_COMPOSITE_BATCH_H
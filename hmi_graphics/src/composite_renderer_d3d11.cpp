@@ -0,0 +1,236 @@
+#include "composite_renderer_d3d11.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <d3dcompiler.h>
+
+#define STRINGIZE_DETAIL(x) #x
+#define STRINGIZE(x) STRINGIZE_DETAIL(x)
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        constexpr size_t INITIAL_INSTANCE_CAPACITY = 256;
+
+        const char COMPOSITE_SHADER[] = R"(
+cbuffer Viewport : register(b0)
+{
+    float2 inverseViewportSize;
+    float2 padding;
+};
+
+struct Instance
+{
+    float4 dest : DEST;
+    float4 source : SOURCE;
+    float4 transform : TRANSFORM;
+    float4 parameters : PARAMETERS;
+};
+
+struct VertexOut
+{
+    float4 position : SV_Position;
+    float2 uv : TEXCOORD0;
+    float opacity : OPACITY;
+};
+
+VertexOut VSMain(Instance instance, uint vertexId : SV_VertexID)
+{
+    float2 corner = float2(vertexId & 1, vertexId >> 1);
+    float2 center = (instance.dest.xy + instance.dest.zw) * 0.5;
+    float2 offset = lerp(instance.dest.xy, instance.dest.zw, corner) - center;
+    float2 position = center + offset.x * instance.transform.xy + offset.y * instance.transform.zw;
+    VertexOut output;
+    output.position = float4(position.x * inverseViewportSize.x * 2.0 - 1.0, 1.0 - position.y * inverseViewportSize.y * 2.0, 0.0, 1.0);
+    output.uv = lerp(instance.source.xy, instance.source.zw, corner);
+    output.opacity = instance.parameters.x;
+    return output;
+}
+
+Texture2D source : register(t0);
+SamplerState sourceSampler : register(s0);
+
+float4 PSMain(VertexOut input) : SV_Target
+{
+    return source.Sample(sourceSampler, input.uv) * input.opacity;
+}
+)";
+
+        struct ViewportConstants
+        {
+            float inverseViewportSize[2];
+            float padding[2];
+        };
+
+        ComPtr<ID3DBlob> CompileShader(const char* entryPoint, const char* target)
+        {
+            ComPtr<ID3DBlob> code;
+            ComPtr<ID3DBlob> errors;
+            HRESULT hr = D3DCompile(COMPOSITE_SHADER, sizeof(COMPOSITE_SHADER) - 1, "composite.hlsl", nullptr, nullptr,
+                entryPoint, target, D3DCOMPILE_OPTIMIZATION_LEVEL3, 0, &code, &errors);
+            if(FAILED(hr))
+                throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " D3DCompile");
+
+            return code;
+        }
+    }
+
+    CompositeRendererD3D11::CompositeRendererD3D11(ID3D11Device* device)
+        : device_{device}
+        , instanceCapacity_{}
+    {
+        HRESULT hr;
+        auto vertexCode = CompileShader("VSMain", "vs_4_0");
+        auto pixelCode = CompileShader("PSMain", "ps_4_0");
+        hr = device->CreateVertexShader(vertexCode->GetBufferPointer(), vertexCode->GetBufferSize(), nullptr, &vertexShader_);
+        if(FAILED(hr))
+            throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " CreateVertexShader");
+
+        hr = device->CreatePixelShader(pixelCode->GetBufferPointer(), pixelCode->GetBufferSize(), nullptr, &pixelShader_);
+        if(FAILED(hr))
+            throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " CreatePixelShader");
+
+        const D3D11_INPUT_ELEMENT_DESC layout[] = {
+            {"DEST", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, offsetof(CompositeQuad, destLeft), D3D11_INPUT_PER_INSTANCE_DATA, 1},
+            {"SOURCE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, offsetof(CompositeQuad, sourceLeft), D3D11_INPUT_PER_INSTANCE_DATA, 1},
+            {"TRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, offsetof(CompositeQuad, transform11), D3D11_INPUT_PER_INSTANCE_DATA, 1},
+            {"PARAMETERS", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, offsetof(CompositeQuad, opacity), D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        };
+        hr = device->CreateInputLayout(layout, 4, vertexCode->GetBufferPointer(), vertexCode->GetBufferSize(), &inputLayout_);
+        if(FAILED(hr))
+            throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " CreateInputLayout");
+
+        D3D11_BUFFER_DESC constantsDesc{};
+        constantsDesc.ByteWidth = sizeof(ViewportConstants);
+        constantsDesc.Usage = D3D11_USAGE_DYNAMIC;
+        constantsDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        constantsDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        hr = device->CreateBuffer(&constantsDesc, nullptr, &constants_);
+        if(FAILED(hr))
+            throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " CreateBuffer");
+
+        // Element surfaces hold premultiplied alpha.
+        D3D11_BLEND_DESC blendDesc{};
+        blendDesc.RenderTarget[0].BlendEnable = TRUE;
+        blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+        blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+        blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+        blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+        blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+        blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+        blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+        hr = device->CreateBlendState(&blendDesc, &blendState_);
+        if(FAILED(hr))
+            throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " CreateBlendState");
+
+        D3D11_RASTERIZER_DESC rasterizerDesc{};
+        rasterizerDesc.FillMode = D3D11_FILL_SOLID;
+        rasterizerDesc.CullMode = D3D11_CULL_NONE;
+        rasterizerDesc.DepthClipEnable = TRUE;
+        rasterizerDesc.ScissorEnable = TRUE;
+        hr = device->CreateRasterizerState(&rasterizerDesc, &rasterizerState_);
+        if(FAILED(hr))
+            throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " CreateRasterizerState");
+
+        D3D11_SAMPLER_DESC samplerDesc{};
+        samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+        samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+        samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+        hr = device->CreateSamplerState(&samplerDesc, &sampler_);
+        if(FAILED(hr))
+            throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " CreateSamplerState");
+
+        if(!EnsureInstanceCapacity(INITIAL_INSTANCE_CAPACITY))
+            throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " CreateBuffer");
+    }
+
+    void CompositeRendererD3D11::Draw(ID3D11DeviceContext* context, ID3D11RenderTargetView* target, int width, int height,
+        const CompositeBatchBuilder& batches, const std::vector<ComPtr<ID3D11ShaderResourceView>>& textures)
+    {
+        auto& instances = batches.GetInstances();
+        if(instances.empty() || !EnsureInstanceCapacity(instances.size()))
+            return;
+
+        D3D11_MAPPED_SUBRESOURCE mapped{};
+        if(FAILED(context->Map(instances_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+            return;
+
+        std::memcpy(mapped.pData, instances.data(), instances.size() * sizeof(CompositeQuad));
+        context->Unmap(instances_.Get(), 0);
+
+        if(SUCCEEDED(context->Map(constants_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+        {
+            ViewportConstants constants{{1.f / width, 1.f / height}, {0.f, 0.f}};
+            std::memcpy(mapped.pData, &constants, sizeof(constants));
+            context->Unmap(constants_.Get(), 0);
+        }
+
+        const UINT stride = sizeof(CompositeQuad);
+        const UINT offset = 0;
+        D3D11_VIEWPORT viewport{0.f, 0.f, (float)width, (float)height, 0.f, 1.f};
+        context->OMSetRenderTargets(1, &target, nullptr);
+        context->OMSetBlendState(blendState_.Get(), nullptr, 0xFFFFFFFF);
+        context->RSSetState(rasterizerState_.Get());
+        context->RSSetViewports(1, &viewport);
+        context->IASetInputLayout(inputLayout_.Get());
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+        context->IASetVertexBuffers(0, 1, instances_.GetAddressOf(), &stride, &offset);
+        context->VSSetShader(vertexShader_.Get(), nullptr, 0);
+        context->VSSetConstantBuffers(0, 1, constants_.GetAddressOf());
+        context->PSSetShader(pixelShader_.Get(), nullptr, 0);
+        context->PSSetSamplers(0, 1, sampler_.GetAddressOf());
+
+        auto& passes = batches.GetPasses();
+        uint32_t currentPass = UINT32_MAX;
+        for(auto& batch: batches.GetBatches())
+        {
+            if(batch.pass != currentPass)
+            {
+                auto& scissor = passes[batch.pass];
+                D3D11_RECT rect{scissor.origin.x, scissor.origin.y, scissor.origin.x + scissor.size.width, scissor.origin.y + scissor.size.height};
+                context->RSSetScissorRects(1, &rect);
+                currentPass = batch.pass;
+            }
+
+            context->PSSetShaderResources(0, 1, textures[batch.texture].GetAddressOf());
+            context->DrawInstanced(4, batch.instanceCount, 0, batch.firstInstance);
+        }
+
+        // Element surfaces are render targets again on the next frame.
+        ID3D11ShaderResourceView* nullView = nullptr;
+        context->PSSetShaderResources(0, 1, &nullView);
+        ID3D11RenderTargetView* nullTarget = nullptr;
+        context->OMSetRenderTargets(1, &nullTarget, nullptr);
+    }
+
+    bool CompositeRendererD3D11::EnsureInstanceCapacity(size_t count)
+    {
+        if(count <= instanceCapacity_)
+            return true;
+
+        size_t capacity = instanceCapacity_ > 0 ? instanceCapacity_ : INITIAL_INSTANCE_CAPACITY;
+        while(capacity < count)
+        {
+            capacity *= 2;
+        }
+
+        D3D11_BUFFER_DESC desc{};
+        desc.ByteWidth = static_cast<UINT>(capacity * sizeof(CompositeQuad));
+        desc.Usage = D3D11_USAGE_DYNAMIC;
+        desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        ComPtr<ID3D11Buffer> buffer;
+        if(FAILED(device_->CreateBuffer(&desc, nullptr, &buffer)))
+            return false;
+
+        instances_ = buffer;
+        instanceCapacity_ = capacity;
+        return true;
+    }
+}
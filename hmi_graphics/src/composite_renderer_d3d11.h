@@ -0,0 +1,37 @@
+#ifndef HMI_COMPOSITE_RENDERER_D3D11_H
+#define HMI_COMPOSITE_RENDERER_D3D11_H
+
+#include <vector>
+#include <d3d11.h>
+#include "comptr.h"
+#include "composite_batch.h"
+
+namespace hmi_graphics
+{
+    // Draws the output of a CompositeBatchBuilder with one instanced draw per batch: every quad lives in a single
+    // dynamic instance buffer and the vertex shader expands it from SV_VertexID.
+    class CompositeRendererD3D11
+    {
+    public:
+        explicit CompositeRendererD3D11(ID3D11Device* device);
+
+        void Draw(ID3D11DeviceContext* context, ID3D11RenderTargetView* target, int width, int height,
+            const CompositeBatchBuilder& batches, const std::vector<ComPtr<ID3D11ShaderResourceView>>& textures);
+
+    private:
+        bool EnsureInstanceCapacity(size_t count);
+
+        ComPtr<ID3D11Device> device_;
+        ComPtr<ID3D11VertexShader> vertexShader_;
+        ComPtr<ID3D11PixelShader> pixelShader_;
+        ComPtr<ID3D11InputLayout> inputLayout_;
+        ComPtr<ID3D11Buffer> constants_;
+        ComPtr<ID3D11Buffer> instances_;
+        ComPtr<ID3D11BlendState> blendState_;
+        ComPtr<ID3D11RasterizerState> rasterizerState_;
+        ComPtr<ID3D11SamplerState> sampler_;
+        size_t instanceCapacity_;
+    };
+}
+
+#endif //HMI_COMPOSITE_RENDERER_D3D11_H
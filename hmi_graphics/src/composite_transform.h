@@ -0,0 +1,62 @@
+#ifndef HMI_COMPOSITE_TRANSFORM_H
+#define HMI_COMPOSITE_TRANSFORM_H
+
+#include <cmath>
+#include "types.h"
+
+namespace hmi_graphics
+{
+    // Row-vector 2x2 matrix of a CompositeTransform, applied to offsets from the element's center.
+    struct CompositeMatrix
+    {
+        float m11;
+        float m12;
+        float m21;
+        float m22;
+    };
+
+    inline CompositeTransform MakeIdentityCompositeTransform()
+    {
+        return CompositeTransform{0.f, 1.f, 1.f, 1.f};
+    }
+
+    inline bool CompositeTransformsEqual(const CompositeTransform& lhs, const CompositeTransform& rhs)
+    {
+        return lhs.rotation == rhs.rotation && lhs.scaleX == rhs.scaleX && lhs.scaleY == rhs.scaleY
+            && lhs.opacity == rhs.opacity;
+    }
+
+    // Whether the transform moves pixels, as opposed to only changing opacity.
+    inline bool HasCompositeGeometry(const CompositeTransform& transform)
+    {
+        return transform.rotation != 0.f || transform.scaleX != 1.f || transform.scaleY != 1.f;
+    }
+
+    inline CompositeMatrix MakeCompositeMatrix(const CompositeTransform& transform)
+    {
+        const float radians = transform.rotation * 3.14159265358979f / 180.f;
+        const float cosine = std::cos(radians);
+        const float sine = std::sin(radians);
+        return CompositeMatrix{transform.scaleX * cosine, transform.scaleX * sine, -transform.scaleY * sine, transform.scaleY * cosine};
+    }
+
+    // Pixels the transformed element extends beyond (or, when shrunk, stays within) each side of its layout rect.
+    // Includes one pixel for bilinear filtering of transformed quads.
+    inline void GetCompositeOutset(const CompositeTransform& transform, int width, int height, int* outsetX, int* outsetY)
+    {
+        if(!HasCompositeGeometry(transform) || width <= 0 || height <= 0)
+        {
+            *outsetX = 0;
+            *outsetY = 0;
+            return;
+        }
+
+        const CompositeMatrix matrix = MakeCompositeMatrix(transform);
+        const float halfWidth = (std::abs(matrix.m11) * width + std::abs(matrix.m21) * height) / 2.f;
+        const float halfHeight = (std::abs(matrix.m12) * width + std::abs(matrix.m22) * height) / 2.f;
+        *outsetX = static_cast<int>(std::ceil(halfWidth - width / 2.f)) + 1;
+        *outsetY = static_cast<int>(std::ceil(halfHeight - height / 2.f)) + 1;
+    }
+}
+
+#endif //HMI_COMPOSITE_TRANSFORM_H
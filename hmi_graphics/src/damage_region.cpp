@@ -0,0 +1,104 @@
+#include "damage_region.h"
+
+#include "rect_util.h"
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        bool ShouldMerge(const Rect& lhs, const Rect& rhs)
+        {
+            const int64_t unionArea = RectArea(UnionRects(lhs, rhs));
+            const int64_t coveredArea = RectArea(lhs) + RectArea(rhs) - RectArea(IntersectRects(lhs, rhs));
+            return (unionArea - coveredArea) * 4 <= unionArea;
+        }
+    }
+
+    DamageRegion::DamageRegion(size_t maxRects)
+        : maxRects_{maxRects > 0 ? maxRects : 1}
+    {
+    }
+
+    void DamageRegion::Add(const Rect& rect)
+    {
+        if(IsEmptyRect(rect))
+            return;
+
+        Rect pending = rect;
+        size_t i = 0;
+        while(i < rects_.size())
+        {
+            const Rect& current = rects_[i];
+            if(RectContains(current, pending))
+                return;
+
+            if(RectContains(pending, current) || ShouldMerge(current, pending))
+            {
+                pending = UnionRects(current, pending);
+                rects_[i] = rects_.back();
+                rects_.pop_back();
+                i = 0;
+                continue;
+            }
+
+            ++i;
+        }
+
+        rects_.push_back(pending);
+        if(rects_.size() > maxRects_)
+        {
+            Rect bounds = GetBounds();
+            rects_.clear();
+            rects_.push_back(bounds);
+        }
+    }
+
+    void DamageRegion::Add(const DamageRegion& region)
+    {
+        for(auto& rect: region.rects_)
+        {
+            Add(rect);
+        }
+    }
+
+    void DamageRegion::Clip(const Rect& bounds)
+    {
+        size_t count = 0;
+        for(auto& rect: rects_)
+        {
+            Rect clipped = IntersectRects(rect, bounds);
+            if(!IsEmptyRect(clipped))
+            {
+                rects_[count++] = clipped;
+            }
+        }
+
+        rects_.resize(count);
+    }
+
+    void DamageRegion::Clear()
+    {
+        rects_.clear();
+    }
+
+    bool DamageRegion::IsEmpty() const
+    {
+        return rects_.empty();
+    }
+
+    Rect DamageRegion::GetBounds() const
+    {
+        Rect bounds = MakeRect(0, 0, 0, 0);
+        for(auto& rect: rects_)
+        {
+            bounds = UnionRects(bounds, rect);
+        }
+
+        return bounds;
+    }
+
+    const std::vector<Rect>& DamageRegion::GetRects() const
+    {
+        return rects_;
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef HMI_DAMAGE_REGION_H
+#define HMI_DAMAGE_REGION_H
+
+#include <cstddef>
+#include <vector>
+#include "types.h"
+
+namespace hmi_graphics
+{
+    // A small set of rectangles covering everything that has to be recomposited. Nearby rects are merged as
+    // long as the merge does not waste much area; once maxRects is exceeded the region collapses to its bounds.
+    class DamageRegion
+    {
+    public:
+        explicit DamageRegion(size_t maxRects = 8);
+
+        void Add(const Rect& rect);
+
+        void Add(const DamageRegion& region);
+
+        void Clip(const Rect& bounds);
+
+        void Clear();
+
+        bool IsEmpty() const;
+
+        Rect GetBounds() const;
+
+        const std::vector<Rect>& GetRects() const;
+
+    private:
+        std::vector<Rect> rects_;
+        size_t maxRects_;
+    };
+}
+
+#endif //HMI_DAMAGE_REGION_H
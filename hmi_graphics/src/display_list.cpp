@@ -0,0 +1,474 @@
+#include "display_list.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <wrl/client.h>
+#include "blend.h"
+#include "graphics_system.h"
+#include "path_rasterizer.h"
+#include "rect_util.h"
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        constexpr float PI = 3.14159265358979f;
+        // Flattening tolerance for ellipses: one segment per this many pixels of circumference.
+        constexpr float ELLIPSE_SEGMENT_LENGTH = 3.f;
+        constexpr int MIN_ELLIPSE_SEGMENTS = 16;
+
+        enum CommandType: uint8_t
+        {
+            COMMAND_CLEAR,
+            COMMAND_PUSH_TRANSFORM,
+            COMMAND_POP_TRANSFORM,
+            COMMAND_FILL_RECTANGLE,
+            COMMAND_DRAW_RECTANGLE,
+            COMMAND_FILL_ELLIPSE,
+            COMMAND_DRAW_ELLIPSE,
+            COMMAND_DRAW_LINE,
+            COMMAND_DRAW_STRING,
+        };
+
+        // Geometry is stored inline; rectangles and lines as left/top/right/bottom or x0/y0/x1/y1, ellipses as
+        // center x/y and radius x/y.
+        struct Command
+        {
+            CommandType type;
+            uint32_t slot;
+            uint32_t color;
+            float strokeWidth;
+            float geometry[4];
+        };
+
+        struct StringSlot
+        {
+            std::wstring text;
+            TextFormatDesc desc;
+            // desc.fontFamily points here so the caller's string does not have to outlive the list.
+            std::wstring fontFamily;
+        };
+
+        D2D1_MATRIX_3X2_F MakeIdentity()
+        {
+            D2D1_MATRIX_3X2_F matrix{};
+            matrix._11 = 1.f;
+            matrix._22 = 1.f;
+            return matrix;
+        }
+
+        // Row-vector convention like Direct2D: lhs is applied first.
+        D2D1_MATRIX_3X2_F Multiply(const D2D1_MATRIX_3X2_F& lhs, const D2D1_MATRIX_3X2_F& rhs)
+        {
+            D2D1_MATRIX_3X2_F result{};
+            result._11 = lhs._11 * rhs._11 + lhs._12 * rhs._21;
+            result._12 = lhs._11 * rhs._12 + lhs._12 * rhs._22;
+            result._21 = lhs._21 * rhs._11 + lhs._22 * rhs._21;
+            result._22 = lhs._21 * rhs._12 + lhs._22 * rhs._22;
+            result._31 = lhs._31 * rhs._11 + lhs._32 * rhs._21 + rhs._31;
+            result._32 = lhs._31 * rhs._12 + lhs._32 * rhs._22 + rhs._32;
+            return result;
+        }
+
+        bool MatricesEqual(const D2D1_MATRIX_3X2_F& lhs, const D2D1_MATRIX_3X2_F& rhs)
+        {
+            return lhs._11 == rhs._11 && lhs._12 == rhs._12 && lhs._21 == rhs._21 && lhs._22 == rhs._22
+                && lhs._31 == rhs._31 && lhs._32 == rhs._32;
+        }
+
+        bool ColorsEqual(const D2D1_COLOR_F& lhs, const D2D1_COLOR_F& rhs)
+        {
+            return lhs.r == rhs.r && lhs.g == rhs.g && lhs.b == rhs.b && lhs.a == rhs.a;
+        }
+
+        uint32_t ToPremultipliedArgb(const D2D1_COLOR_F& color)
+        {
+            auto channel = [](float value)
+            {
+                return static_cast<uint32_t>(std::min(std::max(value, 0.f), 1.f) * 255.f + 0.5f);
+            };
+            const float alpha = std::min(std::max(color.a, 0.f), 1.f);
+            return channel(alpha) << 24 | channel(color.r * alpha) << 16 | channel(color.g * alpha) << 8 | channel(color.b * alpha);
+        }
+
+        class PathBuilder
+        {
+        public:
+            PathBuilder(PathRasterizer* rasterizer, const D2D1_MATRIX_3X2_F& transform)
+                : rasterizer_{rasterizer}
+                , transform_{transform}
+            {
+            }
+
+            void MoveTo(float x, float y)
+            {
+                rasterizer_->MoveTo(TransformX(x, y), TransformY(x, y));
+            }
+
+            void LineTo(float x, float y)
+            {
+                rasterizer_->LineTo(TransformX(x, y), TransformY(x, y));
+            }
+
+            void Rectangle(float left, float top, float right, float bottom, bool reverse)
+            {
+                MoveTo(left, top);
+                if(reverse)
+                {
+                    LineTo(left, bottom);
+                    LineTo(right, bottom);
+                    LineTo(right, top);
+                }
+                else
+                {
+                    LineTo(right, top);
+                    LineTo(right, bottom);
+                    LineTo(left, bottom);
+                }
+            }
+
+            void Ellipse(float centerX, float centerY, float radiusX, float radiusY, bool reverse)
+            {
+                if(radiusX <= 0.f || radiusY <= 0.f)
+                    return;
+
+                const float scale = std::sqrt(std::abs(transform_._11 * transform_._22 - transform_._12 * transform_._21));
+                const float circumference = 2.f * PI * std::max(radiusX, radiusY) * std::max(scale, 1e-3f);
+                const int segments = std::max(MIN_ELLIPSE_SEGMENTS, static_cast<int>(circumference / ELLIPSE_SEGMENT_LENGTH));
+                for(int i = 0; i <= segments; ++i)
+                {
+                    const float angle = (reverse ? -2.f : 2.f) * PI * i / segments;
+                    const float x = centerX + radiusX * std::cos(angle);
+                    const float y = centerY + radiusY * std::sin(angle);
+                    if(i == 0)
+                    {
+                        MoveTo(x, y);
+                    }
+                    else
+                    {
+                        LineTo(x, y);
+                    }
+                }
+            }
+
+        private:
+            float TransformX(float x, float y) const
+            {
+                return x * transform_._11 + y * transform_._21 + transform_._31;
+            }
+
+            float TransformY(float x, float y) const
+            {
+                return x * transform_._12 + y * transform_._22 + transform_._32;
+            }
+
+            PathRasterizer* rasterizer_;
+            D2D1_MATRIX_3X2_F transform_;
+        };
+    }
+
+    class DisplayList::Pimpl
+    {
+    public:
+        std::vector<Command> commands_;
+        std::vector<D2D1_MATRIX_3X2_F> transforms_;
+        std::vector<D2D1_COLOR_F> colors_;
+        std::vector<StringSlot> strings_;
+
+        void Add(CommandType type, uint32_t slot, uint32_t color, float strokeWidth, float a, float b, float c, float d)
+        {
+            commands_.push_back(Command{type, slot, color, strokeWidth, {a, b, c, d}});
+        }
+    };
+
+    DisplayList::DisplayList()
+        : pimpl_{new Pimpl{}}
+    {
+    }
+
+    DisplayList::~DisplayList()
+    {
+        delete pimpl_;
+        pimpl_ = nullptr;
+    }
+
+    uint32_t DisplayList::AddTransform(const D2D1_MATRIX_3X2_F& transform)
+    {
+        pimpl_->transforms_.push_back(transform);
+        return static_cast<uint32_t>(pimpl_->transforms_.size() - 1);
+    }
+
+    uint32_t DisplayList::AddColor(const D2D1_COLOR_F& color)
+    {
+        pimpl_->colors_.push_back(color);
+        return static_cast<uint32_t>(pimpl_->colors_.size() - 1);
+    }
+
+    uint32_t DisplayList::AddString(const wchar_t* text, uint32_t length, const TextFormatDesc& desc)
+    {
+        StringSlot slot{std::wstring{text, length}, desc, desc.fontFamily != nullptr ? desc.fontFamily : L""};
+        pimpl_->strings_.push_back(std::move(slot));
+        auto& added = pimpl_->strings_.back();
+        added.desc.fontFamily = added.fontFamily.c_str();
+        return static_cast<uint32_t>(pimpl_->strings_.size() - 1);
+    }
+
+    bool DisplayList::SetTransform(uint32_t slot, const D2D1_MATRIX_3X2_F& transform)
+    {
+        if(slot >= pimpl_->transforms_.size() || MatricesEqual(pimpl_->transforms_[slot], transform))
+            return false;
+
+        pimpl_->transforms_[slot] = transform;
+        return true;
+    }
+
+    bool DisplayList::SetColor(uint32_t slot, const D2D1_COLOR_F& color)
+    {
+        if(slot >= pimpl_->colors_.size() || ColorsEqual(pimpl_->colors_[slot], color))
+            return false;
+
+        pimpl_->colors_[slot] = color;
+        return true;
+    }
+
+    bool DisplayList::SetString(uint32_t slot, const wchar_t* text, uint32_t length)
+    {
+        if(slot >= pimpl_->strings_.size() || pimpl_->strings_[slot].text.compare(0, std::wstring::npos, text, length) == 0)
+            return false;
+
+        pimpl_->strings_[slot].text.assign(text, length);
+        return true;
+    }
+
+    void DisplayList::Clear(uint32_t color)
+    {
+        pimpl_->Add(COMMAND_CLEAR, 0, color, 0.f, 0.f, 0.f, 0.f, 0.f);
+    }
+
+    void DisplayList::PushTransform(uint32_t transform)
+    {
+        pimpl_->Add(COMMAND_PUSH_TRANSFORM, transform, 0, 0.f, 0.f, 0.f, 0.f, 0.f);
+    }
+
+    void DisplayList::PopTransform()
+    {
+        pimpl_->Add(COMMAND_POP_TRANSFORM, 0, 0, 0.f, 0.f, 0.f, 0.f, 0.f);
+    }
+
+    void DisplayList::FillRectangle(const D2D1_RECT_F& rect, uint32_t color)
+    {
+        pimpl_->Add(COMMAND_FILL_RECTANGLE, 0, color, 0.f, rect.left, rect.top, rect.right, rect.bottom);
+    }
+
+    void DisplayList::DrawRectangle(const D2D1_RECT_F& rect, uint32_t color, float strokeWidth)
+    {
+        pimpl_->Add(COMMAND_DRAW_RECTANGLE, 0, color, strokeWidth, rect.left, rect.top, rect.right, rect.bottom);
+    }
+
+    void DisplayList::FillEllipse(const D2D1_ELLIPSE& ellipse, uint32_t color)
+    {
+        pimpl_->Add(COMMAND_FILL_ELLIPSE, 0, color, 0.f, ellipse.point.x, ellipse.point.y, ellipse.radiusX, ellipse.radiusY);
+    }
+
+    void DisplayList::DrawEllipse(const D2D1_ELLIPSE& ellipse, uint32_t color, float strokeWidth)
+    {
+        pimpl_->Add(COMMAND_DRAW_ELLIPSE, 0, color, strokeWidth, ellipse.point.x, ellipse.point.y, ellipse.radiusX, ellipse.radiusY);
+    }
+
+    void DisplayList::DrawLine(D2D1_POINT_2F from, D2D1_POINT_2F to, uint32_t color, float strokeWidth)
+    {
+        pimpl_->Add(COMMAND_DRAW_LINE, 0, color, strokeWidth, from.x, from.y, to.x, to.y);
+    }
+
+    void DisplayList::DrawString(uint32_t text, const D2D1_RECT_F& box, uint32_t color)
+    {
+        pimpl_->Add(COMMAND_DRAW_STRING, text, color, 0.f, box.left, box.top, box.right, box.bottom);
+    }
+
+    void DisplayList::Reset()
+    {
+        pimpl_->commands_.clear();
+        pimpl_->transforms_.clear();
+        pimpl_->colors_.clear();
+        pimpl_->strings_.clear();
+    }
+
+    size_t DisplayList::GetCommandCount() const
+    {
+        return pimpl_->commands_.size();
+    }
+
+    bool DisplayList::Replay(System* system, ID2D1DeviceContext* context, const D2D1_MATRIX_3X2_F& base) const
+    {
+        if(system == nullptr || context == nullptr)
+            return false;
+
+        std::vector<D2D1_MATRIX_3X2_F> stack{base};
+        for(auto& command: pimpl_->commands_)
+        {
+            if(command.type == COMMAND_PUSH_TRANSFORM)
+            {
+                stack.push_back(Multiply(pimpl_->transforms_[command.slot], stack.back()));
+                context->SetTransform(stack.back());
+                continue;
+            }
+
+            if(command.type == COMMAND_POP_TRANSFORM)
+            {
+                if(stack.size() > 1)
+                {
+                    stack.pop_back();
+                }
+
+                context->SetTransform(stack.back());
+                continue;
+            }
+
+            const D2D1_COLOR_F& color = pimpl_->colors_[command.color];
+            if(command.type == COMMAND_CLEAR)
+            {
+                context->Clear(color);
+                continue;
+            }
+
+            Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> brush;
+            if(!system->GetCachedColorBrush(color, &brush))
+                continue;
+
+            const float* g = command.geometry;
+            switch(command.type)
+            {
+            case COMMAND_FILL_RECTANGLE:
+                context->FillRectangle(D2D1::RectF(g[0], g[1], g[2], g[3]), brush.Get());
+                break;
+            case COMMAND_DRAW_RECTANGLE:
+                context->DrawRectangle(D2D1::RectF(g[0], g[1], g[2], g[3]), brush.Get(), command.strokeWidth);
+                break;
+            case COMMAND_FILL_ELLIPSE:
+                context->FillEllipse(D2D1::Ellipse(D2D1::Point2F(g[0], g[1]), g[2], g[3]), brush.Get());
+                break;
+            case COMMAND_DRAW_ELLIPSE:
+                context->DrawEllipse(D2D1::Ellipse(D2D1::Point2F(g[0], g[1]), g[2], g[3]), brush.Get(), command.strokeWidth);
+                break;
+            case COMMAND_DRAW_LINE:
+                context->DrawLine(D2D1::Point2F(g[0], g[1]), D2D1::Point2F(g[2], g[3]), brush.Get(), command.strokeWidth);
+                break;
+            case COMMAND_DRAW_STRING:
+            {
+                auto& slot = pimpl_->strings_[command.slot];
+                Microsoft::WRL::ComPtr<IDWriteTextLayout> layout;
+                if(system->GetCachedTextLayout(slot.text.c_str(), static_cast<uint32_t>(slot.text.size()), slot.desc,
+                    g[2] - g[0], g[3] - g[1], &layout))
+                {
+                    context->DrawTextLayout(D2D1::Point2F(g[0], g[1]), layout.Get(), brush.Get());
+                }
+
+                break;
+            }
+            default:
+                break;
+            }
+        }
+
+        context->SetTransform(base);
+        return true;
+    }
+
+    bool DisplayList::Replay(System* system, const Surface& surface) const
+    {
+        if(system == nullptr || surface.pixels == nullptr)
+            return false;
+
+        const Rect clip = MakeRect(0, 0, surface.width, surface.height);
+        PathRasterizer rasterizer;
+        std::vector<D2D1_MATRIX_3X2_F> stack{MakeIdentity()};
+        for(auto& command: pimpl_->commands_)
+        {
+            if(command.type == COMMAND_PUSH_TRANSFORM)
+            {
+                stack.push_back(Multiply(pimpl_->transforms_[command.slot], stack.back()));
+                continue;
+            }
+
+            if(command.type == COMMAND_POP_TRANSFORM)
+            {
+                if(stack.size() > 1)
+                {
+                    stack.pop_back();
+                }
+
+                continue;
+            }
+
+            const uint32_t argb = ToPremultipliedArgb(pimpl_->colors_[command.color]);
+            if(command.type == COMMAND_CLEAR)
+            {
+                for(int y = 0; y < surface.height; ++y)
+                {
+                    FillRow(surface.pixels + static_cast<size_t>(y) * surface.stride, argb, static_cast<size_t>(surface.width));
+                }
+
+                continue;
+            }
+
+            const float* g = command.geometry;
+            const float halfStroke = command.strokeWidth / 2.f;
+            PathBuilder path{&rasterizer, stack.back()};
+            switch(command.type)
+            {
+            case COMMAND_FILL_RECTANGLE:
+                path.Rectangle(g[0], g[1], g[2], g[3], false);
+                break;
+            case COMMAND_DRAW_RECTANGLE:
+                // Stroke as the ring between the outer and inner outline, the inner one wound the other way.
+                path.Rectangle(g[0] - halfStroke, g[1] - halfStroke, g[2] + halfStroke, g[3] + halfStroke, false);
+                if(g[2] - g[0] > command.strokeWidth && g[3] - g[1] > command.strokeWidth)
+                {
+                    path.Rectangle(g[0] + halfStroke, g[1] + halfStroke, g[2] - halfStroke, g[3] - halfStroke, true);
+                }
+
+                break;
+            case COMMAND_FILL_ELLIPSE:
+                path.Ellipse(g[0], g[1], g[2], g[3], false);
+                break;
+            case COMMAND_DRAW_ELLIPSE:
+                path.Ellipse(g[0], g[1], g[2] + halfStroke, g[3] + halfStroke, false);
+                path.Ellipse(g[0], g[1], g[2] - halfStroke, g[3] - halfStroke, true);
+                break;
+            case COMMAND_DRAW_LINE:
+            {
+                const float dx = g[2] - g[0];
+                const float dy = g[3] - g[1];
+                const float length = std::sqrt(dx * dx + dy * dy);
+                if(length <= 0.f)
+                    break;
+
+                const float nx = -dy / length * halfStroke;
+                const float ny = dx / length * halfStroke;
+                path.MoveTo(g[0] + nx, g[1] + ny);
+                path.LineTo(g[2] + nx, g[3] + ny);
+                path.LineTo(g[2] - nx, g[3] - ny);
+                path.LineTo(g[0] - nx, g[1] - ny);
+                break;
+            }
+            case COMMAND_DRAW_STRING:
+            {
+                auto& slot = pimpl_->strings_[command.slot];
+                const auto& transform = stack.back();
+                const Rect box = MakeRect(static_cast<int>(std::lround(g[0] + transform._31)),
+                    static_cast<int>(std::lround(g[1] + transform._32)), static_cast<int>(g[2] - g[0]), static_cast<int>(g[3] - g[1]));
+                system->DrawCachedText(surface, box, slot.text.c_str(), static_cast<uint32_t>(slot.text.size()), slot.desc, argb);
+                continue;
+            }
+            default:
+                break;
+            }
+
+            rasterizer.Fill(surface, clip, argb);
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,56 @@
+#include "draw_order.h"
+
+namespace hmi_graphics
+{
+    DrawOrder::DrawOrder()
+        : nextSequence_{}
+    {
+    }
+
+    void DrawOrder::Insert(GraphicsElement* element, ElementHandle handle, int16_t zIndex)
+    {
+        if(positions_.count(element) != 0)
+            return;
+
+        auto result = entries_.insert(Entry{zIndex, ++nextSequence_, element, handle});
+        positions_.emplace(element, result.first);
+    }
+
+    void DrawOrder::Remove(GraphicsElement* element)
+    {
+        auto it = positions_.find(element);
+        if(it == positions_.end())
+            return;
+
+        entries_.erase(it->second);
+        positions_.erase(it);
+    }
+
+    void DrawOrder::Reposition(GraphicsElement* element, int16_t zIndex)
+    {
+        auto it = positions_.find(element);
+        if(it == positions_.end() || it->second->zIndex == zIndex)
+            return;
+
+        // The sequence stays, so the element keeps its insertion rank among its new z-index peers.
+        Entry entry = *it->second;
+        entry.zIndex = zIndex;
+        auto hint = entries_.erase(it->second);
+        it->second = entries_.insert(hint, entry);
+    }
+
+    size_t DrawOrder::GetSize() const
+    {
+        return entries_.size();
+    }
+
+    DrawOrder::Container::const_iterator DrawOrder::begin() const
+    {
+        return entries_.begin();
+    }
+
+    DrawOrder::Container::const_iterator DrawOrder::end() const
+    {
+        return entries_.end();
+    }
+}
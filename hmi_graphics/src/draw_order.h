@@ -0,0 +1,61 @@
+#ifndef HMI_DRAW_ORDER_H
+#define HMI_DRAW_ORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include "types.h"
+
+namespace hmi_graphics
+{
+    class GraphicsElement;
+
+    // Elements in back-to-front order: ascending z-index, insertion order among equal z-indices. Changing the
+    // z-index of one element repositions only that element.
+    class DrawOrder
+    {
+    public:
+        struct Entry
+        {
+            int16_t zIndex;
+            uint32_t sequence;
+            GraphicsElement* element;
+            ElementHandle handle;
+        };
+
+        struct EntryLess
+        {
+            bool operator()(const Entry& lhs, const Entry& rhs) const
+            {
+                if(lhs.zIndex != rhs.zIndex)
+                    return lhs.zIndex < rhs.zIndex;
+
+                return lhs.sequence < rhs.sequence;
+            }
+        };
+
+        using Container = std::set<Entry, EntryLess>;
+
+        DrawOrder();
+
+        void Insert(GraphicsElement* element, ElementHandle handle, int16_t zIndex);
+
+        void Remove(GraphicsElement* element);
+
+        void Reposition(GraphicsElement* element, int16_t zIndex);
+
+        size_t GetSize() const;
+
+        Container::const_iterator begin() const;
+
+        Container::const_iterator end() const;
+
+    private:
+        Container entries_;
+        std::unordered_map<GraphicsElement*, Container::iterator> positions_;
+        uint32_t nextSequence_;
+    };
+}
+
+#endif //HMI_DRAW_ORDER_H
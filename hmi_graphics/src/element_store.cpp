@@ -0,0 +1,244 @@
+#include "element_store.h"
+
+#include "composite_transform.h"
+#include "rect_util.h"
+#include "simd_config.h"
+
+#if defined(HMI_GRAPHICS_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        template<typename T>
+        void SwapRemove(std::vector<T>& column, size_t index)
+        {
+            column[index] = column.back();
+            column.pop_back();
+        }
+    }
+
+    ElementHandle ElementStore::Insert(GraphicsElement* element, int width, int height)
+    {
+        ElementHandle handle = elements_.Insert(element);
+        x_.push_back(0);
+        y_.push_back(0);
+        width_.push_back(width);
+        height_.push_back(height);
+        outsetX_.push_back(0);
+        outsetY_.push_back(0);
+        transforms_.push_back(MakeIdentityCompositeTransform());
+        zIndex_.push_back(0);
+        flags_.push_back(FLAG_UPDATED);
+        return handle;
+    }
+
+    bool ElementStore::Remove(ElementHandle handle)
+    {
+        if(elements_.Find(handle) == nullptr)
+            return false;
+
+        // Mirror the slot map, which moves its last value into the removed position.
+        const size_t index = elements_.GetDenseIndex(handle);
+        SwapRemove(x_, index);
+        SwapRemove(y_, index);
+        SwapRemove(width_, index);
+        SwapRemove(height_, index);
+        SwapRemove(outsetX_, index);
+        SwapRemove(outsetY_, index);
+        SwapRemove(transforms_, index);
+        SwapRemove(zIndex_, index);
+        SwapRemove(flags_, index);
+        elements_.Remove(handle);
+        return true;
+    }
+
+    void ElementStore::Clear()
+    {
+        elements_.Clear();
+        x_.clear();
+        y_.clear();
+        width_.clear();
+        height_.clear();
+        outsetX_.clear();
+        outsetY_.clear();
+        transforms_.clear();
+        zIndex_.clear();
+        flags_.clear();
+    }
+
+    GraphicsElement* ElementStore::GetElement(ElementHandle handle) const
+    {
+        auto* found = elements_.Find(handle);
+        return found != nullptr ? *found : nullptr;
+    }
+
+    size_t ElementStore::GetCount() const
+    {
+        return elements_.GetSize();
+    }
+
+    size_t ElementStore::GetSlotCount() const
+    {
+        return elements_.GetSlotCount();
+    }
+
+    GraphicsElement* const* ElementStore::begin() const
+    {
+        return elements_.begin();
+    }
+
+    GraphicsElement* const* ElementStore::end() const
+    {
+        return elements_.end();
+    }
+
+    Point ElementStore::GetPosition(ElementHandle handle) const
+    {
+        const size_t index = elements_.GetDenseIndex(handle);
+        return Point{x_[index], y_[index]};
+    }
+
+    void ElementStore::SetPosition(ElementHandle handle, int x, int y)
+    {
+        const size_t index = elements_.GetDenseIndex(handle);
+        x_[index] = x;
+        y_[index] = y;
+    }
+
+    Size ElementStore::GetSize(ElementHandle handle) const
+    {
+        const size_t index = elements_.GetDenseIndex(handle);
+        return Size{width_[index], height_[index]};
+    }
+
+    void ElementStore::SetSize(ElementHandle handle, int width, int height)
+    {
+        const size_t index = elements_.GetDenseIndex(handle);
+        width_[index] = width;
+        height_[index] = height;
+        GetCompositeOutset(transforms_[index], width, height, &outsetX_[index], &outsetY_[index]);
+    }
+
+    Rect ElementStore::GetBounds(ElementHandle handle) const
+    {
+        const size_t index = elements_.GetDenseIndex(handle);
+        return MakeRect(x_[index] - outsetX_[index], y_[index] - outsetY_[index], width_[index] + outsetX_[index] * 2,
+            height_[index] + outsetY_[index] * 2);
+    }
+
+    CompositeTransform ElementStore::GetCompositeTransform(ElementHandle handle) const
+    {
+        return transforms_[elements_.GetDenseIndex(handle)];
+    }
+
+    void ElementStore::SetCompositeTransform(ElementHandle handle, const CompositeTransform& transform)
+    {
+        const size_t index = elements_.GetDenseIndex(handle);
+        transforms_[index] = transform;
+        GetCompositeOutset(transform, width_[index], height_[index], &outsetX_[index], &outsetY_[index]);
+    }
+
+    int16_t ElementStore::GetZIndex(ElementHandle handle) const
+    {
+        return zIndex_[elements_.GetDenseIndex(handle)];
+    }
+
+    void ElementStore::SetZIndex(ElementHandle handle, int16_t zIndex)
+    {
+        zIndex_[elements_.GetDenseIndex(handle)] = zIndex;
+    }
+
+    bool ElementStore::HasFlags(ElementHandle handle, uint8_t flags) const
+    {
+        return (flags_[elements_.GetDenseIndex(handle)] & flags) != 0;
+    }
+
+    void ElementStore::SetFlags(ElementHandle handle, uint8_t flags)
+    {
+        flags_[elements_.GetDenseIndex(handle)] |= flags;
+    }
+
+    bool ElementStore::ClearFlags(ElementHandle handle, uint8_t flags)
+    {
+        uint8_t& value = flags_[elements_.GetDenseIndex(handle)];
+        const bool wasSet = (value & flags) != 0;
+        value &= static_cast<uint8_t>(~flags);
+        return wasSet;
+    }
+
+    void ElementStore::CollectFlagged(uint8_t flags, std::vector<ElementHandle>* handles) const
+    {
+        for(size_t i = 0; i < flags_.size(); ++i)
+        {
+            if((flags_[i] & flags) == 0)
+                continue;
+
+            handles->push_back(elements_.GetHandle(i));
+        }
+    }
+
+    void ElementStore::CullIntersecting(const Rect& rect, std::vector<uint8_t>* slotMask) const
+    {
+        slotMask->assign(elements_.GetSlotCount(), 0);
+        if(IsEmptyRect(rect))
+            return;
+
+        const int32_t left = rect.origin.x;
+        const int32_t top = rect.origin.y;
+        const int32_t right = RectRight(rect);
+        const int32_t bottom = RectBottom(rect);
+        const size_t count = x_.size();
+        size_t i = 0;
+#if defined(HMI_GRAPHICS_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i clipLeft = _mm_set1_epi32(left);
+        const __m128i clipTop = _mm_set1_epi32(top);
+        const __m128i clipRight = _mm_set1_epi32(right);
+        const __m128i clipBottom = _mm_set1_epi32(bottom);
+        for(; i + 4 <= count; i += 4)
+        {
+            const __m128i outsetX = _mm_loadu_si128(reinterpret_cast<const __m128i*>(outsetX_.data() + i));
+            const __m128i outsetY = _mm_loadu_si128(reinterpret_cast<const __m128i*>(outsetY_.data() + i));
+            const __m128i x = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x_.data() + i)), outsetX);
+            const __m128i y = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y_.data() + i)), outsetY);
+            const __m128i width = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(width_.data() + i)),
+                _mm_add_epi32(outsetX, outsetX));
+            const __m128i height = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(height_.data() + i)),
+                _mm_add_epi32(outsetY, outsetY));
+            __m128i hit = _mm_and_si128(_mm_cmpgt_epi32(width, zero), _mm_cmpgt_epi32(height, zero));
+            hit = _mm_and_si128(hit, _mm_cmplt_epi32(x, clipRight));
+            hit = _mm_and_si128(hit, _mm_cmplt_epi32(y, clipBottom));
+            hit = _mm_and_si128(hit, _mm_cmpgt_epi32(_mm_add_epi32(x, width), clipLeft));
+            hit = _mm_and_si128(hit, _mm_cmpgt_epi32(_mm_add_epi32(y, height), clipTop));
+            const int bits = _mm_movemask_ps(_mm_castsi128_ps(hit));
+            if(bits == 0)
+                continue;
+
+            for(int lane = 0; lane < 4; ++lane)
+            {
+                if((bits & (1 << lane)) != 0)
+                {
+                    (*slotMask)[elements_.GetSlotIndex(i + lane)] = 1;
+                }
+            }
+        }
+#endif
+        for(; i < count; ++i)
+        {
+            const int32_t x = x_[i] - outsetX_[i];
+            const int32_t y = y_[i] - outsetY_[i];
+            const int32_t width = width_[i] + outsetX_[i] * 2;
+            const int32_t height = height_[i] + outsetY_[i] * 2;
+            if(width <= 0 || height <= 0)
+                continue;
+
+            if(x < right && y < bottom && x + width > left && y + height > top)
+            {
+                (*slotMask)[elements_.GetSlotIndex(i)] = 1;
+            }
+        }
+    }
+}
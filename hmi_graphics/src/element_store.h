@@ -0,0 +1,92 @@
+#ifndef HMI_ELEMENT_STORE_H
+#define HMI_ELEMENT_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "slot_map.h"
+#include "types.h"
+
+namespace hmi_graphics
+{
+    class GraphicsElement;
+
+    // Element geometry and flags as parallel arrays in the dense order of the handle slot map, so loops over every
+    // element read a few contiguous columns instead of chasing element and pimpl pointers. Accessors taking a
+    // handle expect it to be live.
+    class ElementStore
+    {
+    public:
+        enum Flags: uint8_t
+        {
+            FLAG_UPDATED = 1 << 0,
+            // Set from the element's OpacityHint.
+            FLAG_OPAQUE = 1 << 1,
+            // The backend freed the element's backing store; see SystemBase::UpdateSurfaceResidency.
+            FLAG_EVICTED = 1 << 2,
+        };
+
+        ElementHandle Insert(GraphicsElement* element, int width, int height);
+
+        bool Remove(ElementHandle handle);
+
+        void Clear();
+
+        GraphicsElement* GetElement(ElementHandle handle) const;
+
+        size_t GetCount() const;
+
+        size_t GetSlotCount() const;
+
+        GraphicsElement* const* begin() const;
+
+        GraphicsElement* const* end() const;
+
+        Point GetPosition(ElementHandle handle) const;
+
+        void SetPosition(ElementHandle handle, int x, int y);
+
+        Size GetSize(ElementHandle handle) const;
+
+        void SetSize(ElementHandle handle, int width, int height);
+
+        // Visible extent: the layout rect grown or shrunk to cover the element's composite transform.
+        Rect GetBounds(ElementHandle handle) const;
+
+        CompositeTransform GetCompositeTransform(ElementHandle handle) const;
+
+        void SetCompositeTransform(ElementHandle handle, const CompositeTransform& transform);
+
+        int16_t GetZIndex(ElementHandle handle) const;
+
+        void SetZIndex(ElementHandle handle, int16_t zIndex);
+
+        bool HasFlags(ElementHandle handle, uint8_t flags) const;
+
+        void SetFlags(ElementHandle handle, uint8_t flags);
+
+        // Returns whether any of the flags were set.
+        bool ClearFlags(ElementHandle handle, uint8_t flags);
+
+        // Appends the handles of every element with any of the flags set.
+        void CollectFlagged(uint8_t flags, std::vector<ElementHandle>* handles) const;
+
+        // Resizes slotMask to GetSlotCount() and sets the entries of elements whose bounds overlap rect, indexed by
+        // ElementHandle::index. Empty elements never overlap.
+        void CullIntersecting(const Rect& rect, std::vector<uint8_t>* slotMask) const;
+
+    private:
+        SlotMap<GraphicsElement*> elements_;
+        std::vector<int32_t> x_;
+        std::vector<int32_t> y_;
+        std::vector<int32_t> width_;
+        std::vector<int32_t> height_;
+        std::vector<int32_t> outsetX_;
+        std::vector<int32_t> outsetY_;
+        std::vector<CompositeTransform> transforms_;
+        std::vector<int16_t> zIndex_;
+        std::vector<uint8_t> flags_;
+    };
+}
+
+#endif //HMI_ELEMENT_STORE_H
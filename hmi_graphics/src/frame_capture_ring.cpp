@@ -0,0 +1,221 @@
+#include "frame_capture_ring.h"
+
+#include <algorithm>
+
+namespace hmi_graphics
+{
+    class FrameCaptureRing::Frame: public CapturedFrame
+    {
+    public:
+        Frame(FrameCaptureRing* ring, size_t slot)
+            : ring_{ring}
+            , slot_{slot}
+            , refCount_{0}
+            , surface_{}
+            , frameNumber_{0}
+        {
+        }
+
+        uint32_t AddRef() override
+        {
+            return refCount_.fetch_add(1) + 1;
+        }
+
+        uint32_t Release() override
+        {
+            const uint32_t count = refCount_.fetch_sub(1) - 1;
+            if(count == 0)
+            {
+                ring_->OnReleased(slot_);
+            }
+
+            return count;
+        }
+
+        const Surface& GetSurface() const override
+        {
+            return surface_;
+        }
+
+        uint64_t GetFrameNumber() const override
+        {
+            return frameNumber_;
+        }
+
+        size_t GetDamage(Rect* rects, size_t capacity) const override
+        {
+            auto& damage = damage_.GetRects();
+            if(rects != nullptr)
+            {
+                std::copy_n(damage.begin(), std::min(capacity, damage.size()), rects);
+            }
+
+            return damage.size();
+        }
+
+        // Written by the ring under its mutex while no consumer holds the frame.
+        FrameCaptureRing* ring_;
+        size_t slot_;
+        std::atomic<uint32_t> refCount_;
+        Surface surface_;
+        uint64_t frameNumber_;
+        DamageRegion damage_;
+    };
+
+    FrameCaptureRing::FrameCaptureRing()
+        : frameNumber_{0}
+    {
+    }
+
+    FrameCaptureRing::~FrameCaptureRing() = default;
+
+    bool FrameCaptureRing::SetDepth(size_t depth, const Rect& bounds)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(std::find(states_.begin(), states_.end(), SLOT_ACQUIRED) != states_.end())
+            return false;
+
+        frames_.clear();
+        for(size_t i = 0; i < depth; ++i)
+        {
+            frames_.emplace_back(new Frame{this, i});
+        }
+
+        states_.assign(depth, SLOT_FREE);
+        carriedDamage_.Clear();
+        carriedDamage_.Add(bounds);
+        frameNumber_ = 0;
+        return true;
+    }
+
+    size_t FrameCaptureRing::GetDepth() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return frames_.size();
+    }
+
+    bool FrameCaptureRing::BeginCapture(const DamageRegion& damage, size_t* slot)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(frames_.empty())
+            return false;
+
+        ++frameNumber_;
+        carriedDamage_.Add(damage);
+        auto it = std::find(states_.begin(), states_.end(), SLOT_FREE);
+        if(it == states_.end())
+        {
+            // Reuse the oldest ready frame. Its damage moves to the frame after it, which is ready or pending (both
+            // finish in order) or, when it was the newest, the one captured now.
+            size_t oldest = frames_.size();
+            size_t successor = frames_.size();
+            for(size_t i = 0; i < frames_.size(); ++i)
+            {
+                if(states_[i] == SLOT_READY && (oldest == frames_.size() || frames_[i]->frameNumber_ < frames_[oldest]->frameNumber_))
+                {
+                    oldest = i;
+                }
+            }
+
+            if(oldest == frames_.size())
+                return false;
+
+            for(size_t i = 0; i < frames_.size(); ++i)
+            {
+                if((states_[i] == SLOT_READY || states_[i] == SLOT_PENDING)
+                    && frames_[i]->frameNumber_ > frames_[oldest]->frameNumber_
+                    && (successor == frames_.size() || frames_[i]->frameNumber_ < frames_[successor]->frameNumber_))
+                {
+                    successor = i;
+                }
+            }
+
+            if(successor != frames_.size())
+            {
+                frames_[successor]->damage_.Add(frames_[oldest]->damage_);
+            }
+            else
+            {
+                carriedDamage_.Add(frames_[oldest]->damage_);
+            }
+
+            it = states_.begin() + oldest;
+        }
+
+        *slot = static_cast<size_t>(it - states_.begin());
+        Frame& frame = *frames_[*slot];
+        frame.frameNumber_ = frameNumber_;
+        frame.damage_ = carriedDamage_;
+        carriedDamage_.Clear();
+        *it = SLOT_PENDING;
+        return true;
+    }
+
+    void FrameCaptureRing::MarkReady(size_t slot, const Surface& surface)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        frames_[slot]->surface_ = surface;
+        states_[slot] = SLOT_READY;
+    }
+
+    size_t FrameCaptureRing::GetPendingSlots(size_t* slots, size_t capacity) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t count = 0;
+        for(size_t i = 0; i < states_.size() && count < capacity; ++i)
+        {
+            if(states_[i] == SLOT_PENDING)
+            {
+                slots[count++] = i;
+            }
+        }
+
+        std::sort(slots, slots + count, [this](size_t lhs, size_t rhs)
+        {
+            return frames_[lhs]->frameNumber_ < frames_[rhs]->frameNumber_;
+        });
+        return count;
+    }
+
+    bool FrameCaptureRing::TakeReleased(size_t* slot)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = std::find(states_.begin(), states_.end(), SLOT_RELEASED);
+        if(it == states_.end())
+            return false;
+
+        *it = SLOT_FREE;
+        *slot = static_cast<size_t>(it - states_.begin());
+        return true;
+    }
+
+    bool FrameCaptureRing::Acquire(CapturedFrame** frame)
+    {
+        if(frame == nullptr)
+            return false;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t oldest = frames_.size();
+        for(size_t i = 0; i < frames_.size(); ++i)
+        {
+            if(states_[i] == SLOT_READY && (oldest == frames_.size() || frames_[i]->frameNumber_ < frames_[oldest]->frameNumber_))
+            {
+                oldest = i;
+            }
+        }
+
+        if(oldest == frames_.size())
+            return false;
+
+        states_[oldest] = SLOT_ACQUIRED;
+        frames_[oldest]->refCount_.store(1);
+        *frame = frames_[oldest].get();
+        return true;
+    }
+
+    void FrameCaptureRing::OnReleased(size_t slot)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        states_[slot] = SLOT_RELEASED;
+    }
+}
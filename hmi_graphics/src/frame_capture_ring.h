@@ -0,0 +1,71 @@
+#ifndef HMI_FRAME_CAPTURE_RING_H
+#define HMI_FRAME_CAPTURE_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "captured_frame.h"
+#include "damage_region.h"
+
+namespace hmi_graphics
+{
+    // Bookkeeping of the capture ring shared by the backends, which own the buffers of the slots. A slot goes
+    // free -> pending (copy issued) -> ready (buffer readable) -> acquired -> released -> free; the backend unmaps
+    // released slots. When no slot is free the oldest ready one nobody acquired is reused, so the ring keeps the
+    // latest frames. Acquire and the frames' Release may be called from any thread, the rest from the render thread.
+    class FrameCaptureRing
+    {
+    public:
+        FrameCaptureRing();
+
+        FrameCaptureRing(const FrameCaptureRing&) = delete;
+
+        ~FrameCaptureRing();
+
+        // Fails while consumers hold frames. The first frame captured afterwards is damaged in whole bounds.
+        bool SetDepth(size_t depth, const Rect& bounds);
+
+        size_t GetDepth() const;
+
+        // Pending slot for the frame being presented; it may be a reused ready frame whose buffer the backend has to
+        // unmap first. False when every slot is pending or acquired: the frame is dropped, its damage goes to the
+        // next one.
+        bool BeginCapture(const DamageRegion& damage, size_t* slot);
+
+        void MarkReady(size_t slot, const Surface& surface);
+
+        // Pending slots oldest first; readbacks finish in order, so polling can stop at the first unfinished one.
+        size_t GetPendingSlots(size_t* slots, size_t capacity) const;
+
+        // A slot whose frame was released by its consumers; the backend unmaps it and it becomes free.
+        bool TakeReleased(size_t* slot);
+
+        bool Acquire(CapturedFrame** frame);
+
+    private:
+        class Frame;
+
+        enum SlotState
+        {
+            SLOT_FREE,
+            SLOT_PENDING,
+            SLOT_READY,
+            SLOT_ACQUIRED,
+            SLOT_RELEASED,
+        };
+
+        void OnReleased(size_t slot);
+
+        mutable std::mutex mutex_;
+        std::vector<std::unique_ptr<Frame>> frames_;
+        std::vector<SlotState> states_;
+        // Damage of dropped frames, added to the next captured one.
+        DamageRegion carriedDamage_;
+        uint64_t frameNumber_;
+    };
+}
+
+#endif //HMI_FRAME_CAPTURE_RING_H
@@ -0,0 +1,189 @@
+#include "frame_profiler.h"
+
+#include <cstdio>
+#include <memory>
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        const char* const STAGE_NAMES[FRAME_STAGE_COUNT] = {"ElementRender", "ZOrder", "Composite", "Present"};
+
+        double HitRate(const CacheStatistics& statistics)
+        {
+            const uint64_t lookups = statistics.hits + statistics.misses;
+            return lookups > 0 ? static_cast<double>(statistics.hits) / lookups : 0.0;
+        }
+
+        struct FileCloser
+        {
+            void operator()(std::FILE* file) const
+            {
+                std::fclose(file);
+            }
+        };
+    }
+
+    FrameProfiler::FrameProfiler(size_t frameCapacity, size_t elementTimingCapacity, size_t threadCount)
+        : origin_{std::chrono::steady_clock::now()}
+        , enabled_{true}
+        , frames_{frameCapacity}
+        , elementTimings_{elementTimingCapacity}
+        , pendingElementTimings_(threadCount > 0 ? threadCount : 1)
+        , currentFrame_{}
+        , frameStart_{}
+        , stageStart_{}
+        , zOrderMicroseconds_{0}
+        , nextFrameIndex_{}
+    {
+    }
+
+    void FrameProfiler::SetEnabled(bool enabled)
+    {
+        enabled_.store(enabled);
+    }
+
+    bool FrameProfiler::IsEnabled() const
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t FrameProfiler::Now() const
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - origin_).count());
+    }
+
+    void FrameProfiler::BeginFrame()
+    {
+        currentFrame_ = FrameStatistics{};
+        frameStart_ = Now();
+        currentFrame_.startMicroseconds = frameStart_;
+    }
+
+    FrameStatistics& FrameProfiler::GetCurrentFrame()
+    {
+        return currentFrame_;
+    }
+
+    void FrameProfiler::BeginStage(FrameStage stage)
+    {
+        stageStart_[stage] = Now();
+    }
+
+    void FrameProfiler::EndStage(FrameStage stage)
+    {
+        const uint64_t now = Now();
+        currentFrame_.stages[stage].offsetMicroseconds = static_cast<uint32_t>(stageStart_[stage] - frameStart_);
+        currentFrame_.stages[stage].durationMicroseconds += static_cast<uint32_t>(now - stageStart_[stage]);
+    }
+
+    void FrameProfiler::AddZOrderTime(uint64_t microseconds)
+    {
+        zOrderMicroseconds_.fetch_add(microseconds, std::memory_order_relaxed);
+    }
+
+    void FrameProfiler::RecordElement(ElementHandle handle, size_t threadIndex, uint64_t start, uint64_t end)
+    {
+        if(threadIndex >= pendingElementTimings_.size())
+            return;
+
+        ElementTiming timing{};
+        timing.handle = handle;
+        timing.startMicroseconds = start;
+        timing.durationMicroseconds = static_cast<uint32_t>(end - start);
+        timing.threadIndex = static_cast<uint32_t>(threadIndex);
+        pendingElementTimings_[threadIndex].push_back(timing);
+    }
+
+    void FrameProfiler::EndFrame(bool record)
+    {
+        if(!record)
+        {
+            for(auto& pending: pendingElementTimings_)
+            {
+                pending.clear();
+            }
+
+            return;
+        }
+
+        currentFrame_.frameIndex = nextFrameIndex_++;
+        currentFrame_.durationMicroseconds = static_cast<uint32_t>(Now() - frameStart_);
+        currentFrame_.stages[FRAME_STAGE_Z_ORDER].durationMicroseconds =
+            static_cast<uint32_t>(zOrderMicroseconds_.exchange(0, std::memory_order_relaxed));
+        frames_.Push(currentFrame_);
+        for(auto& pending: pendingElementTimings_)
+        {
+            for(auto& timing: pending)
+            {
+                timing.frameIndex = currentFrame_.frameIndex;
+                elementTimings_.Push(timing);
+            }
+
+            pending.clear();
+        }
+    }
+
+    size_t FrameProfiler::GetFrames(FrameStatistics* frames, size_t capacity) const
+    {
+        return frames_.Read(frames, capacity);
+    }
+
+    size_t FrameProfiler::GetElementTimings(ElementTiming* timings, size_t capacity) const
+    {
+        return elementTimings_.Read(timings, capacity);
+    }
+
+    bool FrameProfiler::ExportChromeTrace(const char* path) const
+    {
+        std::unique_ptr<std::FILE, FileCloser> file{std::fopen(path, "w")};
+        if(!file)
+            return false;
+
+        std::vector<FrameStatistics> frames(frames_.GetCapacity());
+        frames.resize(frames_.Read(frames.data(), frames.size()));
+        std::vector<ElementTiming> timings(elementTimings_.GetCapacity());
+        timings.resize(elementTimings_.Read(timings.data(), timings.size()));
+
+        // Chrome trace event format: complete events ("X") for frames, stages and elements, counters ("C") for the rest.
+        std::FILE* out = file.get();
+        std::fprintf(out, "{\"traceEvents\":[\n");
+        std::fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Render\"}}");
+        for(auto& frame: frames)
+        {
+            std::fprintf(out, ",\n{\"name\":\"Frame %llu\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%llu,\"dur\":%u,"
+                "\"args\":{\"presented\":%s,\"dirtyElements\":%u,\"damageRects\":%u,\"damageArea\":%llu}}",
+                static_cast<unsigned long long>(frame.frameIndex), static_cast<unsigned long long>(frame.startMicroseconds),
+                frame.durationMicroseconds, frame.presented ? "true" : "false", frame.dirtyElementCount,
+                frame.damageRectCount, static_cast<unsigned long long>(frame.damageArea));
+            for(int stage = 0; stage < FRAME_STAGE_COUNT; ++stage)
+            {
+                if(stage == FRAME_STAGE_Z_ORDER || frame.stages[stage].durationMicroseconds == 0)
+                    continue;
+
+                std::fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%llu,\"dur\":%u}",
+                    STAGE_NAMES[stage], static_cast<unsigned long long>(frame.startMicroseconds + frame.stages[stage].offsetMicroseconds),
+                    frame.stages[stage].durationMicroseconds);
+            }
+
+            std::fprintf(out, ",\n{\"name\":\"Frame\",\"ph\":\"C\",\"pid\":1,\"ts\":%llu,\"args\":{\"zOrderUs\":%u,\"dirtyElements\":%u,"
+                "\"brushHitRate\":%.3f,\"textFormatHitRate\":%.3f,\"textLayoutHitRate\":%.3f}}",
+                static_cast<unsigned long long>(frame.startMicroseconds), frame.stages[FRAME_STAGE_Z_ORDER].durationMicroseconds,
+                frame.dirtyElementCount, HitRate(frame.colorBrushes), HitRate(frame.textFormats),
+                HitRate(frame.textLayouts));
+        }
+
+        for(auto& timing: timings)
+        {
+            std::fprintf(out, ",\n{\"name\":\"Element %u:%u\",\"cat\":\"element\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu,\"dur\":%u,"
+                "\"args\":{\"frame\":%llu}}",
+                timing.handle.index, timing.handle.generation, timing.threadIndex,
+                static_cast<unsigned long long>(timing.startMicroseconds), timing.durationMicroseconds,
+                static_cast<unsigned long long>(timing.frameIndex));
+        }
+
+        std::fprintf(out, "\n]}\n");
+        return std::ferror(out) == 0;
+    }
+}
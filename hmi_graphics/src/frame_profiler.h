@@ -0,0 +1,64 @@
+#ifndef HMI_FRAME_PROFILER_H
+#define HMI_FRAME_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "seqlock_ring.h"
+#include "types.h"
+
+namespace hmi_graphics
+{
+    // Collects per-frame stage timings and per-element render timings into lock-free rings. The frame is driven by
+    // the thread calling System::Render; element timings may be recorded from any thread pool thread.
+    class FrameProfiler
+    {
+    public:
+        FrameProfiler(size_t frameCapacity, size_t elementTimingCapacity, size_t threadCount);
+
+        void SetEnabled(bool enabled);
+
+        bool IsEnabled() const;
+
+        // Microseconds since the profiler was created.
+        uint64_t Now() const;
+
+        void BeginFrame();
+
+        FrameStatistics& GetCurrentFrame();
+
+        void BeginStage(FrameStage stage);
+
+        void EndStage(FrameStage stage);
+
+        // Accounted to FRAME_STAGE_Z_ORDER of the next recorded frame.
+        void AddZOrderTime(uint64_t microseconds);
+
+        void RecordElement(ElementHandle handle, size_t threadIndex, uint64_t start, uint64_t end);
+
+        // Pushes the frame and its element timings when record is true, drops them otherwise.
+        void EndFrame(bool record);
+
+        size_t GetFrames(FrameStatistics* frames, size_t capacity) const;
+
+        size_t GetElementTimings(ElementTiming* timings, size_t capacity) const;
+
+        bool ExportChromeTrace(const char* path) const;
+
+    private:
+        std::chrono::steady_clock::time_point origin_;
+        std::atomic<bool> enabled_;
+        SeqlockRing<FrameStatistics> frames_;
+        SeqlockRing<ElementTiming> elementTimings_;
+        std::vector<std::vector<ElementTiming>> pendingElementTimings_;
+        FrameStatistics currentFrame_;
+        uint64_t frameStart_;
+        uint64_t stageStart_[FRAME_STAGE_COUNT];
+        std::atomic<uint64_t> zOrderMicroseconds_;
+        uint64_t nextFrameIndex_;
+    };
+}
+
+#endif //HMI_FRAME_PROFILER_H
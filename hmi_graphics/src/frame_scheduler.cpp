@@ -0,0 +1,162 @@
+#include "frame_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#define STRINGIZE_DETAIL(x) #x
+#define STRINGIZE(x) STRINGIZE_DETAIL(x)
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        constexpr uint64_t MICROSECONDS_PER_SECOND = 1000000;
+        // Sleeps end up to a scheduler tick late, so the last stretch before the start is spun.
+        constexpr uint64_t SPIN_MICROSECONDS = 2000;
+
+        class SteadyFrameClock: public FrameClock
+        {
+        public:
+            uint64_t Now() override
+            {
+                return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+            }
+
+            void SleepUntil(uint64_t microseconds) override
+            {
+                const uint64_t now = Now();
+                if(microseconds > now + SPIN_MICROSECONDS)
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds{microseconds - now - SPIN_MICROSECONDS});
+                }
+
+                while(Now() < microseconds)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        };
+    }
+
+    constexpr size_t FrameScheduler::WORK_HISTORY_SIZE;
+
+    FrameClock* FrameClock::GetSteadyClock()
+    {
+        static SteadyFrameClock clock;
+        return &clock;
+    }
+
+    FrameScheduler::FrameScheduler(const FrameSchedulerOptions& options)
+        : options_(options)
+        , clock_{options.clock != nullptr ? options.clock : FrameClock::GetSteadyClock()}
+        , period_{0}
+        , deadline_{0}
+        , start_{0}
+        , scheduled_{false}
+        , lastMissed_{false}
+        , workHistory_{}
+        , workCount_{0}
+        , workNext_{0}
+        , statistics_{}
+    {
+        if(options.targetFps == 0)
+            throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " targetFps");
+
+        period_ = MICROSECONDS_PER_SECOND / options.targetFps;
+    }
+
+    uint64_t FrameScheduler::WaitForFrameStart()
+    {
+        const uint64_t now = clock_->Now();
+        // Starting more than a period early would only overlap the previous frame's deadline and add latency.
+        const uint64_t lead = std::min<uint64_t>(EstimateWork() + options_.safetyMarginMicroseconds, period_);
+        if(!scheduled_)
+        {
+            deadline_ = now + lead;
+            scheduled_ = true;
+        }
+        else if(deadline_ < now + lead)
+        {
+            if(options_.latePolicy == LATE_FRAME_POLICY_SKIP)
+            {
+                const uint64_t skipped = (now + lead - deadline_ + period_ - 1) / period_;
+                deadline_ += skipped * period_;
+                // After idle time the deadlines simply passed; only those a late frame ran over were given up.
+                if(lastMissed_)
+                {
+                    statistics_.skippedDeadlines += skipped;
+                }
+            }
+            else
+            {
+                deadline_ = now + lead;
+            }
+        }
+
+        start_ = deadline_ - lead;
+        if(start_ > now)
+        {
+            clock_->SleepUntil(start_);
+        }
+        else
+        {
+            start_ = now;
+        }
+
+        return deadline_;
+    }
+
+    void FrameScheduler::EndFrame(bool presented)
+    {
+        const uint64_t end = clock_->Now();
+        if(presented)
+        {
+            const uint32_t work = static_cast<uint32_t>(std::min<uint64_t>(end - start_, UINT32_MAX));
+            workHistory_[workNext_] = work;
+            workNext_ = (workNext_ + 1) % WORK_HISTORY_SIZE;
+            workCount_ = std::min(workCount_ + 1, WORK_HISTORY_SIZE);
+            statistics_.frames += 1;
+            statistics_.estimatedWorkMicroseconds = EstimateWork();
+            lastMissed_ = end > deadline_;
+            if(lastMissed_)
+            {
+                const uint32_t lateness = static_cast<uint32_t>(std::min<uint64_t>(end - deadline_, UINT32_MAX));
+                statistics_.missedDeadlines += 1;
+                statistics_.lastLatenessMicroseconds = lateness;
+                statistics_.maxLatenessMicroseconds = std::max(statistics_.maxLatenessMicroseconds, lateness);
+                if(options_.onMissedDeadline)
+                {
+                    options_.onMissedDeadline(MissedDeadline{statistics_.frames - 1, deadline_, lateness, work});
+                }
+            }
+        }
+        else
+        {
+            lastMissed_ = false;
+        }
+
+        deadline_ += period_;
+    }
+
+    void FrameScheduler::GetStatistics(FrameSchedulerStatistics* statistics) const
+    {
+        if(statistics != nullptr)
+        {
+            *statistics = statistics_;
+        }
+    }
+
+    uint64_t FrameScheduler::GetPeriodMicroseconds() const
+    {
+        return period_;
+    }
+
+    uint32_t FrameScheduler::EstimateWork() const
+    {
+        // The longest recent frame rather than the average: starting too late costs a missed deadline.
+        return *std::max_element(workHistory_, workHistory_ + std::max<size_t>(workCount_, 1));
+    }
+}
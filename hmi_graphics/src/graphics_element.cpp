@@ -1,5 +1,7 @@
 #include "graphics_element.h"
 #include "graphics_element_pimpl.h"
+#include <wrl/client.h>
+#include "display_list.h"
 
 namespace hmi_graphics
 {
@@ -27,39 +29,53 @@ namespace hmi_graphics
 
     int16_t GraphicsElement::GetZIndex() const
     {
-        return pimpl_->zIndex_;
+        return pimpl_->system_->GetElementStore().GetZIndex(pimpl_->handle_);
     }
 
     void GraphicsElement::SetZIndex(int16_t zIndex)
     {
-        int16_t oldZIndex = pimpl_->zIndex_;
-        pimpl_->zIndex_ = zIndex;
-        if(oldZIndex != zIndex)
-        {
-            pimpl_->system_->ElementZIndexUpdated();
-        }
+        pimpl_->system_->SetElementZIndex(pimpl_->handle_, zIndex);
     }
 
     void GraphicsElement::SetSize(int16_t width, int16_t height)
     {
-        pimpl_->width_ = width;
-        pimpl_->height_ = height;
+        pimpl_->system_->SetElementSize(pimpl_->handle_, width, height);
     }
 
     Size GraphicsElement::GetSize() const
     {
-        return {pimpl_->width_, pimpl_->height_};
+        return pimpl_->system_->GetElementStore().GetSize(pimpl_->handle_);
     }
 
     void GraphicsElement::SetPosition(int16_t x, int16_t y)
     {
-        pimpl_->x_ = x;
-        pimpl_->y_ = y;
+        pimpl_->system_->SetElementPosition(pimpl_->handle_, x, y);
     }
 
     Point GraphicsElement::GetPosition() const
     {
-        return {pimpl_->x_, pimpl_->y_};
+        return pimpl_->system_->GetElementStore().GetPosition(pimpl_->handle_);
+    }
+
+    void GraphicsElement::SetCompositeTransform(const CompositeTransform& transform)
+    {
+        pimpl_->system_->SetElementCompositeTransform(pimpl_->handle_, transform);
+    }
+
+    CompositeTransform GraphicsElement::GetCompositeTransform() const
+    {
+        return pimpl_->system_->GetElementStore().GetCompositeTransform(pimpl_->handle_);
+    }
+
+    void GraphicsElement::SetOpacityHint(OpacityHint hint)
+    {
+        pimpl_->system_->SetElementOpacityHint(pimpl_->handle_, hint);
+    }
+
+    OpacityHint GraphicsElement::GetOpacityHint() const
+    {
+        const bool opaque = pimpl_->system_->GetElementStore().HasFlags(pimpl_->handle_, ElementStore::FLAG_OPAQUE);
+        return opaque ? OPACITY_HINT_OPAQUE : OPACITY_HINT_TRANSLUCENT;
     }
 
     bool GraphicsElement::GetTarget(ID2D1Bitmap1** target)
@@ -72,25 +88,91 @@ namespace hmi_graphics
         return pimpl_->GetTarget(target);
     }
 
+    bool GraphicsElement::GetSurface(Surface* surface)
+    {
+        if(surface == nullptr)
+        {
+            return false;
+        }
+
+        return pimpl_->GetSurface(surface);
+    }
+
     System* GraphicsElement::GetParent() const
     {
         return pimpl_->system_;
     }
 
+    ElementHandle GraphicsElement::GetHandle() const
+    {
+        return pimpl_->handle_;
+    }
+
     void GraphicsElement::NotifyUpdated()
     {
-        pimpl_->updated_ = true;
+        pimpl_->system_->ElementUpdated(pimpl_->handle_);
     }
 
     bool GraphicsElement::ResetUpdatedFlag()
     {
-        bool updated = pimpl_->updated_;
-        pimpl_->updated_ = false;
-        return updated;
+        return pimpl_->system_->GetElementStore().ClearFlags(pimpl_->handle_, ElementStore::FLAG_UPDATED);
     }
 
     ID2D1Bitmap1* GraphicsElement::GetTarget() const
     {
         return pimpl_->GetTarget();
     }
+
+    bool GraphicsElement::BeginDraw(ID2D1DeviceContext* context)
+    {
+        auto* target = pimpl_->GetTarget();
+        if(context == nullptr || target == nullptr)
+        {
+            return false;
+        }
+
+        const Rect& rect = pimpl_->targetRect_;
+        context->SetTarget(target);
+        context->BeginDraw();
+        context->SetTransform(D2D1::IdentityMatrix());
+        context->PushAxisAlignedClip(D2D1::RectF((float)rect.origin.x, (float)rect.origin.y,
+            (float)(rect.origin.x + rect.size.width), (float)(rect.origin.y + rect.size.height)), D2D1_ANTIALIAS_MODE_ALIASED);
+        context->SetTransform(GetTargetTransform());
+        return true;
+    }
+
+    HRESULT GraphicsElement::EndDraw(ID2D1DeviceContext* context)
+    {
+        context->SetTransform(D2D1::IdentityMatrix());
+        context->PopAxisAlignedClip();
+        HRESULT hr = context->EndDraw();
+        // Other threads' contexts may target the same atlas page next.
+        context->SetTarget(nullptr);
+        return hr;
+    }
+
+    D2D1::Matrix3x2F GraphicsElement::GetTargetTransform() const
+    {
+        const Rect& rect = pimpl_->targetRect_;
+        return D2D1::Matrix3x2F::Translation((float)rect.origin.x, (float)rect.origin.y);
+    }
+
+    bool GraphicsElement::RenderDisplayList(const DisplayList& list)
+    {
+        System* system = pimpl_->system_;
+        Surface surface{};
+        if(pimpl_->GetSurface(&surface))
+        {
+            return list.Replay(system, surface);
+        }
+
+        Microsoft::WRL::ComPtr<ID2D1DeviceContext> context;
+        if(!system->GetDirect2dDeviceContext(&context) || !BeginDraw(context.Get()))
+        {
+            return false;
+        }
+
+        const bool replayed = list.Replay(system, context.Get(), GetTargetTransform());
+        return SUCCEEDED(EndDraw(context.Get())) && replayed;
+    }
 }
@@ -4,53 +4,64 @@
 #include "comptr.h"
 #include "graphics_element.h"
 #include "graphics_system.h"
-#include "graphics_system_d3d11.h"
+#include "graphics_system_base.h"
 #include <d3d11.h>
 #include <d2d1_2.h>
 #include <wrl.h>
-#include <cassert>
+#include <vector>
 
 class hmi_graphics::GraphicsElement::Pimpl
 {
     friend class hmi_graphics::GraphicsElement;
 public:
-    Pimpl(System* system, int16_t width, int16_t height, ID3D11Texture2D* texture);
+    Pimpl(SystemBase* system, ElementHandle handle, int16_t width, int16_t height, ID3D11Texture2D* texture, ID2D1Bitmap1* target, const Rect& targetRect);
+
+    Pimpl(SystemBase* system, ElementHandle handle, int16_t width, int16_t height);
 
     bool GetTarget(ID2D1Bitmap1** target);
 
     ID2D1Bitmap1* GetTarget();
 
+    bool GetSurface(Surface* surface);
+
+    // Used by the backends to evict and restore the backing store; without one the element draws nothing.
+    void ReleaseSurface();
+
+    void RestoreSurface(ID3D11Texture2D* texture, ID2D1Bitmap1* target);
+
+    void RestoreSurface();
+
 private:
-    bool updated_;
-    int16_t x_;
-    int16_t y_;
-    int16_t width_;
-    int16_t height_;
-    int16_t zIndex_;
-    SystemD3D11* system_;
+    SystemBase* system_;
+    ElementHandle handle_;
     ComPtr<ID2D1Bitmap1> target_;
     ComPtr<ID3D11Texture2D> targetTexture_;
     ComPtr<ID2D1DeviceContext> context_;
+    Rect targetRect_;
+    std::vector<uint32_t> pixels_;
+    int16_t surfaceWidth_;
+    int16_t surfaceHeight_;
 };
 
-inline hmi_graphics::GraphicsElement::Pimpl::Pimpl(System* system, int16_t width, int16_t height, ID3D11Texture2D* texture)
-    : updated_{true}
-    , x_{0}
-    , y_{0}
-    , width_{width}
-    , height_{height}
-    , zIndex_{0}
+inline hmi_graphics::GraphicsElement::Pimpl::Pimpl(SystemBase* system, ElementHandle handle, int16_t width, int16_t height, ID3D11Texture2D* texture, ID2D1Bitmap1* target, const Rect& targetRect)
+    : system_{system}
+    , handle_(handle)
+    , target_{target}
+    , targetTexture_{texture}
+    , targetRect_(targetRect)
+    , surfaceWidth_{0}
+    , surfaceHeight_{0}
+{
+}
+
+inline hmi_graphics::GraphicsElement::Pimpl::Pimpl(SystemBase* system, ElementHandle handle, int16_t width, int16_t height)
+    : system_{system}
+    , handle_(handle)
+    , targetRect_{Point{0, 0}, Size{width, height}}
+    , pixels_(static_cast<size_t>(width) * height)
+    , surfaceWidth_{width}
+    , surfaceHeight_{height}
 {
-    HRESULT hr{};
-    system_ = static_cast<SystemD3D11*>(system);
-    ComPtr<IDXGISurface> surface;
-    ComPtr<ID2D1DeviceContext> context;
-    system_->GetDirect2dDeviceContext(&context);
-    targetTexture_ = texture;
-    targetTexture_->QueryInterface(IID_PPV_ARGS(&surface));
-    auto destProp = D2D1::BitmapProperties1(D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW, D2D1::PixelFormat(DXGI_FORMAT_R8G8B8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
-    hr = context->CreateBitmapFromDxgiSurface(surface.Get(), destProp, &target_);
-    assert(SUCCEEDED(hr));
 }
 
 inline bool hmi_graphics::GraphicsElement::Pimpl::GetTarget(ID2D1Bitmap1** target)
@@ -65,9 +76,41 @@ inline bool hmi_graphics::GraphicsElement::Pimpl::GetTarget(ID2D1Bitmap1** targe
     return false;
 }
 
+inline void hmi_graphics::GraphicsElement::Pimpl::ReleaseSurface()
+{
+    target_.Reset();
+    targetTexture_.Reset();
+    std::vector<uint32_t>{}.swap(pixels_);
+}
+
+inline void hmi_graphics::GraphicsElement::Pimpl::RestoreSurface(ID3D11Texture2D* texture, ID2D1Bitmap1* target)
+{
+    target_ = target;
+    targetTexture_ = texture;
+}
+
+inline void hmi_graphics::GraphicsElement::Pimpl::RestoreSurface()
+{
+    pixels_.assign(static_cast<size_t>(surfaceWidth_) * surfaceHeight_, 0);
+}
+
 inline ID2D1Bitmap1* hmi_graphics::GraphicsElement::Pimpl::GetTarget()
 {
     return target_.Get();
 }
 
+inline bool hmi_graphics::GraphicsElement::Pimpl::GetSurface(Surface* surface)
+{
+    if(pixels_.empty())
+    {
+        return false;
+    }
+
+    surface->pixels = pixels_.data();
+    surface->width = surfaceWidth_;
+    surface->height = surfaceHeight_;
+    surface->stride = surfaceWidth_;
+    return true;
+}
+
 #endif //GRAPHICS_ELEMENT_PIMPL_H
@@ -1,5 +1,6 @@
 #include "graphics_system.h"
 #include "graphics_system_d3d11.h"
+#include "graphics_system_software.h"
 #include <new>
 
 namespace hmi_graphics
@@ -8,4 +9,9 @@ namespace hmi_graphics
     {
         return new(std::nothrow) SystemD3D11{hWnd, width, height};
     }
+
+    System* System::CreateHeadlessInstance(int16_t width, int16_t height)
+    {
+        return new(std::nothrow) SystemSoftware{width, height};
+    }
 }
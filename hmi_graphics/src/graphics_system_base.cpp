@@ -0,0 +1,734 @@
+#include "graphics_system_base.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <graphics_element.h>
+#include "composite_transform.h"
+#include "rect_util.h"
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        constexpr size_t PROFILED_FRAME_CAPACITY = 600;
+        constexpr size_t PROFILED_ELEMENT_CAPACITY = 16384;
+        constexpr size_t TEXT_FORMAT_CACHE_CAPACITY = 64;
+        constexpr size_t TEXT_LAYOUT_CACHE_BUDGET = 4 * 1024 * 1024;
+        // One layer blit has to replace at least this many quads to be worth its surface.
+        constexpr size_t MIN_LAYER_ELEMENTS = 2;
+        constexpr uint64_t LAYER_BYTES_PER_PIXEL = 4;
+    }
+
+    SystemBase::SystemBase(int16_t width, int16_t height)
+        : threadPool_{ThreadPool::GetDefaultWorkerCount()}
+        , profiler_{PROFILED_FRAME_CAPACITY, PROFILED_ELEMENT_CAPACITY, threadPool_.GetThreadCount()}
+        , profiling_{false}
+        , textCache_{TEXT_FORMAT_CACHE_CAPACITY, TEXT_LAYOUT_CACHE_BUDGET}
+        , spatialIndex_{width, height}
+        , viewport_(MakeRect(0, 0, width, height))
+        , surfaceBudget_{0}
+        , residentBytes_{0}
+        , evictedBytes_{0}
+        , residencyFrame_{0}
+        , evictions_{0}
+        , restores_{0}
+        , staticThreshold_{0}
+        , compositeFrame_{0}
+        , lastLayerPlan_{0}
+        , layerPlanPending_{false}
+        , layerStatistics_{}
+    {
+    }
+
+    SystemBase::~SystemBase()
+    {
+        DestroyElements();
+    }
+
+    void SystemBase::RemoveElement(GraphicsElement* element)
+    {
+        if(element != nullptr)
+        {
+            RemoveElement(element->GetHandle());
+        }
+    }
+
+    bool SystemBase::RemoveElement(ElementHandle handle)
+    {
+        GraphicsElement* element = store_.GetElement(handle);
+        if(element == nullptr)
+            return false;
+
+        spatialIndex_.Remove(element);
+        drawOrder_.Remove(element);
+        damage_.Add(store_.GetBounds(handle));
+        MarkChanged(handle);
+        const uint64_t bytes = residency_[handle.index].bytes;
+        if(store_.HasFlags(handle, ElementStore::FLAG_EVICTED))
+        {
+            evicted_.erase(std::find_if(evicted_.begin(), evicted_.end(), [handle](ElementHandle entry)
+            {
+                return entry.index == handle.index;
+            }));
+            evictedBytes_ -= bytes;
+        }
+        else
+        {
+            residentBytes_ -= bytes;
+        }
+
+        ReleaseElement(element);
+        store_.Remove(handle);
+        delete element;
+        return true;
+    }
+
+    GraphicsElement* SystemBase::GetElement(ElementHandle handle)
+    {
+        return store_.GetElement(handle);
+    }
+
+    GraphicsElement* SystemBase::HitTest(int32_t x, int32_t y, HitTestCursor* cursor)
+    {
+        return spatialIndex_.Query(x, y, cursor);
+    }
+
+    bool SystemBase::GetCachedTextFormat(const TextFormatDesc& desc, IDWriteTextFormat** textFormat)
+    {
+        return textCache_.GetTextFormat(desc, textFormat);
+    }
+
+    bool SystemBase::GetCachedTextLayout(const wchar_t* text, uint32_t length, const TextFormatDesc& desc, float maxWidth,
+        float maxHeight, IDWriteTextLayout** textLayout)
+    {
+        return textCache_.GetTextLayout(text, length, desc, maxWidth, maxHeight, textLayout);
+    }
+
+    bool SystemBase::DrawCachedText(const Surface& surface, const Rect& box, const wchar_t* text, uint32_t length,
+        const TextFormatDesc& desc, uint32_t argb)
+    {
+        return false;
+    }
+
+    void SystemBase::GetTextCacheStatistics(CacheStatistics* textLayouts, AtlasStatistics* textAtlas)
+    {
+        textCache_.GetStatistics(nullptr, textLayouts);
+        if(textAtlas != nullptr)
+        {
+            *textAtlas = AtlasStatistics{};
+        }
+    }
+
+    void SystemBase::GetDirectWriteFactory(IDWriteFactory** factory)
+    {
+        *factory = textCache_.GetFactory();
+        (*factory)->AddRef();
+    }
+
+    void SystemBase::SetProfilingEnabled(bool enabled)
+    {
+        profiler_.SetEnabled(enabled);
+    }
+
+    size_t SystemBase::GetFrameStatistics(FrameStatistics* frames, size_t capacity)
+    {
+        return profiler_.GetFrames(frames, capacity);
+    }
+
+    size_t SystemBase::GetElementTimings(ElementTiming* timings, size_t capacity)
+    {
+        return profiler_.GetElementTimings(timings, capacity);
+    }
+
+    bool SystemBase::ExportChromeTrace(const char* path)
+    {
+        return profiler_.ExportChromeTrace(path);
+    }
+
+    size_t SystemBase::GetPresentedDamage(Rect* rects, size_t capacity)
+    {
+        auto& presented = presentedDamage_.GetRects();
+        if(rects != nullptr)
+        {
+            std::copy_n(presented.begin(), std::min(capacity, presented.size()), rects);
+        }
+
+        return presented.size();
+    }
+
+    bool SystemBase::AcquireCapturedFrame(CapturedFrame** frame)
+    {
+        return captureRing_.Acquire(frame);
+    }
+
+    void SystemBase::SetSurfaceMemoryBudget(uint64_t bytes)
+    {
+        surfaceBudget_ = bytes;
+    }
+
+    void SystemBase::GetSurfaceMemoryStatistics(SurfaceMemoryStatistics* statistics)
+    {
+        if(statistics == nullptr)
+            return;
+
+        statistics->budgetBytes = surfaceBudget_;
+        statistics->residentBytes = residentBytes_;
+        statistics->evictedBytes = evictedBytes_;
+        statistics->residentCount = store_.GetCount() - evicted_.size();
+        statistics->evictedCount = evicted_.size();
+        statistics->evictions = evictions_;
+        statistics->restores = restores_;
+    }
+
+    bool SystemBase::GetElementSurfaceMemory(ElementHandle handle, ElementSurfaceMemory* memory)
+    {
+        if(memory == nullptr || store_.GetElement(handle) == nullptr)
+            return false;
+
+        memory->bytes = residency_[handle.index].bytes;
+        memory->resident = !store_.HasFlags(handle, ElementStore::FLAG_EVICTED);
+        return true;
+    }
+
+    void SystemBase::SetStaticLayerThreshold(uint32_t frames)
+    {
+        staticThreshold_ = frames;
+        layerPlanPending_ = true;
+        if(frames != 0)
+            return;
+
+        for(uint32_t layer = 0; layer < staticLayers_.size(); ++layer)
+        {
+            if(staticLayers_[layer].alive)
+            {
+                DissolveLayer(layer);
+            }
+        }
+    }
+
+    void SystemBase::GetStaticLayerStatistics(StaticLayerStatistics* statistics)
+    {
+        if(statistics != nullptr)
+        {
+            *statistics = layerStatistics_;
+        }
+    }
+
+    ElementStore& SystemBase::GetElementStore()
+    {
+        return store_;
+    }
+
+    void SystemBase::SetElementPosition(ElementHandle handle, int x, int y)
+    {
+        Point position = store_.GetPosition(handle);
+        if(position.x == x && position.y == y)
+            return;
+
+        damage_.Add(store_.GetBounds(handle));
+        MarkChanged(handle);
+        store_.SetPosition(handle, x, y);
+        Rect bounds = store_.GetBounds(handle);
+        spatialIndex_.Update(store_.GetElement(handle), bounds, store_.GetZIndex(handle));
+        damage_.Add(bounds);
+    }
+
+    void SystemBase::SetElementSize(ElementHandle handle, int width, int height)
+    {
+        Size size = store_.GetSize(handle);
+        if(size.width == width && size.height == height)
+            return;
+
+        damage_.Add(store_.GetBounds(handle));
+        MarkChanged(handle);
+        store_.SetSize(handle, width, height);
+        Rect bounds = store_.GetBounds(handle);
+        spatialIndex_.Update(store_.GetElement(handle), bounds, store_.GetZIndex(handle));
+        damage_.Add(bounds);
+    }
+
+    void SystemBase::SetElementZIndex(ElementHandle handle, int16_t zIndex)
+    {
+        if(store_.GetZIndex(handle) == zIndex)
+            return;
+
+        const bool profiling = profiler_.IsEnabled();
+        const uint64_t start = profiling ? profiler_.Now() : 0;
+        GraphicsElement* element = store_.GetElement(handle);
+        Rect bounds = store_.GetBounds(handle);
+        store_.SetZIndex(handle, zIndex);
+        spatialIndex_.Update(element, bounds, zIndex);
+        drawOrder_.Reposition(element, zIndex);
+        damage_.Add(bounds);
+        MarkChanged(handle);
+        MarkZIndexEntered(zIndex);
+        if(profiling)
+        {
+            profiler_.AddZOrderTime(profiler_.Now() - start);
+        }
+    }
+
+    void SystemBase::SetElementCompositeTransform(ElementHandle handle, const CompositeTransform& transform)
+    {
+        if(CompositeTransformsEqual(store_.GetCompositeTransform(handle), transform))
+            return;
+
+        damage_.Add(store_.GetBounds(handle));
+        MarkChanged(handle);
+        store_.SetCompositeTransform(handle, transform);
+        Rect bounds = store_.GetBounds(handle);
+        spatialIndex_.Update(store_.GetElement(handle), bounds, store_.GetZIndex(handle));
+        damage_.Add(bounds);
+    }
+
+    void SystemBase::SetElementOpacityHint(ElementHandle handle, OpacityHint hint)
+    {
+        const bool opaque = hint == OPACITY_HINT_OPAQUE;
+        if(store_.HasFlags(handle, ElementStore::FLAG_OPAQUE) == opaque)
+            return;
+
+        // What the element hid has to be composited again, or may be skipped from now on.
+        if(opaque)
+        {
+            store_.SetFlags(handle, ElementStore::FLAG_OPAQUE);
+        }
+        else
+        {
+            store_.ClearFlags(handle, ElementStore::FLAG_OPAQUE);
+        }
+
+        damage_.Add(store_.GetBounds(handle));
+    }
+
+    void SystemBase::ElementUpdated(ElementHandle handle)
+    {
+        store_.SetFlags(handle, ElementStore::FLAG_UPDATED);
+        damage_.Add(store_.GetBounds(handle));
+        MarkChanged(handle);
+    }
+
+    void SystemBase::AddDamage(const Rect& rect)
+    {
+        damage_.Add(rect);
+    }
+
+    void SystemBase::CaptureElementStates(std::vector<ElementState>* states, std::vector<uint32_t>* sequences) const
+    {
+        states->clear();
+        sequences->clear();
+        for(auto& entry: drawOrder_)
+        {
+            states->push_back(ElementState{entry.handle, store_.GetBounds(entry.handle), entry.zIndex});
+            sequences->push_back(entry.sequence);
+        }
+    }
+
+    const Rect& SystemBase::GetViewport() const
+    {
+        return viewport_;
+    }
+
+    ElementHandle SystemBase::AllocateHandle(GraphicsElement* element, int width, int height)
+    {
+        return store_.Insert(element, width, height);
+    }
+
+    void SystemBase::ElementAdded(GraphicsElement* element)
+    {
+        ElementHandle handle = element->GetHandle();
+        Rect bounds = store_.GetBounds(handle);
+        spatialIndex_.Insert(element, bounds, store_.GetZIndex(handle));
+        drawOrder_.Insert(element, handle, store_.GetZIndex(handle));
+        damage_.Add(bounds);
+        if(residency_.size() <= handle.index)
+        {
+            residency_.resize(handle.index + 1);
+        }
+
+        residency_[handle.index] = SurfaceResidency{GetSurfaceBytes(handle), residencyFrame_};
+        residentBytes_ += residency_[handle.index].bytes;
+        if(layerOf_.size() <= handle.index)
+        {
+            changedFrames_.resize(handle.index + 1);
+            layerOf_.resize(handle.index + 1);
+        }
+
+        layerOf_[handle.index] = 0;
+        MarkChanged(handle);
+        MarkZIndexEntered(store_.GetZIndex(handle));
+    }
+
+    void SystemBase::DestroyElements()
+    {
+        for(auto* element: store_)
+        {
+            spatialIndex_.Remove(element);
+            drawOrder_.Remove(element);
+            delete element;
+        }
+
+        for(uint32_t layer = 0; layer < staticLayers_.size(); ++layer)
+        {
+            if(staticLayers_[layer].alive)
+            {
+                DissolveLayer(layer);
+            }
+        }
+
+        store_.Clear();
+        evicted_.clear();
+        residentBytes_ = 0;
+        evictedBytes_ = 0;
+    }
+
+    void SystemBase::RenderUpdatedElements()
+    {
+        UpdateSurfaceResidency();
+        renderQueue_.clear();
+        store_.CollectFlagged(ElementStore::FLAG_UPDATED, &renderQueue_);
+        renderItems_.clear();
+        for(auto handle: renderQueue_)
+        {
+            // Nothing would show the result; the flag stays so the element renders when it comes into view.
+            if(store_.HasFlags(handle, ElementStore::FLAG_EVICTED) || !RectsIntersect(store_.GetBounds(handle), viewport_))
+                continue;
+
+            store_.ClearFlags(handle, ElementStore::FLAG_UPDATED);
+            renderItems_.push_back(RenderItem{GetRenderGroup(handle), handle});
+        }
+
+        if(renderItems_.empty())
+            return;
+
+        std::sort(renderItems_.begin(), renderItems_.end(), [](const RenderItem& lhs, const RenderItem& rhs)
+        {
+            return lhs.group < rhs.group;
+        });
+
+        renderGroupStarts_.clear();
+        for(size_t i = 0; i < renderItems_.size(); ++i)
+        {
+            if(i == 0 || renderItems_[i].group != renderItems_[i - 1].group)
+            {
+                renderGroupStarts_.push_back(i);
+            }
+        }
+
+        renderGroupStarts_.push_back(renderItems_.size());
+        if(profiling_)
+        {
+            profiler_.GetCurrentFrame().dirtyElementCount = static_cast<uint32_t>(renderItems_.size());
+            profiler_.BeginStage(FRAME_STAGE_ELEMENT_RENDER);
+        }
+
+        threadPool_.ParallelFor(renderGroupStarts_.size() - 1, [this](size_t group)
+        {
+            const size_t threadIndex = ThreadPool::GetCurrentThreadIndex();
+            for(size_t i = renderGroupStarts_[group]; i < renderGroupStarts_[group + 1]; ++i)
+            {
+                const ElementHandle handle = renderItems_[i].handle;
+                if(!profiling_)
+                {
+                    store_.GetElement(handle)->Render(this);
+                    continue;
+                }
+
+                const uint64_t start = profiler_.Now();
+                store_.GetElement(handle)->Render(this);
+                profiler_.RecordElement(handle, threadIndex, start, profiler_.Now());
+            }
+        });
+
+        if(profiling_)
+        {
+            profiler_.EndStage(FRAME_STAGE_ELEMENT_RENDER);
+        }
+    }
+
+    bool SystemBase::IsShown(ElementHandle handle) const
+    {
+        return RectsIntersect(store_.GetBounds(handle), viewport_) && store_.GetCompositeTransform(handle).opacity > 0.f;
+    }
+
+    void SystemBase::UpdateSurfaceResidency()
+    {
+        if(surfaceBudget_ == 0 && evicted_.empty())
+            return;
+
+        residencyFrame_ += 1;
+        store_.CullIntersecting(viewport_, &viewMask_);
+        const size_t count = std::min(viewMask_.size(), residency_.size());
+        for(size_t i = 0; i < count; ++i)
+        {
+            if(viewMask_[i] != 0)
+            {
+                residency_[i].lastShownFrame = residencyFrame_;
+            }
+        }
+
+        for(size_t i = 0; i < evicted_.size();)
+        {
+            const ElementHandle handle = evicted_[i];
+            if(!IsShown(handle))
+            {
+                ++i;
+                continue;
+            }
+
+            RestoreSurface(handle);
+            store_.ClearFlags(handle, ElementStore::FLAG_EVICTED);
+            ElementUpdated(handle);
+            const uint64_t bytes = residency_[handle.index].bytes;
+            residentBytes_ += bytes;
+            evictedBytes_ -= bytes;
+            restores_ += 1;
+            evicted_[i] = evicted_.back();
+            evicted_.pop_back();
+        }
+
+        if(surfaceBudget_ != 0 && residentBytes_ > surfaceBudget_)
+        {
+            EvictHiddenSurfaces();
+        }
+    }
+
+    void SystemBase::EvictHiddenSurfaces()
+    {
+        evictionCandidates_.clear();
+        for(auto* element: store_)
+        {
+            const ElementHandle handle = element->GetHandle();
+            if(!store_.HasFlags(handle, ElementStore::FLAG_EVICTED) && !IsShown(handle))
+            {
+                evictionCandidates_.push_back(handle);
+            }
+        }
+
+        std::sort(evictionCandidates_.begin(), evictionCandidates_.end(), [this](ElementHandle lhs, ElementHandle rhs)
+        {
+            return residency_[lhs.index].lastShownFrame < residency_[rhs.index].lastShownFrame;
+        });
+
+        for(auto handle: evictionCandidates_)
+        {
+            if(residentBytes_ <= surfaceBudget_)
+                break;
+
+            if(!EvictSurface(handle))
+                continue;
+
+            store_.SetFlags(handle, ElementStore::FLAG_EVICTED);
+            const uint64_t bytes = residency_[handle.index].bytes;
+            residentBytes_ -= bytes;
+            evictedBytes_ += bytes;
+            evictions_ += 1;
+            evicted_.push_back(handle);
+        }
+    }
+
+    void SystemBase::UpdateStaticLayers()
+    {
+        compositeFrame_ += 1;
+        if(staticThreshold_ == 0 || !layerPlanPending_ || compositeFrame_ - lastLayerPlan_ < staticThreshold_)
+            return;
+
+        // Planning walks every element, so it runs at most once per threshold and only after something changed.
+        lastLayerPlan_ = compositeFrame_;
+        layerPlanPending_ = false;
+        run_.clear();
+        for(auto& entry: drawOrder_)
+        {
+            const uint32_t index = entry.handle.index;
+            const bool unchanged = compositeFrame_ - changedFrames_[index] >= staticThreshold_;
+            if(!unchanged)
+            {
+                layerPlanPending_ = true;
+            }
+            else if(layerOf_[index] == 0)
+            {
+                run_.push_back(entry);
+                continue;
+            }
+
+            FinishRun();
+        }
+
+        FinishRun();
+    }
+
+    uint32_t SystemBase::GetStaticLayer(ElementHandle handle) const
+    {
+        return layerOf_[handle.index];
+    }
+
+    void SystemBase::MarkChanged(ElementHandle handle)
+    {
+        changedFrames_[handle.index] = compositeFrame_;
+        layerPlanPending_ = true;
+        if(layerOf_[handle.index] != 0)
+        {
+            DissolveLayer(layerOf_[handle.index] - 1);
+        }
+    }
+
+    void SystemBase::MarkZIndexEntered(int16_t zIndex)
+    {
+        if(layerStatistics_.layerCount == 0)
+            return;
+
+        for(uint32_t layer = 0; layer < staticLayers_.size(); ++layer)
+        {
+            const StaticLayer& entry = staticLayers_[layer];
+            if(entry.alive && entry.minZIndex <= zIndex && zIndex <= entry.maxZIndex)
+            {
+                DissolveLayer(layer);
+            }
+        }
+    }
+
+    void SystemBase::DissolveLayer(uint32_t layer)
+    {
+        // The members look the same composited one by one, so nothing is damaged.
+        StaticLayer& entry = staticLayers_[layer];
+        for(auto handle: entry.members)
+        {
+            layerOf_[handle.index] = 0;
+        }
+
+        ReleaseLayer(layer);
+        layerStatistics_.layerCount -= 1;
+        layerStatistics_.elementCount -= entry.members.size();
+        layerStatistics_.bytes -= static_cast<uint64_t>(RectArea(entry.bounds)) * LAYER_BYTES_PER_PIXEL;
+        layerStatistics_.dissolved += 1;
+        entry.members.clear();
+        entry.alive = false;
+        freeLayers_.push_back(layer);
+        layerPlanPending_ = true;
+    }
+
+    void SystemBase::FinishRun()
+    {
+        // The layer is composited where its first member is drawn, which keeps the members' place in draw order.
+        if(run_.size() >= MIN_LAYER_ELEMENTS)
+        {
+            CreateLayer(run_);
+        }
+
+        run_.clear();
+    }
+
+    void SystemBase::CreateLayer(const std::vector<DrawOrder::Entry>& run)
+    {
+        Rect bounds = MakeRect(0, 0, 0, 0);
+        for(auto& entry: run)
+        {
+            bounds = UnionRects(bounds, IntersectRects(store_.GetBounds(entry.handle), viewport_));
+        }
+
+        if(IsEmptyRect(bounds))
+            return;
+
+        uint32_t layer = static_cast<uint32_t>(staticLayers_.size());
+        if(!freeLayers_.empty())
+        {
+            layer = freeLayers_.back();
+            freeLayers_.pop_back();
+        }
+        else
+        {
+            staticLayers_.emplace_back();
+        }
+
+        StaticLayer& entry = staticLayers_[layer];
+        entry.members.clear();
+        for(auto& member: run)
+        {
+            entry.members.push_back(member.handle);
+            layerOf_[member.handle.index] = layer + 1;
+        }
+
+        entry.bounds = bounds;
+        entry.minZIndex = run.front().zIndex;
+        entry.maxZIndex = run.back().zIndex;
+        entry.alive = true;
+        layerStatistics_.layerCount += 1;
+        layerStatistics_.elementCount += run.size();
+        layerStatistics_.bytes += static_cast<uint64_t>(RectArea(bounds)) * LAYER_BYTES_PER_PIXEL;
+        layerStatistics_.flattened += 1;
+        FlattenLayer(layer);
+    }
+
+    uint64_t SystemBase::GetRenderGroup(ElementHandle handle) const
+    {
+        return handle.index;
+    }
+
+    void SystemBase::BeginFrameProfile()
+    {
+        profiling_ = profiler_.IsEnabled();
+        if(profiling_)
+        {
+            profiler_.BeginFrame();
+        }
+    }
+
+    void SystemBase::EndFrameProfile(bool presented)
+    {
+        if(!profiling_)
+            return;
+
+        FrameStatistics& frame = profiler_.GetCurrentFrame();
+        frame.presented = presented;
+        for(auto& rect: damage_.GetRects())
+        {
+            frame.damageRectCount += 1;
+            frame.damageArea += static_cast<uint64_t>(rect.size.width) * rect.size.height;
+        }
+
+        GetResourceCacheStatistics(&frame.colorBrushes, &frame.textFormats);
+        textCache_.GetStatistics(nullptr, &frame.textLayouts);
+        profiler_.EndFrame(presented || frame.dirtyElementCount > 0);
+        profiling_ = false;
+    }
+
+    void SystemBase::CullElements(const Rect& rect)
+    {
+        store_.CullIntersecting(rect, &cullMask_);
+    }
+
+    Rect SystemBase::CullOccluded(const Rect& rect)
+    {
+        visibleRects_.resize(cullMask_.size());
+        occluders_.clear();
+        // Both backends draw in draw order, so every opaque element drawn later hides what it covers.
+        for(auto it = drawOrder_.end(); it != drawOrder_.begin();)
+        {
+            --it;
+            const ElementHandle handle = it->handle;
+            if(cullMask_[handle.index] == 0)
+                continue;
+
+            const Rect bounds = IntersectRects(store_.GetBounds(handle), rect);
+            Rect visible = bounds;
+            if(!ClipToUncovered(occluders_.data(), occluders_.size(), &visible))
+            {
+                cullMask_[handle.index] = 0;
+                continue;
+            }
+
+            visibleRects_[handle.index] = visible;
+            const CompositeTransform transform = store_.GetCompositeTransform(handle);
+            if(store_.HasFlags(handle, ElementStore::FLAG_OPAQUE) && !HasCompositeGeometry(transform)
+                && transform.opacity >= 1.f)
+            {
+                occluders_.push_back(bounds);
+            }
+        }
+
+        Rect background = rect;
+        if(!ClipToUncovered(occluders_.data(), occluders_.size(), &background))
+            return MakeRect(rect.origin.x, rect.origin.y, 0, 0);
+
+        return background;
+    }
+}
@@ -0,0 +1,239 @@
+#ifndef GRAPHICS_SYSTEM_BASE_H
+#define GRAPHICS_SYSTEM_BASE_H
+
+#include <cstddef>
+#include <vector>
+#include "damage_region.h"
+#include "draw_order.h"
+#include "element_store.h"
+#include "frame_capture_ring.h"
+#include "frame_profiler.h"
+#include "graphics_system.h"
+#include "spatial_index.h"
+#include "text_cache.h"
+#include "thread_pool.h"
+
+namespace hmi_graphics
+{
+    class SystemBase: public System
+    {
+    public:
+        SystemBase(int16_t width, int16_t height);
+
+        ~SystemBase() override;
+
+        void RemoveElement(GraphicsElement* element) override;
+
+        bool RemoveElement(ElementHandle handle) override;
+
+        GraphicsElement* GetElement(ElementHandle handle) override;
+
+        GraphicsElement* HitTest(int32_t x, int32_t y, HitTestCursor* cursor) override;
+
+        bool GetCachedTextFormat(const TextFormatDesc& desc, IDWriteTextFormat** textFormat) override;
+
+        bool GetCachedTextLayout(const wchar_t* text, uint32_t length, const TextFormatDesc& desc, float maxWidth,
+            float maxHeight, IDWriteTextLayout** textLayout) override;
+
+        bool DrawCachedText(const Surface& surface, const Rect& box, const wchar_t* text, uint32_t length,
+            const TextFormatDesc& desc, uint32_t argb) override;
+
+        void GetTextCacheStatistics(CacheStatistics* textLayouts, AtlasStatistics* textAtlas) override;
+
+        void GetDirectWriteFactory(IDWriteFactory** factory) override;
+
+        void SetProfilingEnabled(bool enabled) override;
+
+        size_t GetFrameStatistics(FrameStatistics* frames, size_t capacity) override;
+
+        size_t GetElementTimings(ElementTiming* timings, size_t capacity) override;
+
+        bool ExportChromeTrace(const char* path) override;
+
+        size_t GetPresentedDamage(Rect* rects, size_t capacity) override;
+
+        bool AcquireCapturedFrame(CapturedFrame** frame) override;
+
+        void SetSurfaceMemoryBudget(uint64_t bytes) override;
+
+        void GetSurfaceMemoryStatistics(SurfaceMemoryStatistics* statistics) override;
+
+        bool GetElementSurfaceMemory(ElementHandle handle, ElementSurfaceMemory* memory) override;
+
+        void SetStaticLayerThreshold(uint32_t frames) override;
+
+        void GetStaticLayerStatistics(StaticLayerStatistics* statistics) override;
+
+        ElementStore& GetElementStore();
+
+        void SetElementPosition(ElementHandle handle, int x, int y);
+
+        void SetElementSize(ElementHandle handle, int width, int height);
+
+        void SetElementZIndex(ElementHandle handle, int16_t zIndex);
+
+        // Only damages the old and new bounds; the element is not marked updated.
+        void SetElementCompositeTransform(ElementHandle handle, const CompositeTransform& transform);
+
+        void SetElementOpacityHint(ElementHandle handle, OpacityHint hint);
+
+        void ElementUpdated(ElementHandle handle);
+
+        void AddDamage(const Rect& rect);
+
+        // Element geometry in draw order, back to front, with the DrawOrder sequence of each.
+        void CaptureElementStates(std::vector<ElementState>* states, std::vector<uint32_t>* sequences) const;
+
+        const Rect& GetViewport() const;
+
+    protected:
+        // A run of elements adjacent in draw order that have not changed for a while, composited from one surface
+        // batched at minZIndex. Only a layer whose members all have the same z-index shares it with the element
+        // before the run, so the layer keeps its place when batches reorder quads sharing a z-index. An element
+        // stacked at a z-index within [minZIndex, maxZIndex] dissolves the layer.
+        struct StaticLayer
+        {
+            // Back to front.
+            std::vector<ElementHandle> members;
+            // Union of the members' bounds within the frame.
+            Rect bounds;
+            int16_t minZIndex;
+            int16_t maxZIndex;
+            bool alive;
+        };
+
+        ElementHandle AllocateHandle(GraphicsElement* element, int width, int height);
+
+        // Call once the element has been initialized with the handle from AllocateHandle.
+        void ElementAdded(GraphicsElement* element);
+
+        // Releases the backend resources of an element that is being removed; the element is still alive.
+        virtual void ReleaseElement(GraphicsElement* element) = 0;
+
+        // Backends call this from their destructor so elements go away while backend resources still exist.
+        void DestroyElements();
+
+        // Renders updated elements on the thread pool and returns once all of them finished. Elements outside the
+        // frame or evicted keep their updated flag and are rendered once they come into view.
+        void RenderUpdatedElements();
+
+        // Elements with the same group are rendered one after another on one thread, e.g. because they share a
+        // render target. Defaults to one group per element.
+        virtual uint64_t GetRenderGroup(ElementHandle handle) const;
+
+        // Size of the element's backing store while it is resident.
+        virtual uint64_t GetSurfaceBytes(ElementHandle handle) const = 0;
+
+        // Frees the element's backing store; false when it cannot be evicted, e.g. because it shares an atlas page.
+        virtual bool EvictSurface(ElementHandle handle) = 0;
+
+        // Recreates an evicted backing store. Its content is undefined until the element renders again.
+        virtual void RestoreSurface(ElementHandle handle) = 0;
+
+        // Renders the members of staticLayers_[layer] back to front into a new surface covering its bounds.
+        virtual void FlattenLayer(uint32_t layer) = 0;
+
+        virtual void ReleaseLayer(uint32_t layer) = 0;
+
+        // Call once per composited frame, after RenderUpdatedElements. Flattens the runs of elements that did not
+        // change for the threshold number of composited frames.
+        void UpdateStaticLayers();
+
+        // Index into staticLayers_ plus one, 0 when the element is composited on its own. Composite the layer in
+        // place of its first member and skip the others, whatever their cullMask_.
+        uint32_t GetStaticLayer(ElementHandle handle) const;
+
+        // Backends bracket Render with these; the stages in between are timed with profiler_.BeginStage/EndStage.
+        void BeginFrameProfile();
+
+        void EndFrameProfile(bool presented);
+
+        // Fills cullMask_ for rect; test entries with cullMask_[handle.index].
+        void CullElements(const Rect& rect);
+
+        // Call after CullElements. Walks the culled elements front to back, clears the mask of those hidden behind
+        // opaque elements with a higher z-index and stores the visible part of the others in visibleRects_, clipped
+        // to one rect conservatively. Returns the part of rect that needs clearing, empty when occluders cover it.
+        Rect CullOccluded(const Rect& rect);
+
+        DamageRegion damage_;
+        // Backends copy damage_ here when they present.
+        DamageRegion presentedDamage_;
+        // Backends own the buffers of its slots.
+        FrameCaptureRing captureRing_;
+        DrawOrder drawOrder_;
+        ElementStore store_;
+        std::vector<uint8_t> cullMask_;
+        // Indexed by ElementHandle::index; valid where cullMask_ is set after CullOccluded.
+        std::vector<Rect> visibleRects_;
+        std::vector<StaticLayer> staticLayers_;
+        ThreadPool threadPool_;
+        FrameProfiler profiler_;
+        // Set by BeginFrameProfile for the frame being rendered; profiler_ is only touched while it is.
+        bool profiling_;
+        TextCache textCache_;
+
+    private:
+        struct RenderItem
+        {
+            uint64_t group;
+            ElementHandle handle;
+        };
+
+        struct SurfaceResidency
+        {
+            uint64_t bytes;
+            uint64_t lastShownFrame;
+        };
+
+        bool IsShown(ElementHandle handle) const;
+
+        // Called first by RenderUpdatedElements: restores the evicted elements that are shown again and evicts
+        // hidden ones while the resident surfaces exceed the budget.
+        void UpdateSurfaceResidency();
+
+        void EvictHiddenSurfaces();
+
+        // Records the change for static detection and dissolves the element's layer.
+        void MarkChanged(ElementHandle handle);
+
+        // Dissolves the layers an element with this z-index would now be drawn among.
+        void MarkZIndexEntered(int16_t zIndex);
+
+        void DissolveLayer(uint32_t layer);
+
+        void CreateLayer(const std::vector<DrawOrder::Entry>& run);
+
+        void FinishRun();
+
+        SpatialIndex spatialIndex_;
+        std::vector<ElementHandle> renderQueue_;
+        std::vector<RenderItem> renderItems_;
+        std::vector<size_t> renderGroupStarts_;
+        std::vector<Rect> occluders_;
+        Rect viewport_;
+        // Indexed by ElementHandle::index.
+        std::vector<SurfaceResidency> residency_;
+        std::vector<ElementHandle> evicted_;
+        std::vector<ElementHandle> evictionCandidates_;
+        std::vector<uint8_t> viewMask_;
+        uint64_t surfaceBudget_;
+        uint64_t residentBytes_;
+        uint64_t evictedBytes_;
+        uint64_t residencyFrame_;
+        uint64_t evictions_;
+        uint64_t restores_;
+        // Indexed by ElementHandle::index: the composited frame of the last change and GetStaticLayer.
+        std::vector<uint64_t> changedFrames_;
+        std::vector<uint32_t> layerOf_;
+        std::vector<uint32_t> freeLayers_;
+        std::vector<DrawOrder::Entry> run_;
+        uint32_t staticThreshold_;
+        uint64_t compositeFrame_;
+        uint64_t lastLayerPlan_;
+        bool layerPlanPending_;
+        StaticLayerStatistics layerStatistics_;
+    };
+}
+
+#endif //GRAPHICS_SYSTEM_BASE_H
@@ -3,16 +3,50 @@
 #include <algorithm>
 #include <graphics_element.h>
 #include <stdexcept>
+#include "composite_transform.h"
 #include "graphics_element_pimpl.h"
+#include "rect_util.h"
 
 #define STRINGIZE_DETAIL(x) #x
 #define STRINGIZE(x) STRINGIZE_DETAIL(x)
 
 namespace hmi_graphics
 {
+    namespace
+    {
+        constexpr size_t COLOR_BRUSH_CACHE_CAPACITY = 256;
+        constexpr int ATLAS_PAGE_SIZE = 1024;
+        constexpr int ATLAS_PADDING = 1;
+        constexpr int ATLAS_MAX_ELEMENT_SIZE = 256;
+        // DXGI_FORMAT_R8G8B8A8_UNORM.
+        constexpr uint64_t SURFACE_BYTES_PER_PIXEL = 4;
+
+        // Shrinks an untransformed quad to visible, moving its source rect along so the texels stay in place.
+        void ClipQuad(const Rect& visible, CompositeQuad* quad)
+        {
+            const float scaleU = (quad->sourceRight - quad->sourceLeft) / (quad->destRight - quad->destLeft);
+            const float scaleV = (quad->sourceBottom - quad->sourceTop) / (quad->destBottom - quad->destTop);
+            const float left = std::max(quad->destLeft, (float)visible.origin.x);
+            const float top = std::max(quad->destTop, (float)visible.origin.y);
+            const float right = std::min(quad->destRight, (float)RectRight(visible));
+            const float bottom = std::min(quad->destBottom, (float)RectBottom(visible));
+            quad->sourceLeft += (left - quad->destLeft) * scaleU;
+            quad->sourceTop += (top - quad->destTop) * scaleV;
+            quad->sourceRight -= (quad->destRight - right) * scaleU;
+            quad->sourceBottom -= (quad->destBottom - bottom) * scaleV;
+            quad->destLeft = left;
+            quad->destTop = top;
+            quad->destRight = right;
+            quad->destBottom = bottom;
+        }
+    }
+
     SystemD3D11::SystemD3D11(HWND hWnd, int16_t width, int16_t height)
-        : latestZIndexUpdated_{}
-        , currentZIndexUpdated_{}
+        : SystemBase{width, height}
+        , d2dColorBrushes_{COLOR_BRUSH_CACHE_CAPACITY}
+        , frameLatencyWaitableObject_{}
+        , width_{width}
+        , height_{height}
     {
         HRESULT hr;
         hr = CreateDXGIFactory1(__uuidof(IDXGIFactory2), &factory_);
@@ -33,19 +67,50 @@ namespace hmi_graphics
         swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
         swapChainDesc.BufferCount = 2;
         swapChainDesc.AlphaMode = DXGI_ALPHA_MODE_IGNORE;
-        swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+        swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
         swapChainDesc.Scaling = DXGI_SCALING_STRETCH;
-        swapChainDesc.Flags = 0;
+        swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 
         hr = factory_->CreateSwapChainForHwnd(d3dDevice_.Get(), hWnd, &swapChainDesc, nullptr, nullptr, &swapChain_);
+        if(FAILED(hr))
+        {
+            // The waitable object needs Windows 8.1; fall back to a plain swap chain.
+            swapChainDesc.Flags = 0;
+            hr = factory_->CreateSwapChainForHwnd(d3dDevice_.Get(), hWnd, &swapChainDesc, nullptr, nullptr, &swapChain_);
+        }
+
         if(FAILED(hr))
             throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " CreateSwapChainForHwnd");
 
+        ComPtr<IDXGISwapChain2> swapChain2;
+        if(swapChainDesc.Flags != 0 && SUCCEEDED(swapChain_.As(&swapChain2)))
+        {
+            swapChain2->SetMaximumFrameLatency(1);
+            frameLatencyWaitableObject_ = swapChain2->GetFrameLatencyWaitableObject();
+        }
+
         ComPtr<IDXGIDevice> dxgiDevice;
         d3dDevice_.As(&dxgiDevice);
 
-        D2D1CreateDevice(dxgiDevice.Get(), D2D1::CreationProperties(D2D1_THREADING_MODE_SINGLE_THREADED, D2D1_DEBUG_LEVEL_WARNING, D2D1_DEVICE_CONTEXT_OPTIONS_NONE), &d2dDevice_);
+        // Elements render on the thread pool, each thread through its own device context.
+        D2D1CreateDevice(dxgiDevice.Get(), D2D1::CreationProperties(D2D1_THREADING_MODE_MULTI_THREADED, D2D1_DEBUG_LEVEL_WARNING, D2D1_DEVICE_CONTEXT_OPTIONS_NONE), &d2dDevice_);
         d2dDevice_->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE, &d2dContextForElements_);
+        elementContexts_.push_back(d2dContextForElements_);
+        while(elementContexts_.size() < threadPool_.GetThreadCount())
+        {
+            ComPtr<ID2D1DeviceContext> context;
+            hr = d2dDevice_->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE, &context);
+            if(FAILED(hr))
+                throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " CreateDeviceContext");
+
+            elementContexts_.push_back(context);
+        }
+
+        while(atlasLanes_.size() < threadPool_.GetThreadCount())
+        {
+            atlasLanes_.push_back(AtlasLane{AtlasAllocator{ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, ATLAS_PADDING}, {}});
+        }
+
         d2dDevice_->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE, &d2dContextForRendering_);
 
         ComPtr<IDXGISurface> dxgiSurface;
@@ -54,29 +119,31 @@ namespace hmi_graphics
         if(FAILED(hr))
             throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " CreateBitmap");
 
-        hr = DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED, __uuidof(decltype(dwriteFactory_)::InterfaceType), &dwriteFactory_);
+        swapChain_->GetBuffer(0, __uuidof(backBuffer_), &backBuffer_);
+        hr = d3dDevice_->CreateRenderTargetView(backBuffer_.Get(), nullptr, &backBufferView_);
         if(FAILED(hr))
-            throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " DWriteCreateFactory");
-    }
+            throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " CreateRenderTargetView");
 
-    SystemD3D11::~SystemD3D11()
-    {
-        elements_.clear();
+        compositor_.reset(new CompositeRendererD3D11{d3dDevice_.Get()});
+
+        damage_.Add(MakeRect(0, 0, width, height));
+        previousDamage_.Add(MakeRect(0, 0, width, height));
     }
 
-    void SystemD3D11::RemoveElement(GraphicsElement* element)
+    SystemD3D11::~SystemD3D11()
     {
-        auto it = elements_.begin();
-        while (it != elements_.end())
+        DestroyElements();
+        for(auto& slot: captureSlots_)
         {
-            auto& tuple = *it;
-            if(std::get<0>(tuple) == element)
+            if(slot.mapped)
             {
-                elements_.erase(it);
-                break;
+                d3dContext_->Unmap(slot.texture.Get(), 0);
             }
+        }
 
-            ++it;
+        if(frameLatencyWaitableObject_ != nullptr)
+        {
+            CloseHandle(frameLatencyWaitableObject_);
         }
     }
 
@@ -87,77 +154,174 @@ namespace hmi_graphics
             return false;
         }
 
-        *deviceContext = d2dContextForElements_.Get();
-        d2dContextForElements_->AddRef();
+        size_t index = ThreadPool::GetCurrentThreadIndex();
+        if(index >= elementContexts_.size())
+        {
+            index = 0;
+        }
+
+        *deviceContext = elementContexts_[index].Get();
+        (*deviceContext)->AddRef();
         return true;
     }
 
     bool SystemD3D11::GetCachedColorBrush(const D2D1_COLOR_F& rgba, ID2D1SolidColorBrush** colorBrush)
     {
-        uint32_t key = 0;
-        key |= static_cast<int>(rgba.r * 255) % 256 << 24;
-        key |= static_cast<int>(rgba.g * 255) % 256 << 16;
-        key |= static_cast<int>(rgba.b * 255) % 256 << 8;
-        key |= static_cast<int>(rgba.a * 255) % 256 << 0;
-        for(auto& tuple : d2dColorBrushes_)
+        if(colorBrush == nullptr)
         {
-            auto& color = std::get<0>(tuple);
-            if(key == color)
+            return false;
+        }
+
+        const uint32_t key = MakeColorKey(rgba);
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        auto* cached = d2dColorBrushes_.Find(key);
+        if(cached == nullptr)
+        {
+            // Brushes belong to the device, so one created through any of its contexts works in all of them.
+            ComPtr<ID2D1SolidColorBrush> brush;
+            if(FAILED(d2dContextForElements_->CreateSolidColorBrush(rgba, &brush)))
             {
-                auto& brush = std::get<1>(tuple);
-                *colorBrush = brush.Get();
-                brush->AddRef();
-                return true;
+                return false;
             }
+
+            cached = &d2dColorBrushes_.Insert(key, brush);
         }
 
-        ComPtr<ID2D1SolidColorBrush> brush;
-        d2dContextForElements_->CreateSolidColorBrush(rgba, &brush);
-        *colorBrush = brush.Get();
-        brush->AddRef();
+        *colorBrush = cached->Get();
+        (*colorBrush)->AddRef();
         return true;
     }
 
-    void SystemD3D11::Render()
+    void SystemD3D11::GetResourceCacheStatistics(CacheStatistics* colorBrushes, CacheStatistics* textFormats)
     {
-        for(auto& tuple: elements_)
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        if(colorBrushes != nullptr)
         {
-            auto* element = std::get<0>(tuple);
-            if(!element->ResetUpdatedFlag())
-                continue;
-
-            element->Render(this);
+            *colorBrushes = d2dColorBrushes_.GetStatistics();
         }
 
-        if(currentZIndexUpdated_ != latestZIndexUpdated_)
+        textCache_.GetStatistics(textFormats, nullptr);
+    }
+
+    bool SystemD3D11::Render()
+    {
+        PollFrameCapture();
+        BeginFrameProfile();
+        RenderUpdatedElements();
+
+        damage_.Clip(MakeRect(0, 0, width_, height_));
+        if(damage_.IsEmpty())
         {
-            std::stable_sort(elements_.begin(), elements_.end(), [](auto& e1, auto& e2)
-            {
-                GraphicsElement* lhs = std::get<0>(e1);
-                GraphicsElement* rhs = std::get<0>(e2);
-                return lhs->GetZIndex() < rhs->GetZIndex();
-            });
+            EndFrameProfile(false);
+            return false;
+        }
+
+        UpdateStaticLayers();
+        // Flip-model back buffers hold the frame before the previous one, so they need last frame's damage as well.
+        DamageRegion redraw{previousDamage_};
+        redraw.Add(damage_);
 
-            latestZIndexUpdated_ = currentZIndexUpdated_;
+        if(profiling_)
+        {
+            profiler_.BeginStage(FRAME_STAGE_COMPOSITE);
         }
 
         d2dContextForRendering_->SetTarget(swapChainBitmap_.Get());
         d2dContextForRendering_->BeginDraw();
-        d2dContextForRendering_->Clear(D2D1::ColorF(D2D1::ColorF::White));
-        for(auto& tuple: elements_)
+        batchBuilder_.Reset();
+        for(auto& rect: redraw.GetRects())
         {
-            auto& bitmap = std::get<2>(tuple);
-            auto& element = std::get<0>(tuple);
-            auto size = element->GetSize();
-            auto pos = element->GetPosition();
-            auto dest = D2D1::RectF(pos.x, pos.y);
-            dest.right = dest.left + (float)size.width;
-            dest.bottom = dest.top + (float)size.height;
-            d2dContextForRendering_->DrawBitmap(bitmap.Get(), dest);
+            CullElements(rect);
+            // Only the part opaque elements leave uncovered needs the background.
+            const Rect background = CullOccluded(rect);
+            if(!IsEmptyRect(background))
+            {
+                auto clip = D2D1::RectF((float)background.origin.x, (float)background.origin.y, (float)RectRight(background), (float)RectBottom(background));
+                d2dContextForRendering_->PushAxisAlignedClip(clip, D2D1_ANTIALIAS_MODE_ALIASED);
+                d2dContextForRendering_->Clear(D2D1::ColorF(D2D1::ColorF::White));
+                d2dContextForRendering_->PopAxisAlignedClip();
+            }
+
+            batchBuilder_.BeginPass(rect);
+            for(auto& order: drawOrder_)
+            {
+                const uint32_t layer = GetStaticLayer(order.handle);
+                if(layer != 0)
+                {
+                    // One quad of the layer's surface in place of all its members.
+                    const StaticLayer& entry = staticLayers_[layer - 1];
+                    const Rect visible = IntersectRects(entry.bounds, rect);
+                    if(entry.members.front().index != order.handle.index || IsEmptyRect(visible))
+                        continue;
+
+                    CompositeQuad quad{};
+                    quad.destLeft = (float)entry.bounds.origin.x;
+                    quad.destTop = (float)entry.bounds.origin.y;
+                    quad.destRight = (float)RectRight(entry.bounds);
+                    quad.destBottom = (float)RectBottom(entry.bounds);
+                    quad.sourceRight = 1.f;
+                    quad.sourceBottom = 1.f;
+                    quad.transform11 = 1.f;
+                    quad.transform22 = 1.f;
+                    quad.opacity = 1.f;
+                    ClipQuad(visible, &quad);
+                    batchBuilder_.Add(layerSurfaces_[layer - 1].textureSlot, entry.minZIndex, quad);
+                    continue;
+                }
+
+                if(cullMask_[order.handle.index] == 0)
+                    continue;
+
+                const CompositeTransform transform = store_.GetCompositeTransform(order.handle);
+                if(transform.opacity <= 0.f)
+                    continue;
+
+                CompositeQuad quad = MakeElementQuad(order.handle, transform, 0, 0);
+                if(!HasCompositeGeometry(transform))
+                {
+                    ClipQuad(visibleRects_[order.handle.index], &quad);
+                }
+
+                batchBuilder_.Add(surfaces_[order.handle.index].textureSlot, order.zIndex, quad);
+            }
+
+            batchBuilder_.EndPass();
         }
 
         d2dContextForRendering_->EndDraw();
-        swapChain_->Present(1, 0);
+        compositor_->Draw(d3dContext_.Get(), backBufferView_.Get(), width_, height_, batchBuilder_, textureViews_);
+        CaptureFrame();
+        if(profiling_)
+        {
+            profiler_.EndStage(FRAME_STAGE_COMPOSITE);
+        }
+
+        dirtyRects_.clear();
+        for(auto& rect: damage_.GetRects())
+        {
+            dirtyRects_.push_back(RECT{rect.origin.x, rect.origin.y, RectRight(rect), RectBottom(rect)});
+        }
+
+        DXGI_PRESENT_PARAMETERS parameters{};
+        parameters.DirtyRectsCount = static_cast<UINT>(dirtyRects_.size());
+        parameters.pDirtyRects = dirtyRects_.data();
+        if(profiling_)
+        {
+            profiler_.BeginStage(FRAME_STAGE_PRESENT);
+        }
+
+        swapChain_->Present1(1, 0, &parameters);
+        if(profiling_)
+        {
+            profiler_.EndStage(FRAME_STAGE_PRESENT);
+        }
+
+        EndFrameProfile(true);
+
+        previousDamage_ = damage_;
+        presentedDamage_ = damage_;
+        damage_.Clear();
+        return true;
     }
 
     void SystemD3D11::GetDirect3dDevice(ID3D11Device** device)
@@ -172,60 +336,323 @@ namespace hmi_graphics
         d3dContext_->AddRef();
     }
 
-    void SystemD3D11::GetDirectWriteFactory(IDWriteFactory** factory)
+    bool SystemD3D11::GetFramebuffer(Surface* framebuffer)
     {
-        *factory = dwriteFactory_.Get();
-        dwriteFactory_->AddRef();
+        return false;
     }
 
-    GraphicsElement* SystemD3D11::HitTest(int32_t x, int32_t y, GraphicsElement* hint)
+    bool SystemD3D11::SetFrameCaptureDepth(size_t depth)
     {
-        auto iter = elements_.begin();
-        if(hint != nullptr)
+        if(!captureRing_.SetDepth(depth, MakeRect(0, 0, width_, height_)))
+            return false;
+
+        for(auto& slot: captureSlots_)
         {
-            while(iter != elements_.end())
+            if(slot.mapped)
             {
-                auto& tuple = *iter;
-                auto* element = std::get<0>(tuple);
-                if(element == hint)
-                {
-                    ++iter;
-                    break;
-                }
+                d3dContext_->Unmap(slot.texture.Get(), 0);
+            }
+        }
 
-                ++iter;
+        captureSlots_.clear();
+        D3D11_TEXTURE2D_DESC textureDesc{};
+        textureDesc.Width = width_;
+        textureDesc.Height = height_;
+        textureDesc.MipLevels = 1;
+        textureDesc.ArraySize = 1;
+        textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        textureDesc.SampleDesc.Count = 1;
+        textureDesc.Usage = D3D11_USAGE_STAGING;
+        textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        D3D11_QUERY_DESC queryDesc{};
+        queryDesc.Query = D3D11_QUERY_EVENT;
+        for(size_t i = 0; i < depth; ++i)
+        {
+            CaptureSlot slot{};
+            if(FAILED(d3dDevice_->CreateTexture2D(&textureDesc, nullptr, &slot.texture))
+                || FAILED(d3dDevice_->CreateQuery(&queryDesc, &slot.query)))
+            {
+                captureSlots_.clear();
+                captureRing_.SetDepth(0, MakeRect(0, 0, width_, height_));
+                return false;
             }
+
+            captureSlots_.push_back(slot);
         }
 
-        GraphicsElement* result = nullptr;
-        for(;iter != elements_.end(); ++iter)
+        pendingCaptureSlots_.resize(depth);
+        return true;
+    }
+
+    HANDLE SystemD3D11::GetFrameLatencyWaitableObject()
+    {
+        return frameLatencyWaitableObject_;
+    }
+
+    void SystemD3D11::GetAtlasStatistics(AtlasStatistics* statistics)
+    {
+        if(statistics == nullptr)
+            return;
+
+        *statistics = AtlasStatistics{};
+        for(auto& lane: atlasLanes_)
         {
+            const AtlasStatistics laneStatistics = lane.allocator.GetStatistics();
+            statistics->pageCount += laneStatistics.pageCount;
+            statistics->allocationCount += laneStatistics.allocationCount;
+            statistics->usedArea += laneStatistics.usedArea;
+            statistics->reservedArea += laneStatistics.reservedArea;
+            statistics->pageArea += laneStatistics.pageArea;
+        }
 
-            auto& tuple = *iter;
-            auto* element = std::get<0>(tuple);
-            auto pos = element->GetPosition();
-            if(pos.x > x || pos.y > y)
-                continue;
+        if(statistics->reservedArea > 0)
+        {
+            statistics->fragmentation = 1.f - static_cast<float>(statistics->usedArea) / statistics->reservedArea;
+        }
+    }
 
-            auto size = element->GetSize();
-            pos.x += size.width;
-            pos.y += size.height;
-            if(pos.x < x || pos.y < y)
+    void SystemD3D11::PollFrameCapture()
+    {
+        size_t released = 0;
+        while(captureRing_.TakeReleased(&released))
+        {
+            d3dContext_->Unmap(captureSlots_[released].texture.Get(), 0);
+            captureSlots_[released].mapped = false;
+        }
+
+        const size_t count = captureRing_.GetPendingSlots(pendingCaptureSlots_.data(), pendingCaptureSlots_.size());
+        for(size_t i = 0; i < count; ++i)
+        {
+            // Copies finish in order, so the first unfinished one ends the poll. DONOTFLUSH keeps polling from
+            // submitting work early; Present flushes anyway.
+            auto& slot = captureSlots_[pendingCaptureSlots_[i]];
+            if(d3dContext_->GetData(slot.query.Get(), nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+                break;
+
+            D3D11_MAPPED_SUBRESOURCE mapped{};
+            if(FAILED(d3dContext_->Map(slot.texture.Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped)))
+                break;
+
+            slot.mapped = true;
+            const Surface surface{static_cast<uint32_t*>(mapped.pData), width_, height_, static_cast<int>(mapped.RowPitch / 4)};
+            captureRing_.MarkReady(pendingCaptureSlots_[i], surface);
+        }
+    }
+
+    void SystemD3D11::CaptureFrame()
+    {
+        size_t index = 0;
+        if(!captureRing_.BeginCapture(damage_, &index))
+            return;
+
+        // A reused slot still has the ready frame nobody acquired mapped.
+        auto& slot = captureSlots_[index];
+        if(slot.mapped)
+        {
+            d3dContext_->Unmap(slot.texture.Get(), 0);
+            slot.mapped = false;
+        }
+
+        d3dContext_->CopyResource(slot.texture.Get(), backBuffer_.Get());
+        d3dContext_->End(slot.query.Get());
+    }
+
+    void SystemD3D11::AddElement(GraphicsElement* element, int16_t width, int16_t height)
+    {
+        ElementSurface entry{};
+        entry.element = element;
+        entry.size = Size{width, height};
+        ComPtr<ID2D1Bitmap1> target;
+        Rect targetRect = MakeRect(0, 0, width, height);
+        float textureWidth = width;
+        float textureHeight = height;
+        if(width <= ATLAS_MAX_ELEMENT_SIZE && height <= ATLAS_MAX_ELEMENT_SIZE
+            && AllocateAtlasRegion(width, height, &entry.atlasLane, &entry.region))
+        {
+            AtlasLane& lane = atlasLanes_[entry.atlasLane];
+            while(lane.pages.size() < lane.allocator.GetPageCount())
+            {
+                AtlasPage page{};
+                page.texture = CreateSurfaceTexture(lane.allocator.GetPageWidth(), lane.allocator.GetPageHeight());
+                CreateTargetBitmap(page.texture.Get(), &page.target);
+                page.textureSlot = AcquireTextureSlot(page.texture.Get());
+                lane.pages.push_back(page);
+            }
+
+            auto& page = lane.pages[entry.region.page];
+            entry.texture = page.texture;
+            entry.textureSlot = page.textureSlot;
+            entry.atlased = true;
+            target = page.target;
+            targetRect = entry.region.rect;
+            textureWidth = (float)lane.allocator.GetPageWidth();
+            textureHeight = (float)lane.allocator.GetPageHeight();
+            // Recycled regions still hold the previous owner's pixels, and the padding must stay transparent.
+            ClearTargetRegion(target.Get(), MakeRect(targetRect.origin.x - ATLAS_PADDING, targetRect.origin.y - ATLAS_PADDING,
+                targetRect.size.width + ATLAS_PADDING * 2, targetRect.size.height + ATLAS_PADDING * 2));
+        }
+        else
+        {
+            entry.texture = CreateSurfaceTexture(width, height);
+            entry.textureSlot = AcquireTextureSlot(entry.texture.Get());
+            CreateTargetBitmap(entry.texture.Get(), &target);
+        }
+
+        entry.sourceUv = D2D1::RectF(targetRect.origin.x / textureWidth, targetRect.origin.y / textureHeight,
+            RectRight(targetRect) / textureWidth, RectBottom(targetRect) / textureHeight);
+        ElementHandle handle = AllocateHandle(element, width, height);
+        if(surfaces_.size() <= handle.index)
+        {
+            surfaces_.resize(handle.index + 1);
+        }
+
+        entry.pimpl = new GraphicsElement::Pimpl{this, handle, width, height, entry.texture.Get(), target.Get(), targetRect};
+        surfaces_[handle.index] = entry;
+        element->Initialize(entry.pimpl, this);
+        ElementAdded(element);
+    }
+
+    bool SystemD3D11::AllocateAtlasRegion(int width, int height, uint32_t* lane, AtlasRegion* region)
+    {
+        // The least filled lane, which keeps the elements' area, and so roughly their render work, even across lanes.
+        uint64_t laneArea = UINT64_MAX;
+        for(uint32_t i = 0; i < atlasLanes_.size(); ++i)
+        {
+            const uint64_t usedArea = atlasLanes_[i].allocator.GetStatistics().usedArea;
+            if(usedArea < laneArea)
+            {
+                laneArea = usedArea;
+                *lane = i;
+            }
+        }
+
+        return laneArea != UINT64_MAX && atlasLanes_[*lane].allocator.Allocate(width, height, region);
+    }
+
+    void SystemD3D11::ReleaseElement(GraphicsElement* element)
+    {
+        auto& entry = surfaces_[element->GetHandle().index];
+        if(entry.atlased)
+        {
+            atlasLanes_[entry.atlasLane].allocator.Free(entry.region);
+        }
+        else if(entry.texture)
+        {
+            ReleaseTextureSlot(entry.textureSlot);
+        }
+
+        entry = ElementSurface{};
+    }
+
+    uint64_t SystemD3D11::GetSurfaceBytes(ElementHandle handle) const
+    {
+        const auto& entry = surfaces_[handle.index];
+        const Size size = entry.atlased ? entry.region.rect.size : entry.size;
+        return static_cast<uint64_t>(size.width) * size.height * SURFACE_BYTES_PER_PIXEL;
+    }
+
+    bool SystemD3D11::EvictSurface(ElementHandle handle)
+    {
+        auto& entry = surfaces_[handle.index];
+        if(entry.atlased || !entry.texture)
+            return false;
+
+        ReleaseTextureSlot(entry.textureSlot);
+        entry.texture.Reset();
+        entry.pimpl->ReleaseSurface();
+        return true;
+    }
+
+    void SystemD3D11::RestoreSurface(ElementHandle handle)
+    {
+        auto& entry = surfaces_[handle.index];
+        ComPtr<ID2D1Bitmap1> target;
+        entry.texture = CreateSurfaceTexture(entry.size.width, entry.size.height);
+        entry.textureSlot = AcquireTextureSlot(entry.texture.Get());
+        CreateTargetBitmap(entry.texture.Get(), &target);
+        entry.pimpl->RestoreSurface(entry.texture.Get(), target.Get());
+    }
+
+    uint64_t SystemD3D11::GetRenderGroup(ElementHandle handle) const
+    {
+        // Elements on one atlas page share its target and must not draw into it concurrently.
+        const auto& entry = surfaces_[handle.index];
+        if(entry.atlased)
+        {
+            return static_cast<uint64_t>(entry.atlasLane) << 16 | entry.region.page;
+        }
+
+        return (uint64_t{1} << 32) | handle.index;
+    }
+
+    void SystemD3D11::FlattenLayer(uint32_t layer)
+    {
+        const StaticLayer& entry = staticLayers_[layer];
+        const Rect& bounds = entry.bounds;
+        LayerSurface surface{};
+        surface.texture = CreateSurfaceTexture(bounds.size.width, bounds.size.height);
+        HRESULT hr = d3dDevice_->CreateRenderTargetView(surface.texture.Get(), nullptr, &surface.view);
+        if(FAILED(hr))
+            throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " CreateRenderTargetView");
+
+        surface.textureSlot = AcquireTextureSlot(surface.texture.Get());
+        const FLOAT transparent[4] = {0.f, 0.f, 0.f, 0.f};
+        d3dContext_->ClearRenderTargetView(surface.view.Get(), transparent);
+        layerBatchBuilder_.Reset();
+        layerBatchBuilder_.BeginPass(MakeRect(0, 0, bounds.size.width, bounds.size.height));
+        for(auto handle: entry.members)
+        {
+            // Evicted members are outside the frame or faded out and draw nothing anyway.
+            const CompositeTransform transform = store_.GetCompositeTransform(handle);
+            if(transform.opacity <= 0.f || store_.HasFlags(handle, ElementStore::FLAG_EVICTED))
                 continue;
 
-            result = element;
-            break;
+            layerBatchBuilder_.Add(surfaces_[handle.index].textureSlot, store_.GetZIndex(handle),
+                MakeElementQuad(handle, transform, -bounds.origin.x, -bounds.origin.y));
+        }
+
+        layerBatchBuilder_.EndPass();
+        compositor_->Draw(d3dContext_.Get(), surface.view.Get(), bounds.size.width, bounds.size.height, layerBatchBuilder_,
+            textureViews_);
+        if(layerSurfaces_.size() <= layer)
+        {
+            layerSurfaces_.resize(layer + 1);
         }
 
-        return result;
+        layerSurfaces_[layer] = surface;
     }
 
-    void SystemD3D11::ElementZIndexUpdated()
+    void SystemD3D11::ReleaseLayer(uint32_t layer)
     {
-        currentZIndexUpdated_ += 1;
+        ReleaseTextureSlot(layerSurfaces_[layer].textureSlot);
+        layerSurfaces_[layer] = LayerSurface{};
     }
 
-    void SystemD3D11::AddElement(GraphicsElement* element, int16_t width, int16_t height)
+    CompositeQuad SystemD3D11::MakeElementQuad(ElementHandle handle, const CompositeTransform& transform, int offsetX,
+        int offsetY) const
+    {
+        auto pos = store_.GetPosition(handle);
+        auto size = store_.GetSize(handle);
+        auto& entry = surfaces_[handle.index];
+        const CompositeMatrix matrix = MakeCompositeMatrix(transform);
+        CompositeQuad quad{};
+        quad.destLeft = (float)(pos.x + offsetX);
+        quad.destTop = (float)(pos.y + offsetY);
+        quad.destRight = (float)(pos.x + offsetX + size.width);
+        quad.destBottom = (float)(pos.y + offsetY + size.height);
+        quad.sourceLeft = entry.sourceUv.left;
+        quad.sourceTop = entry.sourceUv.top;
+        quad.sourceRight = entry.sourceUv.right;
+        quad.sourceBottom = entry.sourceUv.bottom;
+        quad.transform11 = matrix.m11;
+        quad.transform12 = matrix.m12;
+        quad.transform21 = matrix.m21;
+        quad.transform22 = matrix.m22;
+        quad.opacity = std::min(transform.opacity, 1.f);
+        return quad;
+    }
+
+    ComPtr<ID3D11Texture2D> SystemD3D11::CreateSurfaceTexture(int width, int height)
     {
         ComPtr<ID3D11Texture2D> texture;
         D3D11_TEXTURE2D_DESC desc{};
@@ -238,17 +665,55 @@ namespace hmi_graphics
         desc.SampleDesc.Quality = 0;
         desc.Usage = D3D11_USAGE_DEFAULT;
         desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_RENDER_TARGET;
-        d3dDevice_->CreateTexture2D(&desc, nullptr, &texture);
-        element->Initialize(new GraphicsElement::Pimpl{this, width, height, texture.Get()}, this);
+        HRESULT hr = d3dDevice_->CreateTexture2D(&desc, nullptr, &texture);
+        if(FAILED(hr))
+            throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " CreateTexture2D");
+
+        return texture;
+    }
+
+    void SystemD3D11::CreateTargetBitmap(ID3D11Texture2D* texture, ID2D1Bitmap1** target)
+    {
         ComPtr<IDXGISurface> surface;
-        ComPtr<ID2D1Bitmap1> bitmapSource;
         texture->QueryInterface(IID_PPV_ARGS(&surface));
-        auto sourceProp = D2D1::BitmapProperties1(D2D1_BITMAP_OPTIONS_NONE, D2D1::PixelFormat(DXGI_FORMAT_R8G8B8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
-        d2dContextForRendering_->CreateBitmapFromDxgiSurface(surface.Get(), sourceProp, &bitmapSource);
+        auto destProp = D2D1::BitmapProperties1(D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW, D2D1::PixelFormat(DXGI_FORMAT_R8G8B8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+        d2dContextForElements_->CreateBitmapFromDxgiSurface(surface.Get(), destProp, target);
+    }
 
-        // auto destProp = D2D1::BitmapProperties1(D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW, D2D1::PixelFormat(DXGI_FORMAT_R8G8B8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
-        // d2dContextForElements_->CreateBitmapFromDxgiSurface(surface.Get(), destProp, &bitmapTarget);
-        elements_.emplace_back(element, texture, bitmapSource);
-        ElementZIndexUpdated();
+    void SystemD3D11::ClearTargetRegion(ID2D1Bitmap1* target, const Rect& rect)
+    {
+        auto clip = D2D1::RectF((float)rect.origin.x, (float)rect.origin.y, (float)RectRight(rect), (float)RectBottom(rect));
+        d2dContextForElements_->SetTarget(target);
+        d2dContextForElements_->BeginDraw();
+        d2dContextForElements_->PushAxisAlignedClip(clip, D2D1_ANTIALIAS_MODE_ALIASED);
+        d2dContextForElements_->Clear(D2D1::ColorF(D2D1::ColorF::White, 0.f));
+        d2dContextForElements_->PopAxisAlignedClip();
+        d2dContextForElements_->EndDraw();
+        d2dContextForElements_->SetTarget(nullptr);
+    }
+
+    uint32_t SystemD3D11::AcquireTextureSlot(ID3D11Texture2D* texture)
+    {
+        ComPtr<ID3D11ShaderResourceView> view;
+        HRESULT hr = d3dDevice_->CreateShaderResourceView(texture, nullptr, &view);
+        if(FAILED(hr))
+            throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " CreateShaderResourceView");
+
+        if(!freeTextureSlots_.empty())
+        {
+            uint32_t slot = freeTextureSlots_.back();
+            freeTextureSlots_.pop_back();
+            textureViews_[slot] = view;
+            return slot;
+        }
+
+        textureViews_.push_back(view);
+        return static_cast<uint32_t>(textureViews_.size() - 1);
+    }
+
+    void SystemD3D11::ReleaseTextureSlot(uint32_t slot)
+    {
+        textureViews_[slot].Reset();
+        freeTextureSlots_.push_back(slot);
     }
 }
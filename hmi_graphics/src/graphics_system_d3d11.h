@@ -1,44 +1,145 @@
 #ifndef GRAPHICS_SYSTEM_D3D11_H
 #define GRAPHICS_SYSTEM_D3D11_H
 
+#include <memory>
+#include <mutex>
 #include <vector>
-#include <tuple>
 #include <dxgi1_5.h>
+#include <graphics_element.h>
 #include "comptr.h"
-#include "graphics_system.h"
+#include "atlas_allocator.h"
+#include "composite_batch.h"
+#include "composite_renderer_d3d11.h"
+#include "graphics_system_base.h"
+#include "lru_cache.h"
+#include "resource_keys.h"
 
 namespace hmi_graphics
 {
-    class SystemD3D11: public System
+    class SystemD3D11: public SystemBase
     {
     public:
         SystemD3D11(HWND hWnd, int16_t width, int16_t height);
 
         ~SystemD3D11() override;
 
-        void RemoveElement(GraphicsElement* element) override;
-
         bool GetDirect2dDeviceContext(ID2D1DeviceContext** deviceContext) override;
 
         bool GetCachedColorBrush(const D2D1_COLOR_F& rgba, ID2D1SolidColorBrush** colorBrush) override;
 
-        void Render() override;
+        void GetResourceCacheStatistics(CacheStatistics* colorBrushes, CacheStatistics* textFormats) override;
+
+        bool Render() override;
 
         void GetDirect3dDevice(ID3D11Device** device) override;
 
         void GetDirect3dContext(ID3D11DeviceContext** deviceContext) override;
 
-        void GetDirectWriteFactory(IDWriteFactory** factory) override;
+        bool GetFramebuffer(Surface* framebuffer) override;
+
+        bool SetFrameCaptureDepth(size_t depth) override;
 
-        GraphicsElement* HitTest(int32_t x, int32_t y, GraphicsElement* hint) override;
+        HANDLE GetFrameLatencyWaitableObject() override;
 
-        void ElementZIndexUpdated();
+        void GetAtlasStatistics(AtlasStatistics* statistics) override;
 
     protected:
         void AddElement(GraphicsElement* element, int16_t width, int16_t height) override;
 
+        void ReleaseElement(GraphicsElement* element) override;
+
+        uint64_t GetRenderGroup(ElementHandle handle) const override;
+
+        uint64_t GetSurfaceBytes(ElementHandle handle) const override;
+
+        bool EvictSurface(ElementHandle handle) override;
+
+        void RestoreSurface(ElementHandle handle) override;
+
+        void FlattenLayer(uint32_t layer) override;
+
+        void ReleaseLayer(uint32_t layer) override;
+
     private:
-        std::vector<std::tuple<GraphicsElement*, ComPtr<ID3D11Texture2D>, ComPtr<ID2D1Bitmap1>>> elements_;
+        struct ElementSurface
+        {
+            GraphicsElement* element;
+            // Owned by the element.
+            GraphicsElement::Pimpl* pimpl;
+            ComPtr<ID3D11Texture2D> texture;
+            uint32_t textureSlot;
+            D2D1_RECT_F sourceUv;
+            AtlasRegion region;
+            uint32_t atlasLane;
+            Size size;
+            bool atlased;
+        };
+
+        struct AtlasPage
+        {
+            ComPtr<ID3D11Texture2D> texture;
+            ComPtr<ID2D1Bitmap1> target;
+            uint32_t textureSlot;
+        };
+
+        // Elements on one page share its target and render one after the other, so small elements are spread over
+        // one allocator per pool thread instead of filling a single page that a single worker would render.
+        struct AtlasLane
+        {
+            AtlasAllocator allocator;
+            std::vector<AtlasPage> pages;
+        };
+
+        struct LayerSurface
+        {
+            ComPtr<ID3D11Texture2D> texture;
+            ComPtr<ID3D11RenderTargetView> view;
+            uint32_t textureSlot;
+        };
+
+        // A staging copy of the back buffer and the query that tells when the copy has finished.
+        struct CaptureSlot
+        {
+            ComPtr<ID3D11Texture2D> texture;
+            ComPtr<ID3D11Query> query;
+            bool mapped;
+        };
+
+        ComPtr<ID3D11Texture2D> CreateSurfaceTexture(int width, int height);
+
+        void CreateTargetBitmap(ID3D11Texture2D* texture, ID2D1Bitmap1** target);
+
+        void ClearTargetRegion(ID2D1Bitmap1* target, const Rect& rect);
+
+        uint32_t AcquireTextureSlot(ID3D11Texture2D* texture);
+
+        // Picks the lane for a new element and allocates its region there.
+        bool AllocateAtlasRegion(int width, int height, uint32_t* lane, AtlasRegion* region);
+
+        // The element's quad in pixels moved by offset, e.g. into a layer surface.
+        CompositeQuad MakeElementQuad(ElementHandle handle, const CompositeTransform& transform, int offsetX, int offsetY) const;
+
+        // Unmaps released capture slots and maps the copies that finished, without waiting for the GPU.
+        void PollFrameCapture();
+
+        void CaptureFrame();
+
+        void ReleaseTextureSlot(uint32_t slot);
+
+        // Indexed by ElementHandle::index.
+        std::vector<ElementSurface> surfaces_;
+        std::vector<AtlasLane> atlasLanes_;
+        std::vector<ComPtr<ID3D11ShaderResourceView>> textureViews_;
+        std::vector<uint32_t> freeTextureSlots_;
+        CompositeBatchBuilder batchBuilder_;
+        CompositeBatchBuilder layerBatchBuilder_;
+        // Indexed like staticLayers_.
+        std::vector<LayerSurface> layerSurfaces_;
+        std::unique_ptr<CompositeRendererD3D11> compositor_;
+        ComPtr<ID3D11RenderTargetView> backBufferView_;
+        ComPtr<ID3D11Texture2D> backBuffer_;
+        std::vector<CaptureSlot> captureSlots_;
+        std::vector<size_t> pendingCaptureSlots_;
         ComPtr<ID3D11Device> d3dDevice_;
         ComPtr<ID3D11DeviceContext> d3dContext_;
         ComPtr<IDXGISwapChain1> swapChain_;
@@ -47,11 +148,16 @@ namespace hmi_graphics
         ComPtr<ID2D1Device> d2dDevice_;
         ComPtr<ID2D1Factory> d2dFactory_;
         ComPtr<ID2D1DeviceContext> d2dContextForElements_;
+        // One per thread pool thread; index 0 is d2dContextForElements_.
+        std::vector<ComPtr<ID2D1DeviceContext>> elementContexts_;
         ComPtr<ID2D1DeviceContext> d2dContextForRendering_;
-        ComPtr<IDWriteFactory> dwriteFactory_;
-        std::vector<std::tuple<uint32_t, ComPtr<ID2D1SolidColorBrush>>> d2dColorBrushes_;
-        size_t latestZIndexUpdated_;
-        size_t currentZIndexUpdated_;
+        LruCache<uint32_t, ComPtr<ID2D1SolidColorBrush>> d2dColorBrushes_;
+        std::mutex cacheMutex_;
+        DamageRegion previousDamage_;
+        std::vector<RECT> dirtyRects_;
+        HANDLE frameLatencyWaitableObject_;
+        int16_t width_;
+        int16_t height_;
     };
 }
 
@@ -0,0 +1,399 @@
+#include "graphics_system_software.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <graphics_element.h>
+#include "blend.h"
+#include "composite_transform.h"
+#include "graphics_element_pimpl.h"
+#include "rect_util.h"
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        constexpr uint32_t CLEAR_COLOR = 0xFFFFFFFF;
+        constexpr int ROW_BAND_HEIGHT = 32;
+        constexpr int TEXT_ATLAS_PAGE_SIZE = 1024;
+        constexpr size_t TEXT_ATLAS_MAX_PAGES = 4;
+
+        uint32_t FetchTexel(const Surface& surface, int width, int height, int x, int y)
+        {
+            if(x < 0 || y < 0 || x >= width || y >= height)
+                return 0;
+
+            return surface.pixels[static_cast<size_t>(y) * surface.stride + x];
+        }
+
+        // Bilinear sample of premultiplied pixels, transparent outside the surface, scaled by opacity.
+        uint32_t SampleBilinear(const Surface& surface, int width, int height, float u, float v, float opacity)
+        {
+            const float left = std::floor(u);
+            const float top = std::floor(v);
+            const int x = static_cast<int>(left);
+            const int y = static_cast<int>(top);
+            const float fractionX = u - left;
+            const float fractionY = v - top;
+            const float weights[4] = {
+                (1.f - fractionX) * (1.f - fractionY) * opacity,
+                fractionX * (1.f - fractionY) * opacity,
+                (1.f - fractionX) * fractionY * opacity,
+                fractionX * fractionY * opacity,
+            };
+            const uint32_t texels[4] = {
+                FetchTexel(surface, width, height, x, y),
+                FetchTexel(surface, width, height, x + 1, y),
+                FetchTexel(surface, width, height, x, y + 1),
+                FetchTexel(surface, width, height, x + 1, y + 1),
+            };
+
+            uint32_t result = 0;
+            for(int shift = 0; shift < 32; shift += 8)
+            {
+                float channel = 0.5f;
+                for(int i = 0; i < 4; ++i)
+                {
+                    channel += ((texels[i] >> shift) & 0xFF) * weights[i];
+                }
+
+                result |= std::min(static_cast<uint32_t>(channel), 255u) << shift;
+            }
+
+            return result;
+        }
+    }
+
+    SystemSoftware::SystemSoftware(int16_t width, int16_t height)
+        : SystemBase{width, height}
+        , textAtlas_{&textCache_, TEXT_ATLAS_PAGE_SIZE, TEXT_ATLAS_MAX_PAGES}
+        , framebuffer_(static_cast<size_t>(width) * height, CLEAR_COLOR)
+        , width_{width}
+        , height_{height}
+    {
+        damage_.Add(MakeRect(0, 0, width, height));
+    }
+
+    SystemSoftware::~SystemSoftware()
+    {
+        DestroyElements();
+    }
+
+    bool SystemSoftware::GetDirect2dDeviceContext(ID2D1DeviceContext** deviceContext)
+    {
+        if(deviceContext != nullptr)
+        {
+            *deviceContext = nullptr;
+        }
+
+        return false;
+    }
+
+    bool SystemSoftware::GetCachedColorBrush(const D2D1_COLOR_F& rgba, ID2D1SolidColorBrush** colorBrush)
+    {
+        if(colorBrush != nullptr)
+        {
+            *colorBrush = nullptr;
+        }
+
+        return false;
+    }
+
+    void SystemSoftware::GetResourceCacheStatistics(CacheStatistics* colorBrushes, CacheStatistics* textFormats)
+    {
+        if(colorBrushes != nullptr)
+        {
+            *colorBrushes = CacheStatistics{};
+        }
+
+        textCache_.GetStatistics(textFormats, nullptr);
+    }
+
+    bool SystemSoftware::DrawCachedText(const Surface& surface, const Rect& box, const wchar_t* text, uint32_t length,
+        const TextFormatDesc& desc, uint32_t argb)
+    {
+        return textAtlas_.Draw(surface, box, text, length, desc, argb);
+    }
+
+    void SystemSoftware::GetTextCacheStatistics(CacheStatistics* textLayouts, AtlasStatistics* textAtlas)
+    {
+        textCache_.GetStatistics(nullptr, textLayouts);
+        textAtlas_.GetStatistics(nullptr, textAtlas);
+    }
+
+    bool SystemSoftware::Render()
+    {
+        // Nothing is mapped here, so released capture slots are free right away.
+        size_t releasedSlot = 0;
+        while(captureRing_.TakeReleased(&releasedSlot))
+        {
+        }
+
+        BeginFrameProfile();
+        RenderUpdatedElements();
+
+        damage_.Clip(MakeRect(0, 0, width_, height_));
+        if(damage_.IsEmpty())
+        {
+            EndFrameProfile(false);
+            return false;
+        }
+
+        UpdateStaticLayers();
+        if(profiling_)
+        {
+            profiler_.BeginStage(FRAME_STAGE_COMPOSITE);
+        }
+
+        const Surface framebuffer{framebuffer_.data(), width_, height_, width_};
+        for(auto& rect: damage_.GetRects())
+        {
+            // Bands of rows are independent, so the pool composites them in parallel.
+            CullElements(rect);
+            const Rect background = CullOccluded(rect);
+            const size_t bandCount = static_cast<size_t>((rect.size.height + ROW_BAND_HEIGHT - 1) / ROW_BAND_HEIGHT);
+            threadPool_.ParallelFor(bandCount, [this, &rect, &background, &framebuffer](size_t band)
+            {
+                const int top = rect.origin.y + static_cast<int>(band) * ROW_BAND_HEIGHT;
+                const Rect bandRect = MakeRect(rect.origin.x, top, rect.size.width, std::min(ROW_BAND_HEIGHT, RectBottom(rect) - top));
+                const Rect clear = IntersectRects(bandRect, background);
+                for(int y = clear.origin.y; !IsEmptyRect(clear) && y < RectBottom(clear); ++y)
+                {
+                    FillRow(framebuffer_.data() + static_cast<size_t>(y) * width_ + clear.origin.x, CLEAR_COLOR, clear.size.width);
+                }
+
+                for(auto& entry: drawOrder_)
+                {
+                    const uint32_t layer = GetStaticLayer(entry.handle);
+                    if(layer != 0)
+                    {
+                        if(staticLayers_[layer - 1].members.front().index == entry.handle.index)
+                        {
+                            CompositeLayer(layer - 1, bandRect);
+                        }
+                    }
+                    else if(cullMask_[entry.handle.index] != 0)
+                    {
+                        Composite(entry.element, IntersectRects(bandRect, visibleRects_[entry.handle.index]), framebuffer,
+                            Point{0, 0});
+                    }
+                }
+            });
+        }
+
+        if(profiling_)
+        {
+            profiler_.EndStage(FRAME_STAGE_COMPOSITE);
+        }
+
+        // The framebuffer is the output; there is no present stage.
+        EndFrameProfile(true);
+        presentedDamage_ = damage_;
+        size_t slot = 0;
+        if(captureRing_.BeginCapture(damage_, &slot))
+        {
+            auto& buffer = captureBuffers_[slot];
+            buffer = framebuffer_;
+            captureRing_.MarkReady(slot, Surface{buffer.data(), width_, height_, width_});
+        }
+
+        damage_.Clear();
+        return true;
+    }
+
+    void SystemSoftware::GetDirect3dDevice(ID3D11Device** device)
+    {
+        *device = nullptr;
+    }
+
+    void SystemSoftware::GetDirect3dContext(ID3D11DeviceContext** deviceContext)
+    {
+        *deviceContext = nullptr;
+    }
+
+    bool SystemSoftware::GetFramebuffer(Surface* framebuffer)
+    {
+        if(framebuffer == nullptr)
+        {
+            return false;
+        }
+
+        framebuffer->pixels = framebuffer_.data();
+        framebuffer->width = width_;
+        framebuffer->height = height_;
+        framebuffer->stride = width_;
+        return true;
+    }
+
+    bool SystemSoftware::SetFrameCaptureDepth(size_t depth)
+    {
+        if(!captureRing_.SetDepth(depth, MakeRect(0, 0, width_, height_)))
+            return false;
+
+        captureBuffers_.assign(depth, std::vector<uint32_t>{});
+        return true;
+    }
+
+    HANDLE SystemSoftware::GetFrameLatencyWaitableObject()
+    {
+        return nullptr;
+    }
+
+    void SystemSoftware::GetAtlasStatistics(AtlasStatistics* statistics)
+    {
+        if(statistics != nullptr)
+        {
+            *statistics = AtlasStatistics{};
+        }
+    }
+
+    void SystemSoftware::AddElement(GraphicsElement* element, int16_t width, int16_t height)
+    {
+        const ElementHandle handle = AllocateHandle(element, width, height);
+        if(pimpls_.size() <= handle.index)
+        {
+            pimpls_.resize(handle.index + 1);
+        }
+
+        pimpls_[handle.index] = new GraphicsElement::Pimpl{this, handle, width, height};
+        element->Initialize(pimpls_[handle.index], this);
+        ElementAdded(element);
+    }
+
+    void SystemSoftware::ReleaseElement(GraphicsElement* element)
+    {
+        pimpls_[element->GetHandle().index] = nullptr;
+    }
+
+    uint64_t SystemSoftware::GetSurfaceBytes(ElementHandle handle) const
+    {
+        Surface surface{};
+        if(!pimpls_[handle.index]->GetSurface(&surface))
+            return 0;
+
+        return static_cast<uint64_t>(surface.stride) * surface.height * sizeof(uint32_t);
+    }
+
+    bool SystemSoftware::EvictSurface(ElementHandle handle)
+    {
+        pimpls_[handle.index]->ReleaseSurface();
+        return true;
+    }
+
+    void SystemSoftware::RestoreSurface(ElementHandle handle)
+    {
+        pimpls_[handle.index]->RestoreSurface();
+    }
+
+    void SystemSoftware::FlattenLayer(uint32_t layer)
+    {
+        if(layerSurfaces_.size() <= layer)
+        {
+            layerSurfaces_.resize(layer + 1);
+        }
+
+        const StaticLayer& entry = staticLayers_[layer];
+        auto& pixels = layerSurfaces_[layer];
+        pixels.assign(static_cast<size_t>(RectArea(entry.bounds)), 0);
+        const Surface target{pixels.data(), entry.bounds.size.width, entry.bounds.size.height, entry.bounds.size.width};
+        for(auto handle: entry.members)
+        {
+            Composite(store_.GetElement(handle), entry.bounds, target, entry.bounds.origin);
+        }
+    }
+
+    void SystemSoftware::ReleaseLayer(uint32_t layer)
+    {
+        std::vector<uint32_t>{}.swap(layerSurfaces_[layer]);
+    }
+
+    void SystemSoftware::CompositeLayer(uint32_t layer, const Rect& clip)
+    {
+        const Rect& bounds = staticLayers_[layer].bounds;
+        const Rect target = IntersectRects(bounds, clip);
+        const uint32_t* pixels = layerSurfaces_[layer].data();
+        for(int y = target.origin.y; !IsEmptyRect(target) && y < RectBottom(target); ++y)
+        {
+            const uint32_t* src = pixels + static_cast<size_t>(y - bounds.origin.y) * bounds.size.width + (target.origin.x - bounds.origin.x);
+            uint32_t* dst = framebuffer_.data() + static_cast<size_t>(y) * width_ + target.origin.x;
+            BlendRowSourceOver(dst, src, static_cast<size_t>(target.size.width));
+        }
+    }
+
+    void SystemSoftware::Composite(GraphicsElement* element, const Rect& clip, const Surface& target, const Point& origin)
+    {
+        Surface surface{};
+        if(!element->GetSurface(&surface))
+            return;
+
+        const CompositeTransform transform = element->GetCompositeTransform();
+        if(transform.opacity <= 0.f)
+            return;
+
+        if(HasCompositeGeometry(transform) || transform.opacity < 1.f)
+        {
+            CompositeTransformed(element, surface, transform, clip, target, origin);
+            return;
+        }
+
+        auto pos = element->GetPosition();
+        auto size = element->GetSize();
+        const int left = std::max(pos.x, clip.origin.x);
+        const int top = std::max(pos.y, clip.origin.y);
+        const int right = std::min({pos.x + size.width, pos.x + surface.width, RectRight(clip)});
+        const int bottom = std::min({pos.y + size.height, pos.y + surface.height, RectBottom(clip)});
+        if(left >= right || top >= bottom)
+            return;
+
+        for(int y = top; y < bottom; ++y)
+        {
+            const uint32_t* src = surface.pixels + static_cast<size_t>(y - pos.y) * surface.stride + (left - pos.x);
+            uint32_t* dst = target.pixels + static_cast<size_t>(y - origin.y) * target.stride + (left - origin.x);
+            BlendRowSourceOver(dst, src, static_cast<size_t>(right - left));
+        }
+    }
+
+    void SystemSoftware::CompositeTransformed(GraphicsElement* element, const Surface& surface,
+        const CompositeTransform& transform, const Rect& clip, const Surface& target, const Point& origin)
+    {
+        const CompositeMatrix matrix = MakeCompositeMatrix(transform);
+        const float determinant = matrix.m11 * matrix.m22 - matrix.m12 * matrix.m21;
+        if(std::abs(determinant) < 1e-6f)
+            return;
+
+        const Rect area = IntersectRects(store_.GetBounds(element->GetHandle()), clip);
+        if(IsEmptyRect(area))
+            return;
+
+        auto pos = element->GetPosition();
+        auto size = element->GetSize();
+        const int width = std::min(size.width, surface.width);
+        const int height = std::min(size.height, surface.height);
+        const float centerX = pos.x + size.width / 2.f;
+        const float centerY = pos.y + size.height / 2.f;
+        const float inverse11 = matrix.m22 / determinant;
+        const float inverse12 = -matrix.m12 / determinant;
+        const float inverse21 = -matrix.m21 / determinant;
+        const float inverse22 = matrix.m11 / determinant;
+        const float opacity = std::min(transform.opacity, 1.f);
+
+        // Map each destination pixel center back into the element and sample it there. Bands composite on the pool,
+        // so each thread keeps its own row instead of allocating one per element and band.
+        thread_local std::vector<uint32_t> row;
+        row.resize(static_cast<size_t>(area.size.width));
+        for(int y = area.origin.y; y < RectBottom(area); ++y)
+        {
+            const float offsetY = y + 0.5f - centerY;
+            for(int x = area.origin.x; x < RectRight(area); ++x)
+            {
+                const float offsetX = x + 0.5f - centerX;
+                const float u = offsetX * inverse11 + offsetY * inverse21 + size.width / 2.f - 0.5f;
+                const float v = offsetX * inverse12 + offsetY * inverse22 + size.height / 2.f - 0.5f;
+                row[x - area.origin.x] = SampleBilinear(surface, width, height, u, v, opacity);
+            }
+
+            uint32_t* dst = target.pixels + static_cast<size_t>(y - origin.y) * target.stride + (area.origin.x - origin.x);
+            BlendRowSourceOver(dst, row.data(), row.size());
+        }
+    }
+}
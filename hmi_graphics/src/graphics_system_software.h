@@ -0,0 +1,80 @@
+#ifndef GRAPHICS_SYSTEM_SOFTWARE_H
+#define GRAPHICS_SYSTEM_SOFTWARE_H
+
+#include <vector>
+#include <graphics_element.h>
+#include "graphics_system_base.h"
+#include "text_atlas.h"
+
+namespace hmi_graphics
+{
+    class SystemSoftware: public SystemBase
+    {
+    public:
+        SystemSoftware(int16_t width, int16_t height);
+
+        ~SystemSoftware() override;
+
+        bool GetDirect2dDeviceContext(ID2D1DeviceContext** deviceContext) override;
+
+        bool GetCachedColorBrush(const D2D1_COLOR_F& rgba, ID2D1SolidColorBrush** colorBrush) override;
+
+        void GetResourceCacheStatistics(CacheStatistics* colorBrushes, CacheStatistics* textFormats) override;
+
+        bool DrawCachedText(const Surface& surface, const Rect& box, const wchar_t* text, uint32_t length,
+            const TextFormatDesc& desc, uint32_t argb) override;
+
+        void GetTextCacheStatistics(CacheStatistics* textLayouts, AtlasStatistics* textAtlas) override;
+
+        bool Render() override;
+
+        void GetDirect3dDevice(ID3D11Device** device) override;
+
+        void GetDirect3dContext(ID3D11DeviceContext** deviceContext) override;
+
+        bool GetFramebuffer(Surface* framebuffer) override;
+
+        bool SetFrameCaptureDepth(size_t depth) override;
+
+        HANDLE GetFrameLatencyWaitableObject() override;
+
+        void GetAtlasStatistics(AtlasStatistics* statistics) override;
+
+    protected:
+        void AddElement(GraphicsElement* element, int16_t width, int16_t height) override;
+
+        void ReleaseElement(GraphicsElement* element) override;
+
+        uint64_t GetSurfaceBytes(ElementHandle handle) const override;
+
+        bool EvictSurface(ElementHandle handle) override;
+
+        void RestoreSurface(ElementHandle handle) override;
+
+        void FlattenLayer(uint32_t layer) override;
+
+        void ReleaseLayer(uint32_t layer) override;
+
+    private:
+        // target holds the pixels of the frame rect at origin with its size, e.g. the framebuffer or a layer.
+        void Composite(GraphicsElement* element, const Rect& clip, const Surface& target, const Point& origin);
+
+        void CompositeTransformed(GraphicsElement* element, const Surface& surface, const CompositeTransform& transform,
+            const Rect& clip, const Surface& target, const Point& origin);
+
+        void CompositeLayer(uint32_t layer, const Rect& clip);
+
+        TextAtlas textAtlas_;
+        // Owned by the elements; indexed by ElementHandle::index.
+        std::vector<GraphicsElement::Pimpl*> pimpls_;
+        // Indexed like staticLayers_.
+        std::vector<std::vector<uint32_t>> layerSurfaces_;
+        std::vector<uint32_t> framebuffer_;
+        // One copy of the framebuffer per capture slot.
+        std::vector<std::vector<uint32_t>> captureBuffers_;
+        int16_t width_;
+        int16_t height_;
+    };
+}
+
+#endif //GRAPHICS_SYSTEM_SOFTWARE_H
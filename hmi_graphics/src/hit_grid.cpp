@@ -0,0 +1,148 @@
+#include "hit_grid.h"
+
+#include <algorithm>
+#include "rect_util.h"
+
+namespace hmi_graphics
+{
+    HitGrid::HitGrid(int cellSize)
+        : width_{0}
+        , height_{0}
+        , cellSize_{cellSize}
+        , columns_{0}
+        , rows_{0}
+        , version_{0}
+    {
+        cellStarts_.resize(1, 0);
+    }
+
+    void HitGrid::Build(int width, int height, const std::vector<ElementState>& states,
+        const std::vector<uint32_t>& sequences, uint32_t version)
+    {
+        width_ = std::max(width, 0);
+        height_ = std::max(height, 0);
+        columns_ = (width_ + cellSize_ - 1) / cellSize_;
+        rows_ = (height_ + cellSize_ - 1) / cellSize_;
+        version_ = version;
+
+        items_.clear();
+        cellStarts_.assign(static_cast<size_t>(columns_) * rows_ + 1, 0);
+        for(size_t i = 0; i < states.size(); ++i)
+        {
+            const ElementState& state = states[i];
+            items_.push_back(Item{state.handle, state.bounds, state.zIndex, i < sequences.size() ? sequences[i] : 0});
+            const Rect cells = GetCellRange(state.bounds);
+            for(int row = cells.origin.y; row < RectBottom(cells); ++row)
+            {
+                for(int column = cells.origin.x; column < RectRight(cells); ++column)
+                {
+                    ++cellStarts_[static_cast<size_t>(row) * columns_ + column + 1];
+                }
+            }
+        }
+
+        for(size_t cell = 1; cell < cellStarts_.size(); ++cell)
+        {
+            cellStarts_[cell] += cellStarts_[cell - 1];
+        }
+
+        // Front to back, so every cell ends up top-most first.
+        entries_.resize(cellStarts_.back());
+        fill_.assign(cellStarts_.begin(), cellStarts_.end() - 1);
+        for(size_t i = items_.size(); i-- > 0;)
+        {
+            const Rect cells = GetCellRange(items_[i].bounds);
+            for(int row = cells.origin.y; row < RectBottom(cells); ++row)
+            {
+                for(int column = cells.origin.x; column < RectRight(cells); ++column)
+                {
+                    entries_[fill_[static_cast<size_t>(row) * columns_ + column]++] = static_cast<uint32_t>(i);
+                }
+            }
+        }
+    }
+
+    ElementHandle HitGrid::Query(int32_t x, int32_t y, HitTestCursor* cursor) const
+    {
+        if(x < 0 || y < 0 || x >= width_ || y >= height_)
+            return ElementHandle{};
+
+        const size_t cell = static_cast<size_t>(y / cellSize_) * columns_ + x / cellSize_;
+        const uint32_t* begin = entries_.data() + cellStarts_[cell];
+        const size_t count = cellStarts_[cell + 1] - cellStarts_[cell];
+        size_t position = 0;
+        if(cursor != nullptr && cursor->started && cursor->x == x && cursor->y == y)
+        {
+            if(cursor->version == version_)
+            {
+                position = cursor->position;
+            }
+            else
+            {
+                // Built from another snapshot since the previous step; resume below the last returned element's key.
+                const Item last{ElementHandle{}, Rect{}, cursor->zIndex, cursor->sequence};
+                position = std::upper_bound(begin, begin + count, last, [this](const Item& key, uint32_t index)
+                {
+                    return IsAbove(key, items_[index]);
+                }) - begin;
+            }
+        }
+
+        for(; position < count; ++position)
+        {
+            const Item& item = items_[begin[position]];
+            if(!RectContainsPoint(item.bounds, x, y))
+                continue;
+
+            if(cursor != nullptr)
+            {
+                cursor->x = x;
+                cursor->y = y;
+                cursor->position = static_cast<uint32_t>(position + 1);
+                cursor->version = version_;
+                cursor->sequence = item.sequence;
+                cursor->zIndex = item.zIndex;
+                cursor->started = true;
+            }
+
+            return item.handle;
+        }
+
+        if(cursor != nullptr)
+        {
+            cursor->x = x;
+            cursor->y = y;
+            cursor->position = static_cast<uint32_t>(count);
+            cursor->version = version_;
+            cursor->started = true;
+        }
+
+        return ElementHandle{};
+    }
+
+    size_t HitGrid::GetElementCount() const
+    {
+        return items_.size();
+    }
+
+    bool HitGrid::IsAbove(const Item& lhs, const Item& rhs)
+    {
+        if(lhs.zIndex != rhs.zIndex)
+            return lhs.zIndex > rhs.zIndex;
+
+        return lhs.sequence > rhs.sequence;
+    }
+
+    Rect HitGrid::GetCellRange(const Rect& bounds) const
+    {
+        Rect visible = IntersectRects(bounds, MakeRect(0, 0, width_, height_));
+        if(IsEmptyRect(visible))
+            return Rect{};
+
+        int left = visible.origin.x / cellSize_;
+        int top = visible.origin.y / cellSize_;
+        int right = (RectRight(visible) - 1) / cellSize_ + 1;
+        int bottom = (RectBottom(visible) - 1) / cellSize_ + 1;
+        return MakeRect(left, top, right - left, bottom - top);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef HMI_HIT_GRID_H
+#define HMI_HIT_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "types.h"
+
+namespace hmi_graphics
+{
+    // Read-only counterpart of SpatialIndex for a captured scene: built in one pass from element states in draw
+    // order, then queried without further changes. Every cell lists the elements overlapping it top-most first,
+    // packed into one array, so rebuilding it for each published snapshot allocates nothing once warm.
+    class HitGrid
+    {
+    public:
+        explicit HitGrid(int cellSize = 64);
+
+        // states are back to front, sequences their DrawOrder sequences. version identifies this build to the
+        // cursors; it has to differ from the version of every other grid they may have been used with.
+        void Build(int width, int height, const std::vector<ElementState>& states,
+            const std::vector<uint32_t>& sequences, uint32_t version);
+
+        // Top-most element containing the point, generation 0 when none. Continues below the previous hit when
+        // given the cursor of the same point back, like SpatialIndex::Query, also across rebuilds.
+        ElementHandle Query(int32_t x, int32_t y, HitTestCursor* cursor) const;
+
+        size_t GetElementCount() const;
+
+    private:
+        struct Item
+        {
+            ElementHandle handle;
+            Rect bounds;
+            int16_t zIndex;
+            uint32_t sequence;
+        };
+
+        static bool IsAbove(const Item& lhs, const Item& rhs);
+
+        Rect GetCellRange(const Rect& bounds) const;
+
+        std::vector<Item> items_;
+        // Cell c lists the items entries_[cellStarts_[c]] up to entries_[cellStarts_[c + 1]].
+        std::vector<uint32_t> cellStarts_;
+        std::vector<uint32_t> entries_;
+        std::vector<uint32_t> fill_;
+        int width_;
+        int height_;
+        int cellSize_;
+        int columns_;
+        int rows_;
+        uint32_t version_;
+    };
+}
+
+#endif //HMI_HIT_GRID_H
@@ -0,0 +1,184 @@
+#ifndef HMI_LRU_CACHE_H
+#define HMI_LRU_CACHE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include "types.h"
+
+namespace hmi_graphics
+{
+    // Capacity is measured in the cost of the entries, which defaults to one per entry; least recently used entries
+    // are evicted until a new entry fits. The eviction handler, if any, sees every evicted entry before it is dropped;
+    // Clear drops entries without calling it.
+    template<typename Key, typename Value, typename Hash = std::hash<Key>>
+    class LruCache
+    {
+    public:
+        using EvictionHandler = std::function<void(const Key&, Value&)>;
+
+        explicit LruCache(size_t capacity, EvictionHandler onEvict = nullptr);
+
+        Value* Find(const Key& key);
+
+        // Find without counting a hit or miss, for re-checking a key after work done outside a lock.
+        Value* FindUncounted(const Key& key);
+
+        Value& Insert(const Key& key, Value value, size_t cost = 1);
+
+        // Drops the least recently used entry through the eviction handler; false when the cache is empty.
+        bool EvictLeastRecent();
+
+        void Clear();
+
+        size_t GetSize() const;
+
+        size_t GetCapacity() const;
+
+        size_t GetCost() const;
+
+        // size and capacity are reported in cost units.
+        CacheStatistics GetStatistics() const;
+
+    private:
+        struct Entry
+        {
+            Key first;
+            Value second;
+            size_t cost;
+        };
+
+        std::list<Entry> entries_;
+        std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index_;
+        EvictionHandler onEvict_;
+        size_t capacity_;
+        size_t cost_;
+        uint64_t hits_;
+        uint64_t misses_;
+        uint64_t evictions_;
+    };
+
+    template<typename Key, typename Value, typename Hash>
+    inline LruCache<Key, Value, Hash>::LruCache(size_t capacity, EvictionHandler onEvict)
+        : onEvict_{std::move(onEvict)}
+        , capacity_{capacity > 0 ? capacity : 1}
+        , cost_{}
+        , hits_{}
+        , misses_{}
+        , evictions_{}
+    {
+        index_.reserve(std::min<size_t>(capacity_, 1024));
+    }
+
+    template<typename Key, typename Value, typename Hash>
+    inline Value* LruCache<Key, Value, Hash>::Find(const Key& key)
+    {
+        auto it = index_.find(key);
+        if(it == index_.end())
+        {
+            ++misses_;
+            return nullptr;
+        }
+
+        ++hits_;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return &it->second->second;
+    }
+
+    template<typename Key, typename Value, typename Hash>
+    inline Value* LruCache<Key, Value, Hash>::FindUncounted(const Key& key)
+    {
+        auto it = index_.find(key);
+        if(it == index_.end())
+            return nullptr;
+
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return &it->second->second;
+    }
+
+    template<typename Key, typename Value, typename Hash>
+    inline Value& LruCache<Key, Value, Hash>::Insert(const Key& key, Value value, size_t cost)
+    {
+        auto it = index_.find(key);
+        if(it != index_.end())
+        {
+            const auto node = it->second;
+            cost_ -= node->cost;
+            index_.erase(it);
+            entries_.erase(node);
+        }
+
+        // An entry costing more than the whole capacity still goes in, after everything else was evicted.
+        while(!entries_.empty() && cost_ + cost > capacity_)
+        {
+            EvictLeastRecent();
+        }
+
+        entries_.push_front(Entry{key, std::move(value), cost});
+        index_.emplace(key, entries_.begin());
+        cost_ += cost;
+        return entries_.front().second;
+    }
+
+    template<typename Key, typename Value, typename Hash>
+    inline bool LruCache<Key, Value, Hash>::EvictLeastRecent()
+    {
+        if(entries_.empty())
+            return false;
+
+        Entry& entry = entries_.back();
+        if(onEvict_)
+        {
+            onEvict_(entry.first, entry.second);
+        }
+
+        cost_ -= entry.cost;
+        index_.erase(entry.first);
+        entries_.pop_back();
+        ++evictions_;
+        return true;
+    }
+
+    template<typename Key, typename Value, typename Hash>
+    inline void LruCache<Key, Value, Hash>::Clear()
+    {
+        index_.clear();
+        entries_.clear();
+        cost_ = 0;
+    }
+
+    template<typename Key, typename Value, typename Hash>
+    inline size_t LruCache<Key, Value, Hash>::GetSize() const
+    {
+        return entries_.size();
+    }
+
+    template<typename Key, typename Value, typename Hash>
+    inline size_t LruCache<Key, Value, Hash>::GetCapacity() const
+    {
+        return capacity_;
+    }
+
+    template<typename Key, typename Value, typename Hash>
+    inline size_t LruCache<Key, Value, Hash>::GetCost() const
+    {
+        return cost_;
+    }
+
+    template<typename Key, typename Value, typename Hash>
+    inline CacheStatistics LruCache<Key, Value, Hash>::GetStatistics() const
+    {
+        CacheStatistics statistics{};
+        statistics.hits = hits_;
+        statistics.misses = misses_;
+        statistics.evictions = evictions_;
+        statistics.size = cost_;
+        statistics.capacity = capacity_;
+        return statistics;
+    }
+}
+
+#endif //HMI_LRU_CACHE_H
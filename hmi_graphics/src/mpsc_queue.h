@@ -0,0 +1,126 @@
+#ifndef HMI_MPSC_QUEUE_H
+#define HMI_MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace hmi_graphics
+{
+    // Bounded lock-free queue for many producers and one consumer. Every cell carries a sequence number that tells
+    // producers whether it is free for the current lap and the consumer whether it has been published. Producers
+    // only contend on one atomic increment and never wait for each other or for the consumer.
+    template<typename T>
+    class BoundedMpscQueue
+    {
+    public:
+        // capacity is rounded up to a power of two.
+        explicit BoundedMpscQueue(size_t capacity);
+
+        BoundedMpscQueue(const BoundedMpscQueue&) = delete;
+
+        // Returns false when the queue is full.
+        bool TryPush(T value);
+
+        // Consumer side only.
+        bool TryPop(T* value);
+
+        bool IsEmpty() const;
+
+        size_t GetCapacity() const;
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        std::unique_ptr<Cell[]> cells_;
+        size_t mask_;
+        alignas(64) std::atomic<size_t> enqueuePosition_;
+        alignas(64) size_t dequeuePosition_;
+    };
+
+    template<typename T>
+    inline BoundedMpscQueue<T>::BoundedMpscQueue(size_t capacity)
+        : mask_{}
+        , enqueuePosition_{0}
+        , dequeuePosition_{0}
+    {
+        size_t size = 2;
+        while(size < capacity)
+        {
+            size <<= 1;
+        }
+
+        cells_.reset(new Cell[size]);
+        mask_ = size - 1;
+        for(size_t i = 0; i < size; ++i)
+        {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    template<typename T>
+    inline bool BoundedMpscQueue<T>::TryPush(T value)
+    {
+        size_t position = enqueuePosition_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while(true)
+        {
+            cell = &cells_[position & mask_];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if(difference == 0)
+            {
+                if(enqueuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if(difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = enqueuePosition_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    template<typename T>
+    inline bool BoundedMpscQueue<T>::TryPop(T* value)
+    {
+        Cell& cell = cells_[dequeuePosition_ & mask_];
+        const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if(sequence != dequeuePosition_ + 1)
+            return false;
+
+        *value = std::move(cell.value);
+        cell.value = T{};
+        cell.sequence.store(dequeuePosition_ + mask_ + 1, std::memory_order_release);
+        dequeuePosition_ += 1;
+        return true;
+    }
+
+    template<typename T>
+    inline bool BoundedMpscQueue<T>::IsEmpty() const
+    {
+        const Cell& cell = cells_[dequeuePosition_ & mask_];
+        return cell.sequence.load(std::memory_order_acquire) != dequeuePosition_ + 1;
+    }
+
+    template<typename T>
+    inline size_t BoundedMpscQueue<T>::GetCapacity() const
+    {
+        return mask_ + 1;
+    }
+}
+
+#endif //HMI_MPSC_QUEUE_H
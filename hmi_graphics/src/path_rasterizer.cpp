@@ -0,0 +1,163 @@
+#include "path_rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include "blend.h"
+#include "rect_util.h"
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        constexpr int SUBSCANLINES = 4;
+
+        void AddSpan(std::vector<float>& coverage, int left, float start, float end, float weight)
+        {
+            const float limit = static_cast<float>(left + static_cast<int>(coverage.size()));
+            start = std::max(start, static_cast<float>(left));
+            end = std::min(end, limit);
+            if(start >= end)
+                return;
+
+            const int first = static_cast<int>(start);
+            const int last = static_cast<int>(end);
+            if(first == last)
+            {
+                coverage[first - left] += (end - start) * weight;
+                return;
+            }
+
+            coverage[first - left] += (first + 1 - start) * weight;
+            for(int x = first + 1; x < last; ++x)
+            {
+                coverage[x - left] += weight;
+            }
+
+            if(last - left < static_cast<int>(coverage.size()))
+            {
+                coverage[last - left] += (end - last) * weight;
+            }
+        }
+    }
+
+    PathRasterizer::PathRasterizer()
+        : startX_{}
+        , startY_{}
+        , currentX_{}
+        , currentY_{}
+    {
+    }
+
+    void PathRasterizer::Reset()
+    {
+        edges_.clear();
+    }
+
+    void PathRasterizer::MoveTo(float x, float y)
+    {
+        Close();
+        startX_ = currentX_ = x;
+        startY_ = currentY_ = y;
+    }
+
+    void PathRasterizer::LineTo(float x, float y)
+    {
+        // Horizontal edges never cross a sub-scanline.
+        if(y != currentY_)
+        {
+            if(y > currentY_)
+            {
+                edges_.push_back(Edge{currentX_, currentY_, x, y, 1});
+            }
+            else
+            {
+                edges_.push_back(Edge{x, y, currentX_, currentY_, -1});
+            }
+        }
+
+        currentX_ = x;
+        currentY_ = y;
+    }
+
+    void PathRasterizer::Close()
+    {
+        LineTo(startX_, startY_);
+    }
+
+    void PathRasterizer::Fill(const Surface& surface, const Rect& clip, uint32_t argb)
+    {
+        Close();
+        if(edges_.empty() || surface.pixels == nullptr)
+            return;
+
+        float minX = edges_.front().x0;
+        float maxX = minX;
+        float minY = edges_.front().y0;
+        float maxY = edges_.front().y1;
+        for(auto& edge: edges_)
+        {
+            minX = std::min({minX, edge.x0, edge.x1});
+            maxX = std::max({maxX, edge.x0, edge.x1});
+            minY = std::min(minY, edge.y0);
+            maxY = std::max(maxY, edge.y1);
+        }
+
+        const Rect pathBounds = MakeRect(static_cast<int>(std::floor(minX)), static_cast<int>(std::floor(minY)),
+            static_cast<int>(std::ceil(maxX)) - static_cast<int>(std::floor(minX)) + 1,
+            static_cast<int>(std::ceil(maxY)) - static_cast<int>(std::floor(minY)) + 1);
+        const Rect bounds = IntersectRects(IntersectRects(pathBounds, clip), MakeRect(0, 0, surface.width, surface.height));
+        if(IsEmptyRect(bounds))
+            return;
+
+        const int left = bounds.origin.x;
+        coverage_.resize(static_cast<size_t>(bounds.size.width));
+        mask_.resize(static_cast<size_t>(bounds.size.width));
+        for(int y = bounds.origin.y; y < RectBottom(bounds); ++y)
+        {
+            std::fill(coverage_.begin(), coverage_.end(), 0.f);
+            for(int sub = 0; sub < SUBSCANLINES; ++sub)
+            {
+                const float sampleY = y + (sub + 0.5f) / SUBSCANLINES;
+                crossings_.clear();
+                for(auto& edge: edges_)
+                {
+                    if(sampleY < edge.y0 || sampleY >= edge.y1)
+                        continue;
+
+                    const float x = edge.x0 + (sampleY - edge.y0) * (edge.x1 - edge.x0) / (edge.y1 - edge.y0);
+                    crossings_.push_back(Crossing{x, edge.winding});
+                }
+
+                std::sort(crossings_.begin(), crossings_.end(), [](const Crossing& lhs, const Crossing& rhs)
+                {
+                    return lhs.x < rhs.x;
+                });
+
+                int winding = 0;
+                float spanStart = 0.f;
+                for(auto& crossing: crossings_)
+                {
+                    const int previous = winding;
+                    winding += crossing.winding;
+                    if(previous == 0 && winding != 0)
+                    {
+                        spanStart = crossing.x;
+                    }
+                    else if(previous != 0 && winding == 0)
+                    {
+                        AddSpan(coverage_, left, spanStart, crossing.x, 1.f / SUBSCANLINES);
+                    }
+                }
+            }
+
+            for(size_t i = 0; i < coverage_.size(); ++i)
+            {
+                mask_[i] = static_cast<uint8_t>(std::min(coverage_[i], 1.f) * 255.f + 0.5f);
+            }
+
+            BlendRowMask(surface.pixels + static_cast<size_t>(y) * surface.stride + left, mask_.data(), argb, mask_.size());
+        }
+
+        edges_.clear();
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef HMI_PATH_RASTERIZER_H
+#define HMI_PATH_RASTERIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "types.h"
+
+namespace hmi_graphics
+{
+    // Scanline fill of polygons with the nonzero winding rule. Edges are sampled on four sub-scanlines per row with
+    // exact horizontal span coverage, which is enough anti-aliasing for element content.
+    class PathRasterizer
+    {
+    public:
+        PathRasterizer();
+
+        void Reset();
+
+        void MoveTo(float x, float y);
+
+        void LineTo(float x, float y);
+
+        void Close();
+
+        // argb is premultiplied; pixels outside clip are left alone.
+        void Fill(const Surface& surface, const Rect& clip, uint32_t argb);
+
+    private:
+        struct Edge
+        {
+            float x0;
+            float y0;
+            float x1;
+            float y1;
+            int winding;
+        };
+
+        struct Crossing
+        {
+            float x;
+            int winding;
+        };
+
+        std::vector<Edge> edges_;
+        std::vector<Crossing> crossings_;
+        std::vector<float> coverage_;
+        std::vector<uint8_t> mask_;
+        float startX_;
+        float startY_;
+        float currentX_;
+        float currentY_;
+    };
+}
+
+#endif //HMI_PATH_RASTERIZER_H
@@ -0,0 +1,137 @@
+#ifndef HMI_RECT_UTIL_H
+#define HMI_RECT_UTIL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include "types.h"
+
+namespace hmi_graphics
+{
+    inline Rect MakeRect(int x, int y, int width, int height)
+    {
+        return Rect{Point{x, y}, Size{width, height}};
+    }
+
+    inline int RectRight(const Rect& rect)
+    {
+        return rect.origin.x + rect.size.width;
+    }
+
+    inline int RectBottom(const Rect& rect)
+    {
+        return rect.origin.y + rect.size.height;
+    }
+
+    inline bool IsEmptyRect(const Rect& rect)
+    {
+        return rect.size.width <= 0 || rect.size.height <= 0;
+    }
+
+    inline int64_t RectArea(const Rect& rect)
+    {
+        if(IsEmptyRect(rect))
+            return 0;
+
+        return static_cast<int64_t>(rect.size.width) * rect.size.height;
+    }
+
+    inline Rect IntersectRects(const Rect& lhs, const Rect& rhs)
+    {
+        const int left = std::max(lhs.origin.x, rhs.origin.x);
+        const int top = std::max(lhs.origin.y, rhs.origin.y);
+        const int right = std::min(RectRight(lhs), RectRight(rhs));
+        const int bottom = std::min(RectBottom(lhs), RectBottom(rhs));
+        if(left >= right || top >= bottom)
+            return MakeRect(left, top, 0, 0);
+
+        return MakeRect(left, top, right - left, bottom - top);
+    }
+
+    inline Rect UnionRects(const Rect& lhs, const Rect& rhs)
+    {
+        if(IsEmptyRect(lhs))
+            return rhs;
+
+        if(IsEmptyRect(rhs))
+            return lhs;
+
+        const int left = std::min(lhs.origin.x, rhs.origin.x);
+        const int top = std::min(lhs.origin.y, rhs.origin.y);
+        const int right = std::max(RectRight(lhs), RectRight(rhs));
+        const int bottom = std::max(RectBottom(lhs), RectBottom(rhs));
+        return MakeRect(left, top, right - left, bottom - top);
+    }
+
+    inline bool RectsIntersect(const Rect& lhs, const Rect& rhs)
+    {
+        return !IsEmptyRect(IntersectRects(lhs, rhs));
+    }
+
+    inline bool RectContains(const Rect& outer, const Rect& inner)
+    {
+        return inner.origin.x >= outer.origin.x && inner.origin.y >= outer.origin.y
+            && RectRight(inner) <= RectRight(outer) && RectBottom(inner) <= RectBottom(outer);
+    }
+
+    inline bool RectContainsPoint(const Rect& rect, int x, int y)
+    {
+        return x >= rect.origin.x && y >= rect.origin.y && x < RectRight(rect) && y < RectBottom(rect);
+    }
+
+    // Shrinks rect past every occluder that covers a whole band along one of its edges, until none does; what is
+    // left may still be partly covered. Returns false when the occluders cover all of rect.
+    inline bool ClipToUncovered(const Rect* occluders, size_t count, Rect* rect)
+    {
+        bool clipped = true;
+        while(clipped && !IsEmptyRect(*rect))
+        {
+            clipped = false;
+            for(size_t i = 0; i < count; ++i)
+            {
+                const Rect& occluder = occluders[i];
+                int left = rect->origin.x;
+                int top = rect->origin.y;
+                int right = RectRight(*rect);
+                int bottom = RectBottom(*rect);
+                const bool spansWidth = occluder.origin.x <= left && RectRight(occluder) >= right;
+                const bool spansHeight = occluder.origin.y <= top && RectBottom(occluder) >= bottom;
+                if(spansWidth && occluder.origin.y <= top && RectBottom(occluder) > top)
+                {
+                    top = RectBottom(occluder);
+                }
+                else if(spansWidth && RectBottom(occluder) >= bottom && occluder.origin.y < bottom)
+                {
+                    bottom = occluder.origin.y;
+                }
+                else if(spansHeight && occluder.origin.x <= left && RectRight(occluder) > left)
+                {
+                    left = RectRight(occluder);
+                }
+                else if(spansHeight && RectRight(occluder) >= right && occluder.origin.x < right)
+                {
+                    right = occluder.origin.x;
+                }
+                else
+                {
+                    continue;
+                }
+
+                *rect = MakeRect(left, top, std::max(right - left, 0), std::max(bottom - top, 0));
+                clipped = true;
+                if(IsEmptyRect(*rect))
+                    return false;
+            }
+        }
+
+        return !IsEmptyRect(*rect);
+    }
+
+    inline bool RectsEqual(const Rect& lhs, const Rect& rhs)
+    {
+        return lhs.origin.x == rhs.origin.x && lhs.origin.y == rhs.origin.y
+            && lhs.size.width == rhs.size.width && lhs.size.height == rhs.size.height;
+    }
+}
+
+#endif //HMI_RECT_UTIL_H
@@ -0,0 +1,508 @@
+#include "render_thread.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <frame_scheduler.h>
+#include <graphics_element.h>
+#include <graphics_system.h>
+#include "graphics_system_base.h"
+#include "hit_grid.h"
+#include "mpsc_queue.h"
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        constexpr std::chrono::milliseconds IDLE_WAIT_TIMEOUT{100};
+        constexpr DWORD FRAME_LATENCY_WAIT_TIMEOUT_MS = 1000;
+    }
+}
+
+class hmi_graphics::RenderThread::Pimpl
+{
+public:
+    Pimpl(System* system, size_t queueCapacity);
+
+    bool Post(ElementHandle handle, int16_t first, int16_t second, int type);
+
+    bool Post(ElementHandle handle, std::function<void(GraphicsElement*)> elementUpdate);
+
+    bool Post(std::function<void(System*)> systemUpdate);
+
+    bool SetFrameListener(std::function<void(System*)> listener);
+
+    bool SetFrameScheduler(const FrameSchedulerOptions& options);
+
+    bool GetFrameSchedulerStatistics(FrameSchedulerStatistics* statistics) const;
+
+    bool GetElementState(ElementHandle handle, ElementState* state) const;
+
+    ElementHandle HitTest(int32_t x, int32_t y, HitTestCursor* cursor) const;
+
+    uint64_t GetFrameCount() const;
+
+    void Stop();
+
+private:
+    enum CommandType
+    {
+        SET_POSITION,
+        SET_SIZE,
+        SET_Z_INDEX,
+        INVOKE_ELEMENT,
+        INVOKE_SYSTEM,
+    };
+
+    struct SceneCommand
+    {
+        int type;
+        ElementHandle handle;
+        int16_t first;
+        int16_t second;
+        std::function<void(GraphicsElement*)> elementUpdate;
+        std::function<void(System*)> systemUpdate;
+    };
+
+    struct Snapshot
+    {
+        // Back to front.
+        std::vector<ElementState> elements;
+        // Position in elements plus one, indexed by ElementHandle::index; 0 when absent.
+        std::vector<uint32_t> lookup;
+        HitGrid grid;
+    };
+
+    friend class hmi_graphics::RenderThread;
+
+    bool Post(SceneCommand command);
+
+    void Run();
+
+    void WaitForWork(bool presented);
+
+    void ApplyCommands();
+
+    bool PublishSnapshot();
+
+    template<typename Function>
+    void ReadSnapshot(Function function) const;
+
+    SystemBase* system_;
+    BoundedMpscQueue<SceneCommand> queue_;
+    Snapshot snapshots_[2];
+    std::atomic<uint32_t> front_;
+    mutable std::atomic<uint32_t> readers_[2];
+    std::atomic<uint64_t> frameCount_;
+    std::atomic<bool> stopping_;
+    std::atomic<bool> sleeping_;
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCondition_;
+    // Only touched on the render thread.
+    std::function<void(System*)> frameListener_;
+    // Swapped in at the top of the next loop so a frame never ends on a scheduler it did not start with.
+    std::shared_ptr<FrameScheduler> scheduler_;
+    std::shared_ptr<FrameScheduler> nextScheduler_;
+    bool schedulerChanged_;
+    mutable std::mutex statisticsMutex_;
+    FrameSchedulerStatistics schedulerStatistics_;
+    bool scheduling_;
+    bool snapshotDirty_;
+    // Only touched on the render thread; the grid version of the next snapshot and its DrawOrder sequences.
+    uint32_t snapshotVersion_;
+    std::vector<uint32_t> sequences_;
+    std::thread thread_;
+};
+
+hmi_graphics::RenderThread::Pimpl::Pimpl(System* system, size_t queueCapacity)
+    : system_{static_cast<SystemBase*>(system)}
+    , queue_{queueCapacity}
+    , front_{0}
+    , readers_{}
+    , frameCount_{0}
+    , stopping_{false}
+    , sleeping_{false}
+    , schedulerChanged_{false}
+    , schedulerStatistics_{}
+    , scheduling_{false}
+    , snapshotDirty_{true}
+    , snapshotVersion_{0}
+{
+    PublishSnapshot();
+    thread_ = std::thread{&Pimpl::Run, this};
+}
+
+bool hmi_graphics::RenderThread::Pimpl::Post(ElementHandle handle, int16_t first, int16_t second, int type)
+{
+    SceneCommand command{};
+    command.type = type;
+    command.handle = handle;
+    command.first = first;
+    command.second = second;
+    return Post(std::move(command));
+}
+
+bool hmi_graphics::RenderThread::Pimpl::Post(ElementHandle handle, std::function<void(GraphicsElement*)> elementUpdate)
+{
+    SceneCommand command{};
+    command.type = INVOKE_ELEMENT;
+    command.handle = handle;
+    command.elementUpdate = std::move(elementUpdate);
+    return Post(std::move(command));
+}
+
+bool hmi_graphics::RenderThread::Pimpl::Post(std::function<void(System*)> systemUpdate)
+{
+    SceneCommand command{};
+    command.type = INVOKE_SYSTEM;
+    command.systemUpdate = std::move(systemUpdate);
+    return Post(std::move(command));
+}
+
+bool hmi_graphics::RenderThread::Pimpl::SetFrameListener(std::function<void(System*)> listener)
+{
+    return Post([this, listener](System*)
+    {
+        frameListener_ = listener;
+    });
+}
+
+bool hmi_graphics::RenderThread::Pimpl::SetFrameScheduler(const FrameSchedulerOptions& options)
+{
+    std::shared_ptr<FrameScheduler> scheduler;
+    if(options.targetFps != 0)
+    {
+        scheduler = std::make_shared<FrameScheduler>(options);
+    }
+
+    return Post([this, scheduler](System*)
+    {
+        nextScheduler_ = scheduler;
+        schedulerChanged_ = true;
+    });
+}
+
+bool hmi_graphics::RenderThread::Pimpl::GetFrameSchedulerStatistics(FrameSchedulerStatistics* statistics) const
+{
+    std::lock_guard<std::mutex> lock(statisticsMutex_);
+    *statistics = schedulerStatistics_;
+    return scheduling_;
+}
+
+bool hmi_graphics::RenderThread::Pimpl::Post(SceneCommand command)
+{
+    if(!queue_.TryPush(std::move(command)))
+        return false;
+
+    // Pairs with the fence in WaitForWork: either the render thread sees the command or we see it sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(sleeping_.load())
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        wakeCondition_.notify_one();
+    }
+
+    return true;
+}
+
+bool hmi_graphics::RenderThread::Pimpl::GetElementState(ElementHandle handle, ElementState* state) const
+{
+    bool found = false;
+    ReadSnapshot([&](const Snapshot& snapshot)
+    {
+        if(handle.index >= snapshot.lookup.size() || snapshot.lookup[handle.index] == 0)
+            return;
+
+        const ElementState& element = snapshot.elements[snapshot.lookup[handle.index] - 1];
+        if(element.handle.generation != handle.generation)
+            return;
+
+        *state = element;
+        found = true;
+    });
+
+    return found;
+}
+
+hmi_graphics::ElementHandle hmi_graphics::RenderThread::Pimpl::HitTest(int32_t x, int32_t y,
+    HitTestCursor* cursor) const
+{
+    ElementHandle result{};
+    ReadSnapshot([&](const Snapshot& snapshot)
+    {
+        result = snapshot.grid.Query(x, y, cursor);
+    });
+
+    return result;
+}
+
+uint64_t hmi_graphics::RenderThread::Pimpl::GetFrameCount() const
+{
+    return frameCount_.load();
+}
+
+void hmi_graphics::RenderThread::Pimpl::Stop()
+{
+    if(!thread_.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stopping_.store(true);
+    }
+
+    wakeCondition_.notify_one();
+    thread_.join();
+}
+
+void hmi_graphics::RenderThread::Pimpl::Run()
+{
+    bool presented = false;
+    while(true)
+    {
+        WaitForWork(presented);
+        const bool stopping = stopping_.load();
+        if(schedulerChanged_)
+        {
+            scheduler_ = std::move(nextScheduler_);
+            schedulerChanged_ = false;
+            std::lock_guard<std::mutex> lock(statisticsMutex_);
+            schedulerStatistics_ = FrameSchedulerStatistics{};
+            scheduling_ = scheduler_ != nullptr;
+        }
+
+        // Commands are applied after the wait, so the frame shows the latest input.
+        if(scheduler_ != nullptr && !stopping)
+        {
+            scheduler_->WaitForFrameStart();
+        }
+
+        ApplyCommands();
+        presented = system_->Render();
+        if(scheduler_ != nullptr && !stopping)
+        {
+            scheduler_->EndFrame(presented);
+            std::lock_guard<std::mutex> lock(statisticsMutex_);
+            scheduler_->GetStatistics(&schedulerStatistics_);
+        }
+
+        if(presented)
+        {
+            frameCount_.fetch_add(1);
+            if(frameListener_)
+            {
+                frameListener_(system_);
+            }
+        }
+
+        if(snapshotDirty_ && PublishSnapshot())
+        {
+            snapshotDirty_ = false;
+        }
+
+        if(stopping)
+            break;
+    }
+}
+
+void hmi_graphics::RenderThread::Pimpl::WaitForWork(bool presented)
+{
+    if(presented)
+    {
+        // Something may still be animating; render again as soon as the swap chain takes another frame.
+        HANDLE waitable = system_->GetFrameLatencyWaitableObject();
+        if(waitable != nullptr)
+        {
+            WaitForSingleObjectEx(waitable, FRAME_LATENCY_WAIT_TIMEOUT_MS, FALSE);
+        }
+
+        return;
+    }
+
+    sleeping_.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    {
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        wakeCondition_.wait_for(lock, IDLE_WAIT_TIMEOUT, [this]()
+        {
+            return stopping_.load() || !queue_.IsEmpty();
+        });
+    }
+
+    sleeping_.store(false);
+}
+
+void hmi_graphics::RenderThread::Pimpl::ApplyCommands()
+{
+    SceneCommand command;
+    while(queue_.TryPop(&command))
+    {
+        snapshotDirty_ = true;
+        if(command.type == INVOKE_SYSTEM)
+        {
+            command.systemUpdate(system_);
+            continue;
+        }
+
+        GraphicsElement* element = system_->GetElement(command.handle);
+        if(element == nullptr)
+            continue;
+
+        switch(command.type)
+        {
+        case SET_POSITION:
+            element->SetPosition(command.first, command.second);
+            break;
+        case SET_SIZE:
+            element->SetSize(command.first, command.second);
+            break;
+        case SET_Z_INDEX:
+            element->SetZIndex(command.first);
+            break;
+        case INVOKE_ELEMENT:
+            command.elementUpdate(element);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+bool hmi_graphics::RenderThread::Pimpl::PublishSnapshot()
+{
+    // Never write the buffer a reader still holds; the snapshot stays dirty and is published after the next frame.
+    const uint32_t back = 1 - front_.load();
+    if(readers_[back].load() != 0)
+        return false;
+
+    Snapshot& snapshot = snapshots_[back];
+    system_->CaptureElementStates(&snapshot.elements, &sequences_);
+    const Rect& viewport = system_->GetViewport();
+    snapshot.grid.Build(viewport.size.width, viewport.size.height, snapshot.elements, sequences_, ++snapshotVersion_);
+    snapshot.lookup.clear();
+    for(size_t i = 0; i < snapshot.elements.size(); ++i)
+    {
+        const uint32_t index = snapshot.elements[i].handle.index;
+        if(snapshot.lookup.size() <= index)
+        {
+            snapshot.lookup.resize(index + 1, 0);
+        }
+
+        snapshot.lookup[index] = static_cast<uint32_t>(i + 1);
+    }
+
+    front_.store(back);
+    return true;
+}
+
+template<typename Function>
+void hmi_graphics::RenderThread::Pimpl::ReadSnapshot(Function function) const
+{
+    uint32_t front;
+    while(true)
+    {
+        front = front_.load();
+        readers_[front].fetch_add(1);
+        if(front_.load() == front)
+            break;
+
+        readers_[front].fetch_sub(1);
+    }
+
+    function(snapshots_[front]);
+    readers_[front].fetch_sub(1);
+}
+
+namespace hmi_graphics
+{
+    RenderThread::RenderThread(System* system, size_t queueCapacity)
+        : pimpl_{new Pimpl{system, queueCapacity}}
+    {
+    }
+
+    RenderThread::~RenderThread()
+    {
+        pimpl_->Stop();
+        delete pimpl_;
+        pimpl_ = nullptr;
+    }
+
+    bool RenderThread::SetPosition(ElementHandle handle, int16_t x, int16_t y)
+    {
+        return pimpl_->Post(handle, x, y, Pimpl::SET_POSITION);
+    }
+
+    bool RenderThread::SetSize(ElementHandle handle, int16_t width, int16_t height)
+    {
+        return pimpl_->Post(handle, width, height, Pimpl::SET_SIZE);
+    }
+
+    bool RenderThread::SetZIndex(ElementHandle handle, int16_t zIndex)
+    {
+        return pimpl_->Post(handle, zIndex, 0, Pimpl::SET_Z_INDEX);
+    }
+
+    bool RenderThread::Invoke(ElementHandle handle, std::function<void(GraphicsElement*)> update)
+    {
+        return pimpl_->Post(handle, std::move(update));
+    }
+
+    bool RenderThread::Invoke(std::function<void(System*)> update)
+    {
+        return pimpl_->Post(std::move(update));
+    }
+
+    bool RenderThread::SetFrameListener(std::function<void(System*)> listener)
+    {
+        return pimpl_->SetFrameListener(std::move(listener));
+    }
+
+    bool RenderThread::GetElementState(ElementHandle handle, ElementState* state) const
+    {
+        if(state == nullptr)
+        {
+            return false;
+        }
+
+        return pimpl_->GetElementState(handle, state);
+    }
+
+    bool RenderThread::SetFrameScheduler(const FrameSchedulerOptions& options)
+    {
+        return pimpl_->SetFrameScheduler(options);
+    }
+
+    bool RenderThread::GetFrameSchedulerStatistics(FrameSchedulerStatistics* statistics) const
+    {
+        if(statistics == nullptr)
+        {
+            return false;
+        }
+
+        return pimpl_->GetFrameSchedulerStatistics(statistics);
+    }
+
+    ElementHandle RenderThread::HitTest(int32_t x, int32_t y) const
+    {
+        return pimpl_->HitTest(x, y, nullptr);
+    }
+
+    ElementHandle RenderThread::HitTest(int32_t x, int32_t y, HitTestCursor* cursor) const
+    {
+        return pimpl_->HitTest(x, y, cursor);
+    }
+
+    uint64_t RenderThread::GetFrameCount() const
+    {
+        return pimpl_->GetFrameCount();
+    }
+
+    void RenderThread::Stop()
+    {
+        pimpl_->Stop();
+    }
+}
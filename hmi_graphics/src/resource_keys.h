@@ -0,0 +1,128 @@
+#ifndef HMI_RESOURCE_KEYS_H
+#define HMI_RESOURCE_KEYS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "graphics_system.h"
+
+namespace hmi_graphics
+{
+    inline uint32_t QuantizeColorChannel(float value)
+    {
+        return static_cast<uint32_t>(std::min(std::max(value, 0.f), 1.f) * 255.f + 0.5f);
+    }
+
+    inline uint32_t MakeColorKey(const D2D1_COLOR_F& rgba)
+    {
+        return QuantizeColorChannel(rgba.r) << 24
+            | QuantizeColorChannel(rgba.g) << 16
+            | QuantizeColorChannel(rgba.b) << 8
+            | QuantizeColorChannel(rgba.a);
+    }
+
+    struct TextFormatKey
+    {
+        explicit TextFormatKey(const TextFormatDesc& desc);
+
+        bool operator==(const TextFormatKey& rhs) const;
+
+        std::wstring fontFamily;
+        float fontSize;
+        int32_t fontWeight;
+        int32_t fontStyle;
+        int32_t fontStretch;
+        int32_t textAlignment;
+        int32_t paragraphAlignment;
+    };
+
+    struct TextFormatKeyHash
+    {
+        size_t operator()(const TextFormatKey& key) const;
+    };
+
+    struct TextLayoutKey
+    {
+        TextLayoutKey(const wchar_t* text, uint32_t length, const TextFormatDesc& desc, float maxWidth, float maxHeight);
+
+        bool operator==(const TextLayoutKey& rhs) const;
+
+        std::wstring text;
+        TextFormatKey format;
+        float maxWidth;
+        float maxHeight;
+    };
+
+    struct TextLayoutKeyHash
+    {
+        size_t operator()(const TextLayoutKey& key) const;
+    };
+
+    inline TextFormatKey::TextFormatKey(const TextFormatDesc& desc)
+        : fontFamily{desc.fontFamily != nullptr ? desc.fontFamily : L""}
+        , fontSize{desc.fontSize}
+        , fontWeight{desc.fontWeight}
+        , fontStyle{desc.fontStyle}
+        , fontStretch{desc.fontStretch}
+        , textAlignment{desc.textAlignment}
+        , paragraphAlignment{desc.paragraphAlignment}
+    {
+    }
+
+    inline bool TextFormatKey::operator==(const TextFormatKey& rhs) const
+    {
+        return fontSize == rhs.fontSize
+            && fontWeight == rhs.fontWeight
+            && fontStyle == rhs.fontStyle
+            && fontStretch == rhs.fontStretch
+            && textAlignment == rhs.textAlignment
+            && paragraphAlignment == rhs.paragraphAlignment
+            && fontFamily == rhs.fontFamily;
+    }
+
+    inline size_t TextFormatKeyHash::operator()(const TextFormatKey& key) const
+    {
+        size_t hash = std::hash<std::wstring>{}(key.fontFamily);
+        auto combine = [&hash](size_t value)
+        {
+            hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        };
+        combine(std::hash<float>{}(key.fontSize));
+        combine(static_cast<size_t>(key.fontWeight));
+        combine(static_cast<size_t>(key.fontStyle));
+        combine(static_cast<size_t>(key.fontStretch));
+        combine(static_cast<size_t>(key.textAlignment));
+        combine(static_cast<size_t>(key.paragraphAlignment));
+        return hash;
+    }
+
+    inline TextLayoutKey::TextLayoutKey(const wchar_t* text, uint32_t length, const TextFormatDesc& desc, float maxWidth,
+        float maxHeight)
+        : text{text, length}
+        , format{desc}
+        , maxWidth{maxWidth}
+        , maxHeight{maxHeight}
+    {
+    }
+
+    inline bool TextLayoutKey::operator==(const TextLayoutKey& rhs) const
+    {
+        return maxWidth == rhs.maxWidth
+            && maxHeight == rhs.maxHeight
+            && text == rhs.text
+            && format == rhs.format;
+    }
+
+    inline size_t TextLayoutKeyHash::operator()(const TextLayoutKey& key) const
+    {
+        size_t hash = TextFormatKeyHash{}(key.format);
+        hash ^= std::hash<std::wstring>{}(key.text) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        hash ^= std::hash<float>{}(key.maxWidth) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        hash ^= std::hash<float>{}(key.maxHeight) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+}
+
+#endif //HMI_RESOURCE_KEYS_H
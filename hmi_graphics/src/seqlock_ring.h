@@ -0,0 +1,98 @@
+#ifndef HMI_SEQLOCK_RING_H
+#define HMI_SEQLOCK_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace hmi_graphics
+{
+    // Fixed-size ring overwritten by a single writer and readable from any thread without locks. Each slot carries
+    // a sequence that is odd while the writer is in it; readers drop slots whose sequence changed while copying.
+    template<typename T>
+    class SeqlockRing
+    {
+    public:
+        explicit SeqlockRing(size_t capacity);
+
+        SeqlockRing(const SeqlockRing&) = delete;
+
+        void Push(const T& value);
+
+        // Copies up to capacity of the latest values, oldest first, and returns how many were copied.
+        size_t Read(T* values, size_t capacity) const;
+
+        size_t GetCapacity() const;
+
+    private:
+        struct Slot
+        {
+            std::atomic<uint64_t> sequence;
+            T value;
+        };
+
+        std::unique_ptr<Slot[]> slots_;
+        size_t capacity_;
+        std::atomic<uint64_t> head_;
+    };
+
+    template<typename T>
+    inline SeqlockRing<T>::SeqlockRing(size_t capacity)
+        : slots_{new Slot[capacity > 0 ? capacity : 1]}
+        , capacity_{capacity > 0 ? capacity : 1}
+        , head_{0}
+    {
+        for(size_t i = 0; i < capacity_; ++i)
+        {
+            slots_[i].sequence.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    template<typename T>
+    inline void SeqlockRing<T>::Push(const T& value)
+    {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        const uint64_t lap = head / capacity_;
+        Slot& slot = slots_[head % capacity_];
+        slot.sequence.store(lap * 2 + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.value = value;
+        slot.sequence.store(lap * 2 + 2, std::memory_order_release);
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    template<typename T>
+    inline size_t SeqlockRing<T>::Read(T* values, size_t capacity) const
+    {
+        const uint64_t head = head_.load(std::memory_order_acquire);
+        const uint64_t available = std::min<uint64_t>(head, capacity_);
+        const uint64_t count = std::min<uint64_t>(available, capacity);
+        size_t copied = 0;
+        for(uint64_t position = head - count; position < head; ++position)
+        {
+            const Slot& slot = slots_[position % capacity_];
+            const uint64_t expected = position / capacity_ * 2 + 2;
+            if(slot.sequence.load(std::memory_order_acquire) != expected)
+                continue;
+
+            T value = slot.value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(slot.sequence.load(std::memory_order_relaxed) != expected)
+                continue;
+
+            values[copied++] = value;
+        }
+
+        return copied;
+    }
+
+    template<typename T>
+    inline size_t SeqlockRing<T>::GetCapacity() const
+    {
+        return capacity_;
+    }
+}
+
+#endif //HMI_SEQLOCK_RING_H
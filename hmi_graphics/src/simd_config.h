@@ -0,0 +1,8 @@
+#ifndef HMI_SIMD_CONFIG_H
+#define HMI_SIMD_CONFIG_H
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HMI_GRAPHICS_SSE2 1
+#endif
+
+#endif //HMI_SIMD_CONFIG_H
@@ -0,0 +1,223 @@
+#ifndef HMI_SLOT_MAP_H
+#define HMI_SLOT_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "types.h"
+
+namespace hmi_graphics
+{
+    // Values live densely in insertion order until a removal swaps the last value into the hole. Handles address
+    // a slot plus the generation it was issued for, so a handle outliving its value no longer resolves.
+    template<typename Value>
+    class SlotMap
+    {
+    public:
+        SlotMap();
+
+        ElementHandle Insert(const Value& value);
+
+        bool Remove(ElementHandle handle);
+
+        Value* Find(ElementHandle handle);
+
+        const Value* Find(ElementHandle handle) const;
+
+        // Position of a live handle's value in the dense array. Remove moves the last value into the freed position.
+        size_t GetDenseIndex(ElementHandle handle) const;
+
+        uint32_t GetSlotIndex(size_t denseIndex) const;
+
+        ElementHandle GetHandle(size_t denseIndex) const;
+
+        void Clear();
+
+        size_t GetSize() const;
+
+        // Upper bound of handle indices issued so far; usable to size arrays indexed by ElementHandle::index.
+        size_t GetSlotCount() const;
+
+        Value* begin();
+
+        Value* end();
+
+        const Value* begin() const;
+
+        const Value* end() const;
+
+    private:
+        static constexpr uint32_t NO_FREE_SLOT = UINT32_MAX;
+
+        struct Slot
+        {
+            uint32_t generation;
+            // Dense index of the value while the slot is live, next free slot otherwise.
+            uint32_t index;
+            bool live;
+        };
+
+        std::vector<Value> values_;
+        std::vector<uint32_t> valueSlots_;
+        std::vector<Slot> slots_;
+        uint32_t freeHead_;
+    };
+
+    template<typename Value>
+    inline SlotMap<Value>::SlotMap()
+        : freeHead_{NO_FREE_SLOT}
+    {
+    }
+
+    template<typename Value>
+    inline ElementHandle SlotMap<Value>::Insert(const Value& value)
+    {
+        uint32_t slotIndex;
+        if(freeHead_ != NO_FREE_SLOT)
+        {
+            slotIndex = freeHead_;
+            freeHead_ = slots_[slotIndex].index;
+        }
+        else
+        {
+            slotIndex = static_cast<uint32_t>(slots_.size());
+            slots_.push_back(Slot{1, 0, false});
+        }
+
+        Slot& slot = slots_[slotIndex];
+        slot.index = static_cast<uint32_t>(values_.size());
+        slot.live = true;
+        values_.push_back(value);
+        valueSlots_.push_back(slotIndex);
+        return ElementHandle{slotIndex, slot.generation};
+    }
+
+    template<typename Value>
+    inline bool SlotMap<Value>::Remove(ElementHandle handle)
+    {
+        if(Find(handle) == nullptr)
+            return false;
+
+        Slot& slot = slots_[handle.index];
+        const uint32_t hole = slot.index;
+        const uint32_t last = static_cast<uint32_t>(values_.size() - 1);
+        if(hole != last)
+        {
+            values_[hole] = std::move(values_[last]);
+            valueSlots_[hole] = valueSlots_[last];
+            slots_[valueSlots_[hole]].index = hole;
+        }
+
+        values_.pop_back();
+        valueSlots_.pop_back();
+
+        slot.live = false;
+        slot.generation += 1;
+        if(slot.generation == 0)
+        {
+            slot.generation = 1;
+        }
+
+        slot.index = freeHead_;
+        freeHead_ = handle.index;
+        return true;
+    }
+
+    template<typename Value>
+    inline Value* SlotMap<Value>::Find(ElementHandle handle)
+    {
+        if(handle.index >= slots_.size())
+            return nullptr;
+
+        const Slot& slot = slots_[handle.index];
+        if(!slot.live || slot.generation != handle.generation)
+            return nullptr;
+
+        return &values_[slot.index];
+    }
+
+    template<typename Value>
+    inline const Value* SlotMap<Value>::Find(ElementHandle handle) const
+    {
+        return const_cast<SlotMap*>(this)->Find(handle);
+    }
+
+    template<typename Value>
+    inline size_t SlotMap<Value>::GetDenseIndex(ElementHandle handle) const
+    {
+        return slots_[handle.index].index;
+    }
+
+    template<typename Value>
+    inline uint32_t SlotMap<Value>::GetSlotIndex(size_t denseIndex) const
+    {
+        return valueSlots_[denseIndex];
+    }
+
+    template<typename Value>
+    inline ElementHandle SlotMap<Value>::GetHandle(size_t denseIndex) const
+    {
+        const uint32_t slotIndex = valueSlots_[denseIndex];
+        return ElementHandle{slotIndex, slots_[slotIndex].generation};
+    }
+
+    template<typename Value>
+    inline void SlotMap<Value>::Clear()
+    {
+        for(uint32_t i = 0; i < valueSlots_.size(); ++i)
+        {
+            Slot& slot = slots_[valueSlots_[i]];
+            slot.live = false;
+            slot.generation += 1;
+            if(slot.generation == 0)
+            {
+                slot.generation = 1;
+            }
+
+            slot.index = freeHead_;
+            freeHead_ = valueSlots_[i];
+        }
+
+        values_.clear();
+        valueSlots_.clear();
+    }
+
+    template<typename Value>
+    inline size_t SlotMap<Value>::GetSize() const
+    {
+        return values_.size();
+    }
+
+    template<typename Value>
+    inline size_t SlotMap<Value>::GetSlotCount() const
+    {
+        return slots_.size();
+    }
+
+    template<typename Value>
+    inline Value* SlotMap<Value>::begin()
+    {
+        return values_.data();
+    }
+
+    template<typename Value>
+    inline Value* SlotMap<Value>::end()
+    {
+        return values_.data() + values_.size();
+    }
+
+    template<typename Value>
+    inline const Value* SlotMap<Value>::begin() const
+    {
+        return values_.data();
+    }
+
+    template<typename Value>
+    inline const Value* SlotMap<Value>::end() const
+    {
+        return values_.data() + values_.size();
+    }
+}
+
+#endif //HMI_SLOT_MAP_H
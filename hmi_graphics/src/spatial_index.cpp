@@ -0,0 +1,193 @@
+#include "spatial_index.h"
+
+#include <algorithm>
+#include "rect_util.h"
+
+namespace hmi_graphics
+{
+    SpatialIndex::SpatialIndex(int width, int height, int cellSize)
+        : width_{width}
+        , height_{height}
+        , cellSize_{cellSize}
+        , columns_{(width + cellSize - 1) / cellSize}
+        , rows_{(height + cellSize - 1) / cellSize}
+        , nextSequence_{}
+        , version_{1}
+    {
+        cells_.resize(static_cast<size_t>(columns_) * rows_);
+    }
+
+    void SpatialIndex::Insert(GraphicsElement* element, const Rect& bounds, int16_t zIndex)
+    {
+        Record record{};
+        record.bounds = bounds;
+        record.zIndex = zIndex;
+        record.sequence = ++nextSequence_;
+        record.cells = GetCellRange(bounds);
+        auto result = records_.emplace(element, record);
+        if(!result.second)
+            return;
+
+        InsertEntries(Entry{zIndex, record.sequence, element, bounds}, record.cells);
+    }
+
+    void SpatialIndex::Update(GraphicsElement* element, const Rect& bounds, int16_t zIndex)
+    {
+        auto it = records_.find(element);
+        if(it == records_.end())
+            return;
+
+        Record& record = it->second;
+        Rect cells = GetCellRange(bounds);
+        Entry entry{record.zIndex, record.sequence, element, record.bounds};
+        if(zIndex != record.zIndex || !RectsEqual(cells, record.cells))
+        {
+            RemoveEntries(entry, record.cells);
+            entry.zIndex = zIndex;
+            entry.bounds = bounds;
+            InsertEntries(entry, cells);
+        }
+        else
+        {
+            // Same cells and the same order; only the bounds stored alongside the entries change.
+            for(int row = cells.origin.y; row < RectBottom(cells); ++row)
+            {
+                for(int column = cells.origin.x; column < RectRight(cells); ++column)
+                {
+                    auto& cell = cells_[static_cast<size_t>(row) * columns_ + column];
+                    auto found = std::lower_bound(cell.begin(), cell.end(), entry, IsAbove);
+                    if(found != cell.end() && found->element == element)
+                    {
+                        found->bounds = bounds;
+                    }
+                }
+            }
+        }
+
+        record.bounds = bounds;
+        record.zIndex = zIndex;
+        record.cells = cells;
+    }
+
+    void SpatialIndex::Remove(GraphicsElement* element)
+    {
+        auto it = records_.find(element);
+        if(it == records_.end())
+            return;
+
+        const Record& record = it->second;
+        RemoveEntries(Entry{record.zIndex, record.sequence, element, record.bounds}, record.cells);
+        records_.erase(it);
+    }
+
+    GraphicsElement* SpatialIndex::Query(int32_t x, int32_t y, HitTestCursor* cursor) const
+    {
+        if(x < 0 || y < 0 || x >= width_ || y >= height_)
+            return nullptr;
+
+        auto& cell = cells_[static_cast<size_t>(y / cellSize_) * columns_ + x / cellSize_];
+        size_t position = 0;
+        if(cursor != nullptr && cursor->started && cursor->x == x && cursor->y == y)
+        {
+            if(cursor->version == version_)
+            {
+                position = cursor->position;
+            }
+            else
+            {
+                // The index changed since the previous step; resume below the last returned element's key.
+                Entry last{cursor->zIndex, cursor->sequence, nullptr, Rect{}};
+                position = std::upper_bound(cell.begin(), cell.end(), last, IsAbove) - cell.begin();
+            }
+        }
+
+        for(; position < cell.size(); ++position)
+        {
+            auto& entry = cell[position];
+            if(!RectContainsPoint(entry.bounds, x, y))
+                continue;
+
+            if(cursor != nullptr)
+            {
+                cursor->x = x;
+                cursor->y = y;
+                cursor->position = static_cast<uint32_t>(position + 1);
+                cursor->version = version_;
+                cursor->sequence = entry.sequence;
+                cursor->zIndex = entry.zIndex;
+                cursor->started = true;
+            }
+
+            return entry.element;
+        }
+
+        if(cursor != nullptr)
+        {
+            cursor->x = x;
+            cursor->y = y;
+            cursor->position = static_cast<uint32_t>(cell.size());
+            cursor->version = version_;
+            cursor->started = true;
+        }
+
+        return nullptr;
+    }
+
+    size_t SpatialIndex::GetElementCount() const
+    {
+        return records_.size();
+    }
+
+    bool SpatialIndex::IsAbove(const Entry& lhs, const Entry& rhs)
+    {
+        if(lhs.zIndex != rhs.zIndex)
+            return lhs.zIndex > rhs.zIndex;
+
+        return lhs.sequence > rhs.sequence;
+    }
+
+    Rect SpatialIndex::GetCellRange(const Rect& bounds) const
+    {
+        Rect visible = IntersectRects(bounds, MakeRect(0, 0, width_, height_));
+        if(IsEmptyRect(visible))
+            return Rect{};
+
+        int left = visible.origin.x / cellSize_;
+        int top = visible.origin.y / cellSize_;
+        int right = (RectRight(visible) - 1) / cellSize_ + 1;
+        int bottom = (RectBottom(visible) - 1) / cellSize_ + 1;
+        return MakeRect(left, top, right - left, bottom - top);
+    }
+
+    void SpatialIndex::InsertEntries(const Entry& entry, const Rect& cells)
+    {
+        for(int row = cells.origin.y; row < RectBottom(cells); ++row)
+        {
+            for(int column = cells.origin.x; column < RectRight(cells); ++column)
+            {
+                auto& cell = cells_[static_cast<size_t>(row) * columns_ + column];
+                cell.insert(std::upper_bound(cell.begin(), cell.end(), entry, IsAbove), entry);
+            }
+        }
+
+        ++version_;
+    }
+
+    void SpatialIndex::RemoveEntries(const Entry& entry, const Rect& cells)
+    {
+        for(int row = cells.origin.y; row < RectBottom(cells); ++row)
+        {
+            for(int column = cells.origin.x; column < RectRight(cells); ++column)
+            {
+                auto& cell = cells_[static_cast<size_t>(row) * columns_ + column];
+                auto found = std::lower_bound(cell.begin(), cell.end(), entry, IsAbove);
+                if(found != cell.end() && found->element == entry.element)
+                {
+                    cell.erase(found);
+                }
+            }
+        }
+
+        ++version_;
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef HMI_SPATIAL_INDEX_H
+#define HMI_SPATIAL_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "types.h"
+
+namespace hmi_graphics
+{
+    class GraphicsElement;
+
+    // Uniform grid over the screen. Every cell lists the elements overlapping it top-most first (higher z-index,
+    // then later insertion), so a point query is a scan of one short cell list.
+    class SpatialIndex
+    {
+    public:
+        SpatialIndex(int width, int height, int cellSize = 64);
+
+        void Insert(GraphicsElement* element, const Rect& bounds, int16_t zIndex);
+
+        void Update(GraphicsElement* element, const Rect& bounds, int16_t zIndex);
+
+        void Remove(GraphicsElement* element);
+
+        GraphicsElement* Query(int32_t x, int32_t y, HitTestCursor* cursor) const;
+
+        size_t GetElementCount() const;
+
+    private:
+        struct Entry
+        {
+            int16_t zIndex;
+            uint32_t sequence;
+            GraphicsElement* element;
+            Rect bounds;
+        };
+
+        struct Record
+        {
+            Rect bounds;
+            int16_t zIndex;
+            uint32_t sequence;
+            Rect cells;
+        };
+
+        static bool IsAbove(const Entry& lhs, const Entry& rhs);
+
+        Rect GetCellRange(const Rect& bounds) const;
+
+        void InsertEntries(const Entry& entry, const Rect& cells);
+
+        void RemoveEntries(const Entry& entry, const Rect& cells);
+
+        std::vector<std::vector<Entry>> cells_;
+        std::unordered_map<GraphicsElement*, Record> records_;
+        int width_;
+        int height_;
+        int cellSize_;
+        int columns_;
+        int rows_;
+        uint32_t nextSequence_;
+        uint32_t version_;
+    };
+}
+
+#endif //HMI_SPATIAL_INDEX_H
@@ -0,0 +1,336 @@
+#include "text_atlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include "blend.h"
+#include "rect_util.h"
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        constexpr int ATLAS_PADDING = 1;
+
+        struct CoveragePiece
+        {
+            Rect rect;
+            std::vector<uint8_t> coverage;
+        };
+
+        // Receives the glyph runs of IDWriteTextLayout::Draw and rasterizes them with DirectWrite's glyph run
+        // analysis, one coverage piece per run. Lives on the stack for a single Draw call, so it is not ref-counted.
+        class GlyphRunRasterizer: public IDWriteTextRenderer
+        {
+        public:
+            explicit GlyphRunRasterizer(IDWriteFactory* factory)
+                : factory_{factory}
+            {
+            }
+
+            const std::vector<CoveragePiece>& GetPieces() const
+            {
+                return pieces_;
+            }
+
+            HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+            {
+                if(riid == __uuidof(IUnknown) || riid == __uuidof(IDWritePixelSnapping) || riid == __uuidof(IDWriteTextRenderer))
+                {
+                    *object = static_cast<IDWriteTextRenderer*>(this);
+                    return S_OK;
+                }
+
+                *object = nullptr;
+                return E_NOINTERFACE;
+            }
+
+            ULONG STDMETHODCALLTYPE AddRef() override
+            {
+                return 1;
+            }
+
+            ULONG STDMETHODCALLTYPE Release() override
+            {
+                return 1;
+            }
+
+            HRESULT STDMETHODCALLTYPE IsPixelSnappingDisabled(void* clientDrawingContext, BOOL* isDisabled) override
+            {
+                *isDisabled = FALSE;
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE GetCurrentTransform(void* clientDrawingContext, DWRITE_MATRIX* transform) override
+            {
+                *transform = DWRITE_MATRIX{1.f, 0.f, 0.f, 1.f, 0.f, 0.f};
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE GetPixelsPerDip(void* clientDrawingContext, FLOAT* pixelsPerDip) override
+            {
+                *pixelsPerDip = 1.f;
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE DrawGlyphRun(void* clientDrawingContext, FLOAT baselineOriginX, FLOAT baselineOriginY,
+                DWRITE_MEASURING_MODE measuringMode, const DWRITE_GLYPH_RUN* glyphRun,
+                const DWRITE_GLYPH_RUN_DESCRIPTION* glyphRunDescription, IUnknown* clientDrawingEffect) override
+            {
+                ComPtr<IDWriteGlyphRunAnalysis> analysis;
+                HRESULT hr = factory_->CreateGlyphRunAnalysis(glyphRun, 1.f, nullptr, DWRITE_RENDERING_MODE_NATURAL, measuringMode,
+                    baselineOriginX, baselineOriginY, &analysis);
+                if(FAILED(hr))
+                    return hr;
+
+                RECT bounds{};
+                hr = analysis->GetAlphaTextureBounds(DWRITE_TEXTURE_CLEARTYPE_3x1, &bounds);
+                if(FAILED(hr) || bounds.right <= bounds.left || bounds.bottom <= bounds.top)
+                    return hr;
+
+                // The natural rendering mode only produces 3x1 subpixel textures; average them to grayscale coverage.
+                const size_t pixelCount = static_cast<size_t>(bounds.right - bounds.left) * (bounds.bottom - bounds.top);
+                subpixels_.resize(pixelCount * 3);
+                hr = analysis->CreateAlphaTexture(DWRITE_TEXTURE_CLEARTYPE_3x1, &bounds, subpixels_.data(),
+                    static_cast<UINT32>(subpixels_.size()));
+                if(FAILED(hr))
+                    return hr;
+
+                CoveragePiece piece{};
+                piece.rect = MakeRect(bounds.left, bounds.top, bounds.right - bounds.left, bounds.bottom - bounds.top);
+                piece.coverage.resize(pixelCount);
+                for(size_t i = 0; i < pixelCount; ++i)
+                {
+                    piece.coverage[i] = static_cast<uint8_t>((subpixels_[i * 3] + subpixels_[i * 3 + 1] + subpixels_[i * 3 + 2] + 1) / 3);
+                }
+
+                pieces_.push_back(std::move(piece));
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE DrawUnderline(void* clientDrawingContext, FLOAT baselineOriginX, FLOAT baselineOriginY,
+                const DWRITE_UNDERLINE* underline, IUnknown* clientDrawingEffect) override
+            {
+                AddLine(baselineOriginX, baselineOriginY + underline->offset, underline->width, underline->thickness);
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE DrawStrikethrough(void* clientDrawingContext, FLOAT baselineOriginX, FLOAT baselineOriginY,
+                const DWRITE_STRIKETHROUGH* strikethrough, IUnknown* clientDrawingEffect) override
+            {
+                AddLine(baselineOriginX, baselineOriginY + strikethrough->offset, strikethrough->width, strikethrough->thickness);
+                return S_OK;
+            }
+
+            HRESULT STDMETHODCALLTYPE DrawInlineObject(void* clientDrawingContext, FLOAT originX, FLOAT originY,
+                IDWriteInlineObject* inlineObject, BOOL isSideways, BOOL isRightToLeft, IUnknown* clientDrawingEffect) override
+            {
+                return S_OK;
+            }
+
+        private:
+            void AddLine(float x, float y, float width, float thickness)
+            {
+                const int left = static_cast<int>(std::floor(x));
+                const int top = static_cast<int>(std::floor(y));
+                const int right = static_cast<int>(std::ceil(x + width));
+                const int bottom = std::max(top + 1, static_cast<int>(std::ceil(y + thickness)));
+                if(right <= left)
+                    return;
+
+                CoveragePiece piece{};
+                piece.rect = MakeRect(left, top, right - left, bottom - top);
+                piece.coverage.assign(static_cast<size_t>(right - left) * (bottom - top), 255);
+                pieces_.push_back(std::move(piece));
+            }
+
+            IDWriteFactory* factory_;
+            std::vector<CoveragePiece> pieces_;
+            std::vector<BYTE> subpixels_;
+        };
+    }
+
+    TextAtlas::TextAtlas(TextCache* textCache, int pageSize, size_t maxPages)
+        : textCache_{textCache}
+        , allocator_{pageSize, pageSize, ATLAS_PADDING, maxPages > 0 ? maxPages : 1}
+        , pageSize_{pageSize}
+        , maxPages_{maxPages > 0 ? maxPages : 1}
+        , entries_{maxPages_ * pageSize * pageSize, [this](const TextLayoutKey&, Entry& entry)
+        {
+            if(!IsEmptyRect(entry.bounds))
+            {
+                allocator_.Free(entry.region);
+            }
+        }}
+    {
+    }
+
+    bool TextAtlas::Draw(const Surface& surface, const Rect& box, const wchar_t* text, uint32_t length,
+        const TextFormatDesc& desc, uint32_t argb)
+    {
+        if(surface.pixels == nullptr || IsEmptyRect(box) || (text == nullptr && length > 0))
+            return false;
+
+        TextLayoutKey key{text, length, desc, static_cast<float>(box.size.width), static_cast<float>(box.size.height)};
+        // A cached mask is copied out under the lock and blended after it, since another thread may evict it and reuse
+        // its atlas space meanwhile. Copying is a fraction of the cost of blending and keeps cached draws concurrent.
+        thread_local std::vector<uint8_t> cached;
+        bool found = false;
+        Rect bounds{};
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto* entry = entries_.Find(key);
+            if(entry != nullptr)
+            {
+                found = true;
+                bounds = entry->bounds;
+                if(!IsEmptyRect(bounds))
+                {
+                    cached.resize(static_cast<size_t>(bounds.size.width) * bounds.size.height);
+                    const uint8_t* page = pages_[entry->region.page].data();
+                    for(int y = 0; y < bounds.size.height; ++y)
+                    {
+                        std::copy_n(page + static_cast<size_t>(entry->region.rect.origin.y + y) * pageSize_
+                            + entry->region.rect.origin.x, bounds.size.width, cached.data() + static_cast<size_t>(y) * bounds.size.width);
+                    }
+                }
+            }
+        }
+
+        if(found)
+        {
+            if(!IsEmptyRect(bounds))
+            {
+                Blit(surface, box, bounds, cached.data(), bounds.size.width, argb);
+            }
+
+            return true;
+        }
+
+        // Shape and rasterize outside the lock; other threads keep blitting cached text meanwhile.
+        Mask mask{};
+        if(!Rasterize(key, desc, &mask))
+            return false;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Store(key, mask);
+        }
+
+        if(!IsEmptyRect(mask.bounds))
+        {
+            Blit(surface, box, mask.bounds, mask.coverage.data(), mask.bounds.size.width, argb);
+        }
+
+        return true;
+    }
+
+    void TextAtlas::GetStatistics(CacheStatistics* masks, AtlasStatistics* atlas)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(masks != nullptr)
+        {
+            *masks = entries_.GetStatistics();
+        }
+
+        if(atlas != nullptr)
+        {
+            *atlas = allocator_.GetStatistics();
+        }
+    }
+
+    bool TextAtlas::Rasterize(const TextLayoutKey& key, const TextFormatDesc& desc, Mask* mask)
+    {
+        ComPtr<IDWriteTextLayout> layout;
+        if(!textCache_->GetTextLayout(key.text.c_str(), static_cast<uint32_t>(key.text.size()), desc, key.maxWidth,
+            key.maxHeight, &layout))
+            return false;
+
+        GlyphRunRasterizer rasterizer{textCache_->GetFactory()};
+        if(FAILED(layout->Draw(nullptr, &rasterizer, 0.f, 0.f)))
+            return false;
+
+        const Rect box = MakeRect(0, 0, static_cast<int>(key.maxWidth), static_cast<int>(key.maxHeight));
+        mask->bounds = Rect{};
+        for(auto& piece: rasterizer.GetPieces())
+        {
+            mask->bounds = UnionRects(mask->bounds, IntersectRects(piece.rect, box));
+        }
+
+        if(IsEmptyRect(mask->bounds))
+            return true;
+
+        const Rect& bounds = mask->bounds;
+        mask->coverage.assign(static_cast<size_t>(bounds.size.width) * bounds.size.height, 0);
+        for(auto& piece: rasterizer.GetPieces())
+        {
+            const Rect clipped = IntersectRects(piece.rect, bounds);
+            for(int y = clipped.origin.y; y < RectBottom(clipped); ++y)
+            {
+                const uint8_t* src = piece.coverage.data() + static_cast<size_t>(y - piece.rect.origin.y) * piece.rect.size.width
+                    + (clipped.origin.x - piece.rect.origin.x);
+                uint8_t* dst = mask->coverage.data() + static_cast<size_t>(y - bounds.origin.y) * bounds.size.width
+                    + (clipped.origin.x - bounds.origin.x);
+                for(int x = 0; x < clipped.size.width; ++x)
+                {
+                    dst[x] = std::max(dst[x], src[x]);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool TextAtlas::Store(const TextLayoutKey& key, const Mask& mask)
+    {
+        // Another thread may have stored the same text while this one was rasterizing it.
+        if(entries_.FindUncounted(key) != nullptr)
+            return true;
+
+        if(IsEmptyRect(mask.bounds))
+        {
+            entries_.Insert(key, Entry{mask.bounds, AtlasRegion{}});
+            return true;
+        }
+
+        if(mask.bounds.size.width + ATLAS_PADDING * 2 > pageSize_ || mask.bounds.size.height + ATLAS_PADDING * 2 > pageSize_)
+            return false;
+
+        // The allocator opens no page past maxPages_: when they are full, make room, or leave the text uncached once
+        // nothing is left to evict.
+        AtlasRegion region{};
+        while(!allocator_.Allocate(mask.bounds.size.width, mask.bounds.size.height, &region))
+        {
+            if(!entries_.EvictLeastRecent())
+                return false;
+        }
+
+        while(pages_.size() <= region.page)
+        {
+            pages_.emplace_back(static_cast<size_t>(pageSize_) * pageSize_);
+        }
+
+        auto& page = pages_[region.page];
+        for(int y = 0; y < mask.bounds.size.height; ++y)
+        {
+            std::copy_n(mask.coverage.data() + static_cast<size_t>(y) * mask.bounds.size.width, mask.bounds.size.width,
+                page.data() + static_cast<size_t>(region.rect.origin.y + y) * pageSize_ + region.rect.origin.x);
+        }
+
+        entries_.Insert(key, Entry{mask.bounds, region}, static_cast<size_t>(RectArea(mask.bounds)));
+        return true;
+    }
+
+    void TextAtlas::Blit(const Surface& surface, const Rect& box, const Rect& bounds, const uint8_t* coverage, int stride,
+        uint32_t argb) const
+    {
+        const Rect target = MakeRect(box.origin.x + bounds.origin.x, box.origin.y + bounds.origin.y, bounds.size.width,
+            bounds.size.height);
+        const Rect clipped = IntersectRects(target, MakeRect(0, 0, surface.width, surface.height));
+        for(int y = clipped.origin.y; y < RectBottom(clipped); ++y)
+        {
+            const uint8_t* src = coverage + static_cast<size_t>(y - target.origin.y) * stride + (clipped.origin.x - target.origin.x);
+            BlendRowMask(surface.pixels + static_cast<size_t>(y) * surface.stride + clipped.origin.x, src, argb,
+                static_cast<size_t>(clipped.size.width));
+        }
+    }
+}
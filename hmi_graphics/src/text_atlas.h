@@ -0,0 +1,62 @@
+#ifndef HMI_TEXT_ATLAS_H
+#define HMI_TEXT_ATLAS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "atlas_allocator.h"
+#include "lru_cache.h"
+#include "resource_keys.h"
+#include "text_cache.h"
+
+namespace hmi_graphics
+{
+    // Coverage masks of laid-out text packed into 8-bit atlas pages for the software backend. The first draw of a
+    // text shapes it through the TextCache and rasterizes the glyph runs with DirectWrite; later draws of the same
+    // text, format and box only blend the cached mask. Pages are bounded and masks are evicted least recently used.
+    class TextAtlas
+    {
+    public:
+        TextAtlas(TextCache* textCache, int pageSize, size_t maxPages);
+
+        TextAtlas(const TextAtlas&) = delete;
+
+        // argb is premultiplied. Safe to call from element Render on any thread.
+        bool Draw(const Surface& surface, const Rect& box, const wchar_t* text, uint32_t length, const TextFormatDesc& desc,
+            uint32_t argb);
+
+        void GetStatistics(CacheStatistics* masks, AtlasStatistics* atlas);
+
+    private:
+        struct Mask
+        {
+            // Relative to the box origin; empty when the text has no visible pixels.
+            Rect bounds;
+            std::vector<uint8_t> coverage;
+        };
+
+        struct Entry
+        {
+            Rect bounds;
+            AtlasRegion region;
+        };
+
+        bool Rasterize(const TextLayoutKey& key, const TextFormatDesc& desc, Mask* mask);
+
+        bool Store(const TextLayoutKey& key, const Mask& mask);
+
+        void Blit(const Surface& surface, const Rect& box, const Rect& bounds, const uint8_t* coverage, int stride,
+            uint32_t argb) const;
+
+        TextCache* textCache_;
+        std::mutex mutex_;
+        AtlasAllocator allocator_;
+        std::vector<std::vector<uint8_t>> pages_;
+        int pageSize_;
+        size_t maxPages_;
+        LruCache<TextLayoutKey, Entry, TextLayoutKeyHash> entries_;
+    };
+}
+
+#endif //HMI_TEXT_ATLAS_H
@@ -0,0 +1,127 @@
+#include "text_cache.h"
+
+#include <stdexcept>
+
+#define STRINGIZE_DETAIL(x) #x
+#define STRINGIZE(x) STRINGIZE_DETAIL(x)
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        // DirectWrite does not report the size of a layout; this approximates the per-layout bookkeeping plus the
+        // glyph indices, advances, offsets and cluster map kept for each character.
+        constexpr size_t LAYOUT_BASE_COST = 1024;
+        constexpr size_t LAYOUT_CHARACTER_COST = 48;
+
+        size_t EstimateLayoutCost(const TextLayoutKey& key)
+        {
+            return LAYOUT_BASE_COST + key.text.size() * (LAYOUT_CHARACTER_COST + sizeof(wchar_t));
+        }
+    }
+
+    TextCache::TextCache(size_t formatCapacity, size_t layoutBudgetBytes)
+        : formats_{formatCapacity}
+        , layouts_{layoutBudgetBytes}
+    {
+        HRESULT hr = DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED, __uuidof(decltype(factory_)::InterfaceType), &factory_);
+        if(FAILED(hr))
+            throw std::runtime_error(__FILE__ "::" STRINGIZE(__LINE__) " DWriteCreateFactory");
+    }
+
+    IDWriteFactory* TextCache::GetFactory() const
+    {
+        return factory_.Get();
+    }
+
+    bool TextCache::GetTextFormat(const TextFormatDesc& desc, IDWriteTextFormat** textFormat)
+    {
+        if(textFormat == nullptr)
+        {
+            return false;
+        }
+
+        TextFormatKey key{desc};
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto* cached = formats_.Find(key);
+        if(cached == nullptr)
+        {
+            ComPtr<IDWriteTextFormat> format;
+            HRESULT hr = factory_->CreateTextFormat(key.fontFamily.c_str(), nullptr, desc.fontWeight, desc.fontStyle,
+                desc.fontStretch, desc.fontSize, L"", &format);
+            if(FAILED(hr))
+            {
+                return false;
+            }
+
+            format->SetTextAlignment(desc.textAlignment);
+            format->SetParagraphAlignment(desc.paragraphAlignment);
+            cached = &formats_.Insert(key, format);
+        }
+
+        *textFormat = cached->Get();
+        (*textFormat)->AddRef();
+        return true;
+    }
+
+    bool TextCache::GetTextLayout(const wchar_t* text, uint32_t length, const TextFormatDesc& desc, float maxWidth,
+        float maxHeight, IDWriteTextLayout** textLayout)
+    {
+        if(textLayout == nullptr || (text == nullptr && length > 0))
+        {
+            return false;
+        }
+
+        TextLayoutKey key{text, length, desc, maxWidth, maxHeight};
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto* cached = layouts_.Find(key);
+            if(cached != nullptr)
+            {
+                *textLayout = cached->Get();
+                (*textLayout)->AddRef();
+                return true;
+            }
+        }
+
+        // Shape outside the lock so a long string does not stall lookups from other threads.
+        ComPtr<IDWriteTextFormat> format;
+        if(!GetTextFormat(desc, &format))
+        {
+            return false;
+        }
+
+        ComPtr<IDWriteTextLayout> layout;
+        HRESULT hr = factory_->CreateTextLayout(key.text.c_str(), length, format.Get(), maxWidth, maxHeight, &layout);
+        if(FAILED(hr))
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Another thread may have shaped the same text meanwhile; keep its layout so callers share one.
+        auto* cached = layouts_.FindUncounted(key);
+        if(cached == nullptr)
+        {
+            cached = &layouts_.Insert(key, layout, EstimateLayoutCost(key));
+        }
+
+        *textLayout = cached->Get();
+        (*textLayout)->AddRef();
+        return true;
+    }
+
+    void TextCache::GetStatistics(CacheStatistics* textFormats, CacheStatistics* textLayouts)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(textFormats != nullptr)
+        {
+            *textFormats = formats_.GetStatistics();
+        }
+
+        if(textLayouts != nullptr)
+        {
+            *textLayouts = layouts_.GetStatistics();
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef HMI_TEXT_CACHE_H
+#define HMI_TEXT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <dwrite.h>
+#include "comptr.h"
+#include "lru_cache.h"
+#include "resource_keys.h"
+
+namespace hmi_graphics
+{
+    // DirectWrite factory with thread-safe caches of text formats and shaped text layouts. Layouts are keyed by
+    // text, format and layout box, shared between all callers, and evicted by an estimate of their memory use.
+    class TextCache
+    {
+    public:
+        TextCache(size_t formatCapacity, size_t layoutBudgetBytes);
+
+        TextCache(const TextCache&) = delete;
+
+        IDWriteFactory* GetFactory() const;
+
+        bool GetTextFormat(const TextFormatDesc& desc, IDWriteTextFormat** textFormat);
+
+        bool GetTextLayout(const wchar_t* text, uint32_t length, const TextFormatDesc& desc, float maxWidth, float maxHeight,
+            IDWriteTextLayout** textLayout);
+
+        void GetStatistics(CacheStatistics* textFormats, CacheStatistics* textLayouts);
+
+    private:
+        ComPtr<IDWriteFactory> factory_;
+        std::mutex mutex_;
+        LruCache<TextFormatKey, ComPtr<IDWriteTextFormat>, TextFormatKeyHash> formats_;
+        LruCache<TextLayoutKey, ComPtr<IDWriteTextLayout>, TextLayoutKeyHash> layouts_;
+    };
+}
+
+#endif //HMI_TEXT_CACHE_H
@@ -0,0 +1,167 @@
+#include "thread_pool.h"
+
+namespace hmi_graphics
+{
+    namespace
+    {
+        thread_local size_t currentThreadIndex = 0;
+        thread_local bool insideTask = false;
+    }
+
+    ThreadPool::ThreadPool(size_t workerCount)
+        : body_{}
+        , remaining_{0}
+        , generation_{}
+        , stopping_{false}
+    {
+        for(size_t i = 0; i <= workerCount; ++i)
+        {
+            queues_.emplace_back(new TaskQueue{});
+        }
+
+        for(size_t i = 1; i <= workerCount; ++i)
+        {
+            workers_.emplace_back(&ThreadPool::WorkerMain, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            stopping_ = true;
+        }
+
+        wakeCondition_.notify_all();
+        for(auto& worker: workers_)
+        {
+            worker.join();
+        }
+    }
+
+    size_t ThreadPool::GetThreadCount() const
+    {
+        return queues_.size();
+    }
+
+    void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body)
+    {
+        if(count == 0)
+            return;
+
+        if(workers_.empty() || count == 1 || insideTask)
+        {
+            for(size_t i = 0; i < count; ++i)
+            {
+                body(i);
+            }
+
+            return;
+        }
+
+        std::lock_guard<std::mutex> jobLock(jobMutex_);
+        body_ = &body;
+        remaining_.store(count);
+        for(size_t i = 0; i < count; ++i)
+        {
+            auto& queue = *queues_[i % queues_.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(i);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            ++generation_;
+        }
+
+        wakeCondition_.notify_all();
+        RunTasks(0);
+
+        std::unique_lock<std::mutex> lock(doneMutex_);
+        doneCondition_.wait(lock, [this]()
+        {
+            return remaining_.load() == 0;
+        });
+
+        body_ = nullptr;
+    }
+
+    size_t ThreadPool::GetCurrentThreadIndex()
+    {
+        return currentThreadIndex;
+    }
+
+    size_t ThreadPool::GetDefaultWorkerCount()
+    {
+        const unsigned int cores = std::thread::hardware_concurrency();
+        return cores > 1 ? cores - 1 : 0;
+    }
+
+    void ThreadPool::WorkerMain(size_t threadIndex)
+    {
+        currentThreadIndex = threadIndex;
+        uint64_t seenGeneration = 0;
+        while(true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex_);
+                wakeCondition_.wait(lock, [&]()
+                {
+                    return stopping_ || generation_ != seenGeneration;
+                });
+
+                if(stopping_)
+                    return;
+
+                seenGeneration = generation_;
+            }
+
+            RunTasks(threadIndex);
+        }
+    }
+
+    void ThreadPool::RunTasks(size_t threadIndex)
+    {
+        insideTask = true;
+        size_t task;
+        while(PopTask(threadIndex, &task))
+        {
+            (*body_)(task);
+            if(remaining_.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> lock(doneMutex_);
+                doneCondition_.notify_all();
+            }
+        }
+
+        insideTask = false;
+    }
+
+    bool ThreadPool::PopTask(size_t threadIndex, size_t* task)
+    {
+        {
+            auto& own = *queues_[threadIndex];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if(!own.tasks.empty())
+            {
+                *task = own.tasks.back();
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+
+        for(size_t i = 1; i < queues_.size(); ++i)
+        {
+            auto& victim = *queues_[(threadIndex + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if(!victim.tasks.empty())
+            {
+                *task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef HMI_THREAD_POOL_H
+#define HMI_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hmi_graphics
+{
+    // Fork-join pool for ParallelFor. Every participating thread owns a task queue: it pops from the back of its
+    // own queue and steals from the front of the others once it runs dry. The thread calling ParallelFor takes part
+    // as thread index 0 and returns when all tasks finished.
+    class ThreadPool
+    {
+    public:
+        // workerCount threads are started in addition to the calling thread; 0 runs everything inline.
+        explicit ThreadPool(size_t workerCount);
+
+        ThreadPool(const ThreadPool&) = delete;
+
+        ~ThreadPool();
+
+        // Number of threads that may run tasks, including the caller of ParallelFor.
+        size_t GetThreadCount() const;
+
+        // Calls body(i) for every i in [0, count). Nested calls from inside a task run inline.
+        void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+        // Index of the calling thread within the pool: 1..GetThreadCount()-1 on workers, 0 anywhere else.
+        static size_t GetCurrentThreadIndex();
+
+        static size_t GetDefaultWorkerCount();
+
+    private:
+        struct TaskQueue
+        {
+            std::mutex mutex;
+            std::deque<size_t> tasks;
+        };
+
+        void WorkerMain(size_t threadIndex);
+
+        void RunTasks(size_t threadIndex);
+
+        bool PopTask(size_t threadIndex, size_t* task);
+
+        std::vector<std::unique_ptr<TaskQueue>> queues_;
+        std::vector<std::thread> workers_;
+        std::mutex jobMutex_;
+        const std::function<void(size_t)>* body_;
+        std::atomic<size_t> remaining_;
+        std::mutex wakeMutex_;
+        std::condition_variable wakeCondition_;
+        uint64_t generation_;
+        bool stopping_;
+        std::mutex doneMutex_;
+        std::condition_variable doneCondition_;
+    };
+}
+
+#endif //HMI_THREAD_POOL_H
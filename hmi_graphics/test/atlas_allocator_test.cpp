@@ -0,0 +1,247 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "atlas_allocator.h"
+#include "rect_util.h"
+#include "test.h"
+
+namespace hmi_graphics
+{
+    namespace test
+    {
+        namespace
+        {
+            constexpr int PAGE_SIZE = 64;
+            constexpr int RANDOM_STEPS = 2000;
+
+            uint64_t PaddedArea(const AtlasRegion& region, int padding)
+            {
+                return static_cast<uint64_t>(region.rect.size.width + padding * 2) * (region.rect.size.height + padding * 2);
+            }
+
+            Rect PaddedRect(const AtlasRegion& region, int padding)
+            {
+                return MakeRect(region.rect.origin.x - padding, region.rect.origin.y - padding,
+                    region.rect.size.width + padding * 2, region.rect.size.height + padding * 2);
+            }
+
+            void TestRoundTrip()
+            {
+                AtlasAllocator allocator{PAGE_SIZE, PAGE_SIZE, 0};
+                AtlasRegion region{};
+                HMI_CHECK(allocator.Allocate(10, 12, &region));
+                HMI_CHECK_EQUAL(region.page, 0u);
+                HMI_CHECK(RectsEqual(region.rect, MakeRect(0, 0, 10, 12)));
+
+                AtlasStatistics statistics = allocator.GetStatistics();
+                HMI_CHECK_EQUAL(statistics.pageCount, 1u);
+                HMI_CHECK_EQUAL(statistics.allocationCount, 1u);
+                HMI_CHECK_EQUAL(statistics.usedArea, 120u);
+                HMI_CHECK_EQUAL(statistics.reservedArea, static_cast<uint64_t>(PAGE_SIZE) * 16);
+                HMI_CHECK_EQUAL(statistics.pageArea, static_cast<uint64_t>(PAGE_SIZE) * PAGE_SIZE);
+
+                // Freeing the last region returns its shelf; the page itself stays.
+                allocator.Free(region);
+                statistics = allocator.GetStatistics();
+                HMI_CHECK_EQUAL(statistics.pageCount, 1u);
+                HMI_CHECK_EQUAL(statistics.allocationCount, 0u);
+                HMI_CHECK_EQUAL(statistics.usedArea, 0u);
+                HMI_CHECK_EQUAL(statistics.reservedArea, 0u);
+
+                AtlasRegion again{};
+                HMI_CHECK(allocator.Allocate(10, 12, &again));
+                HMI_CHECK_EQUAL(again.page, 0u);
+                HMI_CHECK(RectsEqual(again.rect, region.rect));
+
+                // Freeing twice or a page that does not exist changes nothing.
+                allocator.Free(again);
+                allocator.Free(again);
+                allocator.Free(AtlasRegion{7, again.rect});
+                statistics = allocator.GetStatistics();
+                HMI_CHECK_EQUAL(statistics.allocationCount, 0u);
+                HMI_CHECK_EQUAL(statistics.usedArea, 0u);
+            }
+
+            void TestPadding()
+            {
+                AtlasAllocator allocator{PAGE_SIZE, PAGE_SIZE, 2};
+                AtlasRegion first{};
+                AtlasRegion second{};
+                HMI_CHECK(allocator.Allocate(10, 6, &first));
+                HMI_CHECK(allocator.Allocate(10, 6, &second));
+                HMI_CHECK(RectsEqual(first.rect, MakeRect(2, 2, 10, 6)));
+                HMI_CHECK(RectsEqual(second.rect, MakeRect(16, 2, 10, 6)));
+
+                // usedArea counts the padding around each region.
+                AtlasStatistics statistics = allocator.GetStatistics();
+                HMI_CHECK_EQUAL(statistics.usedArea, 2 * PaddedArea(first, 2));
+                HMI_CHECK_EQUAL(statistics.reservedArea, static_cast<uint64_t>(PAGE_SIZE) * 16);
+
+                allocator.Free(first);
+                HMI_CHECK_EQUAL(allocator.GetStatistics().usedArea, PaddedArea(second, 2));
+                allocator.Free(second);
+                HMI_CHECK_EQUAL(allocator.GetStatistics().usedArea, 0u);
+
+                // The padded size has to fit the page.
+                AtlasRegion region{};
+                HMI_CHECK(allocator.Allocate(PAGE_SIZE - 4, PAGE_SIZE - 4, &region));
+                HMI_CHECK(!allocator.Allocate(PAGE_SIZE - 3, 1, &region));
+            }
+
+            void TestShelfReuse()
+            {
+                AtlasAllocator allocator{PAGE_SIZE * 2, PAGE_SIZE * 2, 1};
+                AtlasRegion a{};
+                AtlasRegion b{};
+                AtlasRegion c{};
+                HMI_CHECK(allocator.Allocate(20, 10, &a));
+                HMI_CHECK(allocator.Allocate(20, 10, &b));
+                HMI_CHECK(allocator.Allocate(20, 10, &c));
+                HMI_CHECK_EQUAL(a.rect.origin.y, b.rect.origin.y);
+                HMI_CHECK_EQUAL(b.rect.origin.y, c.rect.origin.y);
+                const uint64_t reserved = allocator.GetStatistics().reservedArea;
+
+                // A freed span takes the next region of its size instead of a new shelf.
+                allocator.Free(a);
+                AtlasRegion reused{};
+                HMI_CHECK(allocator.Allocate(20, 10, &reused));
+                HMI_CHECK(RectsEqual(reused.rect, a.rect));
+                HMI_CHECK_EQUAL(allocator.GetStatistics().reservedArea, reserved);
+
+                // Neighbouring free spans coalesce, so a wider region fits where two narrow ones were.
+                allocator.Free(reused);
+                allocator.Free(b);
+                AtlasRegion wide{};
+                HMI_CHECK(allocator.Allocate(40, 10, &wide));
+                HMI_CHECK(RectsEqual(wide.rect, MakeRect(1, a.rect.origin.y, 40, 10)));
+                HMI_CHECK_EQUAL(allocator.GetStatistics().reservedArea, reserved);
+
+                // A shelf much taller than the region is left alone while the page has room for a better one.
+                AtlasRegion low{};
+                HMI_CHECK(allocator.Allocate(4, 2, &low));
+                HMI_CHECK(low.rect.origin.y > a.rect.origin.y);
+            }
+
+            void TestFullPage()
+            {
+                AtlasAllocator allocator{PAGE_SIZE, PAGE_SIZE, 0};
+                std::vector<AtlasRegion> regions(16);
+                for(auto& region: regions)
+                {
+                    HMI_CHECK(allocator.Allocate(16, 16, &region));
+                    HMI_CHECK_EQUAL(region.page, 0u);
+                }
+
+                AtlasStatistics statistics = allocator.GetStatistics();
+                HMI_CHECK_EQUAL(statistics.usedArea, statistics.pageArea);
+                HMI_CHECK_EQUAL(statistics.fragmentation, 0.f);
+
+                // A full page does not fail the allocation; it opens the next page.
+                AtlasRegion overflow{};
+                HMI_CHECK(allocator.Allocate(16, 16, &overflow));
+                HMI_CHECK_EQUAL(overflow.page, 1u);
+                HMI_CHECK(RectsEqual(overflow.rect, MakeRect(0, 0, 16, 16)));
+
+                allocator.Free(regions[5]);
+                AtlasRegion refill{};
+                HMI_CHECK(allocator.Allocate(16, 16, &refill));
+                HMI_CHECK_EQUAL(refill.page, 0u);
+                HMI_CHECK(RectsEqual(refill.rect, regions[5].rect));
+
+                // Regions larger than a page and invalid sizes fail without touching the allocator.
+                statistics = allocator.GetStatistics();
+                AtlasRegion failed{3, MakeRect(1, 2, 3, 4)};
+                HMI_CHECK(!allocator.Allocate(PAGE_SIZE + 1, 1, &failed));
+                HMI_CHECK(!allocator.Allocate(1, PAGE_SIZE + 1, &failed));
+                HMI_CHECK(!allocator.Allocate(0, 1, &failed));
+                HMI_CHECK(!allocator.Allocate(1, 1, nullptr));
+                HMI_CHECK_EQUAL(failed.page, 3u);
+                HMI_CHECK(RectsEqual(failed.rect, MakeRect(1, 2, 3, 4)));
+                HMI_CHECK_EQUAL(allocator.GetPageCount(), 2u);
+                HMI_CHECK_EQUAL(allocator.GetStatistics().allocationCount, statistics.allocationCount);
+                HMI_CHECK_EQUAL(allocator.GetStatistics().usedArea, statistics.usedArea);
+            }
+
+            void TestPageLimit()
+            {
+                AtlasAllocator allocator{PAGE_SIZE, PAGE_SIZE, 0, 1};
+                AtlasRegion whole{};
+                HMI_CHECK(allocator.Allocate(PAGE_SIZE, PAGE_SIZE, &whole));
+
+                // No page is opened past the limit, so a failed allocation leaves no empty page in the statistics.
+                AtlasRegion region{};
+                HMI_CHECK(!allocator.Allocate(1, 1, &region));
+                const AtlasStatistics statistics = allocator.GetStatistics();
+                HMI_CHECK_EQUAL(statistics.pageCount, 1u);
+                HMI_CHECK_EQUAL(statistics.pageArea, static_cast<uint64_t>(PAGE_SIZE) * PAGE_SIZE);
+
+                allocator.Free(whole);
+                HMI_CHECK(allocator.Allocate(1, 1, &region));
+                HMI_CHECK_EQUAL(region.page, 0u);
+            }
+
+            // Live regions never overlap, padding included, and usedArea always matches them.
+            void TestRandomAllocations()
+            {
+                constexpr int padding = 1;
+                std::mt19937 random{1};
+                std::uniform_int_distribution<int> extent{1, PAGE_SIZE / 4};
+                std::uniform_int_distribution<int> action{0, 2};
+                AtlasAllocator allocator{PAGE_SIZE, PAGE_SIZE, padding};
+                std::vector<AtlasRegion> live;
+                for(int step = 0; step < RANDOM_STEPS; ++step)
+                {
+                    if(!live.empty() && action(random) == 0)
+                    {
+                        const size_t index = std::uniform_int_distribution<size_t>{0, live.size() - 1}(random);
+                        allocator.Free(live[index]);
+                        live[index] = live.back();
+                        live.pop_back();
+                    }
+                    else
+                    {
+                        AtlasRegion region{};
+                        HMI_CHECK(allocator.Allocate(extent(random), extent(random), &region));
+                        live.push_back(region);
+                    }
+
+                    uint64_t usedArea = 0;
+                    for(size_t i = 0; i < live.size(); ++i)
+                    {
+                        const Rect padded = PaddedRect(live[i], padding);
+                        usedArea += PaddedArea(live[i], padding);
+                        if(!RectContains(MakeRect(0, 0, PAGE_SIZE, PAGE_SIZE), padded))
+                        {
+                            ReportFailure(__FILE__, __LINE__, "region outside its page");
+                            return;
+                        }
+
+                        for(size_t j = i + 1; j < live.size(); ++j)
+                        {
+                            if(live[i].page == live[j].page && RectsIntersect(padded, PaddedRect(live[j], padding)))
+                            {
+                                ReportFailure(__FILE__, __LINE__, "regions overlap");
+                                return;
+                            }
+                        }
+                    }
+
+                    const AtlasStatistics statistics = allocator.GetStatistics();
+                    HMI_CHECK_EQUAL(statistics.allocationCount, live.size());
+                    HMI_CHECK_EQUAL(statistics.usedArea, usedArea);
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    hmi_graphics::test::TestRoundTrip();
+    hmi_graphics::test::TestPadding();
+    hmi_graphics::test::TestShelfReuse();
+    hmi_graphics::test::TestFullPage();
+    hmi_graphics::test::TestPageLimit();
+    hmi_graphics::test::TestRandomAllocations();
+    return hmi_graphics::test::Finish("atlas_allocator_test");
+}
@@ -0,0 +1,169 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "blend.h"
+#include "test.h"
+
+namespace hmi_graphics
+{
+    namespace test
+    {
+        namespace
+        {
+            // Covers the SIMD loop, its scalar tail and rows shorter than one vector.
+            constexpr size_t MAX_WIDTH = 37;
+            constexpr int ROUNDS = 200;
+
+            uint32_t MakePremultiplied(std::mt19937* random)
+            {
+                const uint32_t alpha = (*random)() & 0xFF;
+                uint32_t pixel = alpha << 24;
+                for(int shift = 0; shift < 24; shift += 8)
+                {
+                    pixel |= (alpha == 0 ? 0 : (*random)() % (alpha + 1)) << shift;
+                }
+
+                return pixel;
+            }
+
+            // Mostly blended pixels, with runs of opaque and fully transparent ones for the SIMD shortcuts.
+            std::vector<uint32_t> MakeSource(std::mt19937* random, size_t width)
+            {
+                std::vector<uint32_t> pixels(width);
+                const uint32_t kind = (*random)() % 4;
+                for(auto& pixel: pixels)
+                {
+                    pixel = MakePremultiplied(random);
+                    if(kind == 1)
+                    {
+                        pixel |= 0xFF000000u;
+                    }
+                    else if(kind == 2)
+                    {
+                        pixel = 0;
+                    }
+                }
+
+                return pixels;
+            }
+
+            std::vector<uint32_t> MakeDestination(std::mt19937* random, size_t width)
+            {
+                std::vector<uint32_t> pixels(width);
+                for(auto& pixel: pixels)
+                {
+                    pixel = MakePremultiplied(random);
+                }
+
+                return pixels;
+            }
+
+            void TestKnownValues()
+            {
+                // Half-transparent black over white, and an opaque source replacing the destination.
+                uint32_t dst[2] = {0xFFFFFFFFu, 0xFF102030u};
+                const uint32_t src[2] = {0x80000000u, 0xFF405060u};
+                BlendRowSourceOver(dst, src, 2);
+                HMI_CHECK_EQUAL(dst[0], 0xFF7F7F7Fu);
+                HMI_CHECK_EQUAL(dst[1], 0xFF405060u);
+
+                uint32_t masked[3] = {0xFF000000u, 0xFF000000u, 0xFF000000u};
+                const uint8_t mask[3] = {0, 255, 128};
+                BlendRowMask(masked, mask, 0xFFFFFFFFu, 3);
+                HMI_CHECK_EQUAL(masked[0], 0xFF000000u);
+                HMI_CHECK_EQUAL(masked[1], 0xFFFFFFFFu);
+                HMI_CHECK_EQUAL(masked[2], 0xFF808080u);
+            }
+
+            void TestSourceOver()
+            {
+                std::mt19937 random{1};
+                for(int round = 0; round < ROUNDS; ++round)
+                {
+                    for(size_t width = 0; width <= MAX_WIDTH; ++width)
+                    {
+                        // Offset by one pixel so the rows are not 16-byte aligned.
+                        const std::vector<uint32_t> src = MakeSource(&random, width + 1);
+                        std::vector<uint32_t> expected = MakeDestination(&random, width + 1);
+                        std::vector<uint32_t> actual = expected;
+                        BlendRowSourceOverScalar(expected.data() + 1, src.data() + 1, width);
+                        BlendRowSourceOver(actual.data() + 1, src.data() + 1, width);
+                        if(actual != expected)
+                        {
+                            ReportFailure(__FILE__, __LINE__, "BlendRowSourceOver differs from the scalar kernel");
+                            return;
+                        }
+                    }
+                }
+            }
+
+            void TestMask()
+            {
+                std::mt19937 random{2};
+                for(int round = 0; round < ROUNDS; ++round)
+                {
+                    const uint32_t color = MakePremultiplied(&random);
+                    for(size_t width = 0; width <= MAX_WIDTH; ++width)
+                    {
+                        std::vector<uint8_t> mask(width + 1);
+                        const uint32_t kind = random() % 4;
+                        for(auto& coverage: mask)
+                        {
+                            coverage = kind == 0 ? 0 : kind == 1 ? 255 : static_cast<uint8_t>(random());
+                        }
+
+                        std::vector<uint32_t> expected = MakeDestination(&random, width + 1);
+                        std::vector<uint32_t> actual = expected;
+                        BlendRowMaskScalar(expected.data() + 1, mask.data() + 1, color, width);
+                        BlendRowMask(actual.data() + 1, mask.data() + 1, color, width);
+                        if(actual != expected)
+                        {
+                            ReportFailure(__FILE__, __LINE__, "BlendRowMask differs from the scalar kernel");
+                            return;
+                        }
+                    }
+                }
+
+                // Every coverage value against a few colors.
+                const uint32_t colors[] = {0xFFFFFFFFu, 0x80402010u, 0x01010101u, 0xFF0000FFu};
+                std::vector<uint8_t> mask(256);
+                for(size_t i = 0; i < mask.size(); ++i)
+                {
+                    mask[i] = static_cast<uint8_t>(i);
+                }
+
+                for(auto color: colors)
+                {
+                    std::vector<uint32_t> expected = MakeDestination(&random, mask.size());
+                    std::vector<uint32_t> actual = expected;
+                    BlendRowMaskScalar(expected.data(), mask.data(), color, mask.size());
+                    BlendRowMask(actual.data(), mask.data(), color, mask.size());
+                    HMI_CHECK(actual == expected);
+                }
+            }
+
+            void TestFill()
+            {
+                for(size_t width = 0; width <= MAX_WIDTH; ++width)
+                {
+                    // The pixels around the row stay untouched.
+                    std::vector<uint32_t> expected(width + 2, 0x12345678u);
+                    std::vector<uint32_t> actual = expected;
+                    FillRowScalar(expected.data() + 1, 0xDEADBEEFu, width);
+                    FillRow(actual.data() + 1, 0xDEADBEEFu, width);
+                    HMI_CHECK(actual == expected);
+                    HMI_CHECK_EQUAL(actual.back(), 0x12345678u);
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    hmi_graphics::test::TestKnownValues();
+    hmi_graphics::test::TestSourceOver();
+    hmi_graphics::test::TestMask();
+    hmi_graphics::test::TestFill();
+    return hmi_graphics::test::Finish("blend_test");
+}
@@ -0,0 +1,167 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "composite_batch.h"
+#include "test.h"
+
+namespace hmi_graphics
+{
+    namespace test
+    {
+        namespace
+        {
+            constexpr int RANDOM_ROUNDS = 100;
+            constexpr int RANDOM_QUADS = 200;
+
+            // The opacity field tags each quad so the tests can find it among the instances.
+            CompositeQuad MakeQuad(float left, float top, float size, float tag)
+            {
+                return CompositeQuad{left, top, left + size, top + size, 0.f, 0.f, 1.f, 1.f, 1.f, 0.f, 0.f, 1.f, tag, {}};
+            }
+
+            std::vector<float> GetTags(const CompositeBatchBuilder& builder)
+            {
+                std::vector<float> tags;
+                for(auto& instance: builder.GetInstances())
+                {
+                    tags.push_back(instance.opacity);
+                }
+
+                return tags;
+            }
+
+            bool Overlap(const CompositeQuad& lhs, const CompositeQuad& rhs)
+            {
+                return lhs.destLeft < rhs.destRight && rhs.destLeft < lhs.destRight && lhs.destTop < rhs.destBottom
+                    && rhs.destTop < lhs.destBottom;
+            }
+
+            void TestOverlappingKeepOrder()
+            {
+                // Same z-index, overlapping: the middle quad of another texture has to stay between the two others.
+                CompositeBatchBuilder builder;
+                builder.BeginPass(Rect{{0, 0}, {100, 100}});
+                builder.Add(0, 0, MakeQuad(0, 0, 20, 1));
+                builder.Add(1, 0, MakeQuad(10, 10, 20, 2));
+                builder.Add(0, 0, MakeQuad(15, 15, 20, 3));
+                builder.EndPass();
+                HMI_CHECK_EQUAL(builder.GetBatches().size(), 3u);
+                HMI_CHECK(GetTags(builder) == (std::vector<float>{1, 2, 3}));
+            }
+
+            void TestDisjointMerge()
+            {
+                CompositeBatchBuilder builder;
+                builder.BeginPass(Rect{{0, 0}, {100, 100}});
+                builder.Add(0, 0, MakeQuad(0, 0, 10, 1));
+                builder.Add(1, 0, MakeQuad(20, 0, 10, 2));
+                builder.Add(0, 1, MakeQuad(40, 0, 10, 3));
+                // Touching edges do not overlap.
+                builder.Add(1, 1, MakeQuad(30, 0, 10, 4));
+                builder.EndPass();
+
+                const auto& batches = builder.GetBatches();
+                HMI_CHECK_EQUAL(batches.size(), 2u);
+                HMI_CHECK(GetTags(builder) == (std::vector<float>{1, 3, 2, 4}));
+                if(batches.size() == 2)
+                {
+                    HMI_CHECK_EQUAL(batches[0].texture, 0u);
+                    HMI_CHECK_EQUAL(batches[0].firstInstance, 0u);
+                    HMI_CHECK_EQUAL(batches[0].instanceCount, 2u);
+                    HMI_CHECK_EQUAL(batches[1].texture, 1u);
+                    HMI_CHECK_EQUAL(batches[1].firstInstance, 2u);
+                    HMI_CHECK_EQUAL(batches[1].instanceCount, 2u);
+                }
+            }
+
+            void TestTransformedBounds()
+            {
+                // Rotated by 45 degrees, the second quad reaches into the first even though its rect does not.
+                CompositeQuad rotated = MakeQuad(21, 0, 20, 2);
+                rotated.transform11 = .7071f;
+                rotated.transform12 = .7071f;
+                rotated.transform21 = -.7071f;
+                rotated.transform22 = .7071f;
+                CompositeBatchBuilder builder;
+                builder.BeginPass(Rect{{0, 0}, {100, 100}});
+                builder.Add(0, 0, MakeQuad(0, 0, 20, 1));
+                builder.Add(1, 0, rotated);
+                builder.Add(0, 0, MakeQuad(22, 0, 20, 3));
+                builder.EndPass();
+                HMI_CHECK_EQUAL(builder.GetBatches().size(), 3u);
+            }
+
+            void TestZIndexAndPasses()
+            {
+                // Added out of z-index order: sorted by z-index, insertion order among equal ones.
+                CompositeBatchBuilder builder;
+                builder.BeginPass(Rect{{0, 0}, {100, 100}});
+                builder.Add(0, 2, MakeQuad(0, 0, 10, 1));
+                builder.Add(1, 1, MakeQuad(0, 0, 10, 2));
+                builder.Add(2, 1, MakeQuad(0, 0, 10, 3));
+                builder.EndPass();
+                builder.BeginPass(Rect{{0, 0}, {50, 50}});
+                builder.Add(0, 0, MakeQuad(0, 0, 10, 4));
+                builder.EndPass();
+                HMI_CHECK(GetTags(builder) == (std::vector<float>{2, 3, 1, 4}));
+                HMI_CHECK_EQUAL(builder.GetPasses().size(), 2u);
+                HMI_CHECK_EQUAL(builder.GetBatches().size(), 4u);
+                HMI_CHECK(!builder.GetBatches().empty() && builder.GetBatches().back().pass == 1u);
+            }
+
+            // Any two overlapping quads are drawn in the order they were added, whatever merged.
+            void TestRandomOrder()
+            {
+                std::mt19937 random{1};
+                std::uniform_int_distribution<int> position{0, 400};
+                std::uniform_int_distribution<int> size{4, 40};
+                std::uniform_int_distribution<uint32_t> texture{0, 3};
+                CompositeBatchBuilder builder;
+                for(int round = 0; round < RANDOM_ROUNDS; ++round)
+                {
+                    std::vector<CompositeQuad> quads;
+                    builder.Reset();
+                    builder.BeginPass(Rect{{0, 0}, {440, 440}});
+                    for(int i = 0; i < RANDOM_QUADS; ++i)
+                    {
+                        quads.push_back(MakeQuad(static_cast<float>(position(random)), static_cast<float>(position(random)),
+                            static_cast<float>(size(random)), static_cast<float>(i)));
+                        builder.Add(texture(random), 0, quads.back());
+                    }
+
+                    builder.EndPass();
+                    const std::vector<float> tags = GetTags(builder);
+                    std::vector<size_t> drawn(quads.size());
+                    for(size_t i = 0; i < tags.size(); ++i)
+                    {
+                        drawn[static_cast<size_t>(tags[i])] = i;
+                    }
+
+                    HMI_CHECK_EQUAL(tags.size(), quads.size());
+                    HMI_CHECK(builder.GetBatches().size() < quads.size());
+                    for(size_t i = 0; i < quads.size(); ++i)
+                    {
+                        for(size_t j = i + 1; j < quads.size(); ++j)
+                        {
+                            if(Overlap(quads[i], quads[j]) && drawn[i] > drawn[j])
+                            {
+                                ReportFailure(__FILE__, __LINE__, "overlapping quads drawn out of order");
+                                return;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    hmi_graphics::test::TestOverlappingKeepOrder();
+    hmi_graphics::test::TestDisjointMerge();
+    hmi_graphics::test::TestTransformedBounds();
+    hmi_graphics::test::TestZIndexAndPasses();
+    hmi_graphics::test::TestRandomOrder();
+    return hmi_graphics::test::Finish("composite_batch_test");
+}
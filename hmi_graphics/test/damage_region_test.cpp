@@ -0,0 +1,181 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "damage_region.h"
+#include "rect_util.h"
+#include "test.h"
+
+namespace hmi_graphics
+{
+    namespace test
+    {
+        namespace
+        {
+            constexpr int FIELD_SIZE = 64;
+            constexpr int RANDOM_ROUNDS = 200;
+            constexpr int RANDOM_RECTS = 24;
+
+            bool HasSingleRect(const DamageRegion& region, const Rect& expected)
+            {
+                return region.GetRects().size() == 1 && RectsEqual(region.GetRects()[0], expected);
+            }
+
+            bool Covers(const DamageRegion& region, int x, int y)
+            {
+                for(auto& rect: region.GetRects())
+                {
+                    if(RectContainsPoint(rect, x, y))
+                        return true;
+                }
+
+                return false;
+            }
+
+            void TestOverlapping()
+            {
+                DamageRegion region;
+                region.Add(MakeRect(0, 0, 10, 10));
+                region.Add(MakeRect(5, 0, 10, 10));
+                HMI_CHECK(HasSingleRect(region, MakeRect(0, 0, 15, 10)));
+
+                // The union would be mostly area neither rect covers.
+                DamageRegion sparse;
+                sparse.Add(MakeRect(0, 0, 10, 10));
+                sparse.Add(MakeRect(8, 8, 10, 10));
+                HMI_CHECK_EQUAL(sparse.GetRects().size(), 2u);
+                HMI_CHECK(RectsEqual(sparse.GetBounds(), MakeRect(0, 0, 18, 18)));
+            }
+
+            void TestAdjacent()
+            {
+                DamageRegion region;
+                region.Add(MakeRect(0, 0, 10, 10));
+                region.Add(MakeRect(10, 0, 10, 10));
+                region.Add(MakeRect(0, 10, 20, 5));
+                HMI_CHECK(HasSingleRect(region, MakeRect(0, 0, 20, 15)));
+
+                // Touching corners only would double the area.
+                DamageRegion diagonal;
+                diagonal.Add(MakeRect(0, 0, 10, 10));
+                diagonal.Add(MakeRect(10, 10, 10, 10));
+                HMI_CHECK_EQUAL(diagonal.GetRects().size(), 2u);
+            }
+
+            void TestContained()
+            {
+                DamageRegion region;
+                region.Add(MakeRect(0, 0, 100, 100));
+                region.Add(MakeRect(10, 10, 5, 5));
+                HMI_CHECK(HasSingleRect(region, MakeRect(0, 0, 100, 100)));
+
+                DamageRegion growing;
+                growing.Add(MakeRect(10, 10, 5, 5));
+                growing.Add(MakeRect(40, 40, 5, 5));
+                growing.Add(MakeRect(0, 0, 100, 100));
+                HMI_CHECK(HasSingleRect(growing, MakeRect(0, 0, 100, 100)));
+            }
+
+            void TestChainedMerge()
+            {
+                // The bridge merges with one rect and the result then with the other.
+                DamageRegion region;
+                region.Add(MakeRect(0, 0, 10, 10));
+                region.Add(MakeRect(20, 0, 10, 10));
+                HMI_CHECK_EQUAL(region.GetRects().size(), 2u);
+                region.Add(MakeRect(10, 0, 10, 10));
+                HMI_CHECK(HasSingleRect(region, MakeRect(0, 0, 30, 10)));
+            }
+
+            void TestCollapseToBounds()
+            {
+                DamageRegion region{4};
+                for(int i = 0; i < 4; ++i)
+                {
+                    region.Add(MakeRect(i * 100, i * 100, 10, 10));
+                }
+
+                HMI_CHECK_EQUAL(region.GetRects().size(), 4u);
+                region.Add(MakeRect(500, 0, 10, 10));
+                HMI_CHECK(HasSingleRect(region, MakeRect(0, 0, 510, 310)));
+
+                DamageRegion single{0};
+                single.Add(MakeRect(0, 0, 1, 1));
+                single.Add(MakeRect(50, 50, 1, 1));
+                HMI_CHECK(HasSingleRect(single, MakeRect(0, 0, 51, 51)));
+            }
+
+            void TestEmptyAndClip()
+            {
+                DamageRegion region;
+                region.Add(MakeRect(5, 5, 0, 10));
+                region.Add(MakeRect(5, 5, 10, -1));
+                HMI_CHECK(region.IsEmpty());
+                HMI_CHECK(IsEmptyRect(region.GetBounds()));
+
+                region.Add(MakeRect(-10, -10, 20, 20));
+                region.Add(MakeRect(200, 200, 10, 10));
+                region.Clip(MakeRect(0, 0, 100, 100));
+                HMI_CHECK(HasSingleRect(region, MakeRect(0, 0, 10, 10)));
+
+                DamageRegion other;
+                other.Add(MakeRect(10, 0, 10, 10));
+                region.Add(other);
+                HMI_CHECK(HasSingleRect(region, MakeRect(0, 0, 20, 10)));
+
+                region.Clear();
+                HMI_CHECK(region.IsEmpty());
+            }
+
+            // Whatever merges happen, every damaged pixel stays covered and the rect limit holds.
+            void TestRandomCoverage()
+            {
+                std::mt19937 random{1};
+                std::uniform_int_distribution<int> position{0, FIELD_SIZE - 1};
+                std::uniform_int_distribution<int> extent{1, FIELD_SIZE / 4};
+                for(int round = 0; round < RANDOM_ROUNDS; ++round)
+                {
+                    DamageRegion region{8};
+                    std::vector<uint8_t> damaged(FIELD_SIZE * FIELD_SIZE);
+                    for(int i = 0; i < RANDOM_RECTS; ++i)
+                    {
+                        const Rect rect = MakeRect(position(random), position(random), extent(random), extent(random));
+                        region.Add(rect);
+                        for(int y = rect.origin.y; y < RectBottom(rect) && y < FIELD_SIZE; ++y)
+                        {
+                            for(int x = rect.origin.x; x < RectRight(rect) && x < FIELD_SIZE; ++x)
+                            {
+                                damaged[y * FIELD_SIZE + x] = 1;
+                            }
+                        }
+
+                        HMI_CHECK(region.GetRects().size() <= 8u);
+                    }
+
+                    for(int y = 0; y < FIELD_SIZE; ++y)
+                    {
+                        for(int x = 0; x < FIELD_SIZE; ++x)
+                        {
+                            if(damaged[y * FIELD_SIZE + x] != 0 && !Covers(region, x, y))
+                            {
+                                ReportFailure(__FILE__, __LINE__, "damaged pixel not covered");
+                                return;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    hmi_graphics::test::TestOverlapping();
+    hmi_graphics::test::TestAdjacent();
+    hmi_graphics::test::TestContained();
+    hmi_graphics::test::TestChainedMerge();
+    hmi_graphics::test::TestCollapseToBounds();
+    hmi_graphics::test::TestEmptyAndClip();
+    hmi_graphics::test::TestRandomCoverage();
+    return hmi_graphics::test::Finish("damage_region_test");
+}
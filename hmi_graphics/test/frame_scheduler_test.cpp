@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "frame_scheduler.h"
+#include "test.h"
+
+namespace hmi_graphics
+{
+    namespace test
+    {
+        namespace
+        {
+            constexpr uint32_t TARGET_FPS = 100;
+            constexpr uint64_t PERIOD = 10000;
+            constexpr uint32_t SAFETY_MARGIN = 1000;
+            constexpr uint64_t ORIGIN = 1000000;
+            constexpr uint64_t SHORT_WORK = 2000;
+            constexpr uint64_t LONG_WORK = 15000;
+
+            // Time only moves when a frame sleeps or works, so every deadline is exact.
+            class FakeClock: public FrameClock
+            {
+            public:
+                uint64_t Now() override
+                {
+                    return now_;
+                }
+
+                void SleepUntil(uint64_t microseconds) override
+                {
+                    sleeps_ += 1;
+                    now_ = std::max(now_, microseconds);
+                }
+
+                void Advance(uint64_t microseconds)
+                {
+                    now_ += microseconds;
+                }
+
+                uint64_t GetSleepCount() const
+                {
+                    return sleeps_;
+                }
+
+            private:
+                uint64_t now_ = ORIGIN;
+                uint64_t sleeps_ = 0;
+            };
+
+            struct Frame
+            {
+                uint64_t start;
+                uint64_t deadline;
+            };
+
+            Frame RunFrame(FrameScheduler* scheduler, FakeClock* clock, uint64_t work)
+            {
+                const uint64_t deadline = scheduler->WaitForFrameStart();
+                const uint64_t start = clock->Now();
+                clock->Advance(work);
+                scheduler->EndFrame(true);
+                return Frame{start, deadline};
+            }
+
+            FrameSchedulerOptions MakeOptions(FakeClock* clock, LateFramePolicy policy,
+                std::vector<MissedDeadline>* missed)
+            {
+                FrameSchedulerOptions options{};
+                options.targetFps = TARGET_FPS;
+                options.latePolicy = policy;
+                options.safetyMarginMicroseconds = SAFETY_MARGIN;
+                options.clock = clock;
+                options.onMissedDeadline = [missed](const MissedDeadline& deadline)
+                {
+                    missed->push_back(deadline);
+                };
+                return options;
+            }
+
+            // Brings the scheduler to a steady cadence: the first frame has no estimate and misses by its work.
+            void WarmUp(FrameScheduler* scheduler, FakeClock* clock, std::vector<MissedDeadline>* missed)
+            {
+                const Frame first = RunFrame(scheduler, clock, SHORT_WORK);
+                HMI_CHECK_EQUAL(first.deadline, ORIGIN + SAFETY_MARGIN);
+                HMI_CHECK_EQUAL(first.start, ORIGIN);
+                HMI_CHECK_EQUAL(missed->size(), 1u);
+                missed->clear();
+            }
+
+            void TestOnTime()
+            {
+                FakeClock clock;
+                std::vector<MissedDeadline> missed;
+                FrameScheduler scheduler{MakeOptions(&clock, LATE_FRAME_POLICY_SKIP, &missed)};
+                HMI_CHECK_EQUAL(scheduler.GetPeriodMicroseconds(), PERIOD);
+                WarmUp(&scheduler, &clock, &missed);
+
+                // Each frame starts the estimate plus the margin before its deadline, one period after the last.
+                for(uint64_t i = 1; i <= 5; ++i)
+                {
+                    const Frame frame = RunFrame(&scheduler, &clock, SHORT_WORK);
+                    HMI_CHECK_EQUAL(frame.deadline, ORIGIN + SAFETY_MARGIN + i * PERIOD);
+                    HMI_CHECK_EQUAL(frame.start, frame.deadline - SHORT_WORK - SAFETY_MARGIN);
+                }
+
+                FrameSchedulerStatistics statistics{};
+                scheduler.GetStatistics(&statistics);
+                HMI_CHECK(missed.empty());
+                HMI_CHECK_EQUAL(statistics.frames, 6u);
+                HMI_CHECK_EQUAL(statistics.missedDeadlines, 1u);
+                HMI_CHECK_EQUAL(statistics.skippedDeadlines, 0u);
+                HMI_CHECK_EQUAL(statistics.estimatedWorkMicroseconds, SHORT_WORK);
+                HMI_CHECK_EQUAL(clock.GetSleepCount(), 5u);
+            }
+
+            void TestMissedDeadlineSkips()
+            {
+                FakeClock clock;
+                std::vector<MissedDeadline> missed;
+                FrameScheduler scheduler{MakeOptions(&clock, LATE_FRAME_POLICY_SKIP, &missed)};
+                WarmUp(&scheduler, &clock, &missed);
+
+                const Frame late = RunFrame(&scheduler, &clock, LONG_WORK);
+                HMI_CHECK_EQUAL(late.deadline, ORIGIN + SAFETY_MARGIN + PERIOD);
+                HMI_CHECK_EQUAL(missed.size(), 1u);
+                if(!missed.empty())
+                {
+                    HMI_CHECK_EQUAL(missed[0].frameIndex, 1u);
+                    HMI_CHECK_EQUAL(missed[0].deadlineMicroseconds, late.deadline);
+                    HMI_CHECK_EQUAL(missed[0].latenessMicroseconds, late.start + LONG_WORK - late.deadline);
+                    HMI_CHECK_EQUAL(missed[0].workMicroseconds, LONG_WORK);
+                }
+
+                // The lead is capped at one period, so the next frame gives up the deadlines it cannot make and keeps
+                // the original phase.
+                const Frame next = RunFrame(&scheduler, &clock, SHORT_WORK);
+                HMI_CHECK_EQUAL(next.deadline, ORIGIN + SAFETY_MARGIN + 4 * PERIOD);
+                HMI_CHECK_EQUAL(next.start, next.deadline - PERIOD);
+                HMI_CHECK_EQUAL((next.deadline - ORIGIN) % PERIOD, SAFETY_MARGIN);
+
+                FrameSchedulerStatistics statistics{};
+                scheduler.GetStatistics(&statistics);
+                HMI_CHECK_EQUAL(statistics.missedDeadlines, 2u);
+                HMI_CHECK_EQUAL(statistics.skippedDeadlines, 2u);
+                HMI_CHECK_EQUAL(statistics.lastLatenessMicroseconds, late.start + LONG_WORK - late.deadline);
+                HMI_CHECK_EQUAL(missed.size(), 1u);
+            }
+
+            void TestMissedDeadlineResyncs()
+            {
+                FakeClock clock;
+                std::vector<MissedDeadline> missed;
+                FrameScheduler scheduler{MakeOptions(&clock, LATE_FRAME_POLICY_RESYNC, &missed)};
+                WarmUp(&scheduler, &clock, &missed);
+
+                const Frame late = RunFrame(&scheduler, &clock, LONG_WORK);
+                HMI_CHECK_EQUAL(missed.size(), 1u);
+
+                // Starts right away and moves the cadence to the late frame.
+                const uint64_t now = clock.Now();
+                const Frame next = RunFrame(&scheduler, &clock, SHORT_WORK);
+                HMI_CHECK_EQUAL(next.start, now);
+                HMI_CHECK_EQUAL(next.deadline, now + PERIOD);
+                HMI_CHECK(next.deadline < late.deadline + 3 * PERIOD);
+
+                const Frame after = RunFrame(&scheduler, &clock, SHORT_WORK);
+                HMI_CHECK_EQUAL(after.deadline, next.deadline + PERIOD);
+
+                FrameSchedulerStatistics statistics{};
+                scheduler.GetStatistics(&statistics);
+                HMI_CHECK_EQUAL(statistics.skippedDeadlines, 0u);
+                HMI_CHECK_EQUAL(missed.size(), 1u);
+            }
+
+            void TestRecovery()
+            {
+                FakeClock clock;
+                std::vector<MissedDeadline> missed;
+                FrameScheduler scheduler{MakeOptions(&clock, LATE_FRAME_POLICY_SKIP, &missed)};
+                WarmUp(&scheduler, &clock, &missed);
+                RunFrame(&scheduler, &clock, LONG_WORK);
+
+                // The spike keeps frames starting a full period early until 32 frames pushed it out of the history.
+                Frame frame{};
+                for(int i = 0; i < 32; ++i)
+                {
+                    frame = RunFrame(&scheduler, &clock, SHORT_WORK);
+                    HMI_CHECK_EQUAL(frame.start, frame.deadline - PERIOD);
+                }
+
+                frame = RunFrame(&scheduler, &clock, SHORT_WORK);
+                HMI_CHECK_EQUAL(frame.start, frame.deadline - SHORT_WORK - SAFETY_MARGIN);
+                HMI_CHECK_EQUAL((frame.deadline - ORIGIN) % PERIOD, SAFETY_MARGIN);
+                HMI_CHECK_EQUAL(missed.size(), 1u);
+
+                FrameSchedulerStatistics statistics{};
+                scheduler.GetStatistics(&statistics);
+                HMI_CHECK_EQUAL(statistics.estimatedWorkMicroseconds, SHORT_WORK);
+                HMI_CHECK_EQUAL(statistics.maxLatenessMicroseconds, LONG_WORK - SHORT_WORK - SAFETY_MARGIN);
+            }
+
+            void TestIdleFrames()
+            {
+                FakeClock clock;
+                std::vector<MissedDeadline> missed;
+                FrameScheduler scheduler{MakeOptions(&clock, LATE_FRAME_POLICY_SKIP, &missed)};
+                WarmUp(&scheduler, &clock, &missed);
+                RunFrame(&scheduler, &clock, SHORT_WORK);
+
+                // Frames that present nothing neither count nor miss, and deadlines passed while idle are not skips.
+                scheduler.WaitForFrameStart();
+                clock.Advance(5 * PERIOD);
+                scheduler.EndFrame(false);
+                const Frame frame = RunFrame(&scheduler, &clock, SHORT_WORK);
+                HMI_CHECK_EQUAL((frame.deadline - ORIGIN) % PERIOD, SAFETY_MARGIN);
+                HMI_CHECK(frame.start >= frame.deadline - SHORT_WORK - SAFETY_MARGIN);
+
+                FrameSchedulerStatistics statistics{};
+                scheduler.GetStatistics(&statistics);
+                HMI_CHECK_EQUAL(statistics.frames, 3u);
+                HMI_CHECK_EQUAL(statistics.skippedDeadlines, 0u);
+                HMI_CHECK(missed.empty());
+            }
+
+            void TestInvalidTarget()
+            {
+                FakeClock clock;
+                FrameSchedulerOptions options{};
+                options.clock = &clock;
+                bool threw = false;
+                try
+                {
+                    FrameScheduler scheduler{options};
+                }
+                catch(const std::runtime_error&)
+                {
+                    threw = true;
+                }
+
+                HMI_CHECK(threw);
+            }
+        }
+    }
+}
+
+int main()
+{
+    hmi_graphics::test::TestOnTime();
+    hmi_graphics::test::TestMissedDeadlineSkips();
+    hmi_graphics::test::TestMissedDeadlineResyncs();
+    hmi_graphics::test::TestRecovery();
+    hmi_graphics::test::TestIdleFrames();
+    hmi_graphics::test::TestInvalidTarget();
+    return hmi_graphics::test::Finish("frame_scheduler_test");
+}
@@ -0,0 +1,153 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "hit_grid.h"
+#include "rect_util.h"
+#include "test.h"
+
+namespace hmi_graphics
+{
+    namespace test
+    {
+        namespace
+        {
+            constexpr int WIDTH = 300;
+            constexpr int HEIGHT = 200;
+            constexpr int RANDOM_ROUNDS = 20;
+            constexpr int RANDOM_ELEMENTS = 150;
+            constexpr int RANDOM_POINTS = 200;
+
+            // Back to front, as the render thread captures them: ascending z-index, then ascending sequence.
+            struct Scene
+            {
+                std::vector<ElementState> states;
+                std::vector<uint32_t> sequences;
+
+                void Add(uint32_t index, const Rect& bounds, int16_t zIndex, uint32_t sequence)
+                {
+                    states.push_back(ElementState{ElementHandle{index, 1}, bounds, zIndex});
+                    sequences.push_back(sequence);
+                }
+            };
+
+            std::vector<uint32_t> QueryAll(const HitGrid& grid, int32_t x, int32_t y)
+            {
+                std::vector<uint32_t> hits;
+                HitTestCursor cursor{};
+                for(ElementHandle handle = grid.Query(x, y, &cursor); handle.generation != 0;
+                    handle = grid.Query(x, y, &cursor))
+                {
+                    hits.push_back(handle.index);
+                }
+
+                return hits;
+            }
+
+            void TestTopMost()
+            {
+                Scene scene;
+                scene.Add(1, MakeRect(0, 0, 100, 100), 0, 1);
+                scene.Add(2, MakeRect(50, 50, 100, 100), 0, 2);
+                scene.Add(3, MakeRect(60, 60, 10, 10), 1, 3);
+                HitGrid grid;
+                grid.Build(WIDTH, HEIGHT, scene.states, scene.sequences, 1);
+                HMI_CHECK_EQUAL(grid.GetElementCount(), 3u);
+                HMI_CHECK_EQUAL(grid.Query(10, 10, nullptr).index, 1u);
+                HMI_CHECK_EQUAL(grid.Query(55, 55, nullptr).index, 2u);
+                HMI_CHECK_EQUAL(grid.Query(65, 65, nullptr).index, 3u);
+                HMI_CHECK_EQUAL(grid.Query(149, 149, nullptr).index, 2u);
+                HMI_CHECK_EQUAL(grid.Query(150, 150, nullptr).generation, 0u);
+
+                // Outside the viewport nothing is hit, even where an element reaches.
+                HMI_CHECK_EQUAL(grid.Query(-1, 10, nullptr).generation, 0u);
+                HMI_CHECK_EQUAL(grid.Query(WIDTH, 10, nullptr).generation, 0u);
+
+                HMI_CHECK(QueryAll(grid, 65, 65) == (std::vector<uint32_t>{3, 2, 1}));
+                HMI_CHECK(QueryAll(grid, 10, 10) == (std::vector<uint32_t>{1}));
+            }
+
+            void TestCursorAcrossBuilds()
+            {
+                Scene scene;
+                scene.Add(1, MakeRect(0, 0, 50, 50), 0, 1);
+                scene.Add(2, MakeRect(0, 0, 50, 50), 0, 2);
+                scene.Add(3, MakeRect(0, 0, 50, 50), 0, 3);
+                HitGrid grid;
+                grid.Build(WIDTH, HEIGHT, scene.states, scene.sequences, 1);
+                HitTestCursor cursor{};
+                HMI_CHECK_EQUAL(grid.Query(10, 10, &cursor).index, 3u);
+
+                // A newer snapshot removed the element just returned and added one on top: the walk carries on below.
+                Scene next;
+                next.Add(1, MakeRect(0, 0, 50, 50), 0, 1);
+                next.Add(2, MakeRect(0, 0, 50, 50), 0, 2);
+                next.Add(4, MakeRect(0, 0, 50, 50), 0, 4);
+                grid.Build(WIDTH, HEIGHT, next.states, next.sequences, 2);
+                HMI_CHECK_EQUAL(grid.Query(10, 10, &cursor).index, 2u);
+                HMI_CHECK_EQUAL(grid.Query(10, 10, &cursor).index, 1u);
+                HMI_CHECK_EQUAL(grid.Query(10, 10, &cursor).generation, 0u);
+
+                // Another point starts over.
+                HMI_CHECK_EQUAL(grid.Query(11, 10, &cursor).index, 4u);
+
+                // Rebuilding with an empty scene drops every cell.
+                grid.Build(WIDTH, HEIGHT, std::vector<ElementState>{}, std::vector<uint32_t>{}, 3);
+                HMI_CHECK_EQUAL(grid.GetElementCount(), 0u);
+                HMI_CHECK_EQUAL(grid.Query(11, 10, nullptr).generation, 0u);
+            }
+
+            // Every hit list matches a reverse scan of the states.
+            void TestRandomScenes()
+            {
+                std::mt19937 random{1};
+                std::uniform_int_distribution<int> position{-50, WIDTH};
+                std::uniform_int_distribution<int> size{1, 120};
+                std::uniform_int_distribution<int> x{0, WIDTH - 1};
+                std::uniform_int_distribution<int> y{0, HEIGHT - 1};
+                HitGrid grid;
+                for(int round = 0; round < RANDOM_ROUNDS; ++round)
+                {
+                    Scene scene;
+                    for(int16_t z = -2; z <= 2; ++z)
+                    {
+                        for(int i = 0; i < RANDOM_ELEMENTS / 5; ++i)
+                        {
+                            const uint32_t index = static_cast<uint32_t>(scene.states.size());
+                            scene.Add(index, MakeRect(position(random), position(random), size(random), size(random)), z,
+                                index + 1);
+                        }
+                    }
+
+                    grid.Build(WIDTH, HEIGHT, scene.states, scene.sequences, static_cast<uint32_t>(round + 1));
+                    for(int point = 0; point < RANDOM_POINTS; ++point)
+                    {
+                        const int32_t px = x(random);
+                        const int32_t py = y(random);
+                        std::vector<uint32_t> expected;
+                        for(auto it = scene.states.rbegin(); it != scene.states.rend(); ++it)
+                        {
+                            if(RectContainsPoint(it->bounds, px, py))
+                            {
+                                expected.push_back(it->handle.index);
+                            }
+                        }
+
+                        if(QueryAll(grid, px, py) != expected)
+                        {
+                            ReportFailure(__FILE__, __LINE__, "hits differ from a reverse scan");
+                            return;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    hmi_graphics::test::TestTopMost();
+    hmi_graphics::test::TestCursorAcrossBuilds();
+    hmi_graphics::test::TestRandomScenes();
+    return hmi_graphics::test::Finish("hit_grid_test");
+}
@@ -0,0 +1,139 @@
+#include <string>
+#include <utility>
+#include <vector>
+#include "lru_cache.h"
+#include "test.h"
+
+namespace hmi_graphics
+{
+    namespace test
+    {
+        namespace
+        {
+            using Cache = LruCache<int, std::string>;
+            using Evicted = std::vector<std::pair<int, std::string>>;
+
+            Cache::EvictionHandler Record(Evicted* evicted)
+            {
+                return [evicted](const int& key, std::string& value)
+                {
+                    evicted->emplace_back(key, value);
+                };
+            }
+
+            void TestReinsert()
+            {
+                Evicted evicted;
+                Cache cache{10, Record(&evicted)};
+                cache.Insert(1, "a", 3);
+                cache.Insert(2, "b", 3);
+
+                // Replacing an entry is not an eviction, updates its cost and makes it the most recent.
+                std::string& value = cache.Insert(1, "c", 5);
+                HMI_CHECK_EQUAL(value, "c");
+                HMI_CHECK_EQUAL(cache.GetSize(), 2u);
+                HMI_CHECK_EQUAL(cache.GetCost(), 8u);
+                HMI_CHECK(evicted.empty());
+                HMI_CHECK(cache.Find(1) != nullptr && *cache.Find(1) == "c");
+
+                cache.Insert(3, "d", 3);
+                HMI_CHECK_EQUAL(evicted.size(), 1u);
+                HMI_CHECK(!evicted.empty() && evicted[0].first == 2 && evicted[0].second == "b");
+                HMI_CHECK_EQUAL(cache.GetCost(), 8u);
+
+                // Replacing the only entry, with the same key over and over.
+                Cache single{1};
+                for(int i = 0; i < 4; ++i)
+                {
+                    single.Insert(7, std::string(i + 1, 'x'));
+                }
+
+                HMI_CHECK_EQUAL(single.GetSize(), 1u);
+                HMI_CHECK(single.Find(7) != nullptr && *single.Find(7) == "xxxx");
+                HMI_CHECK_EQUAL(single.GetStatistics().evictions, 0u);
+            }
+
+            void TestCostEviction()
+            {
+                Evicted evicted;
+                Cache cache{10, Record(&evicted)};
+                cache.Insert(1, "a", 4);
+                cache.Insert(2, "b", 4);
+                HMI_CHECK(cache.Find(1) != nullptr);
+
+                // 2 is now the least recent and goes first.
+                cache.Insert(3, "c", 4);
+                HMI_CHECK_EQUAL(evicted.size(), 1u);
+                HMI_CHECK(!evicted.empty() && evicted.back().first == 2);
+                HMI_CHECK(cache.Find(2) == nullptr);
+                HMI_CHECK_EQUAL(cache.GetCost(), 8u);
+
+                // An entry costing more than the capacity evicts everything else but still goes in.
+                cache.Insert(4, "d", 12);
+                HMI_CHECK_EQUAL(cache.GetSize(), 1u);
+                HMI_CHECK_EQUAL(cache.GetCost(), 12u);
+                HMI_CHECK(cache.Find(4) != nullptr);
+                HMI_CHECK_EQUAL(evicted.size(), 3u);
+
+                const CacheStatistics statistics = cache.GetStatistics();
+                HMI_CHECK_EQUAL(statistics.evictions, 3u);
+                HMI_CHECK_EQUAL(statistics.size, 12u);
+                HMI_CHECK_EQUAL(statistics.capacity, 10u);
+            }
+
+            void TestEvictionHandler()
+            {
+                Evicted evicted;
+                Cache cache{3, Record(&evicted)};
+                cache.Insert(1, "a");
+                cache.Insert(2, "b");
+                cache.Insert(3, "c");
+                cache.Insert(4, "d");
+                HMI_CHECK_EQUAL(evicted.size(), 1u);
+                HMI_CHECK(!evicted.empty() && evicted[0].first == 1 && evicted[0].second == "a");
+
+                HMI_CHECK(cache.EvictLeastRecent());
+                HMI_CHECK_EQUAL(evicted.size(), 2u);
+                HMI_CHECK(evicted.size() == 2 && evicted[1].first == 2);
+
+                // Clear drops entries without the handler.
+                cache.Clear();
+                HMI_CHECK_EQUAL(evicted.size(), 2u);
+                HMI_CHECK_EQUAL(cache.GetSize(), 0u);
+                HMI_CHECK_EQUAL(cache.GetCost(), 0u);
+                HMI_CHECK(!cache.EvictLeastRecent());
+            }
+
+            void TestStatistics()
+            {
+                Cache cache{4};
+                cache.Insert(1, "a");
+                HMI_CHECK(cache.Find(1) != nullptr);
+                HMI_CHECK(cache.Find(2) == nullptr);
+
+                // FindUncounted leaves the counters alone but still refreshes the entry.
+                cache.Insert(2, "b");
+                HMI_CHECK(cache.FindUncounted(1) != nullptr);
+                HMI_CHECK(cache.FindUncounted(3) == nullptr);
+                const CacheStatistics statistics = cache.GetStatistics();
+                HMI_CHECK_EQUAL(statistics.hits, 1u);
+                HMI_CHECK_EQUAL(statistics.misses, 1u);
+
+                cache.Insert(3, "c");
+                cache.Insert(4, "d");
+                cache.Insert(5, "e");
+                HMI_CHECK(cache.FindUncounted(1) != nullptr);
+                HMI_CHECK(cache.FindUncounted(2) == nullptr);
+            }
+        }
+    }
+}
+
+int main()
+{
+    hmi_graphics::test::TestReinsert();
+    hmi_graphics::test::TestCostEviction();
+    hmi_graphics::test::TestEvictionHandler();
+    hmi_graphics::test::TestStatistics();
+    return hmi_graphics::test::Finish("lru_cache_test");
+}
@@ -0,0 +1,41 @@
+#ifndef HMI_GRAPHICS_TEST_TEST_H
+#define HMI_GRAPHICS_TEST_TEST_H
+
+#include <cstdio>
+
+namespace hmi_graphics
+{
+    namespace test
+    {
+        // Failed checks of the test executable; main returns non-zero when there were any.
+        inline int& GetFailureCount()
+        {
+            static int failures = 0;
+            return failures;
+        }
+
+        inline void ReportFailure(const char* file, int line, const char* expression)
+        {
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+            GetFailureCount() += 1;
+        }
+
+        inline int Finish(const char* name)
+        {
+            std::fprintf(stderr, "%s: %d failed checks\n", name, GetFailureCount());
+            return GetFailureCount() == 0 ? 0 : 1;
+        }
+    }
+}
+
+// Keeps going after a failure, so one run reports every broken expectation.
+#define HMI_CHECK(expression) \
+    do \
+    { \
+        if(!(expression)) \
+            ::hmi_graphics::test::ReportFailure(__FILE__, __LINE__, #expression); \
+    } while(false)
+
+#define HMI_CHECK_EQUAL(actual, expected) HMI_CHECK((actual) == (expected))
+
+#endif //HMI_GRAPHICS_TEST_TEST_H
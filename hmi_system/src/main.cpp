@@ -1,12 +1,25 @@
 #define NOMINMAX
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
 #include <mutex>
+#include <queue>
 #include <string>
+#include <thread>
 #include <array>
+#include <vector>
+#include <cwchar>
+#include <cwctype>
 #include <Windows.h>
 #include <strsafe.h>
 #include <graphics/graphics_system.h>
 #include <graphics/graphics_element.h>
+#include <graphics/display_list.h>
+#include <graphics/render_thread.h>
+#include <vnc/vnc.h>
 #include <wrl/client.h>
 
 class ColorButton;
@@ -19,6 +32,7 @@ __interface IHmiApplicationView;
 __interface IHmiApplicationSession;
 __interface IHmiSystem: IUnknown
 {
+    // Owned by the render thread while it runs: use it from OnSpin, which runs there, or from OnShutdown.
     hmi_graphics::System* GetGraphicsSystem();
 
     bool BindElement(hmi_graphics::GraphicsElement* element, const UUID* appUuid);
@@ -28,8 +42,10 @@ __interface IHmiModule: IUnknown
 {
     STDMETHOD(OnLoaded)(IHmiSystem*);
 
+    // Runs once rendering stopped; remove the module's elements here with RemoveElement.
     STDMETHOD(OnShutdown)();
 
+    // Runs on the render thread between frames, so the graphics system may be used here.
     STDMETHOD(OnSpin)();
 
     STDMETHOD(GetApplication)(IHmiApplication** application);
@@ -54,6 +70,9 @@ __interface IHmiRenderManager: IUnknown
 
 };
 
+const hmi_graphics::TextFormatDesc LABEL_TEXT_FORMAT{L"arial", 11.f, DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL,
+    DWRITE_FONT_STRETCH_NORMAL, DWRITE_TEXT_ALIGNMENT_CENTER, DWRITE_PARAGRAPH_ALIGNMENT_CENTER};
+
 class BazelLabel : public hmi_graphics::GraphicsElement
 {
 public:
@@ -65,10 +84,11 @@ public:
 
     auto SetText(const std::wstring& label) -> void;
 
+    auto GetText() const -> const std::wstring&;
+
 private:
     Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> m_brush;
     Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> m_blackBrush;
-    Microsoft::WRL::ComPtr<IDWriteTextFormat> m_textFormat;
     Microsoft::WRL::ComPtr<IDWriteTextLayout> m_textLayout;
     D2D1_COLOR_F m_color;
     std::wstring m_label;
@@ -85,15 +105,9 @@ auto BazelLabel::Initialize(Pimpl* pimpl, hmi_graphics::System* parent) -> bool
     hmi_graphics::GraphicsElement::Initialize(pimpl, parent);
     parent->GetCachedColorBrush(m_color, &m_brush);
     parent->GetCachedColorBrush(D2D1::ColorF(D2D1::ColorF::Black), &m_blackBrush);
-    Microsoft::WRL::ComPtr<IDWriteFactory> dwriteFactory;
-    parent->GetDirectWriteFactory(&dwriteFactory);
-    dwriteFactory->CreateTextFormat(L"arial", nullptr, DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL,
-        DWRITE_FONT_STRETCH_NORMAL, 11.f, L"", &m_textFormat);
-    m_textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER);
-    m_textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
     auto size = GetSize();
-    dwriteFactory->CreateTextLayout(m_label.c_str(), m_label.size(), m_textFormat.Get(), size.width, size.height,
-        &m_textLayout);
+    parent->GetCachedTextLayout(m_label.c_str(), static_cast<uint32_t>(m_label.size()), LABEL_TEXT_FORMAT, size.width,
+        size.height, &m_textLayout);
 
     return true;
 }
@@ -101,23 +115,31 @@ auto BazelLabel::Initialize(Pimpl* pimpl, hmi_graphics::System* parent) -> bool
 auto BazelLabel::SetText(const std::wstring& label) -> void
 {
     m_label = label;
-    Microsoft::WRL::ComPtr<IDWriteFactory> dwriteFactory;
     auto size = GetSize();
-    dwriteFactory->CreateTextLayout(m_label.c_str(), m_label.size(), m_textFormat.Get(), size.width,
+    m_textLayout.Reset();
+    GetParent()->GetCachedTextLayout(m_label.c_str(), static_cast<uint32_t>(m_label.size()), LABEL_TEXT_FORMAT, size.width,
         size.height, &m_textLayout);
 
     GraphicsElement::NotifyUpdated();
 }
 
+auto BazelLabel::GetText() const -> const std::wstring&
+{
+    return m_label;
+}
+
 auto BazelLabel::Render(hmi_graphics::System* parent) -> void
 {
     Microsoft::WRL::ComPtr<ID2D1DeviceContext> context;
     parent->GetDirect2dDeviceContext(&context);
-    context->SetTarget(GetTarget());
-    context->BeginDraw();
+    if(!BeginDraw(context.Get()))
+    {
+        return;
+    }
+
     context->Clear(m_color);
     context->DrawTextLayout(D2D1::Point2(0.f, 0.f), m_textLayout.Get(), m_blackBrush.Get());
-    context->EndDraw();
+    EndDraw(context.Get());
 }
 
 class PlanPositionIndicator : public hmi_graphics::GraphicsElement
@@ -135,10 +157,7 @@ public:
 
 private:
     float m_angleHeadingRad;
-    Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> m_brush;
-    Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> m_blackBrush;
-    Microsoft::WRL::ComPtr<IDWriteTextFormat> m_textFormat;
-    D2D1::Matrix3x2F m_transform;
+    hmi_graphics::DisplayList m_displayList;
 };
 
 PlanPositionIndicator::PlanPositionIndicator(float angleHeadingRad)
@@ -154,52 +173,34 @@ auto PlanPositionIndicator::Initialize(Pimpl* pimpl, hmi_graphics::System* paren
         return false;
     }
 
-    hmi_graphics::GraphicsElement::Initialize(pimpl, parent);
-    parent->GetCachedColorBrush(D2D1::ColorF{D2D1::ColorF::Red}, &m_brush);
-    parent->GetCachedColorBrush(D2D1::ColorF(D2D1::ColorF::Black), &m_blackBrush);
-    Microsoft::WRL::ComPtr<IDWriteFactory> dwriteFactory;
-    parent->GetDirectWriteFactory(&dwriteFactory);
-    dwriteFactory->CreateTextFormat(L"arial", nullptr, DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL,
-        DWRITE_FONT_STRETCH_NORMAL, 11.f, L"", &m_textFormat);
-    m_textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER);
-    m_textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
-
-    Microsoft::WRL::ComPtr<ID2D1DeviceContext> context;
-    parent->GetDirect2dDeviceContext(&context);
-
     auto size = GetSize();
+    const float radius = std::min(size.width / 2, size.height / 2) - 2.f;
+    const uint32_t transparent = m_displayList.AddColor(D2D1::ColorF{D2D1::ColorF::White, 0.f});
+    const uint32_t red = m_displayList.AddColor(D2D1::ColorF{D2D1::ColorF::Red});
+    const uint32_t black = m_displayList.AddColor(D2D1::ColorF{D2D1::ColorF::Black});
+    // The heading is applied by the compositor, so the content is drawn unrotated once.
     auto transform = D2D1::Matrix3x2F::Scale(D2D1::SizeF(1.F, -1.f));
-    transform = transform * D2D1::Matrix3x2F::Rotation(m_angleHeadingRad);
     transform = transform * D2D1::Matrix3x2F::Translation(size.width / 2, size.height / 2);
-    m_transform = transform;
+    const uint32_t transformSlot = m_displayList.AddTransform(transform);
+
+    m_displayList.Clear(transparent);
+    m_displayList.PushTransform(transformSlot);
+    m_displayList.DrawEllipse(D2D1::Ellipse(D2D1::Point2F(0.f, 0.f), radius, radius), black, 2.f);
+    m_displayList.FillRectangle(D2D1::RectF(-20.f, 30.f, 20.f, -30.f), red);
+    m_displayList.PopTransform();
+    SetCompositeTransform(hmi_graphics::CompositeTransform{m_angleHeadingRad, 1.f, 1.f, 1.f});
     return true;
 }
 
 auto PlanPositionIndicator::SetAngleHeadingRad(float radian) -> void
 {
     m_angleHeadingRad = radian;
-    auto size = GetSize();
-    auto transform = D2D1::Matrix3x2F::Scale(D2D1::SizeF(1.F, -1.f));
-    transform = transform * D2D1::Matrix3x2F::Rotation(m_angleHeadingRad);
-    transform = transform * D2D1::Matrix3x2F::Translation(size.width / 2, size.height / 2);
-    m_transform = transform;
-    NotifyUpdated();
+    SetCompositeTransform(hmi_graphics::CompositeTransform{m_angleHeadingRad, 1.f, 1.f, 1.f});
 }
 
 auto PlanPositionIndicator::Render(hmi_graphics::System* parent) -> void
 {
-    auto size = GetSize();
-    const float radius = std::min(size.width / 2, size.height / 2) - 2.f;
-    Microsoft::WRL::ComPtr<ID2D1DeviceContext> context;
-    parent->GetDirect2dDeviceContext(&context);
-    context->SetTarget(GetTarget());
-    context->BeginDraw();
-    context->Clear(D2D1::ColorF{D2D1::ColorF::White, 0.f});
-    context->SetTransform(m_transform);
-    context->DrawEllipse(D2D1::Ellipse(D2D1::Point2F(0.f, 0.f), radius, radius), m_blackBrush.Get(), 2.f);
-    context->FillRectangle(D2D1::RectF(-20.f, 30.f, 20.f, -30.f), m_brush.Get());
-    context->EndDraw();
-    context->SetTransform(D2D1::IdentityMatrix());
+    RenderDisplayList(m_displayList);
 }
 
 auto PlanPositionIndicator::GetAngleHeadingRad() -> float
@@ -243,26 +244,39 @@ public:
 
     auto Initialize(hmi_graphics::System* system) -> HRESULT;
 
-    auto SpinOnce() -> HRESULT;
+    auto SpinOnce(hmi_graphics::RenderThread* renderThread) -> HRESULT;
+
+    // Called from any thread with an element hit by a remote pointer; toggles the marker of a bazel label.
+    auto OnElementHit(hmi_graphics::RenderThread* renderThread, hmi_graphics::ElementHandle handle) -> void;
 
 private:
     std::atomic_int m_refCnt = 1;
+    hmi_graphics::System* m_system = nullptr;
     PlanPositionIndicator* m_ppi = nullptr;
+    float m_angleHeadingRad = 30.f;
     std::array<BazelLabel*, 20> m_bazelButtons = {};
+    // Written once by Initialize, so other threads may read them.
+    std::array<hmi_graphics::ElementHandle, 20> m_bazelHandles = {};
 };
 
 ExampleRenderManager::~ExampleRenderManager()
 {
-    delete m_ppi;
+    if (m_system == nullptr)
+    {
+        return;
+    }
+
+    m_system->RemoveElement(m_ppi);
     for (auto it : m_bazelButtons)
     {
-        delete it;
+        m_system->RemoveElement(it);
     }
 }
 
 auto ExampleRenderManager::Initialize(hmi_graphics::System* system) -> HRESULT
 {
-    m_ppi = system->AddElement<PlanPositionIndicator>(100, 100, 30.f);
+    m_system = system;
+    m_ppi = system->AddElement<PlanPositionIndicator>(100, 100, m_angleHeadingRad);
     for (auto& it : m_bazelButtons)
     {
         wchar_t buf[16]{};
@@ -276,6 +290,7 @@ auto ExampleRenderManager::Initialize(hmi_graphics::System* system) -> HRESULT
         }
 
         it = system->AddElement<BazelLabel>(width, height, D2D1::ColorF(D2D1::ColorF::Green, 0.5f), buf);
+        m_bazelHandles[index] = it->GetHandle();
     }
 
     m_ppi->SetPosition(110, 80);
@@ -303,23 +318,529 @@ auto ExampleRenderManager::Initialize(hmi_graphics::System* system) -> HRESULT
     return S_OK;
 }
 
-auto ExampleRenderManager::SpinOnce() -> HRESULT
+auto ExampleRenderManager::SpinOnce(hmi_graphics::RenderThread* renderThread) -> HRESULT
 {
-    auto s = m_ppi->GetAngleHeadingRad();
-    m_ppi->SetAngleHeadingRad(s + 0.2f);
+    // The indicator belongs to the render thread now; keep our own copy of the heading and post the new value.
+    m_angleHeadingRad += 0.2f;
+    const float angle = m_angleHeadingRad;
+    renderThread->Invoke(m_ppi->GetHandle(), [angle](hmi_graphics::GraphicsElement* element)
+    {
+        static_cast<PlanPositionIndicator*>(element)->SetAngleHeadingRad(angle);
+    });
+
     return S_OK;
 }
 
+auto ExampleRenderManager::OnElementHit(hmi_graphics::RenderThread* renderThread, hmi_graphics::ElementHandle handle)
+    -> void
+{
+    for (auto& it : m_bazelHandles)
+    {
+        if (it.index != handle.index || it.generation != handle.generation)
+        {
+            continue;
+        }
+
+        renderThread->Invoke(handle, [](hmi_graphics::GraphicsElement* element)
+        {
+            auto label = static_cast<BazelLabel*>(element);
+            const std::wstring& text = label->GetText();
+            label->SetText(text[0] == L'*' ? text.substr(1) : L'*' + text);
+        });
+        return;
+    }
+}
+
+// Clicks of remote operators: a left button press hits the top-most element of the latest published frame.
+class RemotePointerInput : public vnc::InputHandler
+{
+public:
+    RemotePointerInput(hmi_graphics::RenderThread* renderThread, ExampleRenderManager* manager)
+        : m_renderThread(renderThread)
+        , m_manager(manager)
+    {
+    }
+
+    auto OnPointerEvent(int x, int y, uint8_t buttonMask) -> void override
+    {
+        // Several clients share the previous mask, like a single pointer.
+        const uint8_t previous = m_buttonMask.exchange(buttonMask);
+        if ((buttonMask & 1) == 0 || (previous & 1) != 0)
+        {
+            return;
+        }
+
+        const hmi_graphics::ElementHandle handle = m_renderThread->HitTest(x, y);
+        if (handle.generation != 0)
+        {
+            m_manager->OnElementHit(m_renderThread, handle);
+        }
+    }
+
+    auto OnKeyEvent(uint32_t keysym, bool down) -> void override
+    {
+    }
+
+private:
+    hmi_graphics::RenderThread* m_renderThread;
+    ExampleRenderManager* m_manager;
+    std::atomic<uint8_t> m_buttonMask{0};
+};
+
+// Handed to the modules. Applications have no sessions to bind elements to yet, so BindElement refuses them.
+class HmiSystem : public IHmiSystem
+{
+public:
+    explicit HmiSystem(hmi_graphics::System* graphics)
+        : m_graphics(graphics)
+    {
+    }
+
+    auto QueryInterface(const GUID& riid, void** ppvObject) -> HRESULT override
+    {
+        return E_NOTIMPL;
+    }
+
+    // Lives on the stack of wWinMain, past every module.
+    auto AddRef() -> ULONG override
+    {
+        return 1;
+    }
+
+    auto Release() -> ULONG override
+    {
+        return 1;
+    }
+
+    auto GetGraphicsSystem() -> hmi_graphics::System* override
+    {
+        return m_graphics;
+    }
+
+    auto BindElement(hmi_graphics::GraphicsElement* element, const UUID* appUuid) -> bool override
+    {
+        return false;
+    }
+
+private:
+    hmi_graphics::System* m_graphics;
+};
+
+// Exported with C linkage by every module library. HmiGetModuleDependencies lists the modules whose OnLoaded has to
+// finish before this one's, separated by ';'. A module's name is its file name without the extension.
+constexpr char CREATE_MODULE_EXPORT[] = "HmiCreateModule";
+constexpr char GET_MODULE_DEPENDENCIES_EXPORT[] = "HmiGetModuleDependencies";
+using HmiCreateModuleProc = HRESULT (WINAPI*)(IHmiModule** module);
+using HmiGetModuleDependenciesProc = const wchar_t* (WINAPI*)();
+
+struct ModuleTiming
+{
+    std::wstring name;
+    // Relative to the start of ApplicationLoader::Load.
+    uint64_t loadStartMicroseconds;
+    // LoadLibrary and HmiCreateModule.
+    uint32_t loadMicroseconds;
+    uint64_t onLoadedStartMicroseconds;
+    uint32_t onLoadedMicroseconds;
+    uint32_t threadIndex;
+    // E_ABORT when a dependency is missing, failed or part of a cycle; OnLoaded was not called then.
+    HRESULT result;
+};
+
+// Loads the module libraries of a directory. The libraries are mapped in parallel, then OnLoaded runs on a pool of
+// hardware_concurrency threads as soon as every dependency of a module finished it, starting with the modules
+// heading the longest dependency chains. OnLoaded may thus run concurrently with the modules unrelated to it, so it
+// should leave the graphics system to OnSpin, which runs on the render thread. The libraries stay loaded until the
+// loader is destroyed, which has to happen after the graphics system in case it still holds module elements.
 class ApplicationLoader
 {
 public:
     ApplicationLoader();
 
     ~ApplicationLoader();
-private:
 
+    // Returns the number of modules whose OnLoaded succeeded; call once.
+    auto Load(const std::wstring& directory, IHmiSystem* system) -> size_t;
+
+    // Posts a call of OnSpin of the loaded modules, dependencies first, to the render thread that owns the graphics
+    // system. Does nothing while the previous call is still queued, so a slow frame does not fill the queue.
+    auto Spin(hmi_graphics::RenderThread* renderThread) -> void;
+
+    // Calls OnShutdown of the loaded modules, dependents first, then releases every module. Call it once nothing
+    // renders anymore.
+    auto Shutdown() -> void;
+
+    // One entry per library found: those left out for unresolved dependencies first, then the others in the order
+    // OnLoaded finished.
+    auto GetTimings() const -> const std::vector<ModuleTiming>&;
+
+    auto GetStartupMicroseconds() const -> uint64_t;
+
+private:
+    struct Module
+    {
+        std::wstring name;
+        HMODULE library = nullptr;
+        Microsoft::WRL::ComPtr<IHmiModule> module;
+        std::vector<std::wstring> dependencies;
+        std::vector<size_t> dependents;
+        size_t pendingDependencies = 0;
+        // Length of the longest chain of dependents, this module included.
+        size_t chainLength = 0;
+        bool blocked = false;
+        ModuleTiming timing{};
+    };
+
+    // Runs body(threadIndex) on threadCount threads, the calling one being thread 0, and returns once all returned.
+    static auto RunOnThreads(size_t threadCount, const std::function<void(uint32_t)>& body) -> void;
+
+    auto LoadLibraries(const std::wstring& directory, size_t threadCount) -> void;
+
+    auto ResolveDependencies() -> std::vector<size_t>;
+
+    auto RunOnLoaded(const std::vector<size_t>& resolved, IHmiSystem* system, size_t threadCount) -> void;
+
+    auto GetElapsedMicroseconds() const -> uint64_t;
+
+    std::vector<Module> m_modules;
+    // Modules whose OnLoaded succeeded, in the order they finished, which respects their dependencies.
+    std::vector<size_t> m_loaded;
+    std::vector<ModuleTiming> m_timings;
+    std::chrono::steady_clock::time_point m_loadStart;
+    uint64_t m_startupMicroseconds;
+    std::atomic_bool m_spinPending;
+    bool m_shutdown;
 };
 
+ApplicationLoader::ApplicationLoader()
+    : m_startupMicroseconds(0)
+    , m_spinPending(false)
+    , m_shutdown(false)
+{
+}
+
+ApplicationLoader::~ApplicationLoader()
+{
+    Shutdown();
+    for (auto& it : m_modules)
+    {
+        if (it.library != nullptr)
+        {
+            FreeLibrary(it.library);
+        }
+    }
+}
+
+auto ApplicationLoader::Load(const std::wstring& directory, IHmiSystem* system) -> size_t
+{
+    m_loadStart = std::chrono::steady_clock::now();
+    const size_t threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    LoadLibraries(directory, threadCount);
+    RunOnLoaded(ResolveDependencies(), system, threadCount);
+    m_startupMicroseconds = GetElapsedMicroseconds();
+    return m_loaded.size();
+}
+
+auto ApplicationLoader::Spin(hmi_graphics::RenderThread* renderThread) -> void
+{
+    if (m_shutdown || m_spinPending.exchange(true))
+    {
+        return;
+    }
+
+    // Shutdown only runs once the render thread stopped, so the modules outlive every posted call.
+    const bool posted = renderThread->Invoke([this](hmi_graphics::System*)
+    {
+        for (auto it : m_loaded)
+        {
+            m_modules[it].module->OnSpin();
+        }
+
+        m_spinPending = false;
+    });
+    if (!posted)
+    {
+        m_spinPending = false;
+    }
+}
+
+auto ApplicationLoader::Shutdown() -> void
+{
+    if (m_shutdown)
+    {
+        return;
+    }
+
+    m_shutdown = true;
+    for (auto it = m_loaded.rbegin(); it != m_loaded.rend(); ++it)
+    {
+        m_modules[*it].module->OnShutdown();
+    }
+
+    for (auto& it : m_modules)
+    {
+        it.module.Reset();
+    }
+}
+
+auto ApplicationLoader::GetTimings() const -> const std::vector<ModuleTiming>&
+{
+    return m_timings;
+}
+
+auto ApplicationLoader::GetStartupMicroseconds() const -> uint64_t
+{
+    return m_startupMicroseconds;
+}
+
+auto ApplicationLoader::RunOnThreads(size_t threadCount, const std::function<void(uint32_t)>& body) -> void
+{
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; ++i)
+    {
+        threads.emplace_back(body, static_cast<uint32_t>(i));
+    }
+
+    body(0);
+    for (auto& it : threads)
+    {
+        it.join();
+    }
+}
+
+auto ApplicationLoader::LoadLibraries(const std::wstring& directory, size_t threadCount) -> void
+{
+    WIN32_FIND_DATAW found{};
+    HANDLE find = FindFirstFileW((directory + L"\\*.dll").c_str(), &found);
+    if (find == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    do
+    {
+        if ((found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+        {
+            Module module;
+            module.name = found.cFileName;
+            module.name.erase(module.name.rfind(L'.'));
+            m_modules.push_back(std::move(module));
+        }
+    } while (FindNextFileW(find, &found));
+    FindClose(find);
+
+    // Mapping the libraries and running their static initializers is independent of the dependency order.
+    std::atomic<size_t> next{0};
+    RunOnThreads(std::min(threadCount, m_modules.size()), [&](uint32_t threadIndex)
+    {
+        for (size_t i = next.fetch_add(1); i < m_modules.size(); i = next.fetch_add(1))
+        {
+            Module& module = m_modules[i];
+            module.timing.name = module.name;
+            module.timing.threadIndex = threadIndex;
+            module.timing.loadStartMicroseconds = GetElapsedMicroseconds();
+            module.timing.result = E_FAIL;
+            const std::wstring path = directory + L"\\" + module.name + L".dll";
+            module.library = LoadLibraryExW(path.c_str(), nullptr,
+                LOAD_LIBRARY_SEARCH_DLL_LOAD_DIR | LOAD_LIBRARY_SEARCH_DEFAULT_DIRS);
+            auto create = module.library != nullptr
+                ? reinterpret_cast<HmiCreateModuleProc>(GetProcAddress(module.library, CREATE_MODULE_EXPORT))
+                : nullptr;
+            if (create != nullptr)
+            {
+                module.timing.result = create(module.module.GetAddressOf());
+            }
+
+            if (SUCCEEDED(module.timing.result) && module.module.Get() == nullptr)
+            {
+                module.timing.result = E_POINTER;
+            }
+
+            auto getDependencies = module.library != nullptr
+                ? reinterpret_cast<HmiGetModuleDependenciesProc>(
+                    GetProcAddress(module.library, GET_MODULE_DEPENDENCIES_EXPORT))
+                : nullptr;
+            const wchar_t* dependencies = getDependencies != nullptr ? getDependencies() : nullptr;
+            for (const wchar_t* it = dependencies; it != nullptr && *it != L'\0'; )
+            {
+                const wchar_t* end = wcschr(it, L';');
+                const size_t length = end != nullptr ? static_cast<size_t>(end - it) : wcslen(it);
+                std::wstring name{it, length};
+                name.erase(0, name.find_first_not_of(L' '));
+                name.erase(name.find_last_not_of(L' ') + 1);
+                if (!name.empty())
+                {
+                    module.dependencies.push_back(std::move(name));
+                }
+
+                it += end != nullptr ? length + 1 : length;
+            }
+
+            module.timing.loadMicroseconds =
+                static_cast<uint32_t>(GetElapsedMicroseconds() - module.timing.loadStartMicroseconds);
+        }
+    });
+}
+
+auto ApplicationLoader::ResolveDependencies() -> std::vector<size_t>
+{
+    // Module file names are case-insensitive like the file system.
+    auto foldCase = [](std::wstring name)
+    {
+        std::transform(name.begin(), name.end(), name.begin(), towlower);
+        return name;
+    };
+
+    std::map<std::wstring, size_t> indices;
+    for (size_t i = 0; i < m_modules.size(); ++i)
+    {
+        indices.emplace(foldCase(m_modules[i].name), i);
+    }
+
+    // A module that failed to load, or depends on a missing one, keeps a dependency that never resolves.
+    for (size_t i = 0; i < m_modules.size(); ++i)
+    {
+        Module& module = m_modules[i];
+        if (FAILED(module.timing.result))
+        {
+            ++module.pendingDependencies;
+        }
+
+        for (auto& it : module.dependencies)
+        {
+            auto dependency = indices.find(foldCase(it));
+            if (dependency == indices.end())
+            {
+                ++module.pendingDependencies;
+                continue;
+            }
+
+            m_modules[dependency->second].dependents.push_back(i);
+            ++module.pendingDependencies;
+        }
+    }
+
+    // Kahn's algorithm; modules left out are in or behind a cycle or an unresolved dependency.
+    std::vector<size_t> resolved;
+    std::vector<size_t> pending(m_modules.size());
+    for (size_t i = 0; i < m_modules.size(); ++i)
+    {
+        pending[i] = m_modules[i].pendingDependencies;
+        if (pending[i] == 0)
+        {
+            resolved.push_back(i);
+        }
+    }
+
+    for (size_t i = 0; i < resolved.size(); ++i)
+    {
+        for (auto it : m_modules[resolved[i]].dependents)
+        {
+            if (--pending[it] == 0)
+            {
+                resolved.push_back(it);
+            }
+        }
+    }
+
+    for (auto it = resolved.rbegin(); it != resolved.rend(); ++it)
+    {
+        Module& module = m_modules[*it];
+        module.chainLength = 1;
+        for (auto dependent : module.dependents)
+        {
+            module.chainLength = std::max(module.chainLength, m_modules[dependent].chainLength + 1);
+        }
+    }
+
+    for (size_t i = 0; i < m_modules.size(); ++i)
+    {
+        if (pending[i] != 0)
+        {
+            if (SUCCEEDED(m_modules[i].timing.result))
+            {
+                m_modules[i].timing.result = E_ABORT;
+            }
+
+            m_timings.push_back(m_modules[i].timing);
+        }
+    }
+
+    return resolved;
+}
+
+auto ApplicationLoader::RunOnLoaded(const std::vector<size_t>& resolved, IHmiSystem* system, size_t threadCount)
+    -> void
+{
+    std::mutex mutex;
+    std::condition_variable condition;
+    auto longerChain = [this](size_t a, size_t b)
+    {
+        return m_modules[a].chainLength < m_modules[b].chainLength;
+    };
+
+    std::priority_queue<size_t, std::vector<size_t>, decltype(longerChain)> ready{longerChain};
+    for (auto it : resolved)
+    {
+        if (m_modules[it].pendingDependencies == 0)
+        {
+            ready.push(it);
+        }
+    }
+
+    size_t remaining = resolved.size();
+    RunOnThreads(std::min(threadCount, resolved.size()), [&](uint32_t threadIndex)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        while (true)
+        {
+            condition.wait(lock, [&] { return !ready.empty() || remaining == 0; });
+            if (ready.empty())
+            {
+                return;
+            }
+
+            Module& module = m_modules[ready.top()];
+            const size_t index = ready.top();
+            ready.pop();
+            lock.unlock();
+
+            module.timing.threadIndex = threadIndex;
+            module.timing.onLoadedStartMicroseconds = GetElapsedMicroseconds();
+            module.timing.result = module.blocked ? E_ABORT : module.module->OnLoaded(system);
+            module.timing.onLoadedMicroseconds =
+                static_cast<uint32_t>(GetElapsedMicroseconds() - module.timing.onLoadedStartMicroseconds);
+
+            lock.lock();
+            const bool loaded = SUCCEEDED(module.timing.result);
+            if (loaded)
+            {
+                m_loaded.push_back(index);
+            }
+
+            m_timings.push_back(module.timing);
+            for (auto it : module.dependents)
+            {
+                Module& dependent = m_modules[it];
+                dependent.blocked = dependent.blocked || !loaded;
+                if (--dependent.pendingDependencies == 0)
+                {
+                    ready.push(it);
+                }
+            }
+
+            --remaining;
+            condition.notify_all();
+        }
+    });
+}
+
+auto ApplicationLoader::GetElapsedMicroseconds() const -> uint64_t
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - m_loadStart).count());
+}
+
 class HmiSystemWindow
 {
 public:
@@ -327,8 +848,6 @@ public:
 
     ~HmiSystemWindow();
 
-    void SpinOnce();
-
     hmi_graphics::System* GetGraphics() { return m_graphics; }
 
 private:
@@ -352,7 +871,6 @@ public:
 private:
     Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> m_brush;
     Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> m_blackBrush;
-    Microsoft::WRL::ComPtr<IDWriteTextFormat> m_textFormat;
     Microsoft::WRL::ComPtr<IDWriteTextLayout> m_textLayout;
     D2D1_COLOR_F m_color;
     std::wstring m_label;
@@ -363,14 +881,8 @@ bool ColorButton::Initialize(Pimpl* pimpl, hmi_graphics::System* parent)
     GraphicsElement::Initialize(pimpl, parent);
     parent->GetCachedColorBrush(D2D1::ColorF(D2D1::ColorF::Red), &m_brush);
     parent->GetCachedColorBrush(D2D1::ColorF(D2D1::ColorF::Black), &m_blackBrush);
-    Microsoft::WRL::ComPtr<IDWriteFactory> dwriteFactory;
-    parent->GetDirectWriteFactory(&dwriteFactory);
-    dwriteFactory->CreateTextFormat(L"arial", nullptr, DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL,
-        DWRITE_FONT_STRETCH_NORMAL, 11.f, L"", &m_textFormat);
-    m_textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER);
-    m_textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
     auto size = GetSize();
-    dwriteFactory->CreateTextLayout(m_label.c_str(), m_label.size(), m_textFormat.Get(), size.width,
+    parent->GetCachedTextLayout(m_label.c_str(), static_cast<uint32_t>(m_label.size()), LABEL_TEXT_FORMAT, size.width,
         size.height, &m_textLayout);
     return true;
 }
@@ -379,36 +891,199 @@ void ColorButton::Render(hmi_graphics::System* parent)
 {
     Microsoft::WRL::ComPtr<ID2D1DeviceContext> context;
     parent->GetDirect2dDeviceContext(&context);
-    context->SetTarget(GetTarget());
-    context->BeginDraw();
+    if(!BeginDraw(context.Get()))
+    {
+        return;
+    }
+
     context->Clear(m_color);
     context->DrawTextLayout(D2D1::Point2(0.f, 0.f), m_textLayout.Get(), m_blackBrush.Get());
-    context->EndDraw();
+    EndDraw(context.Get());
 }
 
+// Hands the captured frames to the VNC server. Frames are acquired from this thread, so reading the mapped pixels
+// never blocks rendering.
+class RemoteFrameStreamer
+{
+public:
+    RemoteFrameStreamer(hmi_graphics::System* system, vnc::Server* server)
+        : m_system(system)
+        , m_server(server)
+        , m_stopping(false)
+    {
+    }
+
+    ~RemoteFrameStreamer()
+    {
+        Stop();
+    }
+
+    auto Start() -> void
+    {
+        m_thread = std::thread{&RemoteFrameStreamer::Run, this};
+    }
+
+    auto Stop() -> void
+    {
+        if (!m_thread.joinable())
+        {
+            return;
+        }
+
+        m_stopping.store(true);
+        m_thread.join();
+    }
+
+private:
+    auto Run() -> void
+    {
+        constexpr DWORD POLL_INTERVAL_MS = 8;
+        std::vector<hmi_graphics::Rect> damage;
+        std::vector<vnc::Rect> rects;
+        while (!m_stopping.load())
+        {
+            Microsoft::WRL::ComPtr<hmi_graphics::CapturedFrame> frame;
+            while (m_system->AcquireCapturedFrame(frame.ReleaseAndGetAddressOf()))
+            {
+                damage.resize(frame->GetDamage(nullptr, 0));
+                frame->GetDamage(damage.data(), damage.size());
+                rects.clear();
+                for (auto& it : damage)
+                {
+                    rects.push_back(vnc::Rect{it.origin.x, it.origin.y, it.size.width, it.size.height});
+                }
+
+                const hmi_graphics::Surface& surface = frame->GetSurface();
+                const vnc::Framebuffer framebuffer{surface.pixels, surface.width, surface.height, surface.stride};
+                m_server->UpdateFramebuffer(framebuffer, rects.data(), rects.size());
+            }
+
+            Sleep(POLL_INTERVAL_MS);
+        }
+    }
+
+    hmi_graphics::System* m_system;
+    vnc::Server* m_server;
+    std::atomic_bool m_stopping;
+    std::thread m_thread;
+};
+
 int WINAPI wWinMain(
     _In_ HINSTANCE hInstance,
     _In_opt_ HINSTANCE hPrevInstance,
     _In_ LPWSTR lpCmdLine,
     _In_ int nShowCmd) {
+    // Declared first so the module libraries are freed only after the window deleted the graphics system.
+    ApplicationLoader loader;
     HmiSystemWindow window(L"Hello World", 800, 600);
 
     ExampleRenderManager* manager = new ExampleRenderManager{};
     manager->Initialize(window.GetGraphics());
-    
+    // The bezel labels only change when clicked, so after a second they are composited as one layer.
+    constexpr uint32_t STATIC_LAYER_FRAMES = 60;
+    window.GetGraphics()->SetStaticLayerThreshold(STATIC_LAYER_FRAMES);
+
+    // Modules are loaded from the modules directory next to the executable; their startup timings go to the
+    // debugger output.
+    HmiSystem hmiSystem{window.GetGraphics()};
+    {
+        wchar_t executable[MAX_PATH];
+        std::wstring directory{executable, GetModuleFileNameW(nullptr, executable, MAX_PATH)};
+        directory.erase(directory.find_last_of(L'\\') + 1);
+        const size_t loaded = loader.Load(directory + L"modules", &hmiSystem);
+        wchar_t line[256];
+        for (auto& it : loader.GetTimings())
+        {
+            StringCbPrintfW(line, sizeof(line),
+                L"module %s: 0x%08lx, load %u us, OnLoaded %u us at %llu us on thread %u\n", it.name.c_str(),
+                static_cast<unsigned long>(it.result), it.loadMicroseconds, it.onLoadedMicroseconds,
+                static_cast<unsigned long long>(it.onLoadedStartMicroseconds), it.threadIndex);
+            OutputDebugStringW(line);
+        }
+
+        StringCbPrintfW(line, sizeof(line), L"%zu of %zu modules loaded in %llu us\n", loaded,
+            loader.GetTimings().size(), static_cast<unsigned long long>(loader.GetStartupMicroseconds()));
+        OutputDebugStringW(line);
+    }
+
+    // Rendering and presentation run on their own thread from here on; this loop only pumps messages and runs the
+    // application logic. --spin ticks the logic as fast as possible instead of every APP_TICK_MS.
+    hmi_graphics::RenderThread renderThread{window.GetGraphics()};
+    constexpr DWORD APP_TICK_MS = 16;
+    const bool spin = lpCmdLine != nullptr && wcsstr(lpCmdLine, L"--spin") != nullptr;
+
+    // --vnc serves the frame to RFB clients on the loopback interface, fed from the render thread's capture ring.
+    const bool serveVnc = lpCmdLine != nullptr && wcsstr(lpCmdLine, L"--vnc") != nullptr;
+    RemotePointerInput remoteInput{&renderThread, manager};
+    vnc::Server vncServer;
+    RemoteFrameStreamer streamer{window.GetGraphics(), &vncServer};
+    if(serveVnc)
+    {
+        constexpr uint16_t VNC_PORT = 5900;
+        constexpr size_t CAPTURE_DEPTH = 3;
+        const vnc::ServerOptions options{"127.0.0.1", VNC_PORT, "hmi_system", 4};
+        if(vncServer.Start(options, 800, 600, &remoteInput))
+        {
+            renderThread.Invoke([](hmi_graphics::System* system)
+            {
+                system->SetFrameCaptureDepth(CAPTURE_DEPTH);
+            });
+            streamer.Start();
+        }
+    }
+
+    // --fps=<n> paces presentation to n frames per second and starts each frame as late as it safely can, so the
+    // commands posted by the loop below reach the screen sooner. Late frames give up their slot.
+    const wchar_t* fpsOption = lpCmdLine != nullptr ? wcsstr(lpCmdLine, L"--fps=") : nullptr;
+    if (fpsOption != nullptr)
+    {
+        constexpr uint32_t PACING_SAFETY_MARGIN_US = 2000;
+        hmi_graphics::FrameSchedulerOptions pacing{};
+        pacing.targetFps = static_cast<uint32_t>(wcstoul(fpsOption + wcslen(L"--fps="), nullptr, 10));
+        pacing.latePolicy = hmi_graphics::LATE_FRAME_POLICY_SKIP;
+        pacing.safetyMarginMicroseconds = PACING_SAFETY_MARGIN_US;
+        pacing.onMissedDeadline = [](const hmi_graphics::MissedDeadline& missed)
+        {
+            wchar_t line[128];
+            StringCbPrintfW(line, sizeof(line), L"frame %llu missed its deadline by %u us (work %u us)\n",
+                static_cast<unsigned long long>(missed.frameIndex), missed.latenessMicroseconds,
+                missed.workMicroseconds);
+            OutputDebugStringW(line);
+        };
+        renderThread.SetFrameScheduler(pacing);
+    }
+
     MSG message{};
     while(message.message != WM_QUIT)
     {
-        if(PeekMessageW(&message, nullptr, 0, 0, PM_REMOVE))
+        if(spin)
+        {
+            if(PeekMessageW(&message, nullptr, 0, 0, PM_REMOVE))
+            {
+                TranslateMessage(&message);
+                DispatchMessageW(&message);
+            }
+        }
+        else
         {
-            TranslateMessage(&message);
-            DispatchMessageW(&message);
+            MsgWaitForMultipleObjectsEx(0, nullptr, APP_TICK_MS, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+            while(message.message != WM_QUIT && PeekMessageW(&message, nullptr, 0, 0, PM_REMOVE))
+            {
+                TranslateMessage(&message);
+                DispatchMessageW(&message);
+            }
         }
-           
-        manager->SpinOnce();
-        window.SpinOnce();
+
+        manager->SpinOnce(&renderThread);
+        loader.Spin(&renderThread);
     }
 
+    // Clients hit-test through the render thread, so they have to be gone first; captured frames have to be
+    // released before the system goes away. Modules remove their elements once no frame draws them anymore.
+    streamer.Stop();
+    vncServer.Stop();
+    renderThread.Stop();
+    loader.Shutdown();
     manager->Release();
 
     return 0;
@@ -456,11 +1131,6 @@ HmiSystemWindow::~HmiSystemWindow()
     delete m_graphics;
 }
 
-void HmiSystemWindow::SpinOnce()
-{
-    m_graphics->Render();
-}
-
 LRESULT HmiSystemWindow::WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
     if(uMsg != WM_CREATE)
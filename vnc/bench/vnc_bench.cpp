@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <benchmark.h>
+#include "encoder.h"
+#include "frame_store.h"
+#include "pixel_format.h"
+#include "tile_diff.h"
+
+// Throughput of the remote framebuffer path: tile diffing alone for every instruction set, and diffing followed by
+// encoding the changed rects. Results use the JSON format of hmi_graphics_bench.
+namespace
+{
+    using hmi_graphics::bench::BenchmarkOptions;
+    using hmi_graphics::bench::BenchmarkRunner;
+    using hmi_graphics::bench::Random;
+
+    constexpr int FRAMES_PER_REPETITION = 4;
+    const double CHANGED_RATIOS[] = {0.0, 0.1, 1.0};
+
+    struct Resolution
+    {
+        int width;
+        int height;
+    };
+
+    // Flat panels with a gradient band, roughly what an HMI frame compresses like.
+    std::vector<uint32_t> MakeFrame(int width, int height, Random* random)
+    {
+        std::vector<uint32_t> pixels(static_cast<size_t>(width) * height);
+        for(int y = 0; y < height; ++y)
+        {
+            const uint32_t panel = (y / 90) % 2 == 0 ? 0xFF303030u : 0xFF3C5A28u;
+            for(int x = 0; x < width; ++x)
+            {
+                const bool band = x > width / 3 && x < width / 3 * 2;
+                pixels[static_cast<size_t>(y) * width + x] = band ? 0xFF000000u | (x * 3 + y) % 256 << 8 : panel;
+            }
+        }
+
+        for(int i = 0; i < width * height / 200; ++i)
+        {
+            pixels[random->NextInt(width * height)] = 0xFFFFFFFFu;
+        }
+
+        return pixels;
+    }
+
+    // Copy of frame with one pixel changed in about ratio of the diff tiles.
+    std::vector<uint32_t> MakeChangedFrame(const std::vector<uint32_t>& frame, int width, int height, double ratio,
+        Random* random)
+    {
+        std::vector<uint32_t> changed = frame;
+        const int tile = vnc::TILE_DIFF_SIZE;
+        for(int y = 0; y < height; y += tile)
+        {
+            for(int x = 0; x < width; x += tile)
+            {
+                if(random->NextInt(1000) >= static_cast<int>(ratio * 1000))
+                    continue;
+
+                // The last pixel of the tile, so comparing it costs the whole tile.
+                const int px = std::min(x + tile, width) - 1;
+                const int py = std::min(y + tile, height) - 1;
+                changed[static_cast<size_t>(py) * width + px] ^= 0x00FFFFFFu;
+            }
+        }
+
+        return changed;
+    }
+
+    void RunTileDiff(BenchmarkRunner* runner, const Resolution& resolution, double ratio)
+    {
+        Random random{runner->GetOptions().seed};
+        const std::vector<uint32_t> previous = MakeFrame(resolution.width, resolution.height, &random);
+        const std::vector<uint32_t> current = MakeChangedFrame(previous, resolution.width, resolution.height, ratio,
+            &random);
+        const double pixels = static_cast<double>(resolution.width) * resolution.height;
+        for(int impl = 0; impl < vnc::TILE_DIFF_IMPL_COUNT; ++impl)
+        {
+            char name[96];
+            std::snprintf(name, sizeof(name), "tile_diff/%s/%dx%d/changed_%g",
+                vnc::GetTileDiffImplName(static_cast<vnc::TileDiffImpl>(impl)), resolution.width, resolution.height, ratio);
+            const hmi_graphics::bench::BenchmarkParameters parameters{{"width", resolution.width},
+                {"height", resolution.height}, {"changedRatio", ratio}};
+            if(!runner->IsSelected(name))
+                continue;
+
+            if(vnc::GetTileCompareFunction(static_cast<vnc::TileDiffImpl>(impl)) == nullptr)
+            {
+                runner->Skip(name, parameters, "instruction set not available");
+                continue;
+            }
+
+            vnc::TileDiff diff{static_cast<vnc::TileDiffImpl>(impl)};
+            std::vector<vnc::Rect> changed;
+            const vnc::Rect area{0, 0, resolution.width, resolution.height};
+            auto* result = runner->Run(name, parameters, [&]()
+            {
+                for(int frame = 0; frame < FRAMES_PER_REPETITION; ++frame)
+                {
+                    changed.clear();
+                    diff.Diff(previous.data(), resolution.width, current.data(), resolution.width, area, &changed);
+                }
+
+                return static_cast<uint64_t>(FRAMES_PER_REPETITION);
+            });
+
+            if(result != nullptr)
+            {
+                result->metrics.emplace_back("changedRects", static_cast<double>(changed.size()));
+                result->metrics.emplace_back("gigabytesPerSecond", pixels * 4 * 2 / result->medianNanoseconds);
+            }
+        }
+    }
+
+    // A frame update as the server does it: diff the whole frame against the store, then encode what changed.
+    void RunUpdate(BenchmarkRunner* runner, const Resolution& resolution, double ratio, vnc::Encoding encoding,
+        const char* encodingName)
+    {
+        char name[96];
+        std::snprintf(name, sizeof(name), "update/%s/%dx%d/changed_%g", encodingName, resolution.width,
+            resolution.height, ratio);
+        if(!runner->IsSelected(name))
+            return;
+
+        Random random{runner->GetOptions().seed};
+        const std::vector<uint32_t> first = MakeFrame(resolution.width, resolution.height, &random);
+        const std::vector<uint32_t> second = MakeChangedFrame(first, resolution.width, resolution.height, ratio, &random);
+        const vnc::Framebuffer frames[2] = {
+            {first.data(), resolution.width, resolution.height, resolution.width},
+            {second.data(), resolution.width, resolution.height, resolution.width}};
+        vnc::FrameStore store;
+        store.Reset(resolution.width, resolution.height);
+        const vnc::Rect whole = store.GetBounds();
+        std::vector<vnc::Rect> changed;
+        store.Update(frames[0], &whole, 1, &changed);
+
+        const vnc::PixelWriter writer{vnc::MakeServerPixelFormat(), encoding == vnc::ENCODING_ZRLE};
+        vnc::ZrleEncoder zrle;
+        std::vector<uint32_t> pixels;
+        std::vector<uint8_t> message;
+        size_t bytes = 0;
+        size_t rects = 0;
+        // Alternating between the two frames makes every update carry the same change.
+        int next = 1;
+        auto* result = runner->Run(name, {{"width", resolution.width}, {"height", resolution.height},
+            {"changedRatio", ratio}}, [&]()
+        {
+            bytes = 0;
+            rects = 0;
+            for(int frame = 0; frame < FRAMES_PER_REPETITION; ++frame)
+            {
+                changed.clear();
+                store.Update(frames[next], &whole, 1, &changed);
+                next ^= 1;
+                message.clear();
+                for(auto& rect: changed)
+                {
+                    store.Read(rect, &pixels);
+                    const vnc::PixelRect source{pixels.data(), rect.width, rect.width, rect.height};
+                    switch(encoding)
+                    {
+                    case vnc::ENCODING_ZRLE:
+                        zrle.Encode(source, writer, &message);
+                        break;
+                    case vnc::ENCODING_HEXTILE:
+                        vnc::EncodeHextile(source, writer, &message);
+                        break;
+                    default:
+                        vnc::EncodeRaw(source, writer, &message);
+                        break;
+                    }
+                }
+
+                bytes += message.size();
+                rects += changed.size();
+            }
+
+            return static_cast<uint64_t>(FRAMES_PER_REPETITION);
+        });
+
+        if(result != nullptr)
+        {
+            result->metrics.emplace_back("bytesPerFrame", static_cast<double>(bytes) / FRAMES_PER_REPETITION);
+            result->metrics.emplace_back("rectsPerFrame", static_cast<double>(rects) / FRAMES_PER_REPETITION);
+        }
+    }
+
+    void PrintUsage()
+    {
+        std::fprintf(stderr,
+            "usage: vnc_bench [options]\n"
+            "  --filter=TEXT            run benchmarks whose name contains TEXT\n"
+            "  --out=PATH               write JSON results to PATH instead of stdout\n"
+            "  --seed=N                 frame generator seed (default 1)\n"
+            "  --repetitions=N          timed repetitions per benchmark (default 10)\n"
+            "  --resolutions=WxH,...    frame sizes (default 800x600,1280x720,1920x1080,2560x1440,3840x2160)\n");
+    }
+
+    bool ParseResolutions(const char* text, std::vector<Resolution>* resolutions)
+    {
+        resolutions->clear();
+        std::stringstream stream{text};
+        std::string item;
+        while(std::getline(stream, item, ','))
+        {
+            Resolution resolution{};
+            if(std::sscanf(item.c_str(), "%dx%d", &resolution.width, &resolution.height) != 2
+                || resolution.width <= 0 || resolution.height <= 0 || resolution.width > UINT16_MAX
+                || resolution.height > UINT16_MAX)
+            {
+                return false;
+            }
+
+            resolutions->push_back(resolution);
+        }
+
+        return !resolutions->empty();
+    }
+
+    bool MatchOption(const char* argument, const char* option, const char** value)
+    {
+        const size_t length = std::strlen(option);
+        if(std::strncmp(argument, option, length) != 0 || argument[length] != '=')
+            return false;
+
+        *value = argument + length + 1;
+        return true;
+    }
+
+    bool ParseOptions(int argc, char** argv, BenchmarkOptions* options, std::vector<Resolution>* resolutions)
+    {
+        for(int i = 1; i < argc; ++i)
+        {
+            const char* value = nullptr;
+            if(MatchOption(argv[i], "--filter", &value))
+            {
+                options->filter = value;
+            }
+            else if(MatchOption(argv[i], "--out", &value))
+            {
+                options->outputPath = value;
+            }
+            else if(MatchOption(argv[i], "--seed", &value))
+            {
+                options->seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            }
+            else if(MatchOption(argv[i], "--repetitions", &value))
+            {
+                options->repetitions = std::atoi(value);
+            }
+            else if(MatchOption(argv[i], "--resolutions", &value))
+            {
+                if(!ParseResolutions(value, resolutions))
+                    return false;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    struct FileCloser
+    {
+        void operator()(std::FILE* file) const
+        {
+            std::fclose(file);
+        }
+    };
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions options{};
+    options.seed = 1;
+    options.repetitions = 10;
+    std::vector<Resolution> resolutions{{800, 600}, {1280, 720}, {1920, 1080}, {2560, 1440}, {3840, 2160}};
+    if(!ParseOptions(argc, argv, &options, &resolutions))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    BenchmarkRunner runner{options};
+    for(auto& resolution: resolutions)
+    {
+        for(double ratio: CHANGED_RATIOS)
+        {
+            RunTileDiff(&runner, resolution, ratio);
+            RunUpdate(&runner, resolution, ratio, vnc::ENCODING_ZRLE, "zrle");
+            RunUpdate(&runner, resolution, ratio, vnc::ENCODING_HEXTILE, "hextile");
+            RunUpdate(&runner, resolution, ratio, vnc::ENCODING_RAW, "raw");
+        }
+    }
+
+    if(options.outputPath.empty())
+        return runner.WriteJson(stdout) ? 0 : 1;
+
+    std::unique_ptr<std::FILE, FileCloser> file{std::fopen(options.outputPath.c_str(), "w")};
+    if(!file)
+    {
+        std::fprintf(stderr, "cannot open %s\n", options.outputPath.c_str());
+        return 1;
+    }
+
+    return runner.WriteJson(file.get()) ? 0 : 1;
+}
@@ -1,12 +1,90 @@
 #ifndef VNC_VNC_H
 #define VNC_VNC_H
 
+#include <cstddef>
+#include <cstdint>
+
 namespace vnc
 {
-    class Client
+    struct Rect
+    {
+      int x;
+      int y;
+      int width;
+      int height;
+    };
+
+    // R8G8B8A8 pixels in memory order, i.e. 0xAABBGGRR when read as uint32_t; alpha is ignored. stride is in pixels.
+    struct Framebuffer
+    {
+      const uint32_t* pixels;
+      int width;
+      int height;
+      int stride;
+    };
+
+    enum Encoding: int32_t
+    {
+        ENCODING_RAW = 0,
+        ENCODING_COPY_RECT = 1,
+        ENCODING_HEXTILE = 5,
+        ENCODING_ZRLE = 16,
+    };
+
+    // Called from the client connection threads, concurrently when several clients are connected.
+    class InputHandler
+    {
+    public:
+        virtual ~InputHandler() = default;
+
+        // buttonMask has bit 0 for the left, 1 for the middle and 2 for the right button.
+        virtual void OnPointerEvent(int x, int y, uint8_t buttonMask) = 0;
+
+        // keysym as defined by X11.
+        virtual void OnKeyEvent(uint32_t keysym, bool down) = 0;
+    };
+
+    struct ServerOptions
+    {
+      // Dotted IPv4 address to listen on; "127.0.0.1" for local clients only.
+      const char* bindAddress;
+      // 0 picks a free port, see Server::GetPort.
+      uint16_t port;
+      const char* desktopName;
+      size_t maxClients;
+    };
+
+    // RFB 3.8 server (also accepting 3.3 and 3.7 clients) without authentication. Keeps a copy of the frame and
+    // sends each client the rectangles damaged since its last update, encoded with the best encoding it supports
+    // among ZRLE, Hextile and Raw. Every client has a thread reading its messages and one encoding its updates.
+    class Server
     {
       class PImpl;
     public:
+        Server();
+
+        Server(const Server&) = delete;
+
+        ~Server();
+
+        bool Start(const ServerOptions& options, int width, int height, InputHandler* input);
+
+        // Disconnects every client and stops listening; safe to call more than once.
+        void Stop();
+
+        uint16_t GetPort() const;
+
+        size_t GetClientCount() const;
+
+        // Copies the damaged rects of frame, which must be the size given to Start, and queues them for every client.
+        // Damage is refined by comparing 64x64 tiles with the previous frame, so only tiles that changed are sent.
+        void UpdateFramebuffer(const Framebuffer& frame, const Rect* damage, size_t count);
+
+        // For applications that do not track damage: the whole frame is compared with the previous one.
+        void UpdateFramebuffer(const Framebuffer& frame);
+
+        // Moves a rect of the frame, e.g. for scrolling. Clients supporting CopyRect get the move instead of pixels.
+        void CopyRect(const Rect& destination, int sourceX, int sourceY);
 
     private:
         PImpl *impl;
@@ -0,0 +1,373 @@
+#include "client_session.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include "rfb.h"
+
+namespace vnc
+{
+    namespace
+    {
+        // Larger messages are a broken or hostile client.
+        constexpr uint32_t MAX_CUT_TEXT_LENGTH = 1024 * 1024;
+        constexpr uint16_t MAX_ENCODING_COUNT = 1024;
+    }
+
+    ClientSession::ClientSession(Socket socket, FrameStore* frame, InputHandler* input, const std::string& desktopName)
+        : socket_{std::move(socket)}
+        , frame_{frame}
+        , input_{input}
+        , desktopName_{desktopName}
+        , format_{MakeServerPixelFormat()}
+        , encoding_{ENCODING_RAW}
+        , copyRectSupported_{false}
+        , updateRequested_{false}
+        , closed_{false}
+    {
+    }
+
+    ClientSession::~ClientSession()
+    {
+        Close();
+        Join();
+    }
+
+    void ClientSession::Start()
+    {
+        socket_.SetNoDelay(true);
+        reader_ = std::thread{&ClientSession::ReadLoop, this};
+    }
+
+    void ClientSession::Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+
+        condition_.notify_all();
+        socket_.Shutdown();
+    }
+
+    void ClientSession::Join()
+    {
+        // The reader starts the encoder, so it has to finish first.
+        if(reader_.joinable())
+        {
+            reader_.join();
+        }
+
+        if(encoder_.joinable())
+        {
+            encoder_.join();
+        }
+    }
+
+    bool ClientSession::IsClosed() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return closed_;
+    }
+
+    void ClientSession::AddDamage(const Rect& rect)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.Add(rect);
+        if(updateRequested_)
+        {
+            condition_.notify_one();
+        }
+    }
+
+    void ClientSession::AddCopy(const Rect& destination, int sourceX, int sourceY)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // The client copies from what it has been sent, so a source with unsent damage has to be sent as pixels.
+        const Rect source{sourceX, sourceY, destination.width, destination.height};
+        if(!copyRectSupported_ || pending_.Intersects(source))
+        {
+            pending_.Add(destination);
+        }
+        else
+        {
+            copies_.push_back(CopyOperation{destination, sourceX, sourceY});
+        }
+
+        if(updateRequested_)
+        {
+            condition_.notify_one();
+        }
+    }
+
+    void ClientSession::ReadLoop()
+    {
+        if(Handshake())
+        {
+            encoder_ = std::thread{&ClientSession::EncodeLoop, this};
+            uint8_t type = 0;
+            while(socket_.Receive(&type, 1) && HandleMessage(type))
+            {
+            }
+        }
+
+        Close();
+    }
+
+    bool ClientSession::Handshake()
+    {
+        char version[rfb::PROTOCOL_VERSION_LENGTH + 1] = {};
+        if(!socket_.Send(rfb::PROTOCOL_VERSION, rfb::PROTOCOL_VERSION_LENGTH)
+            || !socket_.Receive(version, rfb::PROTOCOL_VERSION_LENGTH))
+        {
+            return false;
+        }
+
+        if(std::strncmp(version, "RFB 003.", 8) != 0)
+            return false;
+
+        // 3.3 clients get the security type from the server; later ones choose from a list.
+        const int minor = std::atoi(version + 8);
+        std::vector<uint8_t> out;
+        if(minor < 7)
+        {
+            PutU32(&out, rfb::SECURITY_NONE);
+            if(!socket_.Send(out.data(), out.size()))
+                return false;
+        }
+        else
+        {
+            const uint8_t types[2] = {1, rfb::SECURITY_NONE};
+            uint8_t chosen = 0;
+            if(!socket_.Send(types, sizeof(types)) || !socket_.Receive(&chosen, 1))
+                return false;
+
+            if(chosen != rfb::SECURITY_NONE)
+            {
+                if(minor >= 8)
+                {
+                    const char reason[] = "unsupported security type";
+                    PutU32(&out, rfb::SECURITY_RESULT_FAILED);
+                    PutU32(&out, static_cast<uint32_t>(sizeof(reason) - 1));
+                    out.insert(out.end(), reason, reason + sizeof(reason) - 1);
+                    socket_.Send(out.data(), out.size());
+                }
+
+                return false;
+            }
+
+            // 3.7 only sends a SecurityResult for types with authentication.
+            if(minor >= 8)
+            {
+                PutU32(&out, rfb::SECURITY_RESULT_OK);
+                if(!socket_.Send(out.data(), out.size()))
+                    return false;
+            }
+        }
+
+        // The shared flag does not matter; every client sees the same frame.
+        uint8_t shared = 0;
+        if(!socket_.Receive(&shared, 1))
+            return false;
+
+        out.clear();
+        PutU16(&out, static_cast<uint16_t>(frame_->GetWidth()));
+        PutU16(&out, static_cast<uint16_t>(frame_->GetHeight()));
+        uint8_t format[rfb::PIXEL_FORMAT_SIZE];
+        WritePixelFormat(MakeServerPixelFormat(), format);
+        out.insert(out.end(), format, format + sizeof(format));
+        PutU32(&out, static_cast<uint32_t>(desktopName_.size()));
+        out.insert(out.end(), desktopName_.begin(), desktopName_.end());
+        return socket_.Send(out.data(), out.size());
+    }
+
+    bool ClientSession::HandleMessage(uint8_t type)
+    {
+        uint8_t header[19];
+        switch(type)
+        {
+        case rfb::SET_PIXEL_FORMAT:
+        {
+            if(!socket_.Receive(header, 3 + rfb::PIXEL_FORMAT_SIZE))
+                return false;
+
+            const PixelFormat format = ReadPixelFormat(header + 3);
+            if(!IsSupportedPixelFormat(format))
+                return false;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            format_ = format;
+            return true;
+        }
+        case rfb::SET_ENCODINGS:
+        {
+            if(!socket_.Receive(header, 3))
+                return false;
+
+            const uint16_t count = GetU16(header + 1);
+            if(count > MAX_ENCODING_COUNT)
+                return false;
+
+            std::vector<uint8_t> encodings(static_cast<size_t>(count) * 4);
+            if(!encodings.empty() && !socket_.Receive(encodings.data(), encodings.size()))
+                return false;
+
+            // The client lists encodings in order of preference.
+            int32_t preferred = ENCODING_RAW;
+            bool preferredFound = false;
+            bool copyRect = false;
+            for(size_t i = 0; i < count; ++i)
+            {
+                const int32_t encoding = static_cast<int32_t>(GetU32(encodings.data() + i * 4));
+                if(encoding == ENCODING_COPY_RECT)
+                {
+                    copyRect = true;
+                }
+                else if(!preferredFound && (encoding == ENCODING_ZRLE || encoding == ENCODING_HEXTILE || encoding == ENCODING_RAW))
+                {
+                    preferred = encoding;
+                    preferredFound = true;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            encoding_ = preferred;
+            copyRectSupported_ = copyRect;
+            return true;
+        }
+        case rfb::FRAMEBUFFER_UPDATE_REQUEST:
+        {
+            if(!socket_.Receive(header, 9))
+                return false;
+
+            const bool incremental = header[0] != 0;
+            const Rect requested{GetU16(header + 1), GetU16(header + 3), GetU16(header + 5), GetU16(header + 7)};
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(!incremental)
+            {
+                pending_.Add(IntersectRects(requested, frame_->GetBounds()));
+            }
+
+            updateRequested_ = true;
+            condition_.notify_one();
+            return true;
+        }
+        case rfb::KEY_EVENT:
+        {
+            if(!socket_.Receive(header, 7))
+                return false;
+
+            if(input_ != nullptr)
+            {
+                input_->OnKeyEvent(GetU32(header + 3), header[0] != 0);
+            }
+
+            return true;
+        }
+        case rfb::POINTER_EVENT:
+        {
+            if(!socket_.Receive(header, 5))
+                return false;
+
+            if(input_ != nullptr)
+            {
+                const int x = std::min<int>(GetU16(header + 1), frame_->GetWidth() - 1);
+                const int y = std::min<int>(GetU16(header + 3), frame_->GetHeight() - 1);
+                input_->OnPointerEvent(x, y, header[0]);
+            }
+
+            return true;
+        }
+        case rfb::CLIENT_CUT_TEXT:
+        {
+            if(!socket_.Receive(header, 7))
+                return false;
+
+            const uint32_t length = GetU32(header + 3);
+            if(length > MAX_CUT_TEXT_LENGTH)
+                return false;
+
+            std::vector<uint8_t> text(length);
+            return length == 0 || socket_.Receive(text.data(), text.size());
+        }
+        default:
+            // Unknown messages have unknown lengths, so the stream cannot be resynchronized.
+            return false;
+        }
+    }
+
+    void ClientSession::EncodeLoop()
+    {
+        std::vector<CopyOperation> copies;
+        std::vector<Rect> rects;
+        while(true)
+        {
+            PixelFormat format{};
+            int32_t encoding = ENCODING_RAW;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [this]()
+                {
+                    return closed_ || (updateRequested_ && (!pending_.IsEmpty() || !copies_.empty()));
+                });
+
+                if(closed_)
+                    break;
+
+                copies.swap(copies_);
+                copies_.clear();
+                rects = pending_.GetRects();
+                pending_.Clear();
+                updateRequested_ = false;
+                format = format_;
+                encoding = encoding_;
+            }
+
+            if(!SendUpdate(copies, rects, format, encoding))
+                break;
+        }
+
+        Close();
+    }
+
+    bool ClientSession::SendUpdate(const std::vector<CopyOperation>& copies, const std::vector<Rect>& rects,
+        const PixelFormat& format, int32_t encoding)
+    {
+        message_.clear();
+        PutU8(&message_, rfb::FRAMEBUFFER_UPDATE);
+        PutU8(&message_, 0);
+        PutU16(&message_, static_cast<uint16_t>(copies.size() + rects.size()));
+
+        // Copies go first: they refer to what the client had before this update.
+        for(auto& copy: copies)
+        {
+            const Rect& rect = copy.destination;
+            PutRectHeader(&message_, rect.x, rect.y, rect.width, rect.height, ENCODING_COPY_RECT);
+            PutU16(&message_, static_cast<uint16_t>(copy.sourceX));
+            PutU16(&message_, static_cast<uint16_t>(copy.sourceY));
+        }
+
+        const PixelWriter writer{format, encoding == ENCODING_ZRLE};
+        for(auto& rect: rects)
+        {
+            frame_->Read(rect, &pixels_);
+            const PixelRect pixels{pixels_.data(), rect.width, rect.width, rect.height};
+            PutRectHeader(&message_, rect.x, rect.y, rect.width, rect.height, encoding);
+            switch(encoding)
+            {
+            case ENCODING_ZRLE:
+                zrle_.Encode(pixels, writer, &message_);
+                break;
+            case ENCODING_HEXTILE:
+                EncodeHextile(pixels, writer, &message_);
+                break;
+            default:
+                EncodeRaw(pixels, writer, &message_);
+                break;
+            }
+        }
+
+        return socket_.Send(message_.data(), message_.size());
+    }
+}
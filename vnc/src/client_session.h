@@ -0,0 +1,86 @@
+#ifndef VNC_CLIENT_SESSION_H
+#define VNC_CLIENT_SESSION_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <vnc/vnc.h>
+#include "encoder.h"
+#include "frame_store.h"
+#include "pixel_format.h"
+#include "socket.h"
+#include "update_region.h"
+
+namespace vnc
+{
+    // One connected client. The reader thread runs the handshake and handles client messages; the encoder thread
+    // waits for an update request with pending damage, encodes it from the frame store and sends it.
+    class ClientSession
+    {
+    public:
+        ClientSession(Socket socket, FrameStore* frame, InputHandler* input, const std::string& desktopName);
+
+        ClientSession(const ClientSession&) = delete;
+
+        ~ClientSession();
+
+        void Start();
+
+        // Disconnects; the threads finish on their own, Join waits for them.
+        void Close();
+
+        void Join();
+
+        bool IsClosed() const;
+
+        void AddDamage(const Rect& rect);
+
+        void AddCopy(const Rect& destination, int sourceX, int sourceY);
+
+    private:
+        struct CopyOperation
+        {
+            Rect destination;
+            int sourceX;
+            int sourceY;
+        };
+
+        void ReadLoop();
+
+        bool Handshake();
+
+        bool HandleMessage(uint8_t type);
+
+        void EncodeLoop();
+
+        bool SendUpdate(const std::vector<CopyOperation>& copies, const std::vector<Rect>& rects,
+            const PixelFormat& format, int32_t encoding);
+
+        Socket socket_;
+        FrameStore* frame_;
+        InputHandler* input_;
+        std::string desktopName_;
+        std::thread reader_;
+        std::thread encoder_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable condition_;
+        UpdateRegion pending_;
+        std::vector<CopyOperation> copies_;
+        PixelFormat format_;
+        int32_t encoding_;
+        bool copyRectSupported_;
+        bool updateRequested_;
+        bool closed_;
+
+        // Encoder thread only.
+        ZrleEncoder zrle_;
+        std::vector<uint32_t> pixels_;
+        std::vector<uint8_t> message_;
+    };
+}
+
+#endif //VNC_CLIENT_SESSION_H
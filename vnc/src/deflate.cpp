@@ -0,0 +1,205 @@
+#include "deflate.h"
+
+#include <algorithm>
+
+namespace vnc
+{
+    namespace
+    {
+        constexpr int HASH_BITS = 15;
+        constexpr uint32_t HASH_SIZE = 1u << HASH_BITS;
+        constexpr uint32_t WINDOW_SIZE = 32768;
+        constexpr uint32_t MIN_MATCH = 3;
+        constexpr uint32_t MAX_MATCH = 258;
+        constexpr int MAX_CHAIN = 32;
+        constexpr uint32_t END_OF_BLOCK = 256;
+
+        constexpr uint16_t LENGTH_BASE[29] = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        constexpr uint8_t LENGTH_EXTRA[29] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        constexpr uint16_t DISTANCE_BASE[30] = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+            6145, 8193, 12289, 16385, 24577};
+        constexpr uint8_t DISTANCE_EXTRA[30] = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+        uint32_t Hash(const uint8_t* data)
+        {
+            const uint32_t value = static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8
+                | static_cast<uint32_t>(data[2]) << 16;
+            return (value * 2654435761u) >> (32 - HASH_BITS);
+        }
+    }
+
+    ZlibStream::ZlibStream()
+        : out_{nullptr}
+        , bitBuffer_{0}
+        , bitCount_{0}
+        , headerWritten_{false}
+        , head_(HASH_SIZE, -1)
+    {
+    }
+
+    void ZlibStream::Compress(const uint8_t* data, size_t size, std::vector<uint8_t>* out)
+    {
+        out_ = out;
+        if(!headerWritten_)
+        {
+            // Deflate with a 32K window and no preset dictionary.
+            out->push_back(0x78);
+            out->push_back(0x01);
+            headerWritten_ = true;
+        }
+
+        // Not the final block, fixed Huffman codes.
+        PutBits(0, 1);
+        PutBits(1, 2);
+
+        std::fill(head_.begin(), head_.end(), -1);
+        previous_.assign(size, -1);
+        size_t position = 0;
+        while(position < size)
+        {
+            uint32_t bestLength = 0;
+            uint32_t bestDistance = 0;
+            if(position + MIN_MATCH <= size)
+            {
+                const uint32_t hash = Hash(data + position);
+                const uint32_t limit = static_cast<uint32_t>(std::min<size_t>(MAX_MATCH, size - position));
+                int32_t candidate = head_[hash];
+                for(int chain = 0; candidate >= 0 && chain < MAX_CHAIN; ++chain)
+                {
+                    const uint32_t distance = static_cast<uint32_t>(position - candidate);
+                    if(distance > WINDOW_SIZE)
+                        break;
+
+                    uint32_t length = 0;
+                    while(length < limit && data[candidate + length] == data[position + length])
+                    {
+                        ++length;
+                    }
+
+                    if(length > bestLength)
+                    {
+                        bestLength = length;
+                        bestDistance = distance;
+                        if(length == limit)
+                            break;
+                    }
+
+                    candidate = previous_[candidate];
+                }
+
+                previous_[position] = head_[hash];
+                head_[hash] = static_cast<int32_t>(position);
+            }
+
+            if(bestLength < MIN_MATCH)
+            {
+                PutLiteral(data[position]);
+                ++position;
+                continue;
+            }
+
+            PutMatch(bestLength, bestDistance);
+            // Index the covered positions so later matches can start inside this one.
+            const size_t end = position + bestLength;
+            for(++position; position < end; ++position)
+            {
+                if(position + MIN_MATCH <= size)
+                {
+                    const uint32_t hash = Hash(data + position);
+                    previous_[position] = head_[hash];
+                    head_[hash] = static_cast<int32_t>(position);
+                }
+            }
+        }
+
+        PutLiteral(END_OF_BLOCK);
+
+        // Sync flush: an empty stored block ends on a byte boundary.
+        PutBits(0, 3);
+        AlignToByte();
+        out->push_back(0x00);
+        out->push_back(0x00);
+        out->push_back(0xFF);
+        out->push_back(0xFF);
+        out_ = nullptr;
+    }
+
+    void ZlibStream::PutBits(uint32_t value, int count)
+    {
+        bitBuffer_ |= value << bitCount_;
+        bitCount_ += count;
+        while(bitCount_ >= 8)
+        {
+            out_->push_back(static_cast<uint8_t>(bitBuffer_));
+            bitBuffer_ >>= 8;
+            bitCount_ -= 8;
+        }
+    }
+
+    void ZlibStream::PutCode(uint32_t code, int length)
+    {
+        uint32_t reversed = 0;
+        for(int i = 0; i < length; ++i)
+        {
+            reversed = reversed << 1 | (code >> i & 1);
+        }
+
+        PutBits(reversed, length);
+    }
+
+    void ZlibStream::PutLiteral(uint32_t symbol)
+    {
+        if(symbol < 144)
+        {
+            PutCode(0x30 + symbol, 8);
+        }
+        else if(symbol < 256)
+        {
+            PutCode(0x190 + symbol - 144, 9);
+        }
+        else if(symbol < 280)
+        {
+            PutCode(symbol - 256, 7);
+        }
+        else
+        {
+            PutCode(0xC0 + symbol - 280, 8);
+        }
+    }
+
+    void ZlibStream::PutMatch(uint32_t length, uint32_t distance)
+    {
+        int lengthCode = 28;
+        while(LENGTH_BASE[lengthCode] > length)
+        {
+            --lengthCode;
+        }
+
+        PutLiteral(257 + lengthCode);
+        PutBits(length - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode]);
+
+        int distanceCode = 29;
+        while(DISTANCE_BASE[distanceCode] > distance)
+        {
+            --distanceCode;
+        }
+
+        PutCode(static_cast<uint32_t>(distanceCode), 5);
+        PutBits(distance - DISTANCE_BASE[distanceCode], DISTANCE_EXTRA[distanceCode]);
+    }
+
+    void ZlibStream::AlignToByte()
+    {
+        if(bitCount_ > 0)
+        {
+            out_->push_back(static_cast<uint8_t>(bitBuffer_));
+        }
+
+        bitBuffer_ = 0;
+        bitCount_ = 0;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef VNC_DEFLATE_H
+#define VNC_DEFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vnc
+{
+    // Writer side of one zlib stream, as ZRLE keeps a single stream per connection. Each Compress call appends one
+    // block with the fixed Huffman codes of deflate, using greedy LZ77 matches within the call's input, followed by
+    // a sync flush so the receiver can inflate everything written so far. The stream is never finished.
+    class ZlibStream
+    {
+    public:
+        ZlibStream();
+
+        void Compress(const uint8_t* data, size_t size, std::vector<uint8_t>* out);
+
+    private:
+        void PutBits(uint32_t value, int count);
+
+        // Huffman codes are sent most significant bit first.
+        void PutCode(uint32_t code, int length);
+
+        void PutLiteral(uint32_t symbol);
+
+        void PutMatch(uint32_t length, uint32_t distance);
+
+        void AlignToByte();
+
+        std::vector<uint8_t>* out_;
+        uint32_t bitBuffer_;
+        int bitCount_;
+        bool headerWritten_;
+        std::vector<int32_t> head_;
+        std::vector<int32_t> previous_;
+    };
+}
+
+#endif //VNC_DEFLATE_H
@@ -0,0 +1,376 @@
+#include "encoder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include "rfb.h"
+
+namespace vnc
+{
+    namespace
+    {
+        enum HextileFlags: uint8_t
+        {
+            HEXTILE_RAW = 1,
+            HEXTILE_BACKGROUND_SPECIFIED = 2,
+            HEXTILE_FOREGROUND_SPECIFIED = 4,
+            HEXTILE_ANY_SUBRECTS = 8,
+            HEXTILE_SUBRECTS_COLOURED = 16,
+        };
+
+        constexpr uint8_t ZRLE_RAW = 0;
+        constexpr uint8_t ZRLE_SOLID = 1;
+        constexpr uint8_t ZRLE_PLAIN_RLE = 128;
+        constexpr size_t ZRLE_MAX_PALETTE = 127;
+        constexpr size_t ZRLE_MAX_PACKED_PALETTE = 16;
+
+        struct Subrect
+        {
+            uint32_t pixel;
+            uint8_t x;
+            uint8_t y;
+            uint8_t width;
+            uint8_t height;
+        };
+
+        uint32_t GetPixel(const PixelRect& rect, int x, int y)
+        {
+            return rect.pixels[static_cast<size_t>(y) * rect.stride + x];
+        }
+
+        PixelRect GetTile(const PixelRect& rect, int x, int y, int size)
+        {
+            return PixelRect{rect.pixels + static_cast<size_t>(y) * rect.stride + x, rect.stride,
+                std::min(size, rect.width - x), std::min(size, rect.height - y)};
+        }
+
+        // Most frequent of the first two colours, and whether the tile has more than two.
+        uint32_t FindBackground(const PixelRect& tile, bool* multiColour)
+        {
+            const uint32_t first = GetPixel(tile, 0, 0);
+            uint32_t second = first;
+            int firstCount = 0;
+            int secondCount = 0;
+            *multiColour = false;
+            for(int y = 0; y < tile.height; ++y)
+            {
+                for(int x = 0; x < tile.width; ++x)
+                {
+                    const uint32_t pixel = GetPixel(tile, x, y);
+                    if(pixel == first)
+                    {
+                        ++firstCount;
+                    }
+                    else if(secondCount == 0 || pixel == second)
+                    {
+                        second = pixel;
+                        ++secondCount;
+                    }
+                    else
+                    {
+                        *multiColour = true;
+                    }
+                }
+            }
+
+            return firstCount >= secondCount ? first : second;
+        }
+
+        // Greedy cover of the non-background pixels with single-colour rectangles; false when there are too many.
+        bool FindSubrects(const PixelRect& tile, uint32_t background, std::vector<Subrect>* subrects)
+        {
+            bool covered[rfb::HEXTILE_TILE_SIZE][rfb::HEXTILE_TILE_SIZE] = {};
+            subrects->clear();
+            for(int y = 0; y < tile.height; ++y)
+            {
+                for(int x = 0; x < tile.width; ++x)
+                {
+                    const uint32_t pixel = GetPixel(tile, x, y);
+                    if(pixel == background || covered[y][x])
+                        continue;
+
+                    int width = 1;
+                    while(x + width < tile.width && !covered[y][x + width] && GetPixel(tile, x + width, y) == pixel)
+                    {
+                        ++width;
+                    }
+
+                    int height = 1;
+                    for(; y + height < tile.height; ++height)
+                    {
+                        bool rowMatches = true;
+                        for(int column = x; column < x + width && rowMatches; ++column)
+                        {
+                            rowMatches = !covered[y + height][column] && GetPixel(tile, column, y + height) == pixel;
+                        }
+
+                        if(!rowMatches)
+                            break;
+                    }
+
+                    for(int row = y; row < y + height; ++row)
+                    {
+                        std::fill(covered[row] + x, covered[row] + x + width, true);
+                    }
+
+                    if(subrects->size() == 255)
+                        return false;
+
+                    subrects->push_back(Subrect{pixel, static_cast<uint8_t>(x), static_cast<uint8_t>(y),
+                        static_cast<uint8_t>(width), static_cast<uint8_t>(height)});
+                }
+            }
+
+            return true;
+        }
+
+        void AppendRawPixels(const PixelRect& rect, const PixelWriter& writer, std::vector<uint8_t>* out)
+        {
+            for(int y = 0; y < rect.height; ++y)
+            {
+                writer.AppendRow(rect.pixels + static_cast<size_t>(y) * rect.stride, static_cast<size_t>(rect.width), out);
+            }
+        }
+
+        size_t GetRunLengthSize(uint32_t length)
+        {
+            return (length - 1) / 255 + 1;
+        }
+
+        // Run lengths are sent minus one, as a sequence of 255s and a final byte below 255.
+        void AppendRunLength(uint32_t length, std::vector<uint8_t>* out)
+        {
+            uint32_t remaining = length - 1;
+            while(remaining >= 255)
+            {
+                out->push_back(255);
+                remaining -= 255;
+            }
+
+            out->push_back(static_cast<uint8_t>(remaining));
+        }
+    }
+
+    void EncodeRaw(const PixelRect& rect, const PixelWriter& writer, std::vector<uint8_t>* out)
+    {
+        AppendRawPixels(rect, writer, out);
+    }
+
+    void EncodeHextile(const PixelRect& rect, const PixelWriter& writer, std::vector<uint8_t>* out)
+    {
+        const size_t pixelSize = writer.GetPixelSize();
+        std::vector<Subrect> subrects;
+        uint32_t background = 0;
+        bool backgroundValid = false;
+        for(int y = 0; y < rect.height; y += rfb::HEXTILE_TILE_SIZE)
+        {
+            for(int x = 0; x < rect.width; x += rfb::HEXTILE_TILE_SIZE)
+            {
+                const PixelRect tile = GetTile(rect, x, y, rfb::HEXTILE_TILE_SIZE);
+                const size_t rawSize = 1 + static_cast<size_t>(tile.width) * tile.height * pixelSize;
+                bool multiColour = false;
+                const uint32_t tileBackground = FindBackground(tile, &multiColour);
+                const bool sendBackground = !backgroundValid || tileBackground != background;
+                uint8_t flags = sendBackground ? HEXTILE_BACKGROUND_SPECIFIED : 0;
+                size_t size = 1 + (sendBackground ? pixelSize : 0);
+                const bool fits = FindSubrects(tile, tileBackground, &subrects);
+                if(!subrects.empty())
+                {
+                    flags |= HEXTILE_ANY_SUBRECTS;
+                    if(multiColour)
+                    {
+                        flags |= HEXTILE_SUBRECTS_COLOURED;
+                        size += 1 + subrects.size() * (pixelSize + 2);
+                    }
+                    else
+                    {
+                        flags |= HEXTILE_FOREGROUND_SPECIFIED;
+                        size += pixelSize + 1 + subrects.size() * 2;
+                    }
+                }
+
+                if(!fits || size >= rawSize)
+                {
+                    // Raw tiles leave the background undefined for the next tile.
+                    out->push_back(HEXTILE_RAW);
+                    AppendRawPixels(tile, writer, out);
+                    backgroundValid = false;
+                    continue;
+                }
+
+                out->push_back(flags);
+                if(sendBackground)
+                {
+                    writer.Append(tileBackground, out);
+                    background = tileBackground;
+                    backgroundValid = true;
+                }
+
+                if(subrects.empty())
+                    continue;
+
+                if(!multiColour)
+                {
+                    writer.Append(subrects.front().pixel, out);
+                }
+
+                out->push_back(static_cast<uint8_t>(subrects.size()));
+                for(auto& subrect: subrects)
+                {
+                    if(multiColour)
+                    {
+                        writer.Append(subrect.pixel, out);
+                    }
+
+                    out->push_back(static_cast<uint8_t>(subrect.x << 4 | subrect.y));
+                    out->push_back(static_cast<uint8_t>((subrect.width - 1) << 4 | (subrect.height - 1)));
+                }
+            }
+        }
+    }
+
+    void ZrleEncoder::Encode(const PixelRect& rect, const PixelWriter& writer, std::vector<uint8_t>* out)
+    {
+        tiles_.clear();
+        for(int y = 0; y < rect.height; y += rfb::ZRLE_TILE_SIZE)
+        {
+            for(int x = 0; x < rect.width; x += rfb::ZRLE_TILE_SIZE)
+            {
+                EncodeTile(GetTile(rect, x, y, rfb::ZRLE_TILE_SIZE), writer);
+            }
+        }
+
+        const size_t lengthOffset = out->size();
+        PutU32(out, 0);
+        stream_.Compress(tiles_.data(), tiles_.size(), out);
+        PatchU32(out, lengthOffset, static_cast<uint32_t>(out->size() - lengthOffset - 4));
+    }
+
+    void ZrleEncoder::EncodeTile(const PixelRect& tile, const PixelWriter& writer)
+    {
+        // Runs continue across rows; the palette is only tracked while it stays small enough to use.
+        runs_.clear();
+        palette_.clear();
+        bool paletteValid = true;
+        for(int y = 0; y < tile.height; ++y)
+        {
+            for(int x = 0; x < tile.width; ++x)
+            {
+                const uint32_t pixel = GetPixel(tile, x, y);
+                if(!runs_.empty() && runs_.back().pixel == pixel)
+                {
+                    ++runs_.back().length;
+                    continue;
+                }
+
+                runs_.push_back(Run{pixel, 1});
+                if(paletteValid && std::find(palette_.begin(), palette_.end(), pixel) == palette_.end())
+                {
+                    palette_.push_back(pixel);
+                    paletteValid = palette_.size() <= ZRLE_MAX_PALETTE;
+                }
+            }
+        }
+
+        if(paletteValid && palette_.size() == 1)
+        {
+            tiles_.push_back(ZRLE_SOLID);
+            writer.Append(palette_.front(), &tiles_);
+            return;
+        }
+
+        const size_t pixelSize = writer.GetPixelSize();
+        const size_t pixelCount = static_cast<size_t>(tile.width) * tile.height;
+        const size_t rawSize = pixelCount * pixelSize;
+        size_t plainRleSize = 0;
+        size_t paletteRleSize = paletteValid ? palette_.size() * pixelSize : SIZE_MAX;
+        for(auto& run: runs_)
+        {
+            plainRleSize += pixelSize + GetRunLengthSize(run.length);
+            if(paletteValid)
+            {
+                paletteRleSize += run.length == 1 ? 1 : 1 + GetRunLengthSize(run.length);
+            }
+        }
+
+        int packedBits = 0;
+        size_t packedSize = SIZE_MAX;
+        if(paletteValid && palette_.size() <= ZRLE_MAX_PACKED_PALETTE)
+        {
+            packedBits = palette_.size() <= 2 ? 1 : palette_.size() <= 4 ? 2 : 4;
+            packedSize = palette_.size() * pixelSize + static_cast<size_t>(tile.height) * ((tile.width * packedBits + 7) / 8);
+        }
+
+        const size_t best = std::min({rawSize, plainRleSize, paletteRleSize, packedSize});
+        auto paletteIndex = [this](uint32_t pixel)
+        {
+            return static_cast<uint8_t>(std::find(palette_.begin(), palette_.end(), pixel) - palette_.begin());
+        };
+
+        if(best == packedSize)
+        {
+            tiles_.push_back(static_cast<uint8_t>(palette_.size()));
+            for(auto pixel: palette_)
+            {
+                writer.Append(pixel, &tiles_);
+            }
+
+            // Rows start on a byte boundary, indices are packed from the most significant bit.
+            for(int y = 0; y < tile.height; ++y)
+            {
+                uint32_t bits = 0;
+                int bitCount = 0;
+                for(int x = 0; x < tile.width; ++x)
+                {
+                    bits = bits << packedBits | paletteIndex(GetPixel(tile, x, y));
+                    bitCount += packedBits;
+                    if(bitCount == 8)
+                    {
+                        tiles_.push_back(static_cast<uint8_t>(bits));
+                        bits = 0;
+                        bitCount = 0;
+                    }
+                }
+
+                if(bitCount > 0)
+                {
+                    tiles_.push_back(static_cast<uint8_t>(bits << (8 - bitCount)));
+                }
+            }
+        }
+        else if(best == paletteRleSize)
+        {
+            tiles_.push_back(static_cast<uint8_t>(ZRLE_PLAIN_RLE + palette_.size()));
+            for(auto pixel: palette_)
+            {
+                writer.Append(pixel, &tiles_);
+            }
+
+            for(auto& run: runs_)
+            {
+                const uint8_t index = paletteIndex(run.pixel);
+                if(run.length == 1)
+                {
+                    tiles_.push_back(index);
+                    continue;
+                }
+
+                tiles_.push_back(static_cast<uint8_t>(index | 128));
+                AppendRunLength(run.length, &tiles_);
+            }
+        }
+        else if(best == plainRleSize)
+        {
+            tiles_.push_back(ZRLE_PLAIN_RLE);
+            for(auto& run: runs_)
+            {
+                writer.Append(run.pixel, &tiles_);
+                AppendRunLength(run.length, &tiles_);
+            }
+        }
+        else
+        {
+            tiles_.push_back(ZRLE_RAW);
+            AppendRawPixels(tile, writer, &tiles_);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef VNC_ENCODER_H
+#define VNC_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "deflate.h"
+#include "pixel_format.h"
+
+namespace vnc
+{
+    // Frame pixels of one update rectangle; pixels points at its top-left corner.
+    struct PixelRect
+    {
+        const uint32_t* pixels;
+        int stride;
+        int width;
+        int height;
+    };
+
+    // The encoders append the rectangle's payload, without the rectangle header.
+    void EncodeRaw(const PixelRect& rect, const PixelWriter& writer, std::vector<uint8_t>* out);
+
+    void EncodeHextile(const PixelRect& rect, const PixelWriter& writer, std::vector<uint8_t>* out);
+
+    // ZRLE keeps one zlib stream for the whole connection, so a client needs its own encoder.
+    class ZrleEncoder
+    {
+    public:
+        // writer must be compact, see PixelWriter.
+        void Encode(const PixelRect& rect, const PixelWriter& writer, std::vector<uint8_t>* out);
+
+    private:
+        struct Run
+        {
+            uint32_t pixel;
+            uint32_t length;
+        };
+
+        void EncodeTile(const PixelRect& tile, const PixelWriter& writer);
+
+        ZlibStream stream_;
+        std::vector<uint8_t> tiles_;
+        std::vector<Run> runs_;
+        std::vector<uint32_t> palette_;
+    };
+}
+
+#endif //VNC_ENCODER_H
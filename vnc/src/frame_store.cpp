@@ -0,0 +1,75 @@
+#include "frame_store.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vnc
+{
+    void FrameStore::Reset(int width, int height)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        width_ = width;
+        height_ = height;
+        // Opaque black until the first frame arrives.
+        pixels_.assign(static_cast<size_t>(width) * height, 0xFF000000u);
+    }
+
+    int FrameStore::GetWidth() const
+    {
+        return width_;
+    }
+
+    int FrameStore::GetHeight() const
+    {
+        return height_;
+    }
+
+    Rect FrameStore::GetBounds() const
+    {
+        return Rect{0, 0, width_, height_};
+    }
+
+    void FrameStore::Update(const Framebuffer& frame, const Rect* rects, size_t count, std::vector<Rect>* changed)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(size_t i = 0; i < count; ++i)
+        {
+            // Copying right after each diff makes tiles shared with a later overlapping rect compare equal there.
+            const size_t first = changed->size();
+            diff_.Diff(pixels_.data(), width_, frame.pixels, frame.stride, rects[i], changed);
+            for(size_t j = first; j < changed->size(); ++j)
+            {
+                const Rect& rect = (*changed)[j];
+                for(int y = rect.y; y < rect.y + rect.height; ++y)
+                {
+                    std::memcpy(pixels_.data() + static_cast<size_t>(y) * width_ + rect.x,
+                        frame.pixels + static_cast<size_t>(y) * frame.stride + rect.x, static_cast<size_t>(rect.width) * 4);
+                }
+            }
+        }
+    }
+
+    void FrameStore::Copy(const Rect& destination, int sourceX, int sourceY)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Walk rows away from the overlap so a row is read before it is overwritten.
+        const bool downward = destination.y > sourceY;
+        for(int i = 0; i < destination.height; ++i)
+        {
+            const int row = downward ? destination.height - 1 - i : i;
+            std::memmove(pixels_.data() + static_cast<size_t>(destination.y + row) * width_ + destination.x,
+                pixels_.data() + static_cast<size_t>(sourceY + row) * width_ + sourceX, static_cast<size_t>(destination.width) * 4);
+        }
+    }
+
+    void FrameStore::Read(const Rect& rect, std::vector<uint32_t>* pixels) const
+    {
+        pixels->resize(static_cast<size_t>(rect.width) * rect.height);
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(int y = 0; y < rect.height; ++y)
+        {
+            std::memcpy(pixels->data() + static_cast<size_t>(y) * rect.width,
+                pixels_.data() + static_cast<size_t>(rect.y + y) * width_ + rect.x, static_cast<size_t>(rect.width) * 4);
+        }
+    }
+}
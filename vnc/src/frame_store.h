@@ -0,0 +1,44 @@
+#ifndef VNC_FRAME_STORE_H
+#define VNC_FRAME_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <vnc/vnc.h>
+#include "tile_diff.h"
+
+namespace vnc
+{
+    // The server's copy of the frame. The application thread writes it while client encoder threads read rects out
+    // of it, so every access copies under the lock and encoding happens on the copies.
+    class FrameStore
+    {
+    public:
+        void Reset(int width, int height);
+
+        int GetWidth() const;
+
+        int GetHeight() const;
+
+        Rect GetBounds() const;
+
+        // Rects are expected to be clipped to the bounds. Only the tiles of the rects whose pixels differ from the
+        // stored frame are copied and appended to changed, so damage reported too coarsely costs no bandwidth.
+        void Update(const Framebuffer& frame, const Rect* rects, size_t count, std::vector<Rect>* changed);
+
+        void Copy(const Rect& destination, int sourceX, int sourceY);
+
+        // Copies rect into pixels, tightly packed.
+        void Read(const Rect& rect, std::vector<uint32_t>* pixels) const;
+
+    private:
+        mutable std::mutex mutex_;
+        std::vector<uint32_t> pixels_;
+        int width_ = 0;
+        int height_ = 0;
+        TileDiff diff_;
+    };
+}
+
+#endif //VNC_FRAME_STORE_H
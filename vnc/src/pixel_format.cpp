@@ -0,0 +1,136 @@
+#include "pixel_format.h"
+
+#include <cstring>
+#include "rfb.h"
+
+namespace vnc
+{
+    PixelFormat MakeServerPixelFormat()
+    {
+        return PixelFormat{32, 24, false, true, 255, 255, 255, 0, 8, 16};
+    }
+
+    void WritePixelFormat(const PixelFormat& format, uint8_t* out)
+    {
+        std::memset(out, 0, rfb::PIXEL_FORMAT_SIZE);
+        out[0] = format.bitsPerPixel;
+        out[1] = format.depth;
+        out[2] = format.bigEndian ? 1 : 0;
+        out[3] = format.trueColor ? 1 : 0;
+        out[4] = static_cast<uint8_t>(format.redMax >> 8);
+        out[5] = static_cast<uint8_t>(format.redMax);
+        out[6] = static_cast<uint8_t>(format.greenMax >> 8);
+        out[7] = static_cast<uint8_t>(format.greenMax);
+        out[8] = static_cast<uint8_t>(format.blueMax >> 8);
+        out[9] = static_cast<uint8_t>(format.blueMax);
+        out[10] = format.redShift;
+        out[11] = format.greenShift;
+        out[12] = format.blueShift;
+    }
+
+    PixelFormat ReadPixelFormat(const uint8_t* in)
+    {
+        PixelFormat format{};
+        format.bitsPerPixel = in[0];
+        format.depth = in[1];
+        format.bigEndian = in[2] != 0;
+        format.trueColor = in[3] != 0;
+        format.redMax = GetU16(in + 4);
+        format.greenMax = GetU16(in + 6);
+        format.blueMax = GetU16(in + 8);
+        format.redShift = in[10];
+        format.greenShift = in[11];
+        format.blueShift = in[12];
+        return format;
+    }
+
+    bool IsSupportedPixelFormat(const PixelFormat& format)
+    {
+        if(!format.trueColor)
+            return false;
+
+        return format.bitsPerPixel == 8 || format.bitsPerPixel == 16 || format.bitsPerPixel == 32;
+    }
+
+    PixelWriter::PixelWriter(const PixelFormat& format, bool compact)
+        : format_{format}
+        , pixelSize_{format.bitsPerPixel / 8u}
+        , firstByte_{0}
+        , identity_{false}
+    {
+        const PixelFormat server = MakeServerPixelFormat();
+        identity_ = format.bitsPerPixel == 32 && !format.bigEndian && format.redMax == server.redMax
+            && format.greenMax == server.greenMax && format.blueMax == server.blueMax && format.redShift == server.redShift
+            && format.greenShift == server.greenShift && format.blueShift == server.blueShift;
+        if(!compact || format.bitsPerPixel != 32 || format.depth > 24)
+            return;
+
+        const uint32_t used = static_cast<uint32_t>(format.redMax) << format.redShift
+            | static_cast<uint32_t>(format.greenMax) << format.greenShift
+            | static_cast<uint32_t>(format.blueMax) << format.blueShift;
+        const bool fitsLow = (used & 0xFF000000u) == 0;
+        const bool fitsHigh = (used & 0x000000FFu) == 0;
+        if(!fitsLow && !fitsHigh)
+            return;
+
+        // The three significant bytes are the first three in memory unless the unused byte comes first.
+        pixelSize_ = 3;
+        firstByte_ = fitsLow == format.bigEndian ? 1 : 0;
+    }
+
+    size_t PixelWriter::GetPixelSize() const
+    {
+        return pixelSize_;
+    }
+
+    uint32_t PixelWriter::Convert(uint32_t pixel) const
+    {
+        if(identity_)
+            return pixel & 0x00FFFFFFu;
+
+        const uint32_t red = pixel & 0xFF;
+        const uint32_t green = (pixel >> 8) & 0xFF;
+        const uint32_t blue = (pixel >> 16) & 0xFF;
+        return (red * format_.redMax + 127) / 255 << format_.redShift
+            | (green * format_.greenMax + 127) / 255 << format_.greenShift
+            | (blue * format_.blueMax + 127) / 255 << format_.blueShift;
+    }
+
+    void PixelWriter::Write(uint32_t pixel, uint8_t* out) const
+    {
+        const uint32_t value = Convert(pixel);
+        const size_t bytes = format_.bitsPerPixel / 8u;
+        uint8_t full[4];
+        for(size_t i = 0; i < bytes; ++i)
+        {
+            const size_t shift = format_.bigEndian ? (bytes - 1 - i) * 8 : i * 8;
+            full[i] = static_cast<uint8_t>(value >> shift);
+        }
+
+        std::memcpy(out, full + firstByte_, pixelSize_);
+    }
+
+    void PixelWriter::Append(uint32_t pixel, std::vector<uint8_t>* out) const
+    {
+        const size_t offset = out->size();
+        out->resize(offset + pixelSize_);
+        Write(pixel, out->data() + offset);
+    }
+
+    void PixelWriter::AppendRow(const uint32_t* pixels, size_t count, std::vector<uint8_t>* out) const
+    {
+        const size_t offset = out->size();
+        out->resize(offset + count * pixelSize_);
+        uint8_t* dst = out->data() + offset;
+        if(identity_ && pixelSize_ == 4)
+        {
+            std::memcpy(dst, pixels, count * 4);
+            return;
+        }
+
+        for(size_t i = 0; i < count; ++i)
+        {
+            Write(pixels[i], dst + i * pixelSize_);
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef VNC_PIXEL_FORMAT_H
+#define VNC_PIXEL_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vnc
+{
+    struct PixelFormat
+    {
+        uint8_t bitsPerPixel;
+        uint8_t depth;
+        bool bigEndian;
+        bool trueColor;
+        uint16_t redMax;
+        uint16_t greenMax;
+        uint16_t blueMax;
+        uint8_t redShift;
+        uint8_t greenShift;
+        uint8_t blueShift;
+    };
+
+    // 32-bit little-endian RGB laid out like the frame's R8G8B8A8 pixels.
+    PixelFormat MakeServerPixelFormat();
+
+    void WritePixelFormat(const PixelFormat& format, uint8_t* out);
+
+    PixelFormat ReadPixelFormat(const uint8_t* in);
+
+    // Colour map formats are not supported.
+    bool IsSupportedPixelFormat(const PixelFormat& format);
+
+    // Converts frame pixels to a client's pixel format. Compact writers produce ZRLE's CPIXELs, which drop the unused
+    // byte of 32-bit formats with depth 24 or less.
+    class PixelWriter
+    {
+    public:
+        PixelWriter(const PixelFormat& format, bool compact);
+
+        size_t GetPixelSize() const;
+
+        void Write(uint32_t pixel, uint8_t* out) const;
+
+        void Append(uint32_t pixel, std::vector<uint8_t>* out) const;
+
+        void AppendRow(const uint32_t* pixels, size_t count, std::vector<uint8_t>* out) const;
+
+    private:
+        uint32_t Convert(uint32_t pixel) const;
+
+        PixelFormat format_;
+        size_t pixelSize_;
+        // First byte of the converted pixel's memory representation that is written.
+        size_t firstByte_;
+        bool identity_;
+    };
+}
+
+#endif //VNC_PIXEL_FORMAT_H
@@ -0,0 +1,89 @@
+#ifndef VNC_RFB_H
+#define VNC_RFB_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vnc
+{
+    namespace rfb
+    {
+        constexpr char PROTOCOL_VERSION[] = "RFB 003.008\n";
+        constexpr size_t PROTOCOL_VERSION_LENGTH = 12;
+
+        constexpr uint8_t SECURITY_NONE = 1;
+        constexpr uint32_t SECURITY_RESULT_OK = 0;
+        constexpr uint32_t SECURITY_RESULT_FAILED = 1;
+
+        enum ClientMessage: uint8_t
+        {
+            SET_PIXEL_FORMAT = 0,
+            SET_ENCODINGS = 2,
+            FRAMEBUFFER_UPDATE_REQUEST = 3,
+            KEY_EVENT = 4,
+            POINTER_EVENT = 5,
+            CLIENT_CUT_TEXT = 6,
+        };
+
+        enum ServerMessage: uint8_t
+        {
+            FRAMEBUFFER_UPDATE = 0,
+        };
+
+        constexpr size_t PIXEL_FORMAT_SIZE = 16;
+        constexpr int HEXTILE_TILE_SIZE = 16;
+        constexpr int ZRLE_TILE_SIZE = 64;
+    }
+
+    // RFB integers are big-endian.
+    inline void PutU8(std::vector<uint8_t>* out, uint8_t value)
+    {
+        out->push_back(value);
+    }
+
+    inline void PutU16(std::vector<uint8_t>* out, uint16_t value)
+    {
+        out->push_back(static_cast<uint8_t>(value >> 8));
+        out->push_back(static_cast<uint8_t>(value));
+    }
+
+    inline void PutU32(std::vector<uint8_t>* out, uint32_t value)
+    {
+        out->push_back(static_cast<uint8_t>(value >> 24));
+        out->push_back(static_cast<uint8_t>(value >> 16));
+        out->push_back(static_cast<uint8_t>(value >> 8));
+        out->push_back(static_cast<uint8_t>(value));
+    }
+
+    inline uint16_t GetU16(const uint8_t* in)
+    {
+        return static_cast<uint16_t>(in[0] << 8 | in[1]);
+    }
+
+    inline uint32_t GetU32(const uint8_t* in)
+    {
+        return static_cast<uint32_t>(in[0]) << 24 | static_cast<uint32_t>(in[1]) << 16 | static_cast<uint32_t>(in[2]) << 8 | in[3];
+    }
+
+    // Overwrites 4 bytes written earlier, e.g. a length known only after the payload.
+    inline void PatchU32(std::vector<uint8_t>* out, size_t offset, uint32_t value)
+    {
+        (*out)[offset] = static_cast<uint8_t>(value >> 24);
+        (*out)[offset + 1] = static_cast<uint8_t>(value >> 16);
+        (*out)[offset + 2] = static_cast<uint8_t>(value >> 8);
+        (*out)[offset + 3] = static_cast<uint8_t>(value);
+    }
+
+    // Rectangle header of a FramebufferUpdate.
+    inline void PutRectHeader(std::vector<uint8_t>* out, int x, int y, int width, int height, int32_t encoding)
+    {
+        PutU16(out, static_cast<uint16_t>(x));
+        PutU16(out, static_cast<uint16_t>(y));
+        PutU16(out, static_cast<uint16_t>(width));
+        PutU16(out, static_cast<uint16_t>(height));
+        PutU32(out, static_cast<uint32_t>(encoding));
+    }
+}
+
+#endif //VNC_RFB_H
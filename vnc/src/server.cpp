@@ -0,0 +1,271 @@
+#include <vnc/vnc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "client_session.h"
+#include "frame_store.h"
+#include "socket.h"
+#include "update_region.h"
+
+namespace vnc
+{
+    namespace
+    {
+        constexpr int ACCEPT_TIMEOUT_MS = 100;
+        constexpr int LISTEN_BACKLOG = 4;
+    }
+
+    class Server::PImpl
+    {
+    public:
+        PImpl()
+            : input_{nullptr}
+            , maxClients_{0}
+            , port_{0}
+            , started_{false}
+            , stopping_{false}
+        {
+        }
+
+        ~PImpl()
+        {
+            Stop();
+        }
+
+        bool Start(const ServerOptions& options, int width, int height, InputHandler* input)
+        {
+            if(started_ || width <= 0 || height <= 0 || width > UINT16_MAX || height > UINT16_MAX)
+                return false;
+
+            if(!Socket::Startup())
+                return false;
+
+            const char* address = options.bindAddress != nullptr ? options.bindAddress : "127.0.0.1";
+            if(!listener_.Listen(address, options.port, LISTEN_BACKLOG))
+            {
+                Socket::Cleanup();
+                return false;
+            }
+
+            frame_.Reset(width, height);
+            input_ = input;
+            maxClients_ = options.maxClients;
+            desktopName_ = options.desktopName != nullptr ? options.desktopName : "";
+            port_ = listener_.GetLocalPort();
+            stopping_ = false;
+            started_ = true;
+            acceptThread_ = std::thread{&PImpl::AcceptLoop, this};
+            return true;
+        }
+
+        void Stop()
+        {
+            if(!started_)
+                return;
+
+            stopping_ = true;
+            acceptThread_.join();
+            listener_.Close();
+
+            std::vector<std::unique_ptr<ClientSession>> clients;
+            {
+                std::lock_guard<std::mutex> lock(clientsMutex_);
+                clients.swap(clients_);
+            }
+
+            for(auto& client: clients)
+            {
+                client->Close();
+            }
+
+            for(auto& client: clients)
+            {
+                client->Join();
+            }
+
+            clients.clear();
+            started_ = false;
+            Socket::Cleanup();
+        }
+
+        uint16_t GetPort() const
+        {
+            return port_;
+        }
+
+        size_t GetClientCount() const
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex_);
+            return static_cast<size_t>(std::count_if(clients_.begin(), clients_.end(),
+                [](const std::unique_ptr<ClientSession>& client)
+            {
+                return !client->IsClosed();
+            }));
+        }
+
+        void UpdateFramebuffer(const Framebuffer& frame, const Rect* damage, size_t count)
+        {
+            if(!started_ || frame.width != frame_.GetWidth() || frame.height != frame_.GetHeight())
+                return;
+
+            clipped_.clear();
+            const Rect bounds = frame_.GetBounds();
+            for(size_t i = 0; i < count; ++i)
+            {
+                const Rect rect = IntersectRects(damage[i], bounds);
+                if(!IsEmptyRect(rect))
+                {
+                    clipped_.push_back(rect);
+                }
+            }
+
+            if(clipped_.empty())
+                return;
+
+            changed_.clear();
+            frame_.Update(frame, clipped_.data(), clipped_.size(), &changed_);
+            if(changed_.empty())
+                return;
+
+            std::lock_guard<std::mutex> lock(clientsMutex_);
+            for(auto& client: clients_)
+            {
+                for(auto& rect: changed_)
+                {
+                    client->AddDamage(rect);
+                }
+            }
+        }
+
+        void CopyRect(const Rect& destination, int sourceX, int sourceY)
+        {
+            if(!started_)
+                return;
+
+            // Clip source and destination together so the copy stays a pure translation.
+            const Rect bounds = frame_.GetBounds();
+            Rect clipped = IntersectRects(destination, bounds);
+            const Rect source = IntersectRects(Rect{clipped.x + sourceX - destination.x,
+                clipped.y + sourceY - destination.y, clipped.width, clipped.height}, bounds);
+            if(IsEmptyRect(clipped) || IsEmptyRect(source))
+                return;
+
+            const int sourceDx = sourceX - destination.x;
+            const int sourceDy = sourceY - destination.y;
+            clipped = Rect{source.x - sourceDx, source.y - sourceDy, source.width, source.height};
+
+            frame_.Copy(clipped, source.x, source.y);
+            std::lock_guard<std::mutex> lock(clientsMutex_);
+            for(auto& client: clients_)
+            {
+                client->AddCopy(clipped, source.x, source.y);
+            }
+        }
+
+    private:
+        void AcceptLoop()
+        {
+            while(!stopping_)
+            {
+                Socket socket = listener_.Accept(ACCEPT_TIMEOUT_MS);
+                PruneClosedClients();
+                if(!socket.IsValid())
+                    continue;
+
+                std::lock_guard<std::mutex> lock(clientsMutex_);
+                if(maxClients_ != 0 && clients_.size() >= maxClients_)
+                    continue;
+
+                std::unique_ptr<ClientSession> client{new ClientSession{std::move(socket), &frame_, input_, desktopName_}};
+                client->Start();
+                clients_.push_back(std::move(client));
+            }
+        }
+
+        void PruneClosedClients()
+        {
+            std::vector<std::unique_ptr<ClientSession>> closed;
+            {
+                std::lock_guard<std::mutex> lock(clientsMutex_);
+                auto it = std::partition(clients_.begin(), clients_.end(),
+                    [](const std::unique_ptr<ClientSession>& client)
+                {
+                    return !client->IsClosed();
+                });
+                std::move(it, clients_.end(), std::back_inserter(closed));
+                clients_.erase(it, clients_.end());
+            }
+
+            // Joined outside the lock; the threads of a closed session are about to finish.
+            closed.clear();
+        }
+
+        FrameStore frame_;
+        Socket listener_;
+        InputHandler* input_;
+        size_t maxClients_;
+        std::string desktopName_;
+        uint16_t port_;
+        bool started_;
+        std::atomic_bool stopping_;
+        std::thread acceptThread_;
+        mutable std::mutex clientsMutex_;
+        std::vector<std::unique_ptr<ClientSession>> clients_;
+        // Application thread only.
+        std::vector<Rect> clipped_;
+        std::vector<Rect> changed_;
+    };
+
+    Server::Server()
+        : impl{new PImpl{}}
+    {
+    }
+
+    Server::~Server()
+    {
+        delete impl;
+    }
+
+    bool Server::Start(const ServerOptions& options, int width, int height, InputHandler* input)
+    {
+        return impl->Start(options, width, height, input);
+    }
+
+    void Server::Stop()
+    {
+        impl->Stop();
+    }
+
+    uint16_t Server::GetPort() const
+    {
+        return impl->GetPort();
+    }
+
+    size_t Server::GetClientCount() const
+    {
+        return impl->GetClientCount();
+    }
+
+    void Server::UpdateFramebuffer(const Framebuffer& frame, const Rect* damage, size_t count)
+    {
+        impl->UpdateFramebuffer(frame, damage, count);
+    }
+
+    void Server::UpdateFramebuffer(const Framebuffer& frame)
+    {
+        const Rect whole{0, 0, frame.width, frame.height};
+        impl->UpdateFramebuffer(frame, &whole, 1);
+    }
+
+    void Server::CopyRect(const Rect& destination, int sourceX, int sourceY)
+    {
+        impl->CopyRect(destination, sourceX, sourceY);
+    }
+}
@@ -0,0 +1,239 @@
+#include "socket.h"
+
+#include <utility>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace vnc
+{
+    namespace
+    {
+#if defined(_WIN32)
+        constexpr SocketHandle INVALID_HANDLE = INVALID_SOCKET;
+        using SocketLength = int;
+
+        void CloseSocketHandle(SocketHandle handle)
+        {
+            closesocket(handle);
+        }
+#else
+        constexpr SocketHandle INVALID_HANDLE = -1;
+        constexpr int SD_BOTH = SHUT_RDWR;
+        using SocketLength = socklen_t;
+
+        void CloseSocketHandle(SocketHandle handle)
+        {
+            close(handle);
+        }
+#endif
+
+        // MSG_NOSIGNAL keeps a peer reset from raising SIGPIPE; Winsock never raises it.
+#if defined(MSG_NOSIGNAL)
+        constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+        constexpr int SEND_FLAGS = 0;
+#endif
+
+        bool MakeAddress(const char* address, uint16_t port, sockaddr_in* result)
+        {
+            *result = sockaddr_in{};
+            result->sin_family = AF_INET;
+            result->sin_port = htons(port);
+            return inet_pton(AF_INET, address != nullptr ? address : "0.0.0.0", &result->sin_addr) == 1;
+        }
+    }
+
+    Socket::Socket()
+        : handle_{INVALID_HANDLE}
+    {
+    }
+
+    Socket::Socket(SocketHandle handle)
+        : handle_{handle}
+    {
+    }
+
+    Socket::Socket(Socket&& other)
+        : handle_{other.handle_}
+    {
+        other.handle_ = INVALID_HANDLE;
+    }
+
+    Socket::~Socket()
+    {
+        Close();
+    }
+
+    Socket& Socket::operator=(Socket&& other)
+    {
+        if(this != &other)
+        {
+            Close();
+            std::swap(handle_, other.handle_);
+        }
+
+        return *this;
+    }
+
+    bool Socket::Startup()
+    {
+#if defined(_WIN32)
+        WSADATA data{};
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+        return true;
+#endif
+    }
+
+    void Socket::Cleanup()
+    {
+#if defined(_WIN32)
+        WSACleanup();
+#endif
+    }
+
+    bool Socket::Listen(const char* address, uint16_t port, int backlog)
+    {
+        Close();
+        sockaddr_in bindAddress{};
+        if(!MakeAddress(address, port, &bindAddress))
+            return false;
+
+        handle_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if(handle_ == INVALID_HANDLE)
+            return false;
+
+        int reuse = 1;
+        setsockopt(handle_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+        if(bind(handle_, reinterpret_cast<const sockaddr*>(&bindAddress), sizeof(bindAddress)) != 0
+            || listen(handle_, backlog) != 0)
+        {
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    bool Socket::Connect(const char* address, uint16_t port)
+    {
+        Close();
+        sockaddr_in peer{};
+        if(!MakeAddress(address, port, &peer))
+            return false;
+
+        handle_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if(handle_ == INVALID_HANDLE)
+            return false;
+
+        if(connect(handle_, reinterpret_cast<const sockaddr*>(&peer), sizeof(peer)) != 0)
+        {
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    Socket Socket::Accept(int timeoutMs)
+    {
+        if(handle_ == INVALID_HANDLE)
+            return Socket{};
+
+        // Polling keeps Stop from having to close the socket under a thread blocked in accept.
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(handle_, &readable);
+        timeval timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+        if(select(static_cast<int>(handle_ + 1), &readable, nullptr, nullptr, &timeout) <= 0)
+            return Socket{};
+
+        SocketHandle accepted = accept(handle_, nullptr, nullptr);
+        if(accepted == INVALID_HANDLE)
+            return Socket{};
+
+        return Socket{accepted};
+    }
+
+    bool Socket::Send(const void* data, size_t size)
+    {
+        const char* bytes = static_cast<const char*>(data);
+        while(size > 0)
+        {
+            const int chunk = static_cast<int>(size < 0x40000000 ? size : 0x40000000);
+            const auto sent = send(handle_, bytes, chunk, SEND_FLAGS);
+            if(sent <= 0)
+                return false;
+
+            bytes += sent;
+            size -= static_cast<size_t>(sent);
+        }
+
+        return true;
+    }
+
+    bool Socket::Receive(void* data, size_t size)
+    {
+        char* bytes = static_cast<char*>(data);
+        while(size > 0)
+        {
+            const int chunk = static_cast<int>(size < 0x40000000 ? size : 0x40000000);
+            const auto received = recv(handle_, bytes, chunk, 0);
+            if(received <= 0)
+                return false;
+
+            bytes += received;
+            size -= static_cast<size_t>(received);
+        }
+
+        return true;
+    }
+
+    void Socket::SetNoDelay(bool enabled)
+    {
+        int value = enabled ? 1 : 0;
+        setsockopt(handle_, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    uint16_t Socket::GetLocalPort() const
+    {
+        sockaddr_in local{};
+        SocketLength length = sizeof(local);
+        if(getsockname(handle_, reinterpret_cast<sockaddr*>(&local), &length) != 0)
+            return 0;
+
+        return ntohs(local.sin_port);
+    }
+
+    bool Socket::IsValid() const
+    {
+        return handle_ != INVALID_HANDLE;
+    }
+
+    void Socket::Shutdown()
+    {
+        if(handle_ != INVALID_HANDLE)
+        {
+            shutdown(handle_, SD_BOTH);
+        }
+    }
+
+    void Socket::Close()
+    {
+        if(handle_ != INVALID_HANDLE)
+        {
+            CloseSocketHandle(handle_);
+            handle_ = INVALID_HANDLE;
+        }
+    }
+}
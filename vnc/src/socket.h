@@ -0,0 +1,64 @@
+#ifndef VNC_SOCKET_H
+#define VNC_SOCKET_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vnc
+{
+#if defined(_WIN32)
+    using SocketHandle = uintptr_t;
+#else
+    using SocketHandle = int;
+#endif
+
+    // Blocking TCP socket over Winsock or BSD sockets. Shutdown may be called from another thread to wake a thread
+    // blocked in Send or Receive.
+    class Socket
+    {
+    public:
+        Socket();
+
+        Socket(const Socket&) = delete;
+
+        Socket(Socket&& other);
+
+        ~Socket();
+
+        Socket& operator=(Socket&& other);
+
+        // Winsock needs process-wide initialization; call once per Socket user, balanced by Cleanup.
+        static bool Startup();
+
+        static void Cleanup();
+
+        bool Listen(const char* address, uint16_t port, int backlog);
+
+        bool Connect(const char* address, uint16_t port);
+
+        // Waits up to timeoutMs for a pending connection; an invalid socket on timeout or error.
+        Socket Accept(int timeoutMs);
+
+        bool Send(const void* data, size_t size);
+
+        // Fills the whole buffer; false when the connection closed first.
+        bool Receive(void* data, size_t size);
+
+        void SetNoDelay(bool enabled);
+
+        uint16_t GetLocalPort() const;
+
+        bool IsValid() const;
+
+        void Shutdown();
+
+        void Close();
+
+    private:
+        explicit Socket(SocketHandle handle);
+
+        SocketHandle handle_;
+    };
+}
+
+#endif //VNC_SOCKET_H
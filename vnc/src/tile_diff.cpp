@@ -0,0 +1,248 @@
+#include "tile_diff.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define VNC_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit instructions of the enabled sets, so the wide paths are compiled for their target
+// explicitly and reached only after the CPU check. MSVC emits any intrinsic.
+#if defined(__GNUC__)
+#define VNC_TARGET(name) __attribute__((target(name)))
+#else
+#define VNC_TARGET(name)
+#endif
+
+namespace vnc
+{
+    namespace
+    {
+        bool CompareScalar(const uint32_t* lhs, size_t lhsStride, const uint32_t* rhs, size_t rhsStride, int width,
+            int height)
+        {
+            const size_t rowBytes = static_cast<size_t>(width) * 4;
+            for(int y = 0; y < height; ++y)
+            {
+                if(std::memcmp(lhs + y * lhsStride, rhs + y * rhsStride, rowBytes) != 0)
+                    return true;
+            }
+
+            return false;
+        }
+
+#if defined(VNC_X86)
+        VNC_TARGET("sse4.1")
+        bool CompareSse41(const uint32_t* lhs, size_t lhsStride, const uint32_t* rhs, size_t rhsStride, int width,
+            int height)
+        {
+            for(int y = 0; y < height; ++y)
+            {
+                const uint32_t* a = lhs + y * lhsStride;
+                const uint32_t* b = rhs + y * rhsStride;
+                // OR the differences of a whole row and test once; a tile row is 16 vectors.
+                __m128i difference = _mm_setzero_si128();
+                int x = 0;
+                for(; x + 4 <= width; x += 4)
+                {
+                    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + x));
+                    const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x));
+                    difference = _mm_or_si128(difference, _mm_xor_si128(va, vb));
+                }
+
+                if(!_mm_testz_si128(difference, difference))
+                    return true;
+
+                for(; x < width; ++x)
+                {
+                    if(a[x] != b[x])
+                        return true;
+                }
+            }
+
+            return false;
+        }
+
+        VNC_TARGET("avx2")
+        bool CompareAvx2(const uint32_t* lhs, size_t lhsStride, const uint32_t* rhs, size_t rhsStride, int width,
+            int height)
+        {
+            for(int y = 0; y < height; ++y)
+            {
+                const uint32_t* a = lhs + y * lhsStride;
+                const uint32_t* b = rhs + y * rhsStride;
+                __m256i difference = _mm256_setzero_si256();
+                int x = 0;
+                for(; x + 8 <= width; x += 8)
+                {
+                    const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + x));
+                    const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + x));
+                    difference = _mm256_or_si256(difference, _mm256_xor_si256(va, vb));
+                }
+
+                if(!_mm256_testz_si256(difference, difference))
+                    return true;
+
+                for(; x < width; ++x)
+                {
+                    if(a[x] != b[x])
+                        return true;
+                }
+            }
+
+            return false;
+        }
+
+        struct CpuFeatures
+        {
+            bool sse41;
+            bool avx2;
+        };
+
+        CpuFeatures DetectCpuFeatures()
+        {
+            CpuFeatures features{};
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            const int maxLeaf = info[0];
+            __cpuid(info, 1);
+            features.sse41 = (info[2] & (1 << 19)) != 0;
+            // AVX state has to be enabled by the OS too.
+            const bool osAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0
+                && (_xgetbv(0) & 0x6) == 0x6;
+            if(osAvx && maxLeaf >= 7)
+            {
+                __cpuidex(info, 7, 0);
+                features.avx2 = (info[1] & (1 << 5)) != 0;
+            }
+#else
+            __builtin_cpu_init();
+            features.sse41 = __builtin_cpu_supports("sse4.1") != 0;
+            features.avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+            return features;
+        }
+
+        const CpuFeatures& GetCpuFeatures()
+        {
+            static const CpuFeatures features = DetectCpuFeatures();
+            return features;
+        }
+#endif
+    }
+
+    TileCompareFunction GetTileCompareFunction(TileDiffImpl impl)
+    {
+        switch(impl)
+        {
+        case TILE_DIFF_SCALAR:
+            return &CompareScalar;
+#if defined(VNC_X86)
+        case TILE_DIFF_SSE41:
+            return GetCpuFeatures().sse41 ? &CompareSse41 : nullptr;
+        case TILE_DIFF_AVX2:
+            return GetCpuFeatures().avx2 ? &CompareAvx2 : nullptr;
+#endif
+        default:
+            return nullptr;
+        }
+    }
+
+    TileDiffImpl GetBestTileDiffImpl()
+    {
+        // Diffing is bound by memory bandwidth and memcmp is already vectorized by the C runtime, so in vnc_bench
+        // neither wide kernel beats it at any resolution, unrolled or not.
+        return TILE_DIFF_SCALAR;
+    }
+
+    const char* GetTileDiffImplName(TileDiffImpl impl)
+    {
+        switch(impl)
+        {
+        case TILE_DIFF_SCALAR:
+            return "scalar";
+        case TILE_DIFF_SSE41:
+            return "sse4.1";
+        case TILE_DIFF_AVX2:
+            return "avx2";
+        default:
+            return "unknown";
+        }
+    }
+
+    TileDiff::TileDiff(TileDiffImpl impl)
+        : compare_{GetTileCompareFunction(impl)}
+    {
+        if(compare_ == nullptr)
+        {
+            compare_ = &CompareScalar;
+        }
+    }
+
+    void TileDiff::Diff(const uint32_t* previous, size_t previousStride, const uint32_t* current, size_t currentStride,
+        const Rect& area, std::vector<Rect>* changed)
+    {
+        if(area.width <= 0 || area.height <= 0)
+            return;
+
+        // open_ holds the rects that reached the previous tile row; a rect stays open while the next row has a run
+        // with exactly the same span.
+        open_.clear();
+        const int right = area.x + area.width;
+        const int bottom = area.y + area.height;
+        const int firstTileY = area.y / TILE_DIFF_SIZE * TILE_DIFF_SIZE;
+        const int firstTileX = area.x / TILE_DIFF_SIZE * TILE_DIFF_SIZE;
+        for(int tileY = firstTileY; tileY < bottom; tileY += TILE_DIFF_SIZE)
+        {
+            const int top = std::max(tileY, area.y);
+            const int height = std::min(tileY + TILE_DIFF_SIZE, bottom) - top;
+            row_.clear();
+            for(int tileX = firstTileX; tileX < right; tileX += TILE_DIFF_SIZE)
+            {
+                const int left = std::max(tileX, area.x);
+                const int width = std::min(tileX + TILE_DIFF_SIZE, right) - left;
+                const size_t previousOffset = static_cast<size_t>(top) * previousStride + left;
+                const size_t currentOffset = static_cast<size_t>(top) * currentStride + left;
+                if(!compare_(previous + previousOffset, previousStride, current + currentOffset, currentStride, width, height))
+                    continue;
+
+                if(!row_.empty() && row_.back().x + row_.back().width == left)
+                {
+                    row_.back().width += width;
+                }
+                else
+                {
+                    row_.push_back(Rect{left, top, width, height});
+                }
+            }
+
+            // Both lists are sorted by x, so matching spans are found in one pass.
+            size_t next = 0;
+            for(auto& run: row_)
+            {
+                while(next < open_.size() && open_[next].x < run.x)
+                {
+                    changed->push_back(open_[next++]);
+                }
+
+                if(next < open_.size() && open_[next].x == run.x && open_[next].width == run.width)
+                {
+                    run.y = open_[next].y;
+                    run.height += open_[next].height;
+                    ++next;
+                }
+            }
+
+            changed->insert(changed->end(), open_.begin() + next, open_.end());
+            open_.swap(row_);
+        }
+
+        changed->insert(changed->end(), open_.begin(), open_.end());
+    }
+}
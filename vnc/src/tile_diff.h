@@ -0,0 +1,51 @@
+#ifndef VNC_TILE_DIFF_H
+#define VNC_TILE_DIFF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <vnc/vnc.h>
+
+namespace vnc
+{
+    constexpr int TILE_DIFF_SIZE = 64;
+
+    enum TileDiffImpl
+    {
+        TILE_DIFF_SCALAR,
+        TILE_DIFF_SSE41,
+        TILE_DIFF_AVX2,
+        TILE_DIFF_IMPL_COUNT,
+    };
+
+    // True when any pixel of the width x height block differs. Strides are in pixels.
+    using TileCompareFunction = bool (*)(const uint32_t* lhs, size_t lhsStride, const uint32_t* rhs, size_t rhsStride,
+        int width, int height);
+
+    // nullptr when the build or the CPU lacks the instruction set.
+    TileCompareFunction GetTileCompareFunction(TileDiffImpl impl);
+
+    // The fastest implementation measured by vnc_bench; the others stay selectable to compare against it.
+    TileDiffImpl GetBestTileDiffImpl();
+
+    const char* GetTileDiffImplName(TileDiffImpl impl);
+
+    // Finds the tiles of the TILE_DIFF_SIZE grid that changed between two frames of the same size and coalesces
+    // them into rects: runs of changed tiles in a tile row, then runs with the same span in consecutive rows.
+    class TileDiff
+    {
+    public:
+        explicit TileDiff(TileDiffImpl impl = GetBestTileDiffImpl());
+
+        // Appends the changed parts of area, which must lie inside both frames, to changed; tiles are clipped to area.
+        void Diff(const uint32_t* previous, size_t previousStride, const uint32_t* current, size_t currentStride,
+            const Rect& area, std::vector<Rect>* changed);
+
+    private:
+        TileCompareFunction compare_;
+        std::vector<Rect> open_;
+        std::vector<Rect> row_;
+    };
+}
+
+#endif //VNC_TILE_DIFF_H
@@ -0,0 +1,113 @@
+#ifndef VNC_UPDATE_REGION_H
+#define VNC_UPDATE_REGION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include <vnc/vnc.h>
+
+namespace vnc
+{
+    inline bool IsEmptyRect(const Rect& rect)
+    {
+        return rect.width <= 0 || rect.height <= 0;
+    }
+
+    inline Rect IntersectRects(const Rect& lhs, const Rect& rhs)
+    {
+        const int left = std::max(lhs.x, rhs.x);
+        const int top = std::max(lhs.y, rhs.y);
+        const int right = std::min(lhs.x + lhs.width, rhs.x + rhs.width);
+        const int bottom = std::min(lhs.y + lhs.height, rhs.y + rhs.height);
+        if(right <= left || bottom <= top)
+            return Rect{left, top, 0, 0};
+
+        return Rect{left, top, right - left, bottom - top};
+    }
+
+    inline Rect UnionRects(const Rect& lhs, const Rect& rhs)
+    {
+        const int left = std::min(lhs.x, rhs.x);
+        const int top = std::min(lhs.y, rhs.y);
+        const int right = std::max(lhs.x + lhs.width, rhs.x + rhs.width);
+        const int bottom = std::max(lhs.y + lhs.height, rhs.y + rhs.height);
+        return Rect{left, top, right - left, bottom - top};
+    }
+
+    inline bool RectContains(const Rect& outer, const Rect& inner)
+    {
+        return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.width <= outer.x + outer.width
+            && inner.y + inner.height <= outer.y + outer.height;
+    }
+
+    // Rects still to be sent to a client. Contained rects are dropped, and past maxRects everything collapses into
+    // the bounding box, which bounds the per-update overhead when damage is scattered.
+    class UpdateRegion
+    {
+    public:
+        explicit UpdateRegion(size_t maxRects = 32)
+            : maxRects_{maxRects}
+        {
+        }
+
+        void Add(const Rect& rect)
+        {
+            if(IsEmptyRect(rect))
+                return;
+
+            for(auto& existing: rects_)
+            {
+                if(RectContains(existing, rect))
+                    return;
+            }
+
+            rects_.erase(std::remove_if(rects_.begin(), rects_.end(), [&rect](const Rect& existing)
+            {
+                return RectContains(rect, existing);
+            }), rects_.end());
+            rects_.push_back(rect);
+            if(rects_.size() > maxRects_)
+            {
+                Rect bounds = rects_.front();
+                for(auto& existing: rects_)
+                {
+                    bounds = UnionRects(bounds, existing);
+                }
+
+                rects_.assign(1, bounds);
+            }
+        }
+
+        bool Intersects(const Rect& rect) const
+        {
+            for(auto& existing: rects_)
+            {
+                if(!IsEmptyRect(IntersectRects(existing, rect)))
+                    return true;
+            }
+
+            return false;
+        }
+
+        void Clear()
+        {
+            rects_.clear();
+        }
+
+        bool IsEmpty() const
+        {
+            return rects_.empty();
+        }
+
+        const std::vector<Rect>& GetRects() const
+        {
+            return rects_;
+        }
+
+    private:
+        size_t maxRects_;
+        std::vector<Rect> rects_;
+    };
+}
+
+#endif //VNC_UPDATE_REGION_H
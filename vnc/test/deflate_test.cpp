@@ -0,0 +1,175 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <zlib.h>
+#include <test.h>
+#include "deflate.h"
+
+// Inflates the output of vnc::ZlibStream with zlib, which rejects any malformed code, length or distance.
+namespace
+{
+    constexpr size_t WINDOW_SIZE = 32768;
+    constexpr size_t MAX_MATCH = 258;
+
+    // Receiving end of one stream, fed the output of one Compress call at a time like a ZRLE client.
+    class Inflater
+    {
+    public:
+        Inflater()
+            : stream_{}
+            , valid_{inflateInit(&stream_) == Z_OK}
+        {
+        }
+
+        Inflater(const Inflater&) = delete;
+
+        ~Inflater()
+        {
+            if(valid_)
+            {
+                inflateEnd(&stream_);
+            }
+        }
+
+        bool Inflate(std::vector<uint8_t>& compressed, std::vector<uint8_t>* out)
+        {
+            out->clear();
+            if(!valid_)
+                return false;
+
+            stream_.next_in = compressed.data();
+            stream_.avail_in = static_cast<uInt>(compressed.size());
+            uint8_t chunk[4096];
+            while(true)
+            {
+                stream_.next_out = chunk;
+                stream_.avail_out = sizeof(chunk);
+                const int result = inflate(&stream_, Z_SYNC_FLUSH);
+                if(result != Z_OK && result != Z_BUF_ERROR)
+                    return false;
+
+                out->insert(out->end(), chunk, chunk + (sizeof(chunk) - stream_.avail_out));
+                if(stream_.avail_in == 0 && stream_.avail_out != 0)
+                    return true;
+
+                if(result == Z_BUF_ERROR)
+                    return false;
+            }
+        }
+
+    private:
+        z_stream stream_;
+        bool valid_;
+    };
+
+    std::vector<uint8_t> MakeRandom(std::mt19937* random, size_t size)
+    {
+        std::vector<uint8_t> data(size);
+        for(auto& byte: data)
+        {
+            byte = static_cast<uint8_t>((*random)());
+        }
+
+        return data;
+    }
+
+    // Compresses data as one call on a fresh stream and checks that zlib gets it back; returns the compressed size.
+    size_t RoundTrip(const std::vector<uint8_t>& data)
+    {
+        vnc::ZlibStream stream;
+        Inflater inflater;
+        std::vector<uint8_t> compressed;
+        std::vector<uint8_t> inflated;
+        stream.Compress(data.data(), data.size(), &compressed);
+        HMI_CHECK(inflater.Inflate(compressed, &inflated));
+        HMI_CHECK(inflated == data);
+        return compressed.size();
+    }
+
+    void TestLiterals()
+    {
+        std::mt19937 random{1};
+        RoundTrip(std::vector<uint8_t>{});
+        RoundTrip(std::vector<uint8_t>{0, 143, 144, 255});
+        for(size_t size: {1u, 2u, 3u, 4u, 1000u})
+        {
+            RoundTrip(MakeRandom(&random, size));
+        }
+
+        // Every byte value, which covers both literal code lengths.
+        std::vector<uint8_t> bytes(256);
+        for(size_t i = 0; i < bytes.size(); ++i)
+        {
+            bytes[i] = static_cast<uint8_t>(i);
+        }
+
+        RoundTrip(bytes);
+    }
+
+    void TestLongMatches()
+    {
+        // A run is sent as one literal and matches of the maximum length at distance 1, 13 bits each; shorter
+        // matches would take at least 18.
+        const std::vector<uint8_t> run(MAX_MATCH * 200 + 17, 0x5A);
+        const size_t size = RoundTrip(run);
+        HMI_CHECK(size < run.size() / MAX_MATCH * 2);
+
+        // Every match length from the minimum up to the maximum, each after a literal that breaks the previous one.
+        std::mt19937 random{2};
+        const std::vector<uint8_t> source = MakeRandom(&random, MAX_MATCH + 1);
+        std::vector<uint8_t> data = source;
+        for(size_t length = 3; length <= MAX_MATCH; ++length)
+        {
+            data.push_back(static_cast<uint8_t>(source[length] + 1));
+            data.insert(data.end(), source.begin(), source.begin() + length);
+        }
+
+        RoundTrip(data);
+    }
+
+    void TestFarDistances()
+    {
+        // Repeats at and around the end of the window; one byte further back is out of reach and must not be used.
+        std::mt19937 random{3};
+        for(size_t distance: {WINDOW_SIZE - 300, WINDOW_SIZE - 1, WINDOW_SIZE, WINDOW_SIZE + 1})
+        {
+            std::vector<uint8_t> data = MakeRandom(&random, distance);
+            data.insert(data.end(), data.begin(), data.begin() + 4096);
+            const size_t size = RoundTrip(data);
+            if(distance <= WINDOW_SIZE)
+            {
+                // The copy costs a few bytes per maximum length match instead of a byte per byte.
+                HMI_CHECK(size < distance + distance / 8 + 4096 / 8);
+            }
+        }
+    }
+
+    // One stream for several calls, each inflated on its own as soon as it arrives.
+    void TestSyncFlush()
+    {
+        std::mt19937 random{4};
+        vnc::ZlibStream stream;
+        Inflater inflater;
+        const std::vector<uint8_t> repeated = MakeRandom(&random, 5000);
+        const std::vector<std::vector<uint8_t>> chunks{MakeRandom(&random, 3000), std::vector<uint8_t>{}, repeated,
+            repeated, std::vector<uint8_t>(70000, 1)};
+        for(auto& chunk: chunks)
+        {
+            std::vector<uint8_t> compressed;
+            std::vector<uint8_t> inflated;
+            stream.Compress(chunk.data(), chunk.size(), &compressed);
+            HMI_CHECK(compressed.size() >= 4);
+            HMI_CHECK(inflater.Inflate(compressed, &inflated));
+            HMI_CHECK(inflated == chunk);
+        }
+    }
+}
+
+int main()
+{
+    TestLiterals();
+    TestLongMatches();
+    TestFarDistances();
+    TestSyncFlush();
+    return hmi_graphics::test::Finish("deflate_test");
+}
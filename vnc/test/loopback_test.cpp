@@ -0,0 +1,657 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+#include <test.h>
+#include <vnc/vnc.h>
+#include "rfb.h"
+#include "socket.h"
+#include "tile_diff.h"
+
+#if defined(VNC_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+// Drives vnc::Server over loopback with a minimal RFB 3.8 client: handshake, a client pixel format different from
+// the server's, then updates for the whole frame and for a damaged rect in each encoding, checked pixel by pixel.
+namespace
+{
+    constexpr int FRAME_WIDTH = 160;
+    constexpr int FRAME_HEIGHT = 96;
+    constexpr char DESKTOP_NAME[] = "loopback";
+    // Little-endian 32 bpp with red in the high byte, unlike the server's R8G8B8A8 memory order.
+    constexpr uint8_t RED_SHIFT = 16;
+    constexpr uint8_t GREEN_SHIFT = 8;
+    constexpr uint8_t BLUE_SHIFT = 0;
+
+    enum HextileFlags: uint8_t
+    {
+        HEXTILE_RAW = 1,
+        HEXTILE_BACKGROUND_SPECIFIED = 2,
+        HEXTILE_FOREGROUND_SPECIFIED = 4,
+        HEXTILE_ANY_SUBRECTS = 8,
+        HEXTILE_SUBRECTS_COLOURED = 16,
+    };
+
+    constexpr uint8_t ZRLE_RAW = 0;
+    constexpr uint8_t ZRLE_SOLID = 1;
+    constexpr uint8_t ZRLE_PLAIN_RLE = 128;
+    // ZRLE's CPIXEL of the client format: the three low bytes.
+    constexpr size_t COMPACT_PIXEL_SIZE = 3;
+
+    struct Update
+    {
+        std::vector<vnc::Rect> rects;
+        // Hextile tile flags or ZRLE subencodings seen, to make sure the frame exercises more than raw tiles.
+        std::set<int> tileTypes;
+        bool valid;
+    };
+
+    // Per connection: ZRLE keeps one zlib stream for all of it.
+    struct Decoder
+    {
+        int32_t encoding;
+#if defined(VNC_HAVE_ZLIB)
+        z_stream stream;
+#endif
+        std::vector<uint8_t> compressed;
+        std::vector<uint8_t> data;
+    };
+
+    // What the client should decode for a frame pixel.
+    uint32_t ToClientPixel(uint32_t pixel)
+    {
+        const uint32_t red = pixel & 0xFF;
+        const uint32_t green = pixel >> 8 & 0xFF;
+        const uint32_t blue = pixel >> 16 & 0xFF;
+        return red << RED_SHIFT | green << GREEN_SHIFT | blue << BLUE_SHIFT;
+    }
+
+    // A gradient, solid areas, stripes, a checkerboard and rectangles on a background, so that Hextile and ZRLE pick
+    // most of their tile kinds.
+    uint32_t GetFramePixel(int x, int y)
+    {
+        const uint32_t colours[] = {0xFF2040C0u, 0xFFC04020u, 0xFF20C040u, 0xFFF0F0F0u, 0xFF101010u};
+        if(x < 64 && y < 64)
+            return 0xFF000000u | (x * 7 & 0xFF) | (y * 5 & 0xFF) << 8 | ((x + y) & 0xFF) << 16;
+
+        if(x < 128 && y < 64)
+            return 0xFF336699u;
+
+        if(y < 64)
+            return colours[x / 3 % 5];
+
+        if(x < 64)
+            return (x / 4 + y / 4) % 2 == 0 ? colours[3] : colours[4];
+
+        if(x < 128)
+        {
+            if(x >= 70 && x < 90 && y >= 70 && y < 75)
+                return colours[0];
+
+            if(x >= 100 && x < 103 && y >= 66 && y < 94)
+                return colours[1];
+
+            return (x - 64) % 16 == 5 && (y - 64) % 16 == 9 ? colours[2] : colours[3];
+        }
+
+        return 0xFF000000u | static_cast<uint32_t>(y * 37 & 0xFF) << 8 | static_cast<uint32_t>(x / 8 * 29 & 0xFF);
+    }
+
+    std::vector<uint32_t> MakeFrame()
+    {
+        std::vector<uint32_t> pixels(static_cast<size_t>(FRAME_WIDTH) * FRAME_HEIGHT);
+        for(int y = 0; y < FRAME_HEIGHT; ++y)
+        {
+            for(int x = 0; x < FRAME_WIDTH; ++x)
+            {
+                pixels[static_cast<size_t>(y) * FRAME_WIDTH + x] = GetFramePixel(x, y);
+            }
+        }
+
+        return pixels;
+    }
+
+    bool Handshake(vnc::Socket* socket)
+    {
+        char version[vnc::rfb::PROTOCOL_VERSION_LENGTH] = {};
+        HMI_CHECK(socket->Receive(version, sizeof(version)));
+        HMI_CHECK(std::memcmp(version, "RFB 003.008\n", sizeof(version)) == 0);
+        HMI_CHECK(socket->Send("RFB 003.008\n", sizeof(version)));
+
+        uint8_t types[2] = {};
+        HMI_CHECK(socket->Receive(types, sizeof(types)));
+        HMI_CHECK_EQUAL(types[0], 1);
+        HMI_CHECK_EQUAL(types[1], vnc::rfb::SECURITY_NONE);
+        const uint8_t chosen = vnc::rfb::SECURITY_NONE;
+        HMI_CHECK(socket->Send(&chosen, 1));
+
+        uint8_t result[4] = {};
+        HMI_CHECK(socket->Receive(result, sizeof(result)));
+        HMI_CHECK_EQUAL(vnc::GetU32(result), vnc::rfb::SECURITY_RESULT_OK);
+
+        const uint8_t shared = 1;
+        HMI_CHECK(socket->Send(&shared, 1));
+        uint8_t serverInit[4 + vnc::rfb::PIXEL_FORMAT_SIZE + 4] = {};
+        if(!socket->Receive(serverInit, sizeof(serverInit)))
+            return false;
+
+        HMI_CHECK_EQUAL(vnc::GetU16(serverInit), FRAME_WIDTH);
+        HMI_CHECK_EQUAL(vnc::GetU16(serverInit + 2), FRAME_HEIGHT);
+        // Server format: 32 bpp, depth 24, true colour.
+        HMI_CHECK_EQUAL(serverInit[4], 32);
+        HMI_CHECK_EQUAL(serverInit[5], 24);
+        HMI_CHECK_EQUAL(serverInit[7], 1);
+        std::string name(vnc::GetU32(serverInit + 4 + vnc::rfb::PIXEL_FORMAT_SIZE), '\0');
+        if(!name.empty() && !socket->Receive(&name[0], name.size()))
+            return false;
+
+        HMI_CHECK_EQUAL(name, DESKTOP_NAME);
+        return true;
+    }
+
+    void SendPixelFormatAndEncodings(vnc::Socket* socket, int32_t encoding)
+    {
+        std::vector<uint8_t> message;
+        vnc::PutU8(&message, vnc::rfb::SET_PIXEL_FORMAT);
+        message.insert(message.end(), 3, 0);
+        const uint8_t format[vnc::rfb::PIXEL_FORMAT_SIZE] = {32, 24, 0, 1, 0, 255, 0, 255, 0, 255, RED_SHIFT,
+            GREEN_SHIFT, BLUE_SHIFT, 0, 0, 0};
+        message.insert(message.end(), format, format + sizeof(format));
+
+        vnc::PutU8(&message, vnc::rfb::SET_ENCODINGS);
+        vnc::PutU8(&message, 0);
+        vnc::PutU16(&message, 1);
+        vnc::PutU32(&message, static_cast<uint32_t>(encoding));
+        HMI_CHECK(socket->Send(message.data(), message.size()));
+    }
+
+    void RequestUpdate(vnc::Socket* socket, bool incremental)
+    {
+        std::vector<uint8_t> message;
+        vnc::PutU8(&message, vnc::rfb::FRAMEBUFFER_UPDATE_REQUEST);
+        vnc::PutU8(&message, incremental ? 1 : 0);
+        vnc::PutU16(&message, 0);
+        vnc::PutU16(&message, 0);
+        vnc::PutU16(&message, FRAME_WIDTH);
+        vnc::PutU16(&message, FRAME_HEIGHT);
+        HMI_CHECK(socket->Send(message.data(), message.size()));
+    }
+
+    uint32_t GetPixel(const uint8_t* in, size_t size)
+    {
+        uint32_t pixel = 0;
+        for(size_t i = 0; i < size; ++i)
+        {
+            pixel |= static_cast<uint32_t>(in[i]) << (i * 8);
+        }
+
+        return pixel;
+    }
+
+    bool ReceivePixel(vnc::Socket* socket, uint32_t* pixel)
+    {
+        uint8_t bytes[4] = {};
+        if(!socket->Receive(bytes, sizeof(bytes)))
+            return false;
+
+        *pixel = GetPixel(bytes, sizeof(bytes));
+        return true;
+    }
+
+    void FillRect(std::vector<uint32_t>* framebuffer, int x, int y, int width, int height, uint32_t pixel)
+    {
+        for(int row = y; row < y + height; ++row)
+        {
+            std::fill_n(framebuffer->begin() + static_cast<size_t>(row) * FRAME_WIDTH + x, width, pixel);
+        }
+    }
+
+    bool ReceiveRaw(vnc::Socket* socket, const vnc::Rect& rect, std::vector<uint32_t>* framebuffer)
+    {
+        std::vector<uint8_t> row(static_cast<size_t>(rect.width) * 4);
+        for(int y = rect.y; y < rect.y + rect.height; ++y)
+        {
+            if(!socket->Receive(row.data(), row.size()))
+                return false;
+
+            for(int x = 0; x < rect.width; ++x)
+            {
+                (*framebuffer)[static_cast<size_t>(y) * FRAME_WIDTH + rect.x + x] = GetPixel(row.data() + x * 4, 4);
+            }
+        }
+
+        return true;
+    }
+
+    bool ReceiveHextile(vnc::Socket* socket, const vnc::Rect& rect, std::vector<uint32_t>* framebuffer, Update* update)
+    {
+        // Background and foreground carry over between the tiles of one rect.
+        uint32_t background = 0;
+        uint32_t foreground = 0;
+        for(int y = rect.y; y < rect.y + rect.height; y += vnc::rfb::HEXTILE_TILE_SIZE)
+        {
+            for(int x = rect.x; x < rect.x + rect.width; x += vnc::rfb::HEXTILE_TILE_SIZE)
+            {
+                const vnc::Rect tile{x, y, std::min(vnc::rfb::HEXTILE_TILE_SIZE, rect.x + rect.width - x),
+                    std::min(vnc::rfb::HEXTILE_TILE_SIZE, rect.y + rect.height - y)};
+                uint8_t flags = 0;
+                if(!socket->Receive(&flags, 1))
+                    return false;
+
+                update->tileTypes.insert(flags);
+                if((flags & HEXTILE_RAW) != 0)
+                {
+                    if(!ReceiveRaw(socket, tile, framebuffer))
+                        return false;
+
+                    continue;
+                }
+
+                if((flags & HEXTILE_BACKGROUND_SPECIFIED) != 0 && !ReceivePixel(socket, &background))
+                    return false;
+
+                FillRect(framebuffer, tile.x, tile.y, tile.width, tile.height, background);
+                if((flags & HEXTILE_FOREGROUND_SPECIFIED) != 0 && !ReceivePixel(socket, &foreground))
+                    return false;
+
+                if((flags & HEXTILE_ANY_SUBRECTS) == 0)
+                    continue;
+
+                uint8_t count = 0;
+                if(!socket->Receive(&count, 1))
+                    return false;
+
+                for(int i = 0; i < count; ++i)
+                {
+                    uint32_t pixel = foreground;
+                    uint8_t geometry[2] = {};
+                    if(((flags & HEXTILE_SUBRECTS_COLOURED) != 0 && !ReceivePixel(socket, &pixel))
+                        || !socket->Receive(geometry, sizeof(geometry)))
+                        return false;
+
+                    const int subrectX = geometry[0] >> 4;
+                    const int subrectY = geometry[0] & 15;
+                    const int width = (geometry[1] >> 4) + 1;
+                    const int height = (geometry[1] & 15) + 1;
+                    if(subrectX + width > tile.width || subrectY + height > tile.height)
+                    {
+                        hmi_graphics::test::ReportFailure(__FILE__, __LINE__, "subrect outside its tile");
+                        return false;
+                    }
+
+                    FillRect(framebuffer, tile.x + subrectX, tile.y + subrectY, width, height, pixel);
+                }
+            }
+        }
+
+        return true;
+    }
+
+#if defined(VNC_HAVE_ZLIB)
+    // Reads the decompressed tile data of one ZRLE rect, failing instead of reading past it.
+    class ZrleReader
+    {
+    public:
+        explicit ZrleReader(const std::vector<uint8_t>& data)
+            : data_(data)
+            , position_{0}
+        {
+        }
+
+        bool Read(size_t size, const uint8_t** out)
+        {
+            if(data_.size() - position_ < size)
+                return false;
+
+            *out = data_.data() + position_;
+            position_ += size;
+            return true;
+        }
+
+        bool ReadPixel(uint32_t* pixel)
+        {
+            const uint8_t* bytes = nullptr;
+            if(!Read(COMPACT_PIXEL_SIZE, &bytes))
+                return false;
+
+            *pixel = GetPixel(bytes, COMPACT_PIXEL_SIZE);
+            return true;
+        }
+
+        bool ReadRunLength(uint32_t* length)
+        {
+            *length = 1;
+            const uint8_t* byte = nullptr;
+            do
+            {
+                if(!Read(1, &byte))
+                    return false;
+
+                *length += *byte;
+            }
+            while(*byte == 255);
+
+            return true;
+        }
+
+        bool IsAtEnd() const
+        {
+            return position_ == data_.size();
+        }
+
+    private:
+        const std::vector<uint8_t>& data_;
+        size_t position_;
+    };
+
+    bool Inflate(Decoder* decoder)
+    {
+        z_stream& stream = decoder->stream;
+        stream.next_in = decoder->compressed.data();
+        stream.avail_in = static_cast<uInt>(decoder->compressed.size());
+        decoder->data.clear();
+        uint8_t chunk[4096];
+        while(true)
+        {
+            stream.next_out = chunk;
+            stream.avail_out = sizeof(chunk);
+            const int result = inflate(&stream, Z_SYNC_FLUSH);
+            if(result != Z_OK && result != Z_BUF_ERROR)
+                return false;
+
+            decoder->data.insert(decoder->data.end(), chunk, chunk + (sizeof(chunk) - stream.avail_out));
+            if(stream.avail_in == 0 && stream.avail_out != 0)
+                return true;
+
+            if(result == Z_BUF_ERROR)
+                return false;
+        }
+    }
+
+    bool DecodeZrleTile(ZrleReader* reader, const vnc::Rect& tile, std::vector<uint32_t>* framebuffer, Update* update)
+    {
+        const uint8_t* bytes = nullptr;
+        if(!reader->Read(1, &bytes))
+            return false;
+
+        const uint8_t subencoding = *bytes;
+        update->tileTypes.insert(subencoding);
+        // 17 to 127 and 129 are not defined.
+        if((subencoding > 16 && subencoding < ZRLE_PLAIN_RLE) || subencoding == ZRLE_PLAIN_RLE + 1)
+            return false;
+
+        const size_t count = static_cast<size_t>(tile.width) * tile.height;
+        std::vector<uint32_t> pixels;
+        std::vector<uint32_t> palette(subencoding >= ZRLE_PLAIN_RLE ? subencoding - ZRLE_PLAIN_RLE : subencoding);
+        for(auto& entry: palette)
+        {
+            if(!reader->ReadPixel(&entry))
+                return false;
+        }
+
+        if(subencoding == ZRLE_RAW)
+        {
+            pixels.resize(count);
+            for(auto& pixel: pixels)
+            {
+                if(!reader->ReadPixel(&pixel))
+                    return false;
+            }
+        }
+        else if(subencoding == ZRLE_SOLID)
+        {
+            pixels.assign(count, palette.front());
+        }
+        else if(subencoding < ZRLE_PLAIN_RLE)
+        {
+            // Packed palette indices, rows starting on a byte boundary.
+            const int bits = palette.size() <= 2 ? 1 : palette.size() <= 4 ? 2 : 4;
+            const size_t rowSize = (static_cast<size_t>(tile.width) * bits + 7) / 8;
+            for(int y = 0; y < tile.height; ++y)
+            {
+                if(!reader->Read(rowSize, &bytes))
+                    return false;
+
+                for(int x = 0; x < tile.width; ++x)
+                {
+                    const int bit = x * bits;
+                    const size_t index = bytes[bit / 8] >> (8 - bits - bit % 8) & ((1 << bits) - 1);
+                    if(index >= palette.size())
+                        return false;
+
+                    pixels.push_back(palette[index]);
+                }
+            }
+        }
+        else
+        {
+            while(pixels.size() < count)
+            {
+                uint32_t pixel = 0;
+                uint32_t length = 1;
+                if(subencoding == ZRLE_PLAIN_RLE)
+                {
+                    if(!reader->ReadPixel(&pixel) || !reader->ReadRunLength(&length))
+                        return false;
+                }
+                else
+                {
+                    if(!reader->Read(1, &bytes) || (*bytes & 127) >= palette.size())
+                        return false;
+
+                    pixel = palette[*bytes & 127];
+                    if((*bytes & 128) != 0 && !reader->ReadRunLength(&length))
+                        return false;
+                }
+
+                if(length > count - pixels.size())
+                    return false;
+
+                pixels.insert(pixels.end(), length, pixel);
+            }
+        }
+
+        for(int y = 0; y < tile.height; ++y)
+        {
+            std::copy_n(pixels.begin() + static_cast<size_t>(y) * tile.width, tile.width,
+                framebuffer->begin() + static_cast<size_t>(tile.y + y) * FRAME_WIDTH + tile.x);
+        }
+
+        return true;
+    }
+
+    bool ReceiveZrle(vnc::Socket* socket, const vnc::Rect& rect, Decoder* decoder, std::vector<uint32_t>* framebuffer,
+        Update* update)
+    {
+        uint8_t length[4] = {};
+        if(!socket->Receive(length, sizeof(length)))
+            return false;
+
+        decoder->compressed.resize(vnc::GetU32(length));
+        if(!socket->Receive(decoder->compressed.data(), decoder->compressed.size()) || !Inflate(decoder))
+            return false;
+
+        ZrleReader reader{decoder->data};
+        for(int y = rect.y; y < rect.y + rect.height; y += vnc::rfb::ZRLE_TILE_SIZE)
+        {
+            for(int x = rect.x; x < rect.x + rect.width; x += vnc::rfb::ZRLE_TILE_SIZE)
+            {
+                const vnc::Rect tile{x, y, std::min(vnc::rfb::ZRLE_TILE_SIZE, rect.x + rect.width - x),
+                    std::min(vnc::rfb::ZRLE_TILE_SIZE, rect.y + rect.height - y)};
+                if(!DecodeZrleTile(&reader, tile, framebuffer, update))
+                {
+                    hmi_graphics::test::ReportFailure(__FILE__, __LINE__, "malformed ZRLE tile");
+                    return false;
+                }
+            }
+        }
+
+        HMI_CHECK(reader.IsAtEnd());
+        return true;
+    }
+#endif
+
+    // Decodes one FramebufferUpdate into framebuffer; every rect has to use the negotiated encoding.
+    Update ReceiveUpdate(vnc::Socket* socket, Decoder* decoder, std::vector<uint32_t>* framebuffer)
+    {
+        Update update{{}, {}, false};
+        uint8_t header[4] = {};
+        if(!socket->Receive(header, sizeof(header)))
+            return update;
+
+        HMI_CHECK_EQUAL(header[0], vnc::rfb::FRAMEBUFFER_UPDATE);
+        const uint16_t count = vnc::GetU16(header + 2);
+        for(uint16_t i = 0; i < count; ++i)
+        {
+            uint8_t rectHeader[12] = {};
+            if(!socket->Receive(rectHeader, sizeof(rectHeader)))
+                return update;
+
+            const vnc::Rect rect{vnc::GetU16(rectHeader), vnc::GetU16(rectHeader + 2), vnc::GetU16(rectHeader + 4),
+                vnc::GetU16(rectHeader + 6)};
+            const int32_t encoding = static_cast<int32_t>(vnc::GetU32(rectHeader + 8));
+            HMI_CHECK_EQUAL(encoding, decoder->encoding);
+            if(rect.x + rect.width > FRAME_WIDTH || rect.y + rect.height > FRAME_HEIGHT || encoding != decoder->encoding)
+            {
+                hmi_graphics::test::ReportFailure(__FILE__, __LINE__, "rect outside the frame or in another encoding");
+                return update;
+            }
+
+            bool received = false;
+            switch(encoding)
+            {
+            case vnc::ENCODING_HEXTILE:
+                received = ReceiveHextile(socket, rect, framebuffer, &update);
+                break;
+#if defined(VNC_HAVE_ZLIB)
+            case vnc::ENCODING_ZRLE:
+                received = ReceiveZrle(socket, rect, decoder, framebuffer, &update);
+                break;
+#endif
+            default:
+                received = ReceiveRaw(socket, rect, framebuffer);
+                break;
+            }
+
+            if(!received)
+                return update;
+
+            update.rects.push_back(rect);
+        }
+
+        update.valid = true;
+        return update;
+    }
+
+    size_t CountMismatches(const std::vector<uint32_t>& frame, const std::vector<uint32_t>& framebuffer)
+    {
+        size_t mismatches = 0;
+        for(size_t i = 0; i < frame.size(); ++i)
+        {
+            mismatches += ToClientPixel(frame[i]) != framebuffer[i] ? 1 : 0;
+        }
+
+        return mismatches;
+    }
+
+    void TestLoopback(int32_t encoding)
+    {
+        std::vector<uint32_t> frame = MakeFrame();
+        vnc::Server server;
+        const vnc::ServerOptions options{"127.0.0.1", 0, DESKTOP_NAME, 1};
+        if(!server.Start(options, FRAME_WIDTH, FRAME_HEIGHT, nullptr))
+        {
+            hmi_graphics::test::ReportFailure(__FILE__, __LINE__, "server.Start");
+            return;
+        }
+
+        server.UpdateFramebuffer(vnc::Framebuffer{frame.data(), FRAME_WIDTH, FRAME_HEIGHT, FRAME_WIDTH});
+        vnc::Socket socket;
+        if(!socket.Connect("127.0.0.1", server.GetPort()) || !Handshake(&socket))
+        {
+            hmi_graphics::test::ReportFailure(__FILE__, __LINE__, "connect and handshake");
+            return;
+        }
+
+        Decoder decoder{};
+        decoder.encoding = encoding;
+#if defined(VNC_HAVE_ZLIB)
+        if(inflateInit(&decoder.stream) != Z_OK)
+        {
+            hmi_graphics::test::ReportFailure(__FILE__, __LINE__, "inflateInit");
+            return;
+        }
+#endif
+
+        SendPixelFormatAndEncodings(&socket, encoding);
+        std::vector<uint32_t> framebuffer(frame.size());
+        RequestUpdate(&socket, false);
+        Update update = ReceiveUpdate(&socket, &decoder, &framebuffer);
+        HMI_CHECK(update.valid);
+        HMI_CHECK_EQUAL(CountMismatches(frame, framebuffer), 0u);
+        if(encoding == vnc::ENCODING_HEXTILE)
+        {
+            HMI_CHECK(update.tileTypes.count(HEXTILE_RAW) == 1);
+            HMI_CHECK(update.tileTypes.count(HEXTILE_BACKGROUND_SPECIFIED) == 1);
+            HMI_CHECK(update.tileTypes.count(HEXTILE_ANY_SUBRECTS | HEXTILE_FOREGROUND_SPECIFIED) == 1
+                || update.tileTypes.count(HEXTILE_ANY_SUBRECTS | HEXTILE_FOREGROUND_SPECIFIED
+                    | HEXTILE_BACKGROUND_SPECIFIED) == 1);
+            HMI_CHECK(update.tileTypes.count(HEXTILE_ANY_SUBRECTS | HEXTILE_SUBRECTS_COLOURED) == 1
+                || update.tileTypes.count(HEXTILE_ANY_SUBRECTS | HEXTILE_SUBRECTS_COLOURED
+                    | HEXTILE_BACKGROUND_SPECIFIED) == 1);
+        }
+        else if(encoding == vnc::ENCODING_ZRLE)
+        {
+            HMI_CHECK(update.tileTypes.count(ZRLE_SOLID) == 1);
+            HMI_CHECK(update.tileTypes.count(2) == 1);
+            HMI_CHECK(*update.tileTypes.rbegin() > ZRLE_PLAIN_RLE || update.tileTypes.count(ZRLE_PLAIN_RLE) == 1);
+        }
+
+        // Damage part of one diff tile; only that tile's part of the damage may come back.
+        const vnc::Rect damage{70, 10, 12, 9};
+        for(int y = damage.y; y < damage.y + damage.height; ++y)
+        {
+            std::fill_n(frame.begin() + y * FRAME_WIDTH + damage.x, damage.width, 0xFF2040C0u);
+        }
+
+        server.UpdateFramebuffer(vnc::Framebuffer{frame.data(), FRAME_WIDTH, FRAME_HEIGHT, FRAME_WIDTH}, &damage, 1);
+        RequestUpdate(&socket, true);
+        update = ReceiveUpdate(&socket, &decoder, &framebuffer);
+        HMI_CHECK(update.valid);
+        HMI_CHECK(!update.rects.empty());
+        int area = 0;
+        for(auto& rect: update.rects)
+        {
+            area += rect.width * rect.height;
+            HMI_CHECK(rect.x >= damage.x && rect.y >= damage.y && rect.x + rect.width <= damage.x + damage.width
+                && rect.y + rect.height <= damage.y + damage.height);
+            HMI_CHECK(rect.x / vnc::TILE_DIFF_SIZE == 1 && rect.y / vnc::TILE_DIFF_SIZE == 0);
+        }
+
+        HMI_CHECK_EQUAL(area, damage.width * damage.height);
+        HMI_CHECK_EQUAL(CountMismatches(frame, framebuffer), 0u);
+
+#if defined(VNC_HAVE_ZLIB)
+        inflateEnd(&decoder.stream);
+#endif
+        socket.Close();
+        server.Stop();
+    }
+}
+
+int main()
+{
+    if(!vnc::Socket::Startup())
+        return 1;
+
+    TestLoopback(vnc::ENCODING_RAW);
+    TestLoopback(vnc::ENCODING_HEXTILE);
+#if defined(VNC_HAVE_ZLIB)
+    TestLoopback(vnc::ENCODING_ZRLE);
+#endif
+    vnc::Socket::Cleanup();
+    return hmi_graphics::test::Finish("vnc_loopback_test");
+}